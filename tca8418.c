@@ -61,9 +61,484 @@
 #define GPIO_PULL2      0x2D //< GPIO Pull-up Disable 2 Register
 #define GPIO_PULL3      0x2E //< GPIO Pull-up Disable 3 Register
 
+/* Assertion evaluated at compile time, usable at file scope */
+#define TCA8418_STATIC_ASSERT(cond, name) typedef char tca8418_static_assert_##name[(cond) ? 1 : -1]
+
+/**
+ * Register fields are described by "register, shift, width" triples.
+ * TCA8418_FIELD() places a constant value in a field and fails to compile when the
+ * field belongs to another register or the value does not fit, so composed register
+ * values stay integer constants and compile to the same stores as literals.
+ */
+#define TCA8418_FIELD(reg, field, value)    TCA8418_FIELD_(reg, field, value)
+#define TCA8418_FIELD_(reg, fieldReg, shift, width, value) \
+    ((uint8_t)(((value) << (shift)) + \
+               0U * sizeof(char[(((fieldReg) == (reg)) && ((unsigned)(value) < (1U << (width)))) ? 1 : -1])))
+#define TCA8418_MASK(field)                 TCA8418_MASK_(field)
+#define TCA8418_MASK_(fieldReg, shift, width) ((uint8_t)(((1U << (width)) - 1U) << (shift)))
+
+/* Pin bits of a GPIO group register: ROW7:0 in group 1, COL7:0 in group 2, COL9:8 as bits 1:0 in group 3 */
+#define TCA8418_PIN(n)          (1U << (n))
+#define TCA8418_PINS(hi, lo)    (((1U << ((hi) - (lo) + 1)) - 1U) << (lo))
+
+/* CFG fields */
+#define FIELD_CFG_AI            CFG, 7, 1 //< Auto-increment for burst accesses
+#define FIELD_CFG_GPI_E_CFG     CFG, 6, 1 //< GPI events tracked while the keypad is locked
+#define FIELD_CFG_OVR_FLOW_M    CFG, 5, 1 //< FIFO overflow overwrites the oldest event
+#define FIELD_CFG_INT_CFG       CFG, 4, 1 //< INT deasserts for 50 us and reasserts while interrupts are pending
+#define FIELD_CFG_OVR_FLOW_IEN  CFG, 3, 1 //< FIFO overflow interrupt enable
+#define FIELD_CFG_K_LCK_IEN     CFG, 2, 1 //< Keypad lock interrupt enable
+#define FIELD_CFG_GPI_IEN       CFG, 1, 1 //< GPI interrupt enable
+#define FIELD_CFG_KE_IEN        CFG, 0, 1 //< Key events interrupt enable
+
+/* INT_STAT fields, write 1 to clear */
+#define FIELD_INT_STAT_CAD_INT      INT_STAT, 4, 1 //< CTRL-ALT-DEL interrupt
+#define FIELD_INT_STAT_OVR_FLOW_INT INT_STAT, 3, 1 //< FIFO overflow interrupt
+#define FIELD_INT_STAT_K_LCK_INT    INT_STAT, 2, 1 //< Keypad lock interrupt
+#define FIELD_INT_STAT_GPI_INT      INT_STAT, 1, 1 //< GPI interrupt
+#define FIELD_INT_STAT_K_INT        INT_STAT, 0, 1 //< Key events interrupt
+
+/* KEY_LCK_EC fields */
+#define FIELD_KEY_LCK_EC_KEC    KEY_LCK_EC, 0, 4 //< Events in the FIFO
+
+/* GPIO group fields used by the keypad configuration */
+#define FIELD_KP_GPIO1_ROW      KP_GPIO1, 0, 8     //< ROW7:0 in the keypad matrix
+#define FIELD_KP_GPIO2_COL      KP_GPIO2, 0, 8     //< COL7:0 in the keypad matrix
+#define FIELD_KP_GPIO3_COL      KP_GPIO3, 0, 2     //< COL9:8 in the keypad matrix
+#define FIELD_GPIO_INT_EN1_ROW  GPIO_INT_EN1, 0, 8 //< ROW7:0 GPI interrupt enable
+#define FIELD_GPIO_INT_EN2_COL  GPIO_INT_EN2, 0, 8 //< COL7:0 GPI interrupt enable
+#define FIELD_GPIO_INT_EN3_COL  GPIO_INT_EN3, 0, 2 //< COL9:8 GPI interrupt enable
+
+/* Keypad matrix: ROW0 and COL6:0, every other pin is a GPIO */
+#define KEYPAD_ROWS             TCA8418_PIN(0)
+#define KEYPAD_COLS             TCA8418_PINS(6, 0)
+#define KEYPAD_COLS_HI          0U
+
+/* Configuration bits */
+#define INT_CFG         TCA8418_FIELD(CFG, FIELD_CFG_INT_CFG, 1)
+
+/* Interrupt status bits */
+#define K_INT           TCA8418_FIELD(INT_STAT, FIELD_INT_STAT_K_INT, 1)
+#define OVR_FLOW_INT    TCA8418_FIELD(INT_STAT, FIELD_INT_STAT_OVR_FLOW_INT, 1)
+
+/* All interrupt status bits: CAD_INT, OVR_FLOW_INT, K_LCK_INT, GPI_INT, K_INT */
+#define INT_STAT_ALL    (TCA8418_MASK(FIELD_INT_STAT_CAD_INT) | TCA8418_MASK(FIELD_INT_STAT_OVR_FLOW_INT) | \
+                         TCA8418_MASK(FIELD_INT_STAT_K_LCK_INT) | TCA8418_MASK(FIELD_INT_STAT_GPI_INT) | \
+                         TCA8418_MASK(FIELD_INT_STAT_K_INT))
+
+/* Auto-increment bit of CFG */
+#define CFG_AI          TCA8418_FIELD(CFG, FIELD_CFG_AI, 1)
+
+/* Key events interrupt enable bit of CFG */
+#define KE_IEN          TCA8418_FIELD(CFG, FIELD_CFG_KE_IEN, 1)
+
+/* CFG after initialization, as in the original driver: key events interrupt enabled, INT latched.
+ * FIFO overflows are still seen in INT_STAT, they always come with a key event */
+#define CFG_DEFAULT     TCA8418_FIELD(CFG, FIELD_CFG_KE_IEN, 1)
+
+/* Register block GPIO_DAT_OUT1 to GPIO_PULL3 saved by the matrix diagnostic */
+#define DIAG_BLOCK_SIZE (GPIO_PULL3 - GPIO_DAT_OUT1 + 1)
+
+/* Key event counter field of KEY_LCK_EC */
+#define KEC_MASK        TCA8418_MASK(FIELD_KEY_LCK_EC_KEC)
+
+/* Transfers of an IT or DMA drain, each one started from the completion of the previous one */
+#define DRAIN_PHASE_FIFO    0 //< FIFO read
+#define DRAIN_PHASE_CLEAR   1 //< INT_STAT clear
+#define DRAIN_PHASE_COUNT   2 //< KEY_LCK_EC read of the latched mode recheck
+
+/* Register block GPIO_DAT_OUT1 to GPIO_DIR3 written back in one burst after a reattach */
+#define REATTACH_BLOCK_SIZE (GPIO_DIR3 - GPIO_DAT_OUT1 + 1)
+
+/* GPIO_INT_EN1 to KP_GPIO3 are written as one auto-increment burst */
+#define GPIO_CONFIG_SIZE 6
+TCA8418_STATIC_ASSERT((GPIO_INT_EN2 == GPIO_INT_EN1 + 1) && (GPIO_INT_EN3 == GPIO_INT_EN1 + 2) && (KP_GPIO1 == GPIO_INT_EN1 + 3) &&
+                      (KP_GPIO2 == GPIO_INT_EN1 + 4) && (KP_GPIO3 == GPIO_INT_EN1 + 5), gpio_config_adjacent);
+TCA8418_STATIC_ASSERT(CFG_DEFAULT == 0x01, cfg_default);
+
+#if (TCA8418_RING_SIZE & (TCA8418_RING_SIZE - 1)) || (TCA8418_RING_SIZE > 128)
+#error "TCA8418_RING_SIZE must be a power of two not larger than 128"
+#endif
+
+#if TCA8418_RING_RESUME_THRESHOLD > TCA8418_RING_SIZE
+#error "TCA8418_RING_RESUME_THRESHOLD must not exceed TCA8418_RING_SIZE"
+#endif
+
 /* Change this according to your I2C handle declared in main.c */
 extern I2C_HandleTypeDef hi2c1; 
 
+#if TCA8418_FEATURE_RING
+/* Event ring filled by TCA8418_ServiceInterrupt() and emptied by TCA8418_PopEvents() */
+static uint8_t eventRing[TCA8418_RING_SIZE];
+static volatile uint8_t ringHead;       //< Free-running write index, owned by the drain
+static volatile uint8_t ringTail;       //< Free-running read index, owned by the consumer
+static volatile uint8_t flowControl = 1;
+static volatile uint8_t throttled;      //< Events are being held in the chip FIFO
+static TCA8418_FlowStats flowStats;
+#endif
+
+#if TCA8418_STAMPS
+#if !TCA8418_FEATURE_RING
+#error "TCA8418_STAMPS requires TCA8418_FEATURE_RING"
+#endif
+/* Stage stamps of the events in eventRing, same index */
+static TCA8418_EventStamps ringStamps[TCA8418_RING_SIZE];
+static volatile uint32_t edgeCycles;    //< INT edge latched by TCA8418_IRQHandler()
+static volatile uint8_t edgePending;    //< edgeCycles belongs to the next drain
+static uint32_t stampInt;               //< INT stage of the drain in progress
+static uint8_t stampEdgeTaken;          //< stampInt is a latched edge, not the drain start
+static uint32_t stampDrain;
+static uint32_t stampFifo[TCA8418_FIFO_DEPTH]; //< One per event for per-register reads, one per read otherwise
+static uint8_t stampFifoCount;
+static uint32_t stampDequeue;
+/* Events taken from the ring and not yet handled, oldest first */
+static TCA8418_EventStamps takenStamps[TCA8418_RING_SIZE];
+static uint8_t takenHead;
+static uint8_t takenTail;
+static TCA8418_StageStats stageStats;
+#endif
+
+/* Shadow of the CFG register and the interrupt output mode it selects */
+static uint8_t cfgRegister = CFG_DEFAULT;
+static TCA8418_IntMode intMode = TCA8418_INT_LATCHED;
+
+/* Drain in progress, shared with the I2C callbacks for the IT and DMA strategies */
+#if TCA8418_FEATURE_RING || TCA8418_FEATURE_CALIBRATION
+static uint8_t drainBuffer[TCA8418_FIFO_DEPTH];
+#endif
+#if TCA8418_FEATURE_RING
+static uint8_t drainCount;              //< Events being read
+static uint8_t drainIntStatus;          //< Interrupt bits to clear once the events are in the ring
+static uint8_t drainPhase;              //< DRAIN_PHASE_* transfer of the IT or DMA drain in flight
+static uint8_t drainEventCount;         //< KEY_LCK_EC read by the IT latched mode recheck
+#endif
+static volatile uint8_t drainBusy;      //< IT or DMA drain in flight, from the FIFO read to the last chained transfer
+static TCA8418_DrainStrategy drainStrategy = TCA8418_DRAIN_PER_REGISTER;
+#if TCA8418_FEATURE_CALIBRATION
+static volatile uint8_t calibrating;    //< Read belongs to TCA8418_CalibrateDrain()
+static TCA8418_DrainCalibration drainCalibration;
+#define TCA8418_CALIBRATING() (calibrating)
+#else
+#define TCA8418_CALIBRATING() 0
+#endif
+
+/* Keypad matrix configuration of GPIO_INT_EN1 to KP_GPIO3. GPI interrupt enables only act on
+ * GPIO pins: the keypad pins' bits are set and ignored, GPIO pins stay disabled */
+static const uint8_t gpioConfigDefault[GPIO_CONFIG_SIZE] = {
+    TCA8418_FIELD(GPIO_INT_EN1, FIELD_GPIO_INT_EN1_ROW, KEYPAD_ROWS),
+    TCA8418_FIELD(GPIO_INT_EN2, FIELD_GPIO_INT_EN2_COL, KEYPAD_COLS),
+    TCA8418_FIELD(GPIO_INT_EN3, FIELD_GPIO_INT_EN3_COL, KEYPAD_COLS_HI),
+    TCA8418_FIELD(KP_GPIO1, FIELD_KP_GPIO1_ROW, KEYPAD_ROWS),
+    TCA8418_FIELD(KP_GPIO2, FIELD_KP_GPIO2_COL, KEYPAD_COLS),
+    TCA8418_FIELD(KP_GPIO3, FIELD_KP_GPIO3_COL, KEYPAD_COLS_HI)
+};
+
+/* Shadow of GPIO_INT_EN1 to KP_GPIO3 as last written, locking changes it */
+static uint8_t gpioConfig[GPIO_CONFIG_SIZE];
+#define GPIO_CONFIG(reg) gpioConfig[(reg) - GPIO_INT_EN1]
+
+#if TCA8418_FEATURE_HOTPLUG
+static volatile uint8_t devicePresent = 1;
+static volatile uint8_t detachPending;  //< Detach seen by a transaction, reported by TCA8418_PollPresence()
+static uint32_t lastProbeTick;
+static TCA8418_PresenceCallback presenceCallback;
+static TCA8418_PresenceStats presenceStats;
+#endif
+
+#if TCA8418_FEATURE_ASYNC_INIT
+/**
+ * @brief One configuration write of TCA8418_InitAsync()
+ */
+typedef struct {
+    uint8_t reg;        //< First register
+    uint8_t *data;      //< Values, must stay valid while the transfer is in flight
+    uint8_t length;     //< Registers written
+} TCA8418_InitStep;
+
+/* CFG written first with only AI set and last with cfgRegister, as in TCA8418_Init() */
+static uint8_t initCfg[2] = {CFG_AI, CFG_DEFAULT};
+static const TCA8418_InitStep initSteps[] = {
+    {CFG, &initCfg[0], 1},
+    {GPIO_INT_EN1, gpioConfig, GPIO_CONFIG_SIZE},
+    {CFG, &initCfg[1], 1}
+};
+#define INIT_STEPS (sizeof(initSteps) / sizeof(initSteps[0]))
+
+static volatile TCA8418_InitState initState;
+static uint8_t initStep;                //< Index of the write in flight
+static uint8_t initAttempt;             //< Attempts of the write in flight so far
+static TCA8418_ReadyCallback readyCallback;
+static TCA8418_BootStats bootStats;
+#endif
+
+#if TCA8418_FEATURE_OUTPUTS
+/* Output frame buffer in the layout of GPIO_DAT_OUT1 to GPIO_DAT_OUT3 */
+static volatile uint8_t outFrame[3];    //< Levels requested by the application
+static uint8_t outWritten[3];           //< Levels last written to GPIO_DAT_OUT1 to GPIO_DAT_OUT3
+static uint8_t outDir[3];               //< Shadow of GPIO_DIR1 to GPIO_DIR3
+static uint32_t lastFrameTick;
+static TCA8418_OutputStats outputStats;
+#endif
+
+#if TCA8418_FEATURE_DEFERRED
+/* Request latched by TCA8418_IRQHandler() for TCA8418_DeferredHandler() */
+static volatile uint8_t drainRequested;
+/* Drain refused with HAL_BUSY by a blocking transaction it preempted, pended again when that ends */
+static volatile uint8_t drainBlocked;
+static TCA8418_DeferredStats deferredStats;
+#endif
+
+#if TCA8418_FEATURE_HOTPLUG
+#define TCA8418_PRESENT() (devicePresent)
+#else
+#define TCA8418_PRESENT() 1
+#endif
+
+/**
+ * @brief Mark the TCA8418 detached when it stopped acknowledging
+ * @param status Status of the last attempt of a transaction
+ * @note An acknowledge failure left after the retries means nothing answers at the address.
+ *       Bus timeouts are not taken as a detach, they point at the bus rather than the board.
+ */
+static inline void TCA8418_CheckPresence(HAL_StatusTypeDef status){
+#if TCA8418_FEATURE_HOTPLUG
+    if((status == HAL_ERROR) && devicePresent && ((HAL_I2C_GetError(&hi2c1) & HAL_I2C_ERROR_AF) != 0)){
+        devicePresent = 0;
+        detachPending = 1;
+        presenceStats.detaches++;
+    }
+#else
+    (void)status;
+#endif
+}
+
+#if TCA8418_STAMPS
+/**
+ * @brief Convert the cycles between two stamps to a stored interval
+ * @param from Earlier stamp
+ * @param to Later stamp
+ * @return uint16_t Interval in units of 2^TCA8418_STAMP_SHIFT cycles, 0xFFFF if it does not fit
+ */
+static inline uint16_t TCA8418_StampInterval(uint32_t from, uint32_t to){
+    uint32_t units = (to - from) >> TCA8418_STAMP_SHIFT;
+    return (units >= 0xFFFF) ? 0xFFFF : (uint16_t)units;
+}
+
+/**
+ * @brief Rebuild the time of a stage from the stored intervals
+ * @param stamps Stamps of the event
+ * @param stage Stage to rebuild
+ * @return uint32_t Cycles at the stage, exact to 2^TCA8418_STAMP_SHIFT cycles per interval
+ */
+static inline uint32_t TCA8418_StampAt(const TCA8418_EventStamps *stamps, TCA8418_Stage stage){
+    uint32_t cycles = stamps->intCycles;
+    for(uint8_t i = 0; i < stage; i++){
+        cycles += (uint32_t)stamps->interval[i] << TCA8418_STAMP_SHIFT;
+    }
+    return cycles;
+}
+#endif
+
+/**
+ * @brief Open the EXTI handler span of a drain called from a device interrupt
+ * @return uint8_t 1 if the span was opened, to be passed to TCA8418_TraceIrqExit()
+ * @note Exception numbers 16 and up are device interrupts such as EXTI. PendSV, where
+ *       TCA8418_DeferredHandler() runs its drains, and the main loop open no span.
+ */
+static inline uint8_t TCA8418_TraceIrqEnter(void){
+#if TCA8418_TRACE
+    if(__get_IPSR() >= 16U){
+        TCA8418_TRACE_INSTANT(TCA8418_TRACE_INT, 0, 0);
+        TCA8418_TRACE_BEGIN(TCA8418_TRACE_ISR, 0, 0);
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief Close the span opened by TCA8418_TraceIrqEnter()
+ * @param entered Return value of TCA8418_TraceIrqEnter()
+ * @param events Events read by the drain
+ */
+static inline void TCA8418_TraceIrqExit(uint8_t entered, uint8_t events){
+    if(entered){
+        TCA8418_TRACE_END(TCA8418_TRACE_ISR, 0, events);
+    }
+    (void)events;
+}
+
+/**
+ * @brief Stamp the INT edge of the next drain
+ * @param cycles Cycles at the edge
+ * @note Coalesced edges keep the oldest stamp, it is the one the first event waited for.
+ */
+static inline void TCA8418_StampEdge(uint32_t cycles){
+#if TCA8418_STAMPS
+    if(!edgePending){
+        edgeCycles = cycles;
+        edgePending = 1;
+    }
+#else
+    (void)cycles;
+#endif
+}
+
+/**
+ * @brief Stamp the start of a drain
+ * @note Without a latched edge the drain runs from the EXTI callback and the edge is taken as now.
+ */
+static inline void TCA8418_StampDrain(void){
+#if TCA8418_STAMPS
+    stampDrain = TCA8418_GetCycles();
+    stampEdgeTaken = edgePending;
+    stampInt = edgePending ? edgeCycles : stampDrain;
+    edgePending = 0;
+#endif
+}
+
+/**
+ * @brief Give the INT edge taken by a drain that could not read INT_STAT back to the next drain
+ * @note A drain refused with HAL_BUSY, e.g. while the application holds hi2c1, is retried
+ *       later, and the retry must still see the edge the events have waited since.
+ */
+static inline void TCA8418_StampDrainRefused(void){
+#if TCA8418_STAMPS
+    if(stampEdgeTaken){
+        edgeCycles = stampInt;
+        edgePending = 1;
+    }
+#endif
+}
+
+/**
+ * @brief Stamp a completed FIFO read
+ * @param index Index of the first event the read returned
+ */
+static inline void TCA8418_StampFifo(uint8_t index){
+#if TCA8418_STAMPS
+    stampFifo[index] = TCA8418_GetCycles();
+    stampFifoCount = (uint8_t)(index + 1);
+#else
+    (void)index;
+#endif
+}
+
+/**
+ * @brief Store the stamps of an event put in the ring
+ * @param slot Ring slot of the event
+ * @param index Index of the event in the drain
+ * @param enqueue Cycles at the enqueue, read once per drain
+ */
+static inline void TCA8418_StampEnqueue(uint8_t slot, uint8_t index, uint32_t enqueue){
+#if TCA8418_STAMPS
+    TCA8418_EventStamps *stamps = &ringStamps[slot];
+    uint32_t fifo = stampFifo[(index < stampFifoCount) ? index : (uint8_t)(stampFifoCount - 1)];
+    stamps->intCycles = stampInt;
+    stamps->interval[TCA8418_STAGE_DRAIN - 1] = TCA8418_StampInterval(stampInt, stampDrain);
+    stamps->interval[TCA8418_STAGE_FIFO - 1] = TCA8418_StampInterval(stampDrain, fifo);
+    stamps->interval[TCA8418_STAGE_ENQUEUE - 1] = TCA8418_StampInterval(fifo, enqueue);
+#else
+    (void)slot;
+    (void)index;
+    (void)enqueue;
+#endif
+}
+
+/**
+ * @brief Move the stamps of an event taken from the ring to the unhandled events
+ * @param slot Ring slot of the event
+ * @param first 1 for the first event of the take, which reads the cycle counter
+ */
+static inline void TCA8418_StampDequeue(uint8_t slot, uint8_t first){
+#if TCA8418_STAMPS
+    TCA8418_EventStamps *stamps;
+    if(first){
+        stampDequeue = TCA8418_GetCycles();
+    }
+    if((uint8_t)(takenHead - takenTail) == TCA8418_RING_SIZE){
+        /* Never marked handled, the oldest is forgotten */
+        takenTail++;
+    }
+    stamps = &takenStamps[takenHead & (TCA8418_RING_SIZE - 1)];
+    *stamps = ringStamps[slot];
+    stamps->interval[TCA8418_STAGE_DEQUEUE - 1] =
+        TCA8418_StampInterval(TCA8418_StampAt(stamps, TCA8418_STAGE_ENQUEUE), stampDequeue);
+    takenHead++;
+#else
+    (void)slot;
+    (void)first;
+#endif
+}
+
+/**
+ * @brief Record delivered key events in the boot and reattach timing
+ * @param count Events delivered
+ */
+static inline void TCA8418_NoteEvents(uint8_t count){
+    if(count == 0){
+        return;
+    }
+#if TCA8418_FEATURE_ASYNC_INIT
+    if(!bootStats.firstEvent){
+        bootStats.firstEventCycles = TCA8418_GetCycles();
+        bootStats.firstEvent = 1;
+    }
+#endif
+#if TCA8418_FEATURE_HOTPLUG
+    if((presenceStats.reattaches > 0) && !presenceStats.firstEvent){
+        presenceStats.firstEventCycles = TCA8418_GetCycles();
+        presenceStats.firstEvent = 1;
+    }
+#endif
+}
+
+/**
+ * @brief Check whether a failed blocking transaction may be attempted again
+ * @param status Status of the transaction
+ * @param attempt Attempts made so far, starting at 0
+ * @return uint8_t 1 if the TCA8418 did not acknowledge and retries are left, otherwise 0
+ * @note Only an acknowledge failure is retried. It happens before any data byte,
+ *       so no event has been popped from the FIFO and the retry loses nothing.
+ */
+static inline uint8_t TCA8418_Retry(HAL_StatusTypeDef status, uint8_t attempt){
+#if TCA8418_I2C_RETRIES > 0
+    return (status == HAL_ERROR) && (attempt < TCA8418_I2C_RETRIES) &&
+           ((HAL_I2C_GetError(&hi2c1) & HAL_I2C_ERROR_AF) != 0);
+#else
+    (void)status;
+    (void)attempt;
+    return 0;
+#endif
+}
+
+#if TCA8418_FEATURE_DEFERRED
+/**
+ * @brief Pend the software interrupt that runs TCA8418_DeferredHandler()
+ */
+static inline void TCA8418_PendDeferred(void){
+#ifdef TCA8418_DEFERRED_IRQn
+    NVIC_SetPendingIRQ(TCA8418_DEFERRED_IRQn);
+#else
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#endif
+}
+#endif
+
+/**
+ * @brief Run the deferred drain refused while the bus was held by the code it preempted
+ * @note Called when a blocking transaction or an IT transfer ends. The deferred handler cannot
+ *       wait for a transaction of the code it preempted, so it leaves drainBlocked set instead.
+ */
+static inline void TCA8418_RetryBlocked(void){
+#if TCA8418_FEATURE_DEFERRED
+    if(drainBlocked){
+        drainBlocked = 0;
+        TCA8418_PendDeferred();
+    }
+#endif
+}
+
 /**
  * @brief Read data from TCA8418 register(s)
  * @param reg Register address to read from
@@ -72,7 +547,21 @@ extern I2C_HandleTypeDef hi2c1;
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
  */
 static inline HAL_StatusTypeDef TCA8418_ReadRegister(uint8_t reg, uint8_t *data, uint16_t length){
-    return HAL_I2C_Mem_Read(&hi2c1, (TCA8418_ADDRESS << 1), reg, I2C_MEMADD_SIZE_8BIT, data, length, HAL_MAX_DELAY);
+    HAL_StatusTypeDef status;
+    if(!TCA8418_PRESENT()){
+        return HAL_ERROR;
+    }
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_READ, reg, length);
+    for(uint8_t attempt = 0; ; attempt++){
+        status = HAL_I2C_Mem_Read(&hi2c1, (TCA8418_ADDRESS << 1), reg, I2C_MEMADD_SIZE_8BIT, data, length, TCA8418_I2C_TIMEOUT);
+        if(!TCA8418_Retry(status, attempt)){
+            break;
+        }
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, reg, length);
+    TCA8418_CheckPresence(status);
+    TCA8418_RetryBlocked();
+    return status;
 }   
 
 /**
@@ -83,7 +572,63 @@ static inline HAL_StatusTypeDef TCA8418_ReadRegister(uint8_t reg, uint8_t *data,
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
  */
 static inline HAL_StatusTypeDef TCA8418_WriteRegister(uint8_t reg, uint8_t *data, uint16_t length){
-    return HAL_I2C_Mem_Write(&hi2c1, (TCA8418_ADDRESS << 1), reg, I2C_MEMADD_SIZE_8BIT, data, length, HAL_MAX_DELAY);
+    HAL_StatusTypeDef status;
+    if(!TCA8418_PRESENT()){
+        return HAL_ERROR;
+    }
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_WRITE, reg, length);
+    for(uint8_t attempt = 0; ; attempt++){
+        status = HAL_I2C_Mem_Write(&hi2c1, (TCA8418_ADDRESS << 1), reg, I2C_MEMADD_SIZE_8BIT, data, length, TCA8418_I2C_TIMEOUT);
+        if(!TCA8418_Retry(status, attempt)){
+            break;
+        }
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, reg, length);
+    TCA8418_CheckPresence(status);
+    TCA8418_RetryBlocked();
+    return status;
+}
+
+/**
+ * @brief Read events from the TCA8418 FIFO with the given strategy
+ * @param strategy Drain strategy to use
+ * @param data Pointer to store the events
+ * @param count Number of events to read
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Burst, IT and DMA reads fetch all events in one transaction. With CFG.AI = 0
+ *       the register address does not increment, so every byte is popped from KEY_EVENT_A.
+ *       IT and DMA reads only start the transfer, which completes in TCA8418_I2C_MemRxCpltCallback().
+ */
+static HAL_StatusTypeDef TCA8418_ReadFIFO(TCA8418_DrainStrategy strategy, uint8_t *data, uint8_t count){
+    HAL_StatusTypeDef status;
+    switch(strategy){
+    case TCA8418_DRAIN_PER_REGISTER:
+        for(uint8_t i = 0; i < count; i++){
+            status = TCA8418_ReadRegister(KEY_EVENT_A, &data[i], 1);
+            if(status != HAL_OK){
+                return status;
+            }
+            TCA8418_StampFifo(i);
+        }
+        return HAL_OK;
+    case TCA8418_DRAIN_BURST:
+        status = TCA8418_ReadRegister(KEY_EVENT_A, data, count);
+        if(status == HAL_OK){
+            TCA8418_StampFifo(0);
+        }
+        return status;
+#if TCA8418_FEATURE_RING
+    case TCA8418_DRAIN_IT:
+        /* The transfer ends in TCA8418_I2C_MemRxCpltCallback() or TCA8418_I2C_ErrorCallback() */
+        TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_READ, KEY_EVENT_A, count);
+        return HAL_I2C_Mem_Read_IT(&hi2c1, (TCA8418_ADDRESS << 1), KEY_EVENT_A, I2C_MEMADD_SIZE_8BIT, data, count);
+    case TCA8418_DRAIN_DMA:
+        TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_READ, KEY_EVENT_A, count);
+        return HAL_I2C_Mem_Read_DMA(&hi2c1, (TCA8418_ADDRESS << 1), KEY_EVENT_A, I2C_MEMADD_SIZE_8BIT, data, count);
+#endif
+    default:
+        return HAL_ERROR;
+    }
 }
 
 /**
@@ -91,31 +636,17 @@ static inline HAL_StatusTypeDef TCA8418_WriteRegister(uint8_t reg, uint8_t *data
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
  * @note This function configures the TCA8418 for keypad operation with pins ROW0 and COL6:0.(7 keys in total)   
  *       It also configures other unused pins as GPIO inputs with pull-up enabled without interrupts.
+ *       CFG is left with only AI set, so GPIO_INT_EN1 to KP_GPIO3 are written in one burst.
+ *       TCA8418_EnableInterrupt() restores CFG.
  */
 static inline HAL_StatusTypeDef TCA8418_KPConfig(void){
     HAL_StatusTypeDef status;
-    uint8_t data = 0x01; // ROW0[0] = 1 -> Keypad row is selected
-    status = TCA8418_WriteRegister(KP_GPIO1, &data, 1);
-    if(status != HAL_OK){
-        return status;
-    }
-    data = 0x7F; // COL6:0[6:0] = 1 -> Keypad columns are selected
-    status = TCA8418_WriteRegister(KP_GPIO2, &data, 1);
-    if(status != HAL_OK){
-        return status;
-    }   
-    data = 0x01; // R7:1IE[7:1] = 0 -> Row7:1 interrupts are disabled
-        status = TCA8418_WriteRegister(GPIO_INT_EN1, &data, 1);
-    if(status != HAL_OK){
-        return status;
-    }
-    data = 0x7F; // C7IE[7] = 0 -> Column7 interrupt is disabled
-    status = TCA8418_WriteRegister(GPIO_INT_EN2, &data, 1);
+    uint8_t data = CFG_AI; // Interrupts stay disabled while the matrix is configured
+    status = TCA8418_WriteRegister(CFG, &data, 1);
     if(status != HAL_OK){
         return status;
     }
-    data = 0x00; // C9:8IE[1:0] = 0 -> Column9:8 interrupts are disabled
-    status = TCA8418_WriteRegister(GPIO_INT_EN3, &data, 1);
+    status = TCA8418_WriteRegister(GPIO_INT_EN1, gpioConfig, GPIO_CONFIG_SIZE);
     if(status != HAL_OK){
         return status;
     }
@@ -128,7 +659,7 @@ static inline HAL_StatusTypeDef TCA8418_KPConfig(void){
  */ 
 static inline HAL_StatusTypeDef TCA8418_EnableInterrupt(void){
     HAL_StatusTypeDef status;
-    uint8_t data = 0x01; // KE_IEN[0] = 1
+    uint8_t data = cfgRegister; // INT_CFG per interrupt mode, KE_IEN set, AI cleared
     status = TCA8418_WriteRegister(CFG, &data, 1);
     if(status != HAL_OK){
         return status;
@@ -137,15 +668,41 @@ static inline HAL_StatusTypeDef TCA8418_EnableInterrupt(void){
 }
 
 /**
- * @brief Initialize TCA8418 with key events interrupt enabled
+ * @brief Load the default keypad configuration into the shadow registers
+ * @note Initialization also assumes the TCA8418 is fitted until a transaction shows otherwise.
+ */
+static inline void TCA8418_ResetConfig(void){
+    for(uint8_t i = 0; i < GPIO_CONFIG_SIZE; i++){
+        gpioConfig[i] = gpioConfigDefault[i];
+    }
+#if TCA8418_FEATURE_HOTPLUG
+    devicePresent = 1;
+    detachPending = 0;
+#endif
+}
+
+/**
+ * @brief Configure the keypad and enable its interrupts with blocking transfers
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
  */
-HAL_StatusTypeDef TCA8418_Init(void){
+static HAL_StatusTypeDef TCA8418_Configure(void){
     HAL_StatusTypeDef status;
     status = TCA8418_KPConfig();
     if(status != HAL_OK){
         return status;
     }
+#if TCA8418_AUTOTUNE_BATCH > 0
+    /* Burst FIFO reads need AI cleared, interrupts stay disabled until calibration is done */
+    uint8_t data = 0x00;
+    status = TCA8418_WriteRegister(CFG, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }
+    status = TCA8418_CalibrateDrain(TCA8418_AUTOTUNE_BATCH);
+    if(status != HAL_OK){
+        return status;
+    }
+#endif
     status = TCA8418_EnableInterrupt();
     if(status != HAL_OK){
         return status;
@@ -153,28 +710,169 @@ HAL_StatusTypeDef TCA8418_Init(void){
     return HAL_OK;
 }
 
+#if TCA8418_FEATURE_ASYNC_INIT
 /**
- * @brief Read key events from TCA8418 FIFO
+ * @brief Record the start of the initialization in the boot timing
+ */
+static void TCA8418_BootStart(void){
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+    /* Keeps counting if the application already started the counter at reset */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    bootStats.initStartCycles = TCA8418_GetCycles();
+    bootStats.ready = 0;
+    bootStats.firstEvent = 0;
+}
+
+/**
+ * @brief Record the end of the initialization and report it
+ * @param status HAL_OK once configured, otherwise error code
+ */
+static void TCA8418_BootReady(HAL_StatusTypeDef status){
+    if(status == HAL_OK){
+        bootStats.readyCycles = TCA8418_GetCycles();
+        bootStats.ready = 1;
+        initState = TCA8418_INIT_READY;
+    } else {
+        initState = TCA8418_INIT_FAILED;
+    }
+}
+
+/**
+ * @brief Start the current write of TCA8418_InitAsync()
+ * @return HAL_StatusTypeDef HAL_OK if the transfer started, otherwise error code
+ */
+static HAL_StatusTypeDef TCA8418_InitAsyncWrite(void){
+    const TCA8418_InitStep *step = &initSteps[initStep];
+    HAL_StatusTypeDef status;
+    /* The transfer ends in TCA8418_I2C_MemTxCpltCallback() or TCA8418_I2C_ErrorCallback() */
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_WRITE, step->reg, step->length);
+    status = HAL_I2C_Mem_Write_IT(&hi2c1, (TCA8418_ADDRESS << 1), step->reg, I2C_MEMADD_SIZE_8BIT, step->data, step->length);
+    if(status != HAL_OK){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, step->reg, 0);
+    }
+    return status;
+}
+
+/**
+ * @brief End TCA8418_InitAsync() and call the ready callback
+ * @param status HAL_OK once configured, otherwise error code
+ */
+static void TCA8418_InitAsyncDone(HAL_StatusTypeDef status){
+    TCA8418_BootReady(status);
+    TCA8418_RetryBlocked();
+    if(readyCallback != NULL){
+        readyCallback(status);
+    }
+}
+#endif
+
+/**
+ * @brief Initialize TCA8418 with key events interrupt enabled
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_Init(void){
+    HAL_StatusTypeDef status;
+#if TCA8418_FEATURE_ASYNC_INIT
+    if(initState == TCA8418_INIT_BUSY){
+        return HAL_BUSY;
+    }
+    TCA8418_BootStart();
+    initState = TCA8418_INIT_BUSY;
+#endif
+    TCA8418_ResetConfig();
+    status = TCA8418_Configure();
+#if TCA8418_FEATURE_ASYNC_INIT
+    TCA8418_BootReady(status);
+#endif
+    return status;
+}
+
+#if TCA8418_FEATURE_ASYNC_INIT
+/**
+ * @brief Start the initialization with interrupt driven transfers and return
+ * @param callback Called when the configuration is complete or failed, NULL to poll TCA8418_GetInitState()
+ * @return HAL_StatusTypeDef HAL_OK if the first transfer started, HAL_BUSY if the bus is in use, otherwise error code
+ * @note Writes the same registers as TCA8418_Init() in three transfers chained from
+ *       TCA8418_I2C_MemTxCpltCallback(), so the caller can bring up other peripherals meanwhile.
+ *       Drain calibration is not run, call TCA8418_CalibrateDrain() once ready if needed.
+ *       Blocking driver calls return HAL_BUSY while a transfer is in flight.
+ */
+HAL_StatusTypeDef TCA8418_InitAsync(TCA8418_ReadyCallback callback){
+    HAL_StatusTypeDef status;
+    if((initState == TCA8418_INIT_BUSY) || drainBusy){
+        return HAL_BUSY;
+    }
+    readyCallback = callback;
+    TCA8418_ResetConfig();
+    initCfg[1] = cfgRegister;
+    initStep = 0;
+    initAttempt = 0;
+    TCA8418_BootStart();
+    initState = TCA8418_INIT_BUSY;
+    status = TCA8418_InitAsyncWrite();
+    if(status != HAL_OK){
+        initState = TCA8418_INIT_FAILED;
+    }
+    return status;
+}
+
+/**
+ * @brief Get the progress of the initialization
+ * @return TCA8418_InitState Current state
+ */
+TCA8418_InitState TCA8418_GetInitState(void){
+    return initState;
+}
+
+/**
+ * @brief Get the boot timing
+ * @param stats Pointer to store the timing
+ * @note TCA8418_GetCycles() counts from when the DWT counter was started. Start it at the top
+ *       of main() for times since reset, readyCycles - initStartCycles is the configuration time.
+ */
+void TCA8418_GetBootStats(TCA8418_BootStats *stats){
+    *stats = bootStats;
+}
+#endif
+
+
+/**
+ * @brief Make INT assert again with a new edge while it stays asserted in latched mode
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note KE_IEN is cleared and set again, INT follows it.
+ */
+static HAL_StatusTypeDef TCA8418_PulseInterrupt(void){
+    HAL_StatusTypeDef status;
+    uint8_t data = (uint8_t)(cfgRegister & (uint8_t)~KE_IEN);
+    status = TCA8418_WriteRegister(CFG, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }
+    data = cfgRegister;
+    return TCA8418_WriteRegister(CFG, &data, 1);
+}
+
+/**
+ * @brief Blocking drain of TCA8418_ReadKeyEvents()
  * @param keyEvents Array to store key events (up to 10 events)
  * @param numEvents Pointer to store number of events read
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
- * @note This function reads all pending key events from the FIFO.
- *       Each event is stored as a byte where:
- *       - Bits 6:0 indicate the key number (0-80 for keypad, 97-114 for GPIO)
- *       - Bit 7 indicates event type (0=release, 1=press)
  */
-HAL_StatusTypeDef TCA8418_ReadKeyEvents(uint8_t *keyEvents, uint8_t *numEvents) {
+static HAL_StatusTypeDef TCA8418_ReadKeyEventsDrain(uint8_t *keyEvents, uint8_t *numEvents){
     HAL_StatusTypeDef status;
     uint8_t intStatus;
     uint8_t eventCount;
+    uint8_t total = 0;
+    *numEvents = 0;
     /* First check if there are any interrupts */
     status = TCA8418_ReadRegister(INT_STAT, &intStatus, 1);
     if(status != HAL_OK){
         return status;
     }
     /* Check if there are key events (KE_INT bit) */
-    if(!(intStatus & 0x01)){
-        *numEvents = 0;
+    if(!(intStatus & K_INT)){
         return HAL_OK; // No events
     }
     /* Read the event counter */
@@ -182,69 +880,1386 @@ HAL_StatusTypeDef TCA8418_ReadKeyEvents(uint8_t *keyEvents, uint8_t *numEvents)
     if(status != HAL_OK){
         return status;
     }
-    /* Limit to maximum 10 events */
-    if(eventCount > 10){
-        eventCount = 10;
-    }
-    /* Read all events from FIFO */
-    for(uint8_t i = 0; i < eventCount; i++){
-        status = TCA8418_ReadRegister(KEY_EVENT_A, &keyEvents[i], 1);
+    eventCount &= KEC_MASK;
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_DRAIN, 0, eventCount);
+    /* Clear KE_INT and OVR_FLOW_INT in one write by writing 1 to their bits */
+    intStatus &= (K_INT | OVR_FLOW_INT);
+    for(;;){
+        /* Limit to the space left of the 10 events */
+        if(eventCount > TCA8418_FIFO_DEPTH - total){
+            eventCount = TCA8418_FIFO_DEPTH - total;
+        }
+        /* Read the events from FIFO, this call blocks so IT and DMA fall back to a burst read */
+        if(eventCount > 0){
+            status = TCA8418_ReadFIFO((drainStrategy == TCA8418_DRAIN_PER_REGISTER) ? TCA8418_DRAIN_PER_REGISTER : TCA8418_DRAIN_BURST,
+                                      &keyEvents[total], eventCount);
+            if(status != HAL_OK){
+                break;
+            }
+            total += eventCount;
+        }
+        status = TCA8418_WriteRegister(INT_STAT, &intStatus, 1);
+        if((status != HAL_OK) || (intMode == TCA8418_INT_REASSERT)){
+            break;
+        }
+        /* Latched mode: events that arrived since the count was read keep INT asserted without an edge */
+        status = TCA8418_ReadRegister(KEY_LCK_EC, &eventCount, 1);
         if(status != HAL_OK){
-            return status;
+            break;
         }
+        eventCount &= KEC_MASK;
+        if(eventCount == 0){
+            break;
+        }
+        if(total == TCA8418_FIFO_DEPTH){
+            status = TCA8418_PulseInterrupt();
+            break;
+        }
+        intStatus = K_INT;
     }
-    *numEvents = eventCount;
-    /* Clear the interrupt by writing 1 to KE_INT bit */
-    intStatus = 0x01;
-    status = TCA8418_WriteRegister(INT_STAT, &intStatus, 1);
-    if(status != HAL_OK){   
-        return status;
-    }
-    return HAL_OK;
+    *numEvents = total;
+    TCA8418_NoteEvents(total);
+    TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, total);
+    return status;
 }
 
 /**
- * @brief Lock TCA8418 keypad except POWER key
+ * @brief Read key events from TCA8418 FIFO
+ * @param keyEvents Array to store key events (up to 10 events)
+ * @param numEvents Pointer to store number of events read, also the events read before a failure
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
- * @note This function disables all keypad columns except column 0 (POWER key)
+ * @note This function reads all pending key events from the FIFO.
+ *       Each event is stored as a byte where:
+ *       - Bits 6:0 indicate the key number (0-80 for keypad, 97-114 for GPIO)
+ *       - Bit 7 indicates event type (0=release, 1=press)
+ *       In reassert mode events arriving during the read pulse INT again. In latched mode,
+ *       the default, they leave INT asserted without a new edge, so the event counter is
+ *       read again after the clear and the new events are read in the same call. If
+ *       keyEvents is already full, INT is pulsed so the next call is triggered by a new edge.
  */
-HAL_StatusTypeDef TCA8418_LockKeypad(void){
-    HAL_StatusTypeDef status;
-    uint8_t data;
-    /* Enable only column 0 (POWER key) for keypad operation */
-    data = 0x01; // COL0[0] = 1 -> Enable column 0 for keypad
-    status = TCA8418_WriteRegister(KP_GPIO2, &data, 1);
-    if(status != HAL_OK){
-        return status;
-    }   
-    /* Disable interrupt for all columns except column 0 */
-    data = 0x7F; // C7:1IE[7:1] = 0 -> Disable interrupts for columns 1-7
-    status = TCA8418_WriteRegister(GPIO_INT_EN2, &data, 1);
-    if(status != HAL_OK){
-        return status;
-    }   
-    return HAL_OK;
-}   
+HAL_StatusTypeDef TCA8418_ReadKeyEvents(uint8_t *keyEvents, uint8_t *numEvents) {
+    uint8_t traced = TCA8418_TraceIrqEnter();
+    HAL_StatusTypeDef status = TCA8418_ReadKeyEventsDrain(keyEvents, numEvents);
+    TCA8418_TraceIrqExit(traced, *numEvents);
+    return status;
+}
 
+#if TCA8418_FEATURE_RING
 /**
- * @brief Unlock TCA8418 keypad
- * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
- * @note This function enables all keypad columns (0-6) and their interrupts
+ * @brief Number of free slots in the event ring
+ * @return uint8_t Free slots
  */
-HAL_StatusTypeDef TCA8418_UnlockKeypad(void){
-    HAL_StatusTypeDef status;
+static inline uint8_t TCA8418_RingFree(void){
+    return (uint8_t)(TCA8418_RING_SIZE - (uint8_t)(ringHead - ringTail));
+}
+
+/**
+ * @brief Move the events of the current drain into the event ring
+ */
+static void TCA8418_DrainEnqueue(void){
+    uint8_t freeSlots = TCA8418_RingFree();
+    uint32_t enqueue = 0;
+    TCA8418_STAMP(enqueue);
+    for(uint8_t i = 0; i < drainCount; i++){
+        if(i >= freeSlots){
+            flowStats.eventsDropped++;
+            continue;
+        }
+        eventRing[ringHead & (TCA8418_RING_SIZE - 1)] = drainBuffer[i];
+        TCA8418_StampEnqueue(ringHead & (TCA8418_RING_SIZE - 1), i, enqueue);
+        ringHead++;
+    }
+    TCA8418_TRACE_INSTANT(TCA8418_TRACE_ENQUEUE, 0, (drainCount < freeSlots) ? drainCount : freeSlots);
+    TCA8418_NoteEvents((drainCount < freeSlots) ? drainCount : freeSlots);
+}
+
+/**
+ * @brief Move the events of the current drain into the event ring and clear the handled interrupts
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+static HAL_StatusTypeDef TCA8418_DrainComplete(void){
+    HAL_StatusTypeDef status = HAL_OK;
+    TCA8418_DrainEnqueue();
+    if(drainIntStatus != 0){
+        /* Clear the handled interrupts by writing 1 to their bits */
+        status = TCA8418_WriteRegister(INT_STAT, &drainIntStatus, 1);
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, drainCount);
+    return status;
+}
+#endif
+
+#if TCA8418_FEATURE_RING || TCA8418_FEATURE_DIAG
+/**
+ * @brief Read the number of events waiting in the TCA8418 FIFO
+ * @param eventCount Pointer to store the number of events (0 to 10)
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+static HAL_StatusTypeDef TCA8418_ReadEventCount(uint8_t *eventCount){
+    HAL_StatusTypeDef status;
+    status = TCA8418_ReadRegister(KEY_LCK_EC, eventCount, 1);
+    if(status != HAL_OK){
+        return status;
+    }
+    *eventCount &= KEC_MASK;
+    if(*eventCount > TCA8418_FIFO_DEPTH){
+        *eventCount = TCA8418_FIFO_DEPTH;
+    }
+    return HAL_OK;
+}
+#endif
+
+#if TCA8418_FEATURE_RING
+/**
+ * @brief Start one drain pass over the events counted in the TCA8418 FIFO
+ * @param intStatus Interrupt bits to clear once the events are in the ring
+ * @param eventCount Number of events in the FIFO
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Blocking strategies complete the pass before returning. IT and DMA strategies
+ *       leave drainBusy set and complete it in TCA8418_I2C_MemRxCpltCallback().
+ */
+static HAL_StatusTypeDef TCA8418_DrainStart(uint8_t intStatus, uint8_t eventCount){
+    HAL_StatusTypeDef status;
+    uint8_t freeSlots = TCA8418_RingFree();
+    TCA8418_DrainStrategy strategy = drainStrategy;
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_DRAIN, 0, eventCount);
+    drainCount = eventCount;
+    if(flowControl && (eventCount > freeSlots)){
+        /* Leave the surplus in the chip FIFO and keep KE_INT set so it holds INT asserted */
+        drainCount = freeSlots;
+        intStatus &= (uint8_t)~K_INT;
+        if(!throttled){
+            throttled = 1;
+            flowStats.backpressureEngaged++;
+        }
+        flowStats.eventsHeld += eventCount - freeSlots;
+    }
+    drainIntStatus = intStatus;
+    if(drainCount == 0){
+        return TCA8418_DrainComplete();
+    }
+    if((strategy == TCA8418_DRAIN_IT) || (strategy == TCA8418_DRAIN_DMA)){
+        drainBusy = 1;
+        drainPhase = DRAIN_PHASE_FIFO;
+        status = TCA8418_ReadFIFO(strategy, drainBuffer, drainCount);
+        if(status != HAL_OK){
+            drainBusy = 0;
+            TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, KEY_EVENT_A, drainCount);
+            TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, 0);
+        }
+        return status;
+    }
+    status = TCA8418_ReadFIFO(strategy, drainBuffer, drainCount);
+    if(status != HAL_OK){
+        TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, 0);
+        return status;
+    }
+    return TCA8418_DrainComplete();
+}
+
+/**
+ * @brief Count events that arrived during a drain pass and would otherwise be stranded
+ * @param eventCount Pointer to store the number of events left to drain
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note In latched mode INT stays asserted when KE_INT is cleared while events are pending,
+ *       so an edge triggered EXTI sees no new edge and the events must be drained now.
+ *       In reassert mode the chip pulses INT for them, and while throttled they are held
+ *       on purpose, so no bus access is needed.
+ */
+static HAL_StatusTypeDef TCA8418_DrainRecheck(uint8_t *eventCount){
+    if((intMode == TCA8418_INT_REASSERT) || throttled){
+        *eventCount = 0;
+        return HAL_OK;
+    }
+    return TCA8418_ReadEventCount(eventCount);
+}
+
+/**
+ * @brief Drain passes of TCA8418_ServiceInterrupt()
+ * @return HAL_StatusTypeDef HAL_OK if successful, HAL_BUSY if an IT or DMA drain is still in flight,
+ *         otherwise error code
+ */
+static HAL_StatusTypeDef TCA8418_ServiceDrain(void){
+    HAL_StatusTypeDef status;
+    uint8_t intStatus;
+    uint8_t eventCount;
+    if(drainBusy){
+        return HAL_BUSY;
+    }
+    TCA8418_StampDrain();
+    status = TCA8418_ReadRegister(INT_STAT, &intStatus, 1);
+    if(status != HAL_OK){
+        TCA8418_StampDrainRefused();
+        return status;
+    }
+    intStatus &= (K_INT | OVR_FLOW_INT);
+    if(intStatus == 0){
+        return HAL_OK; // No events
+    }
+    if(intStatus & OVR_FLOW_INT){
+        flowStats.fifoOverflows++;
+    }
+    status = TCA8418_ReadEventCount(&eventCount);
+    if(status != HAL_OK){
+        return status;
+    }
+    do{
+        status = TCA8418_DrainStart(intStatus, eventCount);
+        if((status != HAL_OK) || drainBusy){
+            return status;
+        }
+        status = TCA8418_DrainRecheck(&eventCount);
+        if(status != HAL_OK){
+            return status;
+        }
+        intStatus = K_INT;
+    }while(eventCount > 0);
+    return HAL_OK;
+}
+
+/**
+ * @brief Drain pending key events from the TCA8418 FIFO into the event ring
+ * @return HAL_StatusTypeDef HAL_OK if successful, HAL_BUSY if an IT or DMA drain is still in flight,
+ *         otherwise error code
+ * @note With flow control enabled only as many events as fit in the ring are read.
+ *       The rest stay in the chip FIFO and KE_INT is left set, so INT stays asserted
+ *       and no new edge arrives until TCA8418_PopEvents() frees space and resumes the drain.
+ *       With flow control disabled the FIFO is always emptied and surplus events are dropped.
+ *       KE_INT and OVR_FLOW_INT are cleared with a single write. In latched mode the FIFO is
+ *       checked again after the clear so events arriving mid-drain are not stranded.
+ */
+HAL_StatusTypeDef TCA8418_ServiceInterrupt(void){
+    uint8_t traced = TCA8418_TraceIrqEnter();
+    HAL_StatusTypeDef status = TCA8418_ServiceDrain();
+    TCA8418_TraceIrqExit(traced, 0);
+    return status;
+}
+
+/**
+ * @brief End an IT or DMA drain and hand over the requests latched while it ran
+ */
+static void TCA8418_DrainIdle(void){
+    drainBusy = 0;
+    TCA8418_RetryBlocked();
+#if TCA8418_FEATURE_DEFERRED
+    if(drainRequested){
+        TCA8418_PendDeferred();
+    }
+#endif
+}
+
+/**
+ * @brief End an IT or DMA drain whose next transfer could not start
+ * @note The interrupts may be left uncleared, so with TCA8418_FEATURE_DEFERRED a drain is
+ *       requested to finish them. Otherwise the next INT edge or TCA8418_ServiceInterrupt() does.
+ */
+static void TCA8418_DrainAbort(void){
+#if TCA8418_FEATURE_DEFERRED
+    drainRequested = 1;
+#endif
+    TCA8418_DrainIdle();
+}
+
+/**
+ * @brief Continue an IT or DMA drain after its interrupts were cleared
+ * @note In latched mode KEY_LCK_EC is read again with an IT transfer, completed in
+ *       TCA8418_I2C_MemRxCpltCallback(), as TCA8418_DrainRecheck() does for blocking drains.
+ */
+static void TCA8418_DrainRecheckAsync(void){
+    if((intMode == TCA8418_INT_REASSERT) || throttled){
+        TCA8418_DrainIdle();
+        return;
+    }
+    drainPhase = DRAIN_PHASE_COUNT;
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_READ, KEY_LCK_EC, 1);
+    if(HAL_I2C_Mem_Read_IT(&hi2c1, (TCA8418_ADDRESS << 1), KEY_LCK_EC, I2C_MEMADD_SIZE_8BIT, &drainEventCount, 1) != HAL_OK){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, KEY_LCK_EC, 0);
+        TCA8418_DrainAbort();
+    }
+}
+
+/**
+ * @brief Complete a transfer of an IT or DMA drain
+ * @param hi2c I2C handle passed to HAL_I2C_MemRxCpltCallback()
+ * @note Call this from HAL_I2C_MemRxCpltCallback() when using the IT or DMA drain strategy.
+ *       No blocking transfer runs from the callbacks: the interrupt clear is chained as an IT
+ *       write, completed in TCA8418_I2C_MemTxCpltCallback(), and the latched mode recheck as
+ *       an IT read completed here, which starts the next FIFO read if events arrived.
+ */
+void TCA8418_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    uint8_t eventCount;
+    if((hi2c != &hi2c1) || !drainBusy){
+        return;
+    }
+    if(drainPhase == DRAIN_PHASE_COUNT){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, KEY_LCK_EC, 1);
+        eventCount = drainEventCount & KEC_MASK;
+        if(eventCount > TCA8418_FIFO_DEPTH){
+            eventCount = TCA8418_FIFO_DEPTH;
+        }
+        if(eventCount == 0){
+            TCA8418_DrainIdle();
+            return;
+        }
+        /* Started again with drainBusy set for the FIFO read, the surplus is held as in any pass */
+        drainBusy = 0;
+        if(TCA8418_DrainStart(K_INT, eventCount) != HAL_OK){
+            TCA8418_DrainAbort();
+        } else if(!drainBusy){
+            TCA8418_DrainIdle();
+        }
+        return;
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, KEY_EVENT_A, drainCount);
+    TCA8418_StampFifo(0);
+    if(TCA8418_CALIBRATING()){
+        drainBusy = 0;
+        return;
+    }
+    TCA8418_DrainEnqueue();
+    if(drainIntStatus == 0){
+        TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, drainCount);
+        TCA8418_DrainRecheckAsync();
+        return;
+    }
+    drainPhase = DRAIN_PHASE_CLEAR;
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_I2C_WRITE, INT_STAT, 1);
+    if(HAL_I2C_Mem_Write_IT(&hi2c1, (TCA8418_ADDRESS << 1), INT_STAT, I2C_MEMADD_SIZE_8BIT, &drainIntStatus, 1) != HAL_OK){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, INT_STAT, 0);
+        TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, 0);
+        TCA8418_DrainAbort();
+    }
+}
+#endif
+
+#if TCA8418_FEATURE_RING || TCA8418_FEATURE_ASYNC_INIT
+/**
+ * @brief Continue an IT or DMA drain or TCA8418_InitAsync()
+ * @param hi2c I2C handle passed to HAL_I2C_MemTxCpltCallback()
+ * @note Call this from HAL_I2C_MemTxCpltCallback() when using the IT or DMA drain strategy
+ *       or TCA8418_InitAsync().
+ */
+void TCA8418_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    if(hi2c != &hi2c1){
+        return;
+    }
+#if TCA8418_FEATURE_RING
+    if(drainBusy && (drainPhase == DRAIN_PHASE_CLEAR)){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, INT_STAT, 1);
+        TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, drainCount);
+        TCA8418_DrainRecheckAsync();
+        return;
+    }
+#endif
+#if TCA8418_FEATURE_ASYNC_INIT
+    if(initState != TCA8418_INIT_BUSY){
+        return;
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, initSteps[initStep].reg, initSteps[initStep].length);
+    initStep++;
+    initAttempt = 0;
+    if(initStep >= INIT_STEPS){
+        TCA8418_InitAsyncDone(HAL_OK);
+        return;
+    }
+    if(TCA8418_InitAsyncWrite() != HAL_OK){
+        TCA8418_InitAsyncDone(HAL_ERROR);
+    }
+#endif
+}
+#endif
+
+#if TCA8418_FEATURE_OUTPUTS
+/**
+ * @brief Write the levels and directions of every byte holding output pins
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Levels go first, so a pin starts at its level when it becomes an output.
+ *       Single-byte writes: CFG.AI stays cleared for the FIFO burst reads.
+ */
+static HAL_StatusTypeDef TCA8418_RestoreOutputs(void){
+    HAL_StatusTypeDef status;
+    uint8_t data;
+    for(uint8_t i = 0; i < 3; i++){
+        if(outDir[i] == 0){
+            continue;
+        }
+        data = outFrame[i];
+        status = TCA8418_WriteRegister((uint8_t)(GPIO_DAT_OUT1 + i), &data, 1);
+        if(status != HAL_OK){
+            return status;
+        }
+        outWritten[i] = data;
+        status = TCA8418_WriteRegister((uint8_t)(GPIO_DIR1 + i), &outDir[i], 1);
+        if(status != HAL_OK){
+            return status;
+        }
+    }
+    return HAL_OK;
+}
+#endif
+
+#if TCA8418_FEATURE_HOTPLUG
+/**
+ * @brief Set the callback notified of detaches and reattaches
+ * @param callback Callback, NULL to stop notifications
+ */
+void TCA8418_SetPresenceCallback(TCA8418_PresenceCallback callback){
+    presenceCallback = callback;
+}
+
+/**
+ * @brief Check whether the TCA8418 is currently considered fitted
+ * @return uint8_t 1 if fitted, 0 after a detach until the next reattach
+ */
+uint8_t TCA8418_IsPresent(void){
+    return devicePresent;
+}
+
+/**
+ * @brief Forget the drain state left from before a detach
+ * @note Events in the ring, a throttled or requested drain and an IT or DMA drain that never
+ *       completed all belong to the chip that went away. The FIFO of the reattached chip is
+ *       empty and its INT stays deasserted until the configuration is restored, so no drain
+ *       runs concurrently. The ring is emptied from the consumer side, as TCA8418_PopEvents() does.
+ */
+static void TCA8418_ReattachReset(void){
+    drainBusy = 0;
+#if TCA8418_FEATURE_RING
+    ringTail = ringHead;
+    throttled = 0;
+    drainPhase = DRAIN_PHASE_FIFO;
+#endif
+#if TCA8418_FEATURE_DEFERRED
+    drainRequested = 0;
+    drainBlocked = 0;
+#endif
+}
+
+/**
+ * @brief Write the cached configuration back to a reattached TCA8418
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note CFG is left with only AI set, TCA8418_EnableInterrupt() restores it. With outputs one
+ *       burst covers GPIO_DAT_OUT1 to GPIO_DIR3, so the levels are written before the directions.
+ *       GPIO_EM1 to GPIO_EM3 in between get their reset values, the driver never changes them.
+ */
+static HAL_StatusTypeDef TCA8418_ReattachConfig(void){
+#if TCA8418_FEATURE_OUTPUTS
+    HAL_StatusTypeDef status;
+    uint8_t data = CFG_AI;
+    uint8_t block[REATTACH_BLOCK_SIZE];
+    for(uint8_t i = 0; i < 3; i++){
+        block[GPIO_DAT_OUT1 - GPIO_DAT_OUT1 + i] = outFrame[i];
+        block[GPIO_EM1 - GPIO_DAT_OUT1 + i] = 0;
+        block[GPIO_DIR1 - GPIO_DAT_OUT1 + i] = outDir[i];
+    }
+    for(uint8_t i = 0; i < GPIO_CONFIG_SIZE; i++){
+        block[GPIO_INT_EN1 - GPIO_DAT_OUT1 + i] = gpioConfig[i];
+    }
+    status = TCA8418_WriteRegister(CFG, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }
+    status = TCA8418_WriteRegister(GPIO_DAT_OUT1, block, REATTACH_BLOCK_SIZE);
+    if(status != HAL_OK){
+        return status;
+    }
+    for(uint8_t i = 0; i < 3; i++){
+        outWritten[i] = block[i];
+    }
+    return HAL_OK;
+#else
+    return TCA8418_KPConfig();
+#endif
+}
+
+/**
+ * @brief Report detaches and probe for a reattached TCA8418
+ * @param now Current time in milliseconds
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code of the reconfiguration
+ * @note Call from the main loop. A detach is seen by the first transaction the TCA8418 does not
+ *       acknowledge. While detached, driver calls fail at once without bus traffic and this
+ *       function sends one address-only probe every TCA8418_PRESENCE_PROBE_MS. Once the TCA8418
+ *       answers, the events and drain state from before the detach are dropped and the cached
+ *       configuration, including locking, the outputs and the interrupt mode, is written back in
+ *       one burst before TCA8418_ATTACHED is reported. Callbacks run from this function.
+ */
+HAL_StatusTypeDef TCA8418_PollPresence(uint32_t now){
+    HAL_StatusTypeDef status;
+    if(detachPending){
+        detachPending = 0;
+        lastProbeTick = now;
+        if(presenceCallback != NULL){
+            presenceCallback(TCA8418_DETACHED);
+        }
+    }
+    if(devicePresent || ((now - lastProbeTick) < TCA8418_PRESENCE_PROBE_MS)){
+        return HAL_OK;
+    }
+    lastProbeTick = now;
+    presenceStats.probes++;
+    status = HAL_I2C_IsDeviceReady(&hi2c1, (TCA8418_ADDRESS << 1), 1, TCA8418_I2C_TIMEOUT);
+    TCA8418_RetryBlocked();
+    if(status != HAL_OK){
+        return HAL_OK;
+    }
+    /* A fresh power-up: CFG and the GPIO registers are at their reset values and the FIFO is empty */
+    devicePresent = 1;
+    presenceStats.reattachCycles = TCA8418_GetCycles();
+    TCA8418_ReattachReset();
+    status = TCA8418_ReattachConfig();
+    if(status == HAL_OK){
+        status = TCA8418_EnableInterrupt();
+    }
+    if(status != HAL_OK){
+        /* Probe and reconfigure again later */
+        devicePresent = 0;
+        detachPending = 0;
+        return status;
+    }
+    presenceStats.reattaches++;
+    presenceStats.readyCycles = TCA8418_GetCycles();
+    presenceStats.firstEvent = 0;
+    if(presenceCallback != NULL){
+        presenceCallback(TCA8418_ATTACHED);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Get the presence counters and the reattach timing
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetPresenceStats(TCA8418_PresenceStats *stats){
+    *stats = presenceStats;
+}
+#endif
+
+/**
+ * @brief Select how the TCA8418 drives INT while events are pending
+ * @param mode Interrupt output mode
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_SetInterruptMode(TCA8418_IntMode mode){
+    HAL_StatusTypeDef status;
+    uint8_t data;
+    if((mode != TCA8418_INT_LATCHED) && (mode != TCA8418_INT_REASSERT)){
+        return HAL_ERROR;
+    }
+#if TCA8418_FEATURE_MUX
+    /* The CFG shadow is written back to whichever keypad is connected, so every keypad keeps one mode */
+    if(mode != intMode){
+        return HAL_ERROR;
+    }
+#endif
+    data = (mode == TCA8418_INT_REASSERT) ? (cfgRegister | INT_CFG) : (cfgRegister & (uint8_t)~INT_CFG);
+    status = TCA8418_WriteRegister(CFG, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }
+    cfgRegister = data;
+    intMode = mode;
+    return HAL_OK;
+}
+
+#if TCA8418_FEATURE_RING || TCA8418_FEATURE_ASYNC_INIT
+/**
+ * @brief Abort an IT or DMA drain or TCA8418_InitAsync() after a bus error
+ * @param hi2c I2C handle passed to HAL_I2C_ErrorCallback()
+ * @note Call this from HAL_I2C_ErrorCallback() when using the IT or DMA drain strategy or TCA8418_InitAsync().
+ *       A failed FIFO read leaves the events in the chip FIFO for the next drain. A failed
+ *       interrupt clear or recheck requests a deferred drain to finish it. A configuration write
+ *       the TCA8418 did not acknowledge is retried up to TCA8418_I2C_RETRIES times.
+ */
+void TCA8418_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    if(hi2c != &hi2c1){
+        return;
+    }
+#if TCA8418_FEATURE_ASYNC_INIT
+    if(initState == TCA8418_INIT_BUSY){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, initSteps[initStep].reg, 0);
+        if(TCA8418_Retry(HAL_ERROR, initAttempt)){
+            initAttempt++;
+            if(TCA8418_InitAsyncWrite() == HAL_OK){
+                return;
+            }
+        }
+        TCA8418_InitAsyncDone(HAL_ERROR);
+        return;
+    }
+#endif
+#if TCA8418_FEATURE_RING
+    if(!drainBusy){
+        TCA8418_DrainIdle();
+        return;
+    }
+    TCA8418_CheckPresence(HAL_ERROR);
+    if(drainPhase == DRAIN_PHASE_FIFO){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, KEY_EVENT_A, drainCount);
+        if(!TCA8418_CALIBRATING()){
+            TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, 0);
+        }
+        TCA8418_DrainIdle();
+        return;
+    }
+    if(drainPhase == DRAIN_PHASE_CLEAR){
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_WRITE, INT_STAT, 0);
+        TCA8418_TRACE_END(TCA8418_TRACE_DRAIN, 0, 0);
+    } else {
+        TCA8418_TRACE_END(TCA8418_TRACE_I2C_READ, KEY_LCK_EC, 0);
+    }
+    /* The events are in the ring but the interrupts may still be set */
+    TCA8418_DrainAbort();
+#endif
+}
+#endif
+
+/**
+ * @brief Select the strategy used to read the TCA8418 FIFO
+ * @param strategy Drain strategy
+ * @return HAL_StatusTypeDef HAL_OK if successful, HAL_BUSY if a drain is in flight, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_SetDrainStrategy(TCA8418_DrainStrategy strategy){
+    if(strategy >= TCA8418_DRAIN_COUNT){
+        return HAL_ERROR;
+    }
+#if !TCA8418_FEATURE_RING
+    /* IT and DMA reads complete through the event ring */
+    if((strategy == TCA8418_DRAIN_IT) || (strategy == TCA8418_DRAIN_DMA)){
+        return HAL_ERROR;
+    }
+#endif
+    if(drainBusy){
+        return HAL_BUSY;
+    }
+    drainStrategy = strategy;
+    return HAL_OK;
+}
+
+/**
+ * @brief Get the strategy used to read the TCA8418 FIFO
+ * @return TCA8418_DrainStrategy Current drain strategy
+ */
+TCA8418_DrainStrategy TCA8418_GetDrainStrategy(void){
+    return drainStrategy;
+}
+
+/**
+ * @brief Read the cycle counter used to time drain strategies
+ * @return uint32_t Current cycle count
+ * @note Uses the DWT cycle counter when the core has one, otherwise the HAL tick scaled to cycles.
+ *       Override this function to time drains against a simulated bus.
+ */
+__weak uint32_t TCA8418_GetCycles(void){
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+    return DWT->CYCCNT;
+#else
+    return HAL_GetTick() * (SystemCoreClock / 1000U);
+#endif
+}
+
+/**
+ * @brief Reprogram hi2c1 to a bus speed
+ * @param hz Bus speed in Hz
+ * @return HAL_StatusTypeDef HAL_OK if hi2c1 runs at hz, otherwise error code
+ * @note The timing fields of I2C_InitTypeDef differ between STM32 families, so this default
+ *       supports no change and TCA8418_ProbeBus() keeps the speed set by MX_I2C1_Init().
+ *       Override it to update hi2c1.Init and call HAL_I2C_Init().
+ */
+__weak HAL_StatusTypeDef TCA8418_SetBusSpeed(uint32_t hz){
+    (void)hz;
+    return HAL_ERROR;
+}
+
+#if TCA8418_FEATURE_PROBE
+/* Candidate bus speeds of TCA8418_ProbeBus() */
+static const uint32_t probeSpeeds[] = {TCA8418_PROBE_SPEEDS};
+TCA8418_STATIC_ASSERT(sizeof(probeSpeeds) / sizeof(probeSpeeds[0]) == TCA8418_PROBE_SPEED_COUNT, probe_speed_count);
+
+/* Patterns toggling every bit both ways and in alternating neighbours */
+static const uint8_t probePatterns[8] = {0x55, 0xAA, 0x00, 0xFF, 0x5A, 0xA5, 0x0F, 0xF0};
+
+/* Register used for the write and readback checks, it only selects the GPI interrupt edge */
+#define PROBE_REGISTER  GPIO_INT_LVL1
+
+/**
+ * @brief Write and read back the probe patterns at the current bus speed
+ * @return uint16_t Failed checks
+ * @note Uses single attempts without TCA8418_I2C_RETRIES, a retried error is still an error here.
+ */
+static uint16_t TCA8418_ProbePatterns(void){
+    uint16_t errors = 0;
+    for(uint8_t round = 0; round < TCA8418_PROBE_ROUNDS; round++){
+        for(uint8_t i = 0; i < sizeof(probePatterns); i++){
+            uint8_t data = probePatterns[i];
+            uint8_t readback = (uint8_t)~data;
+            if((HAL_I2C_Mem_Write(&hi2c1, (TCA8418_ADDRESS << 1), PROBE_REGISTER, I2C_MEMADD_SIZE_8BIT, &data, 1,
+                                  TCA8418_I2C_TIMEOUT) != HAL_OK) ||
+               (HAL_I2C_Mem_Read(&hi2c1, (TCA8418_ADDRESS << 1), PROBE_REGISTER, I2C_MEMADD_SIZE_8BIT, &readback, 1,
+                                 TCA8418_I2C_TIMEOUT) != HAL_OK) ||
+               (readback != data)){
+                errors++;
+            }
+            TCA8418_RetryBlocked();
+        }
+    }
+    return errors;
+}
+
+/**
+ * @brief Check that the TCA8418 is fitted and select the fastest reliable bus speed
+ * @param probe Pointer to store the result
+ * @return HAL_StatusTypeDef HAL_OK if a speed was selected, HAL_ERROR if the TCA8418 is absent or unreliable
+ * @note Call before TCA8418_Init(). The presence check is a single address-only transaction.
+ *       Each candidate speed of TCA8418_PROBE_SPEEDS is then set with TCA8418_SetBusSpeed()
+ *       and checked with write and readback patterns, stopping at the first speed with errors.
+ *       hi2c1 is left at the fastest speed without errors, failedHz - selectedHz is the margin.
+ */
+HAL_StatusTypeDef TCA8418_ProbeBus(TCA8418_BusProbe *probe){
+    uint8_t saved;
+    uint8_t current = 0;
+    probe->present = 0;
+    probe->tested = 0;
+    probe->checks = TCA8418_PROBE_ROUNDS * sizeof(probePatterns);
+    probe->selectedHz = 0;
+    probe->failedHz = 0;
+    for(uint8_t s = 0; s < TCA8418_PROBE_SPEED_COUNT; s++){
+        probe->errors[s] = 0;
+    }
+    if(HAL_I2C_IsDeviceReady(&hi2c1, (TCA8418_ADDRESS << 1), 1, TCA8418_I2C_TIMEOUT) != HAL_OK){
+        TCA8418_RetryBlocked();
+        return HAL_ERROR;
+    }
+    TCA8418_RetryBlocked();
+    probe->present = 1;
+    if(TCA8418_ReadRegister(PROBE_REGISTER, &saved, 1) != HAL_OK){
+        return HAL_ERROR;
+    }
+    for(uint8_t s = 0; s < TCA8418_PROBE_SPEED_COUNT; s++){
+        /* The first speed is the one hi2c1 was initialized with */
+        if((s > 0) && (TCA8418_SetBusSpeed(probeSpeeds[s]) != HAL_OK)){
+            break;
+        }
+        current = s;
+        probe->tested++;
+        probe->errors[s] = TCA8418_ProbePatterns();
+        if(probe->errors[s] != 0){
+            probe->failedHz = probeSpeeds[s];
+            break;
+        }
+        probe->selectedHz = probeSpeeds[s];
+    }
+    if(probe->selectedHz == 0){
+        /* Errors already at the initial speed, which is still set */
+        return HAL_ERROR;
+    }
+    if((probe->selectedHz != probeSpeeds[current]) && (TCA8418_SetBusSpeed(probe->selectedHz) != HAL_OK)){
+        probe->selectedHz = 0;
+        return HAL_ERROR;
+    }
+    return TCA8418_WriteRegister(PROBE_REGISTER, &saved, 1);
+}
+#endif
+
+#if TCA8418_FEATURE_CALIBRATION
+/**
+ * @brief Time every drain strategy and select the fastest one
+ * @param batchSize Number of events read per measurement (1 to 10)
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Each strategy reads batchSize bytes from KEY_EVENT_A. An empty FIFO reads as 0,
+ *       but events already pending are consumed, so calibrate before key events are expected.
+ *       Strategies the HAL rejects, e.g. DMA without a DMA channel linked to hi2c1, are skipped.
+ */
+HAL_StatusTypeDef TCA8418_CalibrateDrain(uint8_t batchSize){
+    HAL_StatusTypeDef status;
+    uint32_t start;
+    uint32_t tickStart;
+    if((batchSize == 0) || (batchSize > TCA8418_FIFO_DEPTH)){
+        return HAL_ERROR;
+    }
+    if(drainBusy){
+        return HAL_BUSY;
+    }
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    drainCalibration.batchSize = batchSize;
+    drainCalibration.selected = TCA8418_DRAIN_PER_REGISTER;
+    for(uint8_t s = 0; s < TCA8418_DRAIN_COUNT; s++){
+        uint8_t async = (s == TCA8418_DRAIN_IT) || (s == TCA8418_DRAIN_DMA);
+        drainCalibration.cycles[s] = UINT32_MAX;
+        calibrating = 1;
+        drainBusy = async;
+        start = TCA8418_GetCycles();
+        status = TCA8418_ReadFIFO((TCA8418_DrainStrategy)s, drainBuffer, batchSize);
+        if((status == HAL_OK) && async){
+            tickStart = HAL_GetTick();
+            while(drainBusy && ((HAL_GetTick() - tickStart) < TCA8418_CALIBRATION_TIMEOUT)){
+            }
+            if(drainBusy){
+                status = HAL_TIMEOUT;
+            }
+        }
+        if(status == HAL_OK){
+            drainCalibration.cycles[s] = TCA8418_GetCycles() - start;
+        }
+        drainBusy = 0;
+        calibrating = 0;
+        if(drainCalibration.cycles[s] < drainCalibration.cycles[drainCalibration.selected]){
+            drainCalibration.selected = (TCA8418_DrainStrategy)s;
+        }
+    }
+    if(drainCalibration.cycles[drainCalibration.selected] == UINT32_MAX){
+        return HAL_ERROR;
+    }
+    drainStrategy = drainCalibration.selected;
+    return HAL_OK;
+}
+
+/**
+ * @brief Get the measurements of the last drain calibration
+ * @param calibration Pointer to store the measurements
+ */
+void TCA8418_GetDrainCalibration(TCA8418_DrainCalibration *calibration){
+    *calibration = drainCalibration;
+}
+#endif
+
+#if TCA8418_FEATURE_DEFERRED
+/**
+ * @brief Top half of the TCA8418 interrupt
+ * @note Call this from HAL_GPIO_EXTI_Callback(). It only latches the request and pends the
+ *       low priority software interrupt, the drain runs later in TCA8418_DeferredHandler().
+ */
+void TCA8418_IRQHandler(void){
+    uint32_t start = TCA8418_GetCycles();
+    TCA8418_StampEdge(start);
+    TCA8418_TRACE_INSTANT(TCA8418_TRACE_INT, 0, 0);
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_ISR, 0, 0);
+    if(drainRequested){
+        deferredStats.coalesced++;
+    }
+    drainRequested = 1;
+    deferredStats.requests++;
+    TCA8418_PendDeferred();
+    start = TCA8418_GetCycles() - start;
+    if(start > deferredStats.maxTopHalfCycles){
+        deferredStats.maxTopHalfCycles = start;
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_ISR, 0, 0);
+}
+
+/**
+ * @brief Bottom half of the TCA8418 interrupt
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Call this from PendSV_Handler(), or from the handler of TCA8418_DEFERRED_IRQn when
+ *       that macro names a spare interrupt. Give that interrupt the lowest priority so the
+ *       blocking I2C drain never delays other interrupts. Requests latched while the drain
+ *       runs are served before returning.
+ */
+HAL_StatusTypeDef TCA8418_DeferredHandler(void){
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t start = TCA8418_GetCycles();
+    TCA8418_TRACE_BEGIN(TCA8418_TRACE_DEFERRED, 0, 0);
+    while(drainRequested){
+        drainRequested = 0;
+        status = TCA8418_ServiceInterrupt();
+        if(status == HAL_BUSY){
+            drainRequested = 1;
+            status = HAL_OK;
+            if(!drainBusy){
+                /* The HAL lock is held by the blocking transaction this handler preempted.
+                 * Pending again now would only preempt it again, its end pends this handler */
+                drainBlocked = 1;
+                deferredStats.blocked++;
+            }
+            /* Otherwise an IT or DMA drain is in flight, its completion pends this handler again */
+            break;
+        }
+        if(status != HAL_OK){
+            break;
+        }
+    }
+    start = TCA8418_GetCycles() - start;
+    if(start > deferredStats.maxBottomHalfCycles){
+        deferredStats.maxBottomHalfCycles = start;
+    }
+    TCA8418_TRACE_END(TCA8418_TRACE_DEFERRED, 0, 0);
+    return status;
+}
+
+/**
+ * @brief Retry a deferred drain refused while the application held hi2c1
+ * @note The driver does this itself after its own transactions. Call it after blocking
+ *       transactions of the application on hi2c1 with other devices, made from code that
+ *       TCA8418_DeferredHandler() can preempt, otherwise a drain refused meanwhile waits
+ *       for the next driver transaction.
+ */
+void TCA8418_BusReleased(void){
+    TCA8418_RetryBlocked();
+}
+
+/**
+ * @brief Get the counters of the deferred drain
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetDeferredStats(TCA8418_DeferredStats *stats){
+    *stats = deferredStats;
+}
+#endif
+
+#if TCA8418_FEATURE_RING
+/**
+ * @brief Copy key events out of the event ring
+ * @param keyEvents Array to store key events
+ * @param maxEvents Capacity of keyEvents
+ * @return uint8_t Number of events taken
+ */
+static uint8_t TCA8418_RingTake(uint8_t *keyEvents, uint8_t maxEvents){
+    uint8_t count = 0;
+    while((count < maxEvents) && (ringTail != ringHead)){
+        TCA8418_StampDequeue(ringTail & (TCA8418_RING_SIZE - 1), count == 0);
+        keyEvents[count++] = eventRing[ringTail & (TCA8418_RING_SIZE - 1)];
+        ringTail++;
+    }
+    if(count > 0){
+        TCA8418_TRACE_INSTANT(TCA8418_TRACE_DEQUEUE, 0, count);
+    }
+    return count;
+}
+
+/**
+ * @brief Take key events out of the event ring
+ * @param keyEvents Array to store key events
+ * @param maxEvents Capacity of keyEvents
+ * @param numEvents Pointer to store number of events taken
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note When the drain was throttled and enough space has been freed, this function
+ *       resumes it. With TCA8418_FEATURE_DEFERRED the resume is handed to
+ *       TCA8418_DeferredHandler() as in TCA8418_TakeEvents(), so the bottom half stays the
+ *       only producer of the event ring. Otherwise TCA8418_ServiceInterrupt() is called here,
+ *       so this function may access the I2C bus and returns the status of that drain.
+ */
+HAL_StatusTypeDef TCA8418_PopEvents(uint8_t *keyEvents, uint8_t maxEvents, uint8_t *numEvents){
+    *numEvents = TCA8418_RingTake(keyEvents, maxEvents);
+    if(throttled && !drainBusy && (TCA8418_RingFree() >= TCA8418_RING_RESUME_THRESHOLD)){
+        throttled = 0;
+#if TCA8418_FEATURE_DEFERRED
+        drainRequested = 1;
+        TCA8418_PendDeferred();
+#else
+        /* INT stays asserted while throttled, so no EXTI drain can run concurrently */
+        return TCA8418_ServiceInterrupt();
+#endif
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Take key events out of the event ring without accessing the bus
+ * @param keyEvents Array to store key events
+ * @param maxEvents Capacity of keyEvents
+ * @return uint8_t Number of events taken
+ * @note For polling consumers such as UI input callbacks. A throttled drain is handed to
+ *       TCA8418_DeferredHandler() when TCA8418_FEATURE_DEFERRED is enabled, otherwise it
+ *       resumes at the next TCA8418_PopEvents() or TCA8418_ServiceInterrupt() call.
+ */
+uint8_t TCA8418_TakeEvents(uint8_t *keyEvents, uint8_t maxEvents){
+    uint8_t count = TCA8418_RingTake(keyEvents, maxEvents);
+#if TCA8418_FEATURE_DEFERRED
+    if(throttled && !drainBusy && (TCA8418_RingFree() >= TCA8418_RING_RESUME_THRESHOLD)){
+        throttled = 0;
+        drainRequested = 1;
+        TCA8418_PendDeferred();
+    }
+#endif
+    return count;
+}
+
+/**
+ * @brief Get the number of key events waiting in the event ring
+ * @return uint8_t Events waiting
+ */
+uint8_t TCA8418_PendingEvents(void){
+    return (uint8_t)(ringHead - ringTail);
+}
+
+#if TCA8418_STAMPS
+/**
+ * @brief Mark the oldest taken event handled and add its stamps to the stage statistics
+ * @note Call once per event, in the order the events were taken, when the application is done
+ *       with it. Events never marked handled are forgotten after TCA8418_RING_SIZE later takes.
+ */
+void TCA8418_StampHandled(void){
+    TCA8418_EventStamps *stamps;
+    uint32_t now = TCA8418_GetCycles();
+    if(takenTail == takenHead){
+        return;
+    }
+    stamps = &takenStamps[takenTail & (TCA8418_RING_SIZE - 1)];
+    stamps->interval[TCA8418_STAGE_HANDLED - 1] =
+        TCA8418_StampInterval(TCA8418_StampAt(stamps, TCA8418_STAGE_DEQUEUE), now);
+    TCA8418_Stamps_Add(&stageStats, stamps);
+    takenTail++;
+}
+
+/**
+ * @brief Get the latency of the handled events attributed to their stages
+ * @param stats Pointer to store the statistics
+ */
+void TCA8418_GetStageStats(TCA8418_StageStats *stats){
+    *stats = stageStats;
+}
+
+/**
+ * @brief Reset the stage statistics
+ */
+void TCA8418_ClearStageStats(void){
+    stageStats = (TCA8418_StageStats){0};
+}
+#endif
+
+/**
+ * @brief Enable or disable flow control of the event ring
+ * @param enable 1 to leave events in the chip FIFO when the ring is full, 0 to drop them
+ * @note Flow control is enabled by default.
+ */
+void TCA8418_SetFlowControl(uint8_t enable){
+    flowControl = enable ? 1 : 0;
+}
+
+/**
+ * @brief Get the flow control counters of the event ring
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetFlowStats(TCA8418_FlowStats *stats){
+    *stats = flowStats;
+}
+#endif
+
+/**
+ * @brief Lock TCA8418 keypad except POWER key
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note This function disables all keypad columns except column 0 (POWER key)
+ */
+HAL_StatusTypeDef TCA8418_LockKeypad(void){
+    HAL_StatusTypeDef status;
+    uint8_t data;
+    /* Enable only column 0 (POWER key) for keypad operation */
+    data = TCA8418_FIELD(KP_GPIO2, FIELD_KP_GPIO2_COL, TCA8418_PIN(0)); // COL0 stays in the keypad, COL6:1 become GPIOs
+    status = TCA8418_WriteRegister(KP_GPIO2, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }   
+    GPIO_CONFIG(KP_GPIO2) = data;
+    /* GPI interrupt enables as configured by TCA8418_KPConfig(), CFG.GPI_IEN keeps GPI interrupts off INT */
+    data = TCA8418_FIELD(GPIO_INT_EN2, FIELD_GPIO_INT_EN2_COL, KEYPAD_COLS);
+    status = TCA8418_WriteRegister(GPIO_INT_EN2, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }   
+    GPIO_CONFIG(GPIO_INT_EN2) = data;
+    return HAL_OK;
+}   
+
+/**
+ * @brief Unlock TCA8418 keypad
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note This function enables all keypad columns (0-6) and their interrupts
+ */
+HAL_StatusTypeDef TCA8418_UnlockKeypad(void){
+    HAL_StatusTypeDef status;
     uint8_t data;
     /* Enable all columns (0-6) for keypad operation */
-    data = 0x7F; // COL6:0[6:0] = 1 -> Enable columns 0-6 for keypad
+    data = TCA8418_FIELD(KP_GPIO2, FIELD_KP_GPIO2_COL, KEYPAD_COLS); // COL6:0 in the keypad
     status = TCA8418_WriteRegister(KP_GPIO2, &data, 1);
     if(status != HAL_OK){
         return status;
     }   
-    /* Disable interrupt for column 7 */
-    data = 0x7F; // C7IE[7] = 0 -> Disable interrupt for column 7
+    GPIO_CONFIG(KP_GPIO2) = data;
+    /* GPI interrupt of COL7, the only GPIO column, stays disabled */
+    data = TCA8418_FIELD(GPIO_INT_EN2, FIELD_GPIO_INT_EN2_COL, KEYPAD_COLS);
     status = TCA8418_WriteRegister(GPIO_INT_EN2, &data, 1);
     if(status != HAL_OK){
         return status;
     }
+    GPIO_CONFIG(GPIO_INT_EN2) = data;
+    return HAL_OK;
+}
+
+#if TCA8418_FEATURE_OUTPUTS
+/**
+ * @brief Configure GPIO pins as outputs driven from the output frame buffer
+ * @param pins TCA8418_GPIO_ROW() and TCA8418_GPIO_COL() bits of the pins, keypad pins are rejected
+ * @param levels Initial levels of the pins
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Pins stay outputs across TCA8418_Init() and are restored after a reattach.
+ *       Pins of the keypad matrix are rejected also while the keypad is locked.
+ */
+HAL_StatusTypeDef TCA8418_ConfigureOutputs(uint32_t pins, uint32_t levels){
+    /* Locking hands keypad pins to GPIO in the shadow, they still belong to the matrix */
+    uint32_t keypad = TCA8418_DIAG_MASK(&GPIO_CONFIG(KP_GPIO1)) |
+                      TCA8418_DIAG_MASK(&gpioConfigDefault[KP_GPIO1 - GPIO_INT_EN1]);
+    if((pins == 0) || (pins >> TCA8418_DIAG_PINS) || (pins & keypad)){
+        return HAL_ERROR;
+    }
+    for(uint8_t i = 0; i < 3; i++){
+        uint8_t mask = (uint8_t)(pins >> (8 * i));
+        outFrame[i] = (uint8_t)((outFrame[i] & ~mask) | ((uint8_t)(levels >> (8 * i)) & mask));
+        outDir[i] |= mask;
+    }
+    return TCA8418_RestoreOutputs();
+}
+
+/**
+ * @brief Change output levels in the frame buffer without bus access
+ * @param pins Output pins to change, pins not configured as outputs are ignored
+ * @param levels New levels of those pins
+ * @note Every change made before the next frame is written with that frame, so an animation
+ *       step touching many LEDs costs at most one write per register byte.
+ */
+void TCA8418_SetOutputs(uint32_t pins, uint32_t levels){
+    for(uint8_t i = 0; i < 3; i++){
+        uint8_t mask = (uint8_t)(pins >> (8 * i)) & outDir[i];
+        uint8_t frame = outFrame[i];
+        uint8_t next = (uint8_t)((frame & ~mask) | ((uint8_t)(levels >> (8 * i)) & mask));
+        if(next == frame){
+            continue;
+        }
+        /* The byte already waits for this frame, the change rides along */
+        if(frame != outWritten[i]){
+            outputStats.changesMerged++;
+        }
+        outFrame[i] = next;
+    }
+}
+
+/**
+ * @brief Check whether key events wait for a drain
+ * @return uint8_t 1 if a drain is in flight or due, otherwise 0
+ */
+static inline uint8_t TCA8418_DrainPending(void){
+    if(drainBusy){
+        return 1;
+    }
+#if TCA8418_FEATURE_DEFERRED
+    if(drainRequested){
+        return 1;
+    }
+#endif
+#if defined(TCA8418_INT_Pin) && defined(TCA8418_INT_GPIO_Port)
+    /* INT is active low. While throttled it stays asserted until the consumer frees ring space,
+     * waiting for it would stall the outputs */
+#if TCA8418_FEATURE_RING
+    if(throttled){
+        return 0;
+    }
+#endif
+    if(HAL_GPIO_ReadPin(TCA8418_INT_GPIO_Port, TCA8418_INT_Pin) == GPIO_PIN_RESET){
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief Write the changed bytes of the frame buffer once per frame, call from the main loop
+ * @param now Current time in milliseconds
+ * @return HAL_StatusTypeDef HAL_OK if flushed or not due, HAL_BUSY if postponed for a key drain, otherwise error code
+ * @note Key events have priority: while a drain is in flight or pending the frame is postponed
+ *       and written by the next call. Only the GPIO_DAT_OUT bytes that changed since the last
+ *       frame are written, one single-byte write each, as CFG.AI stays cleared for the FIFO.
+ */
+HAL_StatusTypeDef TCA8418_FlushOutputs(uint32_t now){
+    HAL_StatusTypeDef status;
+    uint8_t written = 0;
+    if((now - lastFrameTick) < TCA8418_OUTPUT_FRAME_MS){
+        return HAL_OK;
+    }
+    if(TCA8418_DrainPending()){
+        outputStats.deferred++;
+        return HAL_BUSY;
+    }
+    lastFrameTick = now;
+    for(uint8_t i = 0; i < 3; i++){
+        uint8_t data = outFrame[i];
+        if(data == outWritten[i]){
+            continue;
+        }
+        status = TCA8418_WriteRegister((uint8_t)(GPIO_DAT_OUT1 + i), &data, 1);
+        if(status != HAL_OK){
+            return status;
+        }
+        outWritten[i] = data;
+        written++;
+    }
+    if(written != 0){
+        outputStats.frames++;
+        outputStats.bytesWritten += written;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Get the counters of the GPIO output frames
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetOutputStats(TCA8418_OutputStats *stats){
+    *stats = outputStats;
+}
+#endif
+
+#if TCA8418_FEATURE_DIAG
+/**
+ * @brief Write the bytes of a 3-register GPIO group that differ from the chip's copy
+ * @param reg First register of the group
+ * @param current Register values the chip holds, updated to the written values
+ * @param next Register values to write
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note Needs CFG.AI = 1, the changed bytes are written in one transaction.
+ */
+static HAL_StatusTypeDef TCA8418_WriteGroupDelta(uint8_t reg, uint8_t *current, const uint8_t *next){
+    HAL_StatusTypeDef status;
+    uint8_t first = 3;
+    uint8_t last = 0;
+    for(uint8_t i = 0; i < 3; i++){
+        if(current[i] != next[i]){
+            if(first == 3){
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if(first == 3){
+        return HAL_OK;
+    }
+    for(uint8_t i = first; i <= last; i++){
+        current[i] = next[i];
+    }
+    status = TCA8418_WriteRegister((uint8_t)(reg + first), &current[first], (uint16_t)(last - first + 1));
+    return status;
+}
+
+/**
+ * @brief Drive each matrix pin low in turn and record which other pins follow it
+ * @param diag Pointer to store the results
+ * @param saved Register block GPIO_DAT_OUT1 to GPIO_PULL3 as configured for the keypad
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+static HAL_StatusTypeDef TCA8418_DiagWalk(TCA8418_MatrixDiag *diag, const uint8_t *saved){
+    HAL_StatusTypeDef status;
+    uint8_t block[DIAG_BLOCK_SIZE];
+    uint8_t dir[3] = {0, 0, 0};
+    uint8_t next[3];
+    uint8_t stat[3];
+    uint32_t start;
+    /* Every matrix pin becomes a GPIO input with pull-up, no interrupts, no events, output latch low */
+    for(uint8_t i = 0; i < DIAG_BLOCK_SIZE; i++){
+        block[i] = saved[i];
+    }
+    for(uint8_t i = 0; i < 3; i++){
+        uint8_t pins = saved[KP_GPIO1 - GPIO_DAT_OUT1 + i];
+        block[GPIO_DAT_OUT1 - GPIO_DAT_OUT1 + i] &= (uint8_t)~pins;
+        block[GPIO_INT_EN1 - GPIO_DAT_OUT1 + i] &= (uint8_t)~pins;
+        block[KP_GPIO1 - GPIO_DAT_OUT1 + i] = 0;
+        block[GPIO_EM1 - GPIO_DAT_OUT1 + i] &= (uint8_t)~pins;
+        block[GPIO_DIR1 - GPIO_DAT_OUT1 + i] &= (uint8_t)~pins;
+        block[GPIO_PULL1 - GPIO_DAT_OUT1 + i] &= (uint8_t)~pins;
+        dir[i] = block[GPIO_DIR1 - GPIO_DAT_OUT1 + i];
+    }
+    status = TCA8418_WriteRegister(GPIO_DAT_OUT1, block, DIAG_BLOCK_SIZE);
+    if(status != HAL_OK){
+        return status;
+    }
+    /* Nothing driven: a pin reading low is shorted to ground */
+    status = TCA8418_ReadRegister(GPIO_DAT_STAT1, stat, 3);
+    if(status != HAL_OK){
+        return status;
+    }
+    diag->stuckLow = diag->pins & ~TCA8418_DIAG_MASK(stat);
+    start = TCA8418_GetCycles();
+    for(uint8_t pin = 0; pin < TCA8418_DIAG_PINS; pin++){
+        uint32_t bit = 1UL << pin;
+        if(!(diag->pins & bit)){
+            continue;
+        }
+        /* Only this pin is an output, driving its low output latch */
+        for(uint8_t i = 0; i < 3; i++){
+            next[i] = (uint8_t)(block[GPIO_DIR1 - GPIO_DAT_OUT1 + i] | (uint8_t)(bit >> (8 * i)));
+        }
+        status = TCA8418_WriteGroupDelta(GPIO_DIR1, dir, next);
+        if(status != HAL_OK){
+            return status;
+        }
+        status = TCA8418_ReadRegister(GPIO_DAT_STAT1, stat, 3);
+        if(status != HAL_OK){
+            return status;
+        }
+        diag->connections[pin] = diag->pins & ~TCA8418_DIAG_MASK(stat) & ~bit;
+        diag->patterns++;
+    }
+    diag->cycles = TCA8418_GetCycles() - start;
     return HAL_OK;
-}       
\ No newline at end of file
+}
+
+/**
+ * @brief Test the keypad matrix electrically for shorts and opens
+ * @param diag Pointer to store the results
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note The pins currently configured as keypad rows and columns are turned into GPIOs.
+ *       Each pin is driven low in turn while the others are pulled up, and the pins
+ *       reading low are recorded in diag->connections. With no key pressed every
+ *       connection is a short or a stuck key. With every key held by the test jig,
+ *       a row and column that are not connected reveal an open.
+ *       The register block GPIO_DAT_OUT1 to GPIO_PULL3 is saved and restored with one
+ *       burst each, events queued during the test are discarded and the interrupts
+ *       cleared. Do not drain events while the test runs.
+ */
+HAL_StatusTypeDef TCA8418_RunMatrixDiagnostic(TCA8418_MatrixDiag *diag){
+    HAL_StatusTypeDef status;
+    HAL_StatusTypeDef restoreStatus;
+    uint8_t saved[DIAG_BLOCK_SIZE];
+    uint8_t data;
+    uint8_t eventCount;
+    if(drainBusy){
+        return HAL_BUSY;
+    }
+    for(uint8_t i = 0; i < TCA8418_DIAG_PINS; i++){
+        diag->connections[i] = 0;
+    }
+    diag->patterns = 0;
+    diag->cycles = 0;
+    /* Interrupts off and auto-increment on for the burst accesses */
+    data = CFG_AI;
+    status = TCA8418_WriteRegister(CFG, &data, 1);
+    if(status != HAL_OK){
+        return status;
+    }
+    status = TCA8418_ReadRegister(GPIO_DAT_OUT1, saved, DIAG_BLOCK_SIZE);
+    if(status == HAL_OK){
+        diag->pins = TCA8418_DIAG_MASK(&saved[KP_GPIO1 - GPIO_DAT_OUT1]);
+        status = TCA8418_DiagWalk(diag, saved);
+        restoreStatus = TCA8418_WriteRegister(GPIO_DAT_OUT1, saved, DIAG_BLOCK_SIZE);
+        if(status == HAL_OK){
+            status = restoreStatus;
+        }
+    }
+    /* Discard the events the reconfiguration produced */
+    if((status == HAL_OK) && (TCA8418_ReadEventCount(&eventCount) == HAL_OK)){
+        for(uint8_t i = 0; i < eventCount; i++){
+            (void)TCA8418_ReadRegister(KEY_EVENT_A, &data, 1);
+        }
+    }
+    data = cfgRegister;
+    restoreStatus = TCA8418_WriteRegister(CFG, &data, 1);
+    if(status == HAL_OK){
+        status = restoreStatus;
+    }
+    data = INT_STAT_ALL;
+    restoreStatus = TCA8418_WriteRegister(INT_STAT, &data, 1);
+    if(status == HAL_OK){
+        status = restoreStatus;
+    }
+    return status;
+}
+#endif
@@ -20,13 +20,248 @@ extern "C" {
 #include <stdint.h> 
 /* For HAL functions */
 #include "main.h"
+/* For the TCA8418_FEATURE_* switches */
+#include "tca8418_config.h"
+/* For the TCA8418_TRACE_* trace points */
+#include "tca8418_trace.h"
+
+/* Depth of the TCA8418 key event FIFO */
+#define TCA8418_FIFO_DEPTH 10
+
+/* Timeout of one blocking I2C transaction in milliseconds, replaces HAL_MAX_DELAY so every call is bounded */
+#ifndef TCA8418_I2C_TIMEOUT
+#define TCA8418_I2C_TIMEOUT 10
+#endif
+
+/* Extra attempts of a blocking transaction the TCA8418 did not acknowledge */
+#ifndef TCA8418_I2C_RETRIES
+#define TCA8418_I2C_RETRIES 0
+#endif
+
+/* Capacity of the driver event ring, must be a power of two not larger than 128 */
+#ifndef TCA8418_RING_SIZE
+#define TCA8418_RING_SIZE 32
+#endif
+
+/* Free ring slots required before a throttled drain is resumed */
+#ifndef TCA8418_RING_RESUME_THRESHOLD
+#define TCA8418_RING_RESUME_THRESHOLD TCA8418_FIFO_DEPTH
+#endif
+
+/* Batch size used to calibrate the drain strategy in TCA8418_Init(), 0 disables calibration */
+#ifndef TCA8418_AUTOTUNE_BATCH
+#define TCA8418_AUTOTUNE_BATCH 0
+#endif
+
+#if (TCA8418_AUTOTUNE_BATCH > 0) && !TCA8418_FEATURE_CALIBRATION
+#error "TCA8418_AUTOTUNE_BATCH requires TCA8418_FEATURE_CALIBRATION"
+#endif
+
+/* Time allowed for an IT or DMA read during calibration in milliseconds */
+#ifndef TCA8418_CALIBRATION_TIMEOUT
+#define TCA8418_CALIBRATION_TIMEOUT 10
+#endif
+
+/* Bus speeds tried by TCA8418_ProbeBus() in increasing order, the first one is the speed hi2c1 is initialized with */
+#ifndef TCA8418_PROBE_SPEEDS
+#define TCA8418_PROBE_SPEEDS        100000, 400000, 1000000
+#define TCA8418_PROBE_SPEED_COUNT   3
+#endif
+
+/* Period of the address probes sent while the TCA8418 is detached in milliseconds */
+#ifndef TCA8418_PRESENCE_PROBE_MS
+#define TCA8418_PRESENCE_PROBE_MS 100
+#endif
+
+/* Period of the GPIO output frames in milliseconds, 20 for 50 Hz */
+#ifndef TCA8418_OUTPUT_FRAME_MS
+#define TCA8418_OUTPUT_FRAME_MS 20
+#endif
+
+/* Write and readback pattern rounds per bus speed, 8 patterns each */
+#ifndef TCA8418_PROBE_ROUNDS
+#define TCA8418_PROBE_ROUNDS 4
+#endif
+
+/**
+ * @brief Ways of reading the TCA8418 FIFO
+ */
+typedef enum {
+    TCA8418_DRAIN_PER_REGISTER = 0, //< One blocking transaction per event
+    TCA8418_DRAIN_BURST,            //< One blocking transaction for all events
+    TCA8418_DRAIN_IT,               //< One interrupt driven transaction for all events
+    TCA8418_DRAIN_DMA,              //< One DMA transaction for all events
+    TCA8418_DRAIN_COUNT
+} TCA8418_DrainStrategy;
+
+/**
+ * @brief INT pin behaviour while interrupts are pending (CFG.INT_CFG)
+ */
+typedef enum {
+    TCA8418_INT_LATCHED = 0, //< INT stays asserted until every pending interrupt is cleared
+    TCA8418_INT_REASSERT     //< INT deasserts for 50 us on clear and reasserts if events are pending
+} TCA8418_IntMode;
+
+/**
+ * @brief Measurements of the last drain calibration
+ */
+typedef struct {
+    uint32_t cycles[TCA8418_DRAIN_COUNT]; //< Cycles taken by each strategy, UINT32_MAX if unavailable
+    uint8_t batchSize;                    //< Events read per measurement
+    TCA8418_DrainStrategy selected;       //< Fastest strategy
+} TCA8418_DrainCalibration;
+
+/**
+ * @brief Progress of the initialization
+ */
+typedef enum {
+    TCA8418_INIT_IDLE = 0,  //< Not initialized
+    TCA8418_INIT_BUSY,      //< TCA8418_InitAsync() transfers in flight
+    TCA8418_INIT_READY,     //< Configured, key events are delivered
+    TCA8418_INIT_FAILED     //< A configuration write failed
+} TCA8418_InitState;
+
+/**
+ * @brief Callback signalling the end of TCA8418_InitAsync()
+ * @param status HAL_OK once configured, otherwise HAL_ERROR
+ * @note Called from the I2C interrupt.
+ */
+typedef void (*TCA8418_ReadyCallback)(HAL_StatusTypeDef status);
+
+/**
+ * @brief Boot timing, TCA8418_GetCycles() values
+ */
+typedef struct {
+    uint32_t initStartCycles;   //< TCA8418_Init() or TCA8418_InitAsync() called
+    uint32_t readyCycles;       //< Configuration complete, interrupts enabled
+    uint32_t firstEventCycles;  //< First key event returned by TCA8418_ReadKeyEvents() or put in the event ring
+    uint8_t ready;              //< readyCycles is valid
+    uint8_t firstEvent;         //< firstEventCycles is valid
+} TCA8418_BootStats;
+
+/**
+ * @brief Result of the presence probe and bus speed selection
+ */
+typedef struct {
+    uint8_t present;                                //< TCA8418 acknowledged its address
+    uint8_t tested;                                 //< Speeds tested, from the first entry of TCA8418_PROBE_SPEEDS
+    uint16_t checks;                                //< Pattern checks per tested speed
+    uint16_t errors[TCA8418_PROBE_SPEED_COUNT];     //< Failed pattern checks per tested speed
+    uint32_t selectedHz;                            //< Fastest speed passing every check, hi2c1 is left at it, 0 if none
+    uint32_t failedHz;                              //< Slowest speed failing a check, 0 if every tested speed passed
+} TCA8418_BusProbe;
+
+/**
+ * @brief Presence changes reported by TCA8418_PollPresence()
+ */
+typedef enum {
+    TCA8418_DETACHED = 0,   //< The TCA8418 stopped acknowledging, driver calls fail until it is back
+    TCA8418_ATTACHED        //< The TCA8418 answers again and its configuration is restored
+} TCA8418_PresenceEvent;
+
+/**
+ * @brief Callback notified of presence changes
+ * @param event Presence change
+ */
+typedef void (*TCA8418_PresenceCallback)(TCA8418_PresenceEvent event);
+
+/**
+ * @brief Presence counters, times are TCA8418_GetCycles() values
+ */
+typedef struct {
+    uint32_t detaches;          //< Detaches seen
+    uint32_t reattaches;        //< Successful reattaches
+    uint32_t probes;            //< Address probes sent while detached
+    uint32_t reattachCycles;    //< Last reattach found by a probe
+    uint32_t readyCycles;       //< Configuration of the last reattach restored
+    uint32_t firstEventCycles;  //< First key event delivered after the last reattach
+    uint8_t firstEvent;         //< firstEventCycles is valid
+} TCA8418_PresenceStats;
+
+/**
+ * @brief Counters of the GPIO output frames
+ */
+typedef struct {
+    uint32_t frames;            //< Frames flushed with at least one changed byte
+    uint32_t bytesWritten;      //< GPIO_DAT_OUT bytes written
+    uint32_t changesMerged;     //< Output changes that did not need a write of their own
+    uint32_t deferred;          //< Flushes postponed because a key drain was pending
+} TCA8418_OutputStats;
+
+/**
+ * @brief Counters of the deferred drain
+ */
+typedef struct {
+    uint32_t requests;            //< INT edges seen by TCA8418_IRQHandler()
+    uint32_t coalesced;           //< Edges that arrived while a drain was already requested
+    uint32_t blocked;             //< Drains refused with HAL_BUSY by a preempted transaction and retried after it
+    uint32_t maxTopHalfCycles;    //< Longest time spent in TCA8418_IRQHandler()
+    uint32_t maxBottomHalfCycles; //< Longest time spent in TCA8418_DeferredHandler()
+} TCA8418_DeferredStats;
+
+/* GPIO output pins, same layout as the matrix pins below */
+#define TCA8418_GPIO_ROW(n)     (1UL << (n))
+#define TCA8418_GPIO_COL(n)     (1UL << (8 + (n)))
+
+/* Matrix pins: bits 7:0 ROW7:0, bits 17:8 COL9:0, the layout of the three GPIO register groups */
+#define TCA8418_DIAG_PINS       18
+#define TCA8418_DIAG_ROW(n)     (1UL << (n))
+#define TCA8418_DIAG_COL(n)     (1UL << (8 + (n)))
+
+/* Pin mask from three consecutive GPIO group registers */
+#define TCA8418_DIAG_MASK(regs) ((uint32_t)(regs)[0] | ((uint32_t)(regs)[1] << 8) | ((uint32_t)((regs)[2] & 0x03) << 16))
+
+/**
+ * @brief Results of the matrix diagnostic
+ */
+typedef struct {
+    uint32_t pins;                              //< Pins tested, the keypad rows and columns
+    uint32_t stuckLow;                          //< Pins reading low with nothing driven
+    uint32_t connections[TCA8418_DIAG_PINS];    //< Per driven pin, the other pins reading low
+    uint32_t patterns;                          //< Patterns driven
+    uint32_t cycles;                            //< TCA8418_GetCycles() time of all patterns
+} TCA8418_MatrixDiag;
+
+/**
+ * @brief Flow control counters of the event ring
+ */
+typedef struct {
+    uint32_t backpressureEngaged; //< Number of times draining was paused because the ring was full
+    uint32_t eventsHeld;          //< Events left buffered in the chip FIFO while paused
+    uint32_t eventsDropped;       //< Events discarded because the ring was full and flow control was off
+    uint32_t fifoOverflows;       //< Chip FIFO overflows, each one losing at least one event
+} TCA8418_FlowStats;
 
 /**
  * @brief Initialize TCA8418 with key events interrupt enabled
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note With TCA8418_FEATURE_MUX call it once per keypad with its channel selected. Every keypad
+ *       gets the same configuration from the shared shadow registers.
  */
 HAL_StatusTypeDef TCA8418_Init(void);
 
+#if TCA8418_FEATURE_ASYNC_INIT
+/**
+ * @brief Start the initialization with interrupt driven transfers and return
+ * @param callback Called when the configuration is complete or failed, NULL to poll TCA8418_GetInitState()
+ * @return HAL_StatusTypeDef HAL_OK if the first transfer started, HAL_BUSY if the bus is in use, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_InitAsync(TCA8418_ReadyCallback callback);
+
+/**
+ * @brief Get the progress of the initialization
+ * @return TCA8418_InitState Current state
+ */
+TCA8418_InitState TCA8418_GetInitState(void);
+
+/**
+ * @brief Get the boot timing
+ * @param stats Pointer to store the timing
+ */
+void TCA8418_GetBootStats(TCA8418_BootStats *stats);
+
+#endif
+
 /**
  * @brief Read key events from TCA8418 FIFO
  * @param keyEvents Array to store key events (up to 10 events)
@@ -35,9 +270,246 @@ HAL_StatusTypeDef TCA8418_Init(void);
  */
 HAL_StatusTypeDef TCA8418_ReadKeyEvents(uint8_t *keyEvents, uint8_t *numEvents);  
 
+#if TCA8418_FEATURE_RING
+/**
+ * @brief Drain pending key events from the TCA8418 FIFO into the event ring
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_ServiceInterrupt(void);
+#endif
+
+#if TCA8418_FEATURE_DEFERRED
+/**
+ * @brief Top half of the TCA8418 interrupt, call from HAL_GPIO_EXTI_Callback()
+ */
+void TCA8418_IRQHandler(void);
+
+/**
+ * @brief Bottom half of the TCA8418 interrupt, call from the low priority software interrupt
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_DeferredHandler(void);
+
+/**
+ * @brief Retry a deferred drain refused while hi2c1 was held, call after application transactions on hi2c1
+ */
+void TCA8418_BusReleased(void);
+
+/**
+ * @brief Get the counters of the deferred drain
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetDeferredStats(TCA8418_DeferredStats *stats);
+#endif
+
+#if TCA8418_FEATURE_RING
+/**
+ * @brief Take key events out of the event ring
+ * @param keyEvents Array to store key events
+ * @param maxEvents Capacity of keyEvents
+ * @param numEvents Pointer to store number of events taken
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_PopEvents(uint8_t *keyEvents, uint8_t maxEvents, uint8_t *numEvents);
+
+/**
+ * @brief Take key events out of the event ring without accessing the bus
+ * @param keyEvents Array to store key events
+ * @param maxEvents Capacity of keyEvents
+ * @return uint8_t Number of events taken
+ */
+uint8_t TCA8418_TakeEvents(uint8_t *keyEvents, uint8_t maxEvents);
+
+/**
+ * @brief Get the number of key events waiting in the event ring
+ * @return uint8_t Events waiting
+ */
+uint8_t TCA8418_PendingEvents(void);
+
+/**
+ * @brief Enable or disable flow control of the event ring
+ * @param enable 1 to leave events in the chip FIFO when the ring is full, 0 to drop them
+ */
+void TCA8418_SetFlowControl(uint8_t enable);
+
+/**
+ * @brief Get the flow control counters of the event ring
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetFlowStats(TCA8418_FlowStats *stats);
+
+/**
+ * @brief Complete an IT or DMA drain, call from HAL_I2C_MemRxCpltCallback()
+ * @param hi2c I2C handle passed to the HAL callback
+ */
+void TCA8418_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+#endif
+
+#if TCA8418_FEATURE_RING || TCA8418_FEATURE_ASYNC_INIT
+/**
+ * @brief Continue an IT or DMA drain or TCA8418_InitAsync(), call from HAL_I2C_MemTxCpltCallback()
+ * @param hi2c I2C handle passed to the HAL callback
+ */
+void TCA8418_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief Abort an IT or DMA drain or TCA8418_InitAsync(), call from HAL_I2C_ErrorCallback()
+ * @param hi2c I2C handle passed to the HAL callback
+ */
+void TCA8418_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+#endif
+
+/**
+ * @brief Select how the TCA8418 drives INT while events are pending
+ * @param mode Interrupt output mode
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note With TCA8418_FEATURE_MUX the mode and CFG shadow are shared by every keypad and written
+ *       back to the connected one by the drains, so the keypads stay in latched mode and any
+ *       other mode is refused with HAL_ERROR.
+ */
+HAL_StatusTypeDef TCA8418_SetInterruptMode(TCA8418_IntMode mode);
+
+/**
+ * @brief Select the strategy used to read the TCA8418 FIFO
+ * @param strategy Drain strategy
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note With TCA8418_FEATURE_MUX the strategy applies to every keypad. It only sets how the MCU
+ *       reads the FIFO, nothing is written to the keypad.
+ */
+HAL_StatusTypeDef TCA8418_SetDrainStrategy(TCA8418_DrainStrategy strategy);
+
+/**
+ * @brief Get the strategy used to read the TCA8418 FIFO
+ * @return TCA8418_DrainStrategy Current drain strategy
+ */
+TCA8418_DrainStrategy TCA8418_GetDrainStrategy(void);
+
+/**
+ * @brief Read the cycle counter used to time drain strategies
+ * @return uint32_t Current cycle count
+ */
+uint32_t TCA8418_GetCycles(void);
+
+/**
+ * @brief Reprogram hi2c1 to a bus speed, weak so the application can provide it
+ * @param hz Bus speed in Hz
+ * @return HAL_StatusTypeDef HAL_OK if hi2c1 runs at hz, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_SetBusSpeed(uint32_t hz);
+
+#if TCA8418_FEATURE_HOTPLUG
+/**
+ * @brief Set the callback notified of detaches and reattaches
+ * @param callback Callback, NULL to stop notifications
+ */
+void TCA8418_SetPresenceCallback(TCA8418_PresenceCallback callback);
+
+/**
+ * @brief Check whether the TCA8418 is currently considered fitted
+ * @return uint8_t 1 if fitted, 0 after a detach until the next reattach
+ */
+uint8_t TCA8418_IsPresent(void);
+
+/**
+ * @brief Report detaches and probe for a reattached TCA8418, call from the main loop
+ * @param now Current time in milliseconds
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code of the reconfiguration
+ */
+HAL_StatusTypeDef TCA8418_PollPresence(uint32_t now);
+
+/**
+ * @brief Get the presence counters and the reattach timing
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetPresenceStats(TCA8418_PresenceStats *stats);
+#endif
+
+#if TCA8418_STAMPS
+/**
+ * @brief Mark the oldest taken event handled and add its stamps to the stage statistics
+ */
+void TCA8418_StampHandled(void);
+
+/**
+ * @brief Get the latency of the handled events attributed to their stages
+ * @param stats Pointer to store the statistics, print them with TCA8418_Stamps_WriteReport()
+ */
+void TCA8418_GetStageStats(TCA8418_StageStats *stats);
+
+/**
+ * @brief Reset the stage statistics
+ */
+void TCA8418_ClearStageStats(void);
+#endif
+
+#if TCA8418_FEATURE_OUTPUTS
+/**
+ * @brief Configure GPIO pins as outputs driven from the output frame buffer
+ * @param pins TCA8418_GPIO_ROW() and TCA8418_GPIO_COL() bits of the pins, keypad pins are rejected
+ * @param levels Initial levels of the pins
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_ConfigureOutputs(uint32_t pins, uint32_t levels);
+
+/**
+ * @brief Change output levels in the frame buffer without bus access
+ * @param pins Output pins to change
+ * @param levels New levels of those pins
+ */
+void TCA8418_SetOutputs(uint32_t pins, uint32_t levels);
+
+/**
+ * @brief Write the changed bytes of the frame buffer once per frame, call from the main loop
+ * @param now Current time in milliseconds
+ * @return HAL_StatusTypeDef HAL_OK if flushed or not due, HAL_BUSY if postponed for a key drain, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_FlushOutputs(uint32_t now);
+
+/**
+ * @brief Get the counters of the GPIO output frames
+ * @param stats Pointer to store the counters
+ */
+void TCA8418_GetOutputStats(TCA8418_OutputStats *stats);
+#endif
+
+#if TCA8418_FEATURE_PROBE
+/**
+ * @brief Check that the TCA8418 is fitted and select the fastest reliable bus speed
+ * @param probe Pointer to store the result
+ * @return HAL_StatusTypeDef HAL_OK if a speed was selected, HAL_ERROR if the TCA8418 is absent or unreliable
+ */
+HAL_StatusTypeDef TCA8418_ProbeBus(TCA8418_BusProbe *probe);
+#endif
+
+#if TCA8418_FEATURE_CALIBRATION
+/**
+ * @brief Time every drain strategy and select the fastest one
+ * @param batchSize Number of events read per measurement (1 to 10)
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_CalibrateDrain(uint8_t batchSize);
+
+/**
+ * @brief Get the measurements of the last drain calibration
+ * @param calibration Pointer to store the measurements
+ */
+void TCA8418_GetDrainCalibration(TCA8418_DrainCalibration *calibration);
+#endif
+
+#if TCA8418_FEATURE_DIAG
+/**
+ * @brief Test the keypad matrix electrically for shorts and opens
+ * @param diag Pointer to store the results
+ * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_RunMatrixDiagnostic(TCA8418_MatrixDiag *diag);
+#endif
+
 /**
  * @brief Lock TCA8418 keypad except POWER key
  * @return HAL_StatusTypeDef HAL_OK if successful, otherwise error code
+ * @note With TCA8418_FEATURE_MUX it locks the keypad on the selected channel only. The shared
+ *       shadow registers it updates are not written back to the keypads in such builds.
  */
 HAL_StatusTypeDef TCA8418_LockKeypad(void);
 
@@ -0,0 +1,103 @@
+/**
+ * @file tca8418_config.h
+ * @brief TCA8418 library feature configuration
+ * @details This header file selects the subsystems compiled into the library.
+ *          A profile enables a group of features at once, and each feature can
+ *          still be set to 0 or 1 on its own, e.g. with -DTCA8418_FEATURE_DIAG=0.
+ *          A disabled feature compiles to nothing: its code and state are left
+ *          out, driver functions are no longer declared in tca8418.h and an
+ *          optional module becomes an empty translation unit, so the files can
+ *          stay in the project.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_CONFIG_H__
+#define __TCA8418_CONFIG_H__
+
+/* Profiles */
+#define TCA8418_PROFILE_MINIMAL     1 //< Init, TCA8418_ReadKeyEvents(), locking and mode selection only
+#define TCA8418_PROFILE_STANDARD    2 //< Adds the event ring, IT and DMA drains, the deferred drain, async init, HID and gestures
+#define TCA8418_PROFILE_FULL        3 //< Every subsystem of a single keypad
+
+#ifndef TCA8418_PROFILE
+#define TCA8418_PROFILE TCA8418_PROFILE_FULL
+#endif
+
+/* Driver subsystems in tca8418.c */
+#ifndef TCA8418_FEATURE_RING
+#define TCA8418_FEATURE_RING        (TCA8418_PROFILE >= TCA8418_PROFILE_STANDARD) //< Event ring, flow control, IT and DMA drains
+#endif
+#ifndef TCA8418_FEATURE_DEFERRED
+#define TCA8418_FEATURE_DEFERRED    (TCA8418_PROFILE >= TCA8418_PROFILE_STANDARD) //< Top and bottom half interrupt handling
+#endif
+#ifndef TCA8418_FEATURE_ASYNC_INIT
+#define TCA8418_FEATURE_ASYNC_INIT  (TCA8418_PROFILE >= TCA8418_PROFILE_STANDARD) //< Interrupt driven initialization and boot timing
+#endif
+#ifndef TCA8418_FEATURE_CALIBRATION
+#define TCA8418_FEATURE_CALIBRATION (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< Drain strategy calibration
+#endif
+#ifndef TCA8418_FEATURE_PROBE
+#define TCA8418_FEATURE_PROBE       (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< Presence probe and bus speed selection
+#endif
+#ifndef TCA8418_FEATURE_HOTPLUG
+#define TCA8418_FEATURE_HOTPLUG     (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< Detach detection and reattach
+#endif
+#ifndef TCA8418_FEATURE_OUTPUTS
+#define TCA8418_FEATURE_OUTPUTS     (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< Frame-buffered GPIO outputs
+#endif
+#ifndef TCA8418_FEATURE_DIAG
+#define TCA8418_FEATURE_DIAG        (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< Matrix diagnostic
+#endif
+
+/* Optional modules, each one compiles to nothing when disabled */
+#ifndef TCA8418_FEATURE_HID
+#define TCA8418_FEATURE_HID         (TCA8418_PROFILE >= TCA8418_PROFILE_STANDARD) //< tca8418_hid.c
+#endif
+#ifndef TCA8418_FEATURE_GESTURE
+#define TCA8418_FEATURE_GESTURE     (TCA8418_PROFILE >= TCA8418_PROFILE_STANDARD) //< tca8418_gesture.c
+#endif
+#ifndef TCA8418_FEATURE_XCORE
+#define TCA8418_FEATURE_XCORE       (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< tca8418_xcore.c
+#endif
+#ifndef TCA8418_FEATURE_STREAM
+#define TCA8418_FEATURE_STREAM      (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< tca8418_stream.c
+#endif
+#ifndef TCA8418_FEATURE_TEXT
+#define TCA8418_FEATURE_TEXT        (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< tca8418_text.c
+#endif
+#ifndef TCA8418_FEATURE_WEAR
+#define TCA8418_FEATURE_WEAR        (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< tca8418_wear.c
+#endif
+#ifndef TCA8418_FEATURE_MODELS
+#define TCA8418_FEATURE_MODELS      (TCA8418_PROFILE >= TCA8418_PROFILE_FULL)     //< tca8418_power.c and tca8418_wcet.c
+#endif
+
+/* Modules needing a third-party library, enabled on their own and never by a profile */
+#ifndef TCA8418_FEATURE_LVGL
+#define TCA8418_FEATURE_LVGL        0 //< tca8418_lvgl.c, needs the LVGL headers
+#endif
+
+/* Several keypads behind a multiplexer, enabled on their own: the driver keeps the state of one device */
+#ifndef TCA8418_FEATURE_MUX
+#define TCA8418_FEATURE_MUX         0 //< tca8418_mux.c
+#endif
+
+#if TCA8418_FEATURE_LVGL && !TCA8418_FEATURE_RING
+#error "TCA8418_FEATURE_LVGL requires TCA8418_FEATURE_RING"
+#endif
+
+#if TCA8418_FEATURE_DEFERRED && !TCA8418_FEATURE_RING
+#error "TCA8418_FEATURE_DEFERRED requires TCA8418_FEATURE_RING"
+#endif
+
+/* The ring, the presence state and the output frame would mix the events and pins of every keypad,
+   the asynchronous initialization runs for one keypad at a time and calibration would tune every
+   keypad to the one it measured */
+#if TCA8418_FEATURE_MUX && (TCA8418_FEATURE_RING || TCA8418_FEATURE_HOTPLUG || TCA8418_FEATURE_OUTPUTS || \
+                            TCA8418_FEATURE_ASYNC_INIT || TCA8418_FEATURE_CALIBRATION)
+#error "TCA8418_FEATURE_MUX cannot be combined with TCA8418_FEATURE_RING, TCA8418_FEATURE_HOTPLUG, TCA8418_FEATURE_OUTPUTS, TCA8418_FEATURE_ASYNC_INIT or TCA8418_FEATURE_CALIBRATION"
+#endif
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file tca8418_gesture.c
+ * @brief TCA8418 tap gesture recognizer implementation
+ * @details This file contains the implementation of the per-key tap, multi-tap
+ *          and hold state machines and of the deadline queue they share.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_gesture.h"
+/* For TCA8418_FEATURE_GESTURE */
+#include "tca8418_config.h"
+
+#if TCA8418_FEATURE_GESTURE
+
+/* Slot states */
+#define STATE_FREE      0 //< Slot not tracking a key
+#define STATE_PRESSED   1 //< Key down, deadline is the hold time
+#define STATE_RELEASED  2 //< Key up between taps, deadline is the tap gap
+#define STATE_HELD      3 //< Hold reported, waiting for the release
+
+/* End of the deadline queue */
+#define QUEUE_END       0xFF
+
+/**
+ * @brief Compare two times, tolerating tick counter wrap around
+ * @param a First time
+ * @param b Second time
+ * @return uint8_t 1 if a is not later than b, otherwise 0
+ */
+static inline uint8_t TCA8418_Gesture_NotLater(uint32_t a, uint32_t b){
+    return ((int32_t)(a - b) <= 0) ? 1 : 0;
+}
+
+/**
+ * @brief Remove a slot from the deadline queue
+ * @param recognizer Recognizer state
+ * @param index Slot index
+ */
+static void TCA8418_Gesture_Unschedule(TCA8418_GestureRecognizer *recognizer, uint8_t index){
+    uint8_t *link = &recognizer->queueHead;
+    while(*link != QUEUE_END){
+        if(*link == index){
+            *link = recognizer->slots[index].next;
+            return;
+        }
+        link = &recognizer->slots[*link].next;
+    }
+}
+
+/**
+ * @brief Insert a slot into the deadline queue, ordered by deadline
+ * @param recognizer Recognizer state
+ * @param index Slot index
+ * @param deadline Time at which the slot times out
+ */
+static void TCA8418_Gesture_Schedule(TCA8418_GestureRecognizer *recognizer, uint8_t index, uint32_t deadline){
+    uint8_t *link = &recognizer->queueHead;
+    recognizer->slots[index].deadline = deadline;
+    while((*link != QUEUE_END) && TCA8418_Gesture_NotLater(recognizer->slots[*link].deadline, deadline)){
+        link = &recognizer->slots[*link].next;
+    }
+    recognizer->slots[index].next = *link;
+    *link = index;
+}
+
+/**
+ * @brief Find the slot tracking a key
+ * @param recognizer Recognizer state
+ * @param key Key number
+ * @return uint8_t Slot index, QUEUE_END if the key is not tracked
+ */
+static uint8_t TCA8418_Gesture_Find(const TCA8418_GestureRecognizer *recognizer, uint8_t key){
+    for(uint8_t i = 0; i < TCA8418_GESTURE_SLOTS; i++){
+        if((recognizer->slots[i].state != STATE_FREE) && (recognizer->slots[i].key == key)){
+            return i;
+        }
+    }
+    return QUEUE_END;
+}
+
+/**
+ * @brief Handle a key press
+ * @param recognizer Recognizer state
+ * @param key Key number
+ * @param now Time of the press in milliseconds
+ */
+static void TCA8418_Gesture_Press(TCA8418_GestureRecognizer *recognizer, uint8_t key, uint32_t now){
+    uint8_t index = TCA8418_Gesture_Find(recognizer, key);
+    TCA8418_GestureSlot *slot;
+    if(index == QUEUE_END){
+        for(index = 0; index < TCA8418_GESTURE_SLOTS; index++){
+            if(recognizer->slots[index].state == STATE_FREE){
+                break;
+            }
+        }
+        if(index == TCA8418_GESTURE_SLOTS){
+            return; // Every slot busy, the key is not tracked
+        }
+        recognizer->slots[index].key = key;
+        recognizer->slots[index].taps = 0;
+    }
+    slot = &recognizer->slots[index];
+    if(slot->state == STATE_RELEASED){
+        TCA8418_Gesture_Unschedule(recognizer, index);
+    } else if(slot->state != STATE_FREE){
+        return; // Already down
+    }
+    slot->state = STATE_PRESSED;
+    TCA8418_Gesture_Schedule(recognizer, index, now + recognizer->holdMs);
+}
+
+/**
+ * @brief Handle a key release
+ * @param recognizer Recognizer state
+ * @param key Key number
+ * @param now Time of the release in milliseconds
+ */
+static void TCA8418_Gesture_Release(TCA8418_GestureRecognizer *recognizer, uint8_t key, uint32_t now){
+    uint8_t index = TCA8418_Gesture_Find(recognizer, key);
+    TCA8418_GestureSlot *slot;
+    if(index == QUEUE_END){
+        return;
+    }
+    slot = &recognizer->slots[index];
+    if(slot->state == STATE_HELD){
+        slot->state = STATE_FREE;
+        recognizer->callback(key, TCA8418_GESTURE_HOLD_END, slot->taps);
+        return;
+    }
+    if(slot->state != STATE_PRESSED){
+        return;
+    }
+    TCA8418_Gesture_Unschedule(recognizer, index);
+    slot->taps++;
+    if(slot->taps >= TCA8418_GESTURE_MAX_TAPS){
+        slot->state = STATE_FREE;
+        recognizer->callback(key, TCA8418_GESTURE_TAP, slot->taps);
+        return;
+    }
+    slot->state = STATE_RELEASED;
+    TCA8418_Gesture_Schedule(recognizer, index, now + recognizer->tapGapMs);
+}
+
+/**
+ * @brief Initialize the recognizer
+ * @param recognizer Recognizer state
+ * @param callback Sink of recognized gestures
+ * @param tapGapMs Longest release before the next tap of a sequence in milliseconds
+ * @param holdMs Shortest press reported as a hold in milliseconds
+ */
+void TCA8418_Gesture_Init(TCA8418_GestureRecognizer *recognizer, TCA8418_GestureCallback callback,
+                          uint16_t tapGapMs, uint16_t holdMs){
+    recognizer->callback = callback;
+    recognizer->tapGapMs = tapGapMs;
+    recognizer->holdMs = holdMs;
+    recognizer->queueHead = QUEUE_END;
+    for(uint8_t i = 0; i < TCA8418_GESTURE_SLOTS; i++){
+        recognizer->slots[i].state = STATE_FREE;
+        recognizer->slots[i].next = QUEUE_END;
+    }
+}
+
+/**
+ * @brief Feed drained key events to the recognizer
+ * @param recognizer Recognizer state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ * @note Deadlines up to now are resolved first, so a press that outlived the hold
+ *       time is reported as a hold even if its release is in this batch.
+ */
+void TCA8418_Gesture_ProcessEvents(TCA8418_GestureRecognizer *recognizer, const uint8_t *keyEvents,
+                                   uint8_t numEvents, uint32_t now){
+    TCA8418_Gesture_Poll(recognizer, now);
+    for(uint8_t i = 0; i < numEvents; i++){
+        uint8_t key = keyEvents[i] & 0x7F; // Bits 6:0
+        if(keyEvents[i] & 0x80){ // Bit 7
+            TCA8418_Gesture_Press(recognizer, key, now);
+        } else {
+            TCA8418_Gesture_Release(recognizer, key, now);
+        }
+    }
+}
+
+/**
+ * @brief Report the gestures whose deadline has passed
+ * @param recognizer Recognizer state
+ * @param now Current time in milliseconds
+ * @note Only expired slots at the head of the queue are visited.
+ */
+void TCA8418_Gesture_Poll(TCA8418_GestureRecognizer *recognizer, uint32_t now){
+    while(recognizer->queueHead != QUEUE_END){
+        uint8_t index = recognizer->queueHead;
+        TCA8418_GestureSlot *slot = &recognizer->slots[index];
+        if(!TCA8418_Gesture_NotLater(slot->deadline, now)){
+            return;
+        }
+        recognizer->queueHead = slot->next;
+        if(slot->state == STATE_PRESSED){
+            slot->state = STATE_HELD;
+            recognizer->callback(slot->key, TCA8418_GESTURE_HOLD, slot->taps);
+        } else {
+            slot->state = STATE_FREE;
+            recognizer->callback(slot->key, TCA8418_GESTURE_TAP, slot->taps);
+        }
+    }
+}
+
+/**
+ * @brief Get the earliest pending deadline
+ * @param recognizer Recognizer state
+ * @param deadline Pointer to store the deadline in milliseconds
+ * @return uint8_t 1 if a deadline is pending, 0 if the MCU can sleep until the next key event
+ */
+uint8_t TCA8418_Gesture_NextDeadline(const TCA8418_GestureRecognizer *recognizer, uint32_t *deadline){
+    if(recognizer->queueHead == QUEUE_END){
+        return 0;
+    }
+    *deadline = recognizer->slots[recognizer->queueHead].deadline;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file tca8418_gesture.h
+ * @brief TCA8418 tap gesture recognizer header
+ * @details This header file contains the declarations of a per-key gesture
+ *          recognizer that classifies press and release sequences into taps,
+ *          double and triple taps and holds, with all pending timeouts kept
+ *          in one shared deadline queue.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_GESTURE_H__
+#define __TCA8418_GESTURE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Number of keys tracked at the same time */
+#ifndef TCA8418_GESTURE_SLOTS
+#define TCA8418_GESTURE_SLOTS 8
+#endif
+
+/* Most taps counted in one sequence, reaching it reports the taps at once */
+#ifndef TCA8418_GESTURE_MAX_TAPS
+#define TCA8418_GESTURE_MAX_TAPS 3
+#endif
+
+/**
+ * @brief Recognized gestures
+ */
+typedef enum {
+    TCA8418_GESTURE_TAP = 0,   //< taps quick presses, 1 single, 2 double, 3 triple tap
+    TCA8418_GESTURE_HOLD,      //< Key held past the hold time after taps quick presses, tap-hold when taps > 0
+    TCA8418_GESTURE_HOLD_END   //< Held key released
+} TCA8418_Gesture;
+
+/**
+ * @brief Callback receiving recognized gestures
+ * @param key Key number (bits 6:0 of the event)
+ * @param gesture Recognized gesture
+ * @param taps Number of taps in the sequence
+ */
+typedef void (*TCA8418_GestureCallback)(uint8_t key, TCA8418_Gesture gesture, uint8_t taps);
+
+/**
+ * @brief State of one tracked key
+ */
+typedef struct {
+    uint8_t key;        //< Key number
+    uint8_t state;      //< Sequence state
+    uint8_t taps;       //< Taps completed so far
+    uint8_t next;       //< Next slot in the deadline queue
+    uint32_t deadline;  //< Time at which the current state times out
+} TCA8418_GestureSlot;
+
+/**
+ * @brief Gesture recognizer state
+ */
+typedef struct {
+    TCA8418_GestureCallback callback;                  //< Sink of recognized gestures
+    uint16_t tapGapMs;                                 //< Longest release before the next tap of a sequence
+    uint16_t holdMs;                                   //< Shortest press reported as a hold
+    uint8_t queueHead;                                 //< Slot with the earliest deadline
+    TCA8418_GestureSlot slots[TCA8418_GESTURE_SLOTS];  //< Tracked keys
+} TCA8418_GestureRecognizer;
+
+/**
+ * @brief Initialize the recognizer
+ * @param recognizer Recognizer state
+ * @param callback Sink of recognized gestures
+ * @param tapGapMs Longest release before the next tap of a sequence in milliseconds
+ * @param holdMs Shortest press reported as a hold in milliseconds
+ */
+void TCA8418_Gesture_Init(TCA8418_GestureRecognizer *recognizer, TCA8418_GestureCallback callback,
+                          uint16_t tapGapMs, uint16_t holdMs);
+
+/**
+ * @brief Feed drained key events to the recognizer
+ * @param recognizer Recognizer state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ */
+void TCA8418_Gesture_ProcessEvents(TCA8418_GestureRecognizer *recognizer, const uint8_t *keyEvents,
+                                   uint8_t numEvents, uint32_t now);
+
+/**
+ * @brief Report the gestures whose deadline has passed
+ * @param recognizer Recognizer state
+ * @param now Current time in milliseconds
+ */
+void TCA8418_Gesture_Poll(TCA8418_GestureRecognizer *recognizer, uint32_t now);
+
+/**
+ * @brief Get the earliest pending deadline
+ * @param recognizer Recognizer state
+ * @param deadline Pointer to store the deadline in milliseconds
+ * @return uint8_t 1 if a deadline is pending, 0 if the MCU can sleep until the next key event
+ */
+uint8_t TCA8418_Gesture_NextDeadline(const TCA8418_GestureRecognizer *recognizer, uint32_t *deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
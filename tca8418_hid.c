@@ -0,0 +1,179 @@
+/**
+ * @file tca8418_hid.c
+ * @brief TCA8418 USB HID keyboard report implementation
+ * @details This file contains the implementation of the incremental boot
+ *          protocol and NKRO report builder.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_hid.h"
+/* For TCA8418_FEATURE_HID */
+#include "tca8418_config.h"
+
+#if TCA8418_FEATURE_HID
+
+/* Offsets in the boot protocol report */
+#define BOOT_MODIFIERS  0 //< Modifier bits
+#define BOOT_KEYS       2 //< First of the 6 key slots
+#define BOOT_SLOTS      6 //< Number of key slots
+
+/* Offsets in the NKRO report */
+#define NKRO_MODIFIERS  0 //< Modifier bits
+#define NKRO_BITMAP     1 //< First byte of the usage bitmap
+
+/**
+ * @brief Rebuild the boot key slots from the NKRO bitmap
+ * @param hid Report state
+ * @note Only used when leaving the rollover state, when the slots hold no key list.
+ */
+static void TCA8418_HID_RebuildBootKeys(TCA8418_HID *hid){
+    hid->bootKeys = 0;
+    for(uint8_t i = 0; i < (TCA8418_HID_NKRO_SIZE - NKRO_BITMAP); i++){
+        uint8_t bits = hid->nkroReport[NKRO_BITMAP + i];
+        while(bits != 0){
+            uint8_t bit = (uint8_t)__builtin_ctz(bits);
+            hid->bootReport[BOOT_KEYS + hid->bootKeys++] = (uint8_t)(i * 8 + bit);
+            bits &= (uint8_t)(bits - 1);
+        }
+    }
+    for(uint8_t i = hid->bootKeys; i < BOOT_SLOTS; i++){
+        hid->bootReport[BOOT_KEYS + i] = 0;
+    }
+}
+
+/**
+ * @brief Count a key press or release on its usage
+ * @param hid Report state
+ * @param key Key number
+ * @param usage HID usage of the key
+ * @param isPress 1 for a press, 0 for a release
+ * @return uint8_t 1 if the usage changes state in the reports, otherwise 0
+ * @note Keys mapped to the same usage hold it together, it is released with the last of them.
+ *       A repeated press or a release of a key that is not held is ignored.
+ */
+static uint8_t TCA8418_HID_Count(TCA8418_HID *hid, uint8_t key, uint8_t usage, uint8_t isPress){
+    uint8_t *byte = &hid->keysHeld[key >> 3];
+    uint8_t mask = (uint8_t)(1U << (key & 7));
+    if(isPress){
+        if(*byte & mask){
+            return 0;
+        }
+        *byte |= mask;
+        return (hid->usageHolds[usage]++ == 0) ? 1 : 0;
+    }
+    if(!(*byte & mask)){
+        return 0;
+    }
+    *byte &= (uint8_t)~mask;
+    return (--hid->usageHolds[usage] == 0) ? 1 : 0;
+}
+
+/**
+ * @brief Apply a press of a non-modifier usage
+ * @param hid Report state
+ * @param usage HID usage
+ */
+static void TCA8418_HID_Press(TCA8418_HID *hid, uint8_t usage){
+    hid->nkroReport[NKRO_BITMAP + (usage >> 3)] |= (uint8_t)(1U << (usage & 7));
+    hid->heldKeys++;
+    if(hid->heldKeys <= BOOT_SLOTS){
+        hid->bootReport[BOOT_KEYS + hid->bootKeys++] = usage;
+    } else if(hid->heldKeys == BOOT_SLOTS + 1){
+        /* Too many keys for the boot report, report ErrorRollOver in every slot */
+        for(uint8_t i = 0; i < BOOT_SLOTS; i++){
+            hid->bootReport[BOOT_KEYS + i] = TCA8418_HID_ERROR_ROLLOVER;
+        }
+    }
+}
+
+/**
+ * @brief Apply a release of a non-modifier usage
+ * @param hid Report state
+ * @param usage HID usage
+ */
+static void TCA8418_HID_Release(TCA8418_HID *hid, uint8_t usage){
+    hid->nkroReport[NKRO_BITMAP + (usage >> 3)] &= (uint8_t)~(1U << (usage & 7));
+    hid->heldKeys--;
+    if(hid->heldKeys == BOOT_SLOTS){
+        TCA8418_HID_RebuildBootKeys(hid);
+        return;
+    }
+    if(hid->heldKeys > BOOT_SLOTS){
+        return; // Still in rollover
+    }
+    /* Remove the usage and close the gap, keeping the press order */
+    for(uint8_t i = 0; i < hid->bootKeys; i++){
+        if(hid->bootReport[BOOT_KEYS + i] != usage){
+            continue;
+        }
+        hid->bootKeys--;
+        for(; i < hid->bootKeys; i++){
+            hid->bootReport[BOOT_KEYS + i] = hid->bootReport[BOOT_KEYS + i + 1];
+        }
+        hid->bootReport[BOOT_KEYS + hid->bootKeys] = 0;
+        return;
+    }
+}
+
+/**
+ * @brief Reset the reports and select the keymap
+ * @param hid Report state
+ * @param keymap Table of TCA8418_HID_KEYMAP_SIZE HID usages indexed by key number
+ */
+void TCA8418_HID_Init(TCA8418_HID *hid, const uint8_t *keymap){
+    hid->keymap = keymap;
+    for(uint8_t i = 0; i < TCA8418_HID_BOOT_SIZE; i++){
+        hid->bootReport[i] = 0;
+    }
+    for(uint8_t i = 0; i < TCA8418_HID_NKRO_SIZE; i++){
+        hid->nkroReport[i] = 0;
+    }
+    for(uint8_t i = 0; i < sizeof(hid->keysHeld); i++){
+        hid->keysHeld[i] = 0;
+    }
+    for(uint16_t i = 0; i < sizeof(hid->usageHolds); i++){
+        hid->usageHolds[i] = 0;
+    }
+    hid->bootKeys = 0;
+    hid->heldKeys = 0;
+    hid->changed = 1;
+}
+
+/**
+ * @brief Apply drained key events to the reports
+ * @param hid Report state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @note Each event only touches the report bytes it changes, except when the number of
+ *       held keys drops back to 6 and the boot slots are rebuilt from the bitmap. A usage
+ *       mapped to several keys stays reported until the last of them is released.
+ *       Call TCA8418_HID_TakeChanged() from the same context as this function.
+ */
+void TCA8418_HID_ProcessEvents(TCA8418_HID *hid, const uint8_t *keyEvents, uint8_t numEvents){
+    for(uint8_t i = 0; i < numEvents; i++){
+        uint8_t isPress = (keyEvents[i] & 0x80) ? 1 : 0; // Bit 7
+        uint8_t key = keyEvents[i] & 0x7F; // Bits 6:0
+        uint8_t usage = hid->keymap[key];
+        if((usage == 0) || (usage > TCA8418_HID_RIGHT_GUI) || !TCA8418_HID_Count(hid, key, usage, isPress)){
+            continue;
+        }
+        if(usage >= TCA8418_HID_LEFT_CTRL){
+            uint8_t mask = (uint8_t)(1U << (usage - TCA8418_HID_LEFT_CTRL));
+            if(isPress){
+                hid->bootReport[BOOT_MODIFIERS] |= mask;
+            } else {
+                hid->bootReport[BOOT_MODIFIERS] &= (uint8_t)~mask;
+            }
+            hid->nkroReport[NKRO_MODIFIERS] = hid->bootReport[BOOT_MODIFIERS];
+        } else if(isPress){
+            TCA8418_HID_Press(hid, usage);
+        } else {
+            TCA8418_HID_Release(hid, usage);
+        }
+        hid->changed = 1;
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file tca8418_hid.h
+ * @brief TCA8418 USB HID keyboard report header
+ * @details This header file contains the declarations for building USB HID
+ *          keyboard reports from drained TCA8418 key events. The boot protocol
+ *          6KRO report and the NKRO bitmap report are updated incrementally as
+ *          events arrive, so a report is ready to send on every USB poll.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_HID_H__
+#define __TCA8418_HID_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t */
+#include <stdint.h>
+
+/* Key number reported by the TCA8418 for a keypad row and column */
+#define TCA8418_KEY(row, col)       ((uint8_t)((row) * 10 + (col) + 1))
+
+/* Number of entries of a keymap, indexed by key number (bits 6:0 of an event) */
+#define TCA8418_HID_KEYMAP_SIZE     128
+
+/* Size of the boot protocol report: modifiers, reserved, 6 keys */
+#define TCA8418_HID_BOOT_SIZE       8
+
+/* Size of the NKRO report: modifiers, then one bit per usage 0x00 to 0xDF */
+#define TCA8418_HID_NKRO_SIZE       29
+
+/* HID usages with special meaning in the reports */
+#define TCA8418_HID_ERROR_ROLLOVER  0x01 //< Reported in every boot slot when more than 6 keys are held
+#define TCA8418_HID_LEFT_CTRL       0xE0 //< First modifier usage
+#define TCA8418_HID_RIGHT_GUI       0xE7 //< Last modifier usage
+
+/**
+ * @brief Keyboard report state
+ */
+typedef struct {
+    const uint8_t *keymap;                         //< Key number to HID usage, 0 for unmapped keys
+    uint8_t bootReport[TCA8418_HID_BOOT_SIZE];     //< Boot protocol 6KRO report
+    uint8_t nkroReport[TCA8418_HID_NKRO_SIZE];     //< NKRO bitmap report
+    uint8_t keysHeld[TCA8418_HID_KEYMAP_SIZE / 8]; //< Key numbers pressed, one bit each
+    uint8_t usageHolds[TCA8418_HID_RIGHT_GUI + 1]; //< Keys holding each usage, the usage is released at 0
+    uint8_t bootKeys;                              //< Keys in the boot report slots
+    uint8_t heldKeys;                              //< Non-modifier usages held
+    uint8_t changed;                               //< Reports changed since the last TCA8418_HID_TakeChanged()
+} TCA8418_HID;
+
+/**
+ * @brief Reset the reports and select the keymap
+ * @param hid Report state
+ * @param keymap Table of TCA8418_HID_KEYMAP_SIZE HID usages indexed by key number
+ */
+void TCA8418_HID_Init(TCA8418_HID *hid, const uint8_t *keymap);
+
+/**
+ * @brief Apply drained key events to the reports
+ * @param hid Report state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ */
+void TCA8418_HID_ProcessEvents(TCA8418_HID *hid, const uint8_t *keyEvents, uint8_t numEvents);
+
+/**
+ * @brief Get the boot protocol report
+ * @param hid Report state
+ * @return const uint8_t* TCA8418_HID_BOOT_SIZE bytes ready to send
+ */
+static inline const uint8_t *TCA8418_HID_BootReport(const TCA8418_HID *hid){
+    return hid->bootReport;
+}
+
+/**
+ * @brief Get the NKRO report
+ * @param hid Report state
+ * @return const uint8_t* TCA8418_HID_NKRO_SIZE bytes ready to send
+ */
+static inline const uint8_t *TCA8418_HID_NkroReport(const TCA8418_HID *hid){
+    return hid->nkroReport;
+}
+
+/**
+ * @brief Check whether the reports changed since the last call and reset the flag
+ * @param hid Report state
+ * @return uint8_t 1 if a new report must be sent, otherwise 0
+ */
+static inline uint8_t TCA8418_HID_TakeChanged(TCA8418_HID *hid){
+    uint8_t changed = hid->changed;
+    hid->changed = 0;
+    return changed;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
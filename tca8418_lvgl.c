@@ -0,0 +1,111 @@
+/**
+ * @file tca8418_lvgl.c
+ * @brief TCA8418 LVGL keypad input device implementation
+ * @details This file contains the read callback and the registration of the
+ *          keypad input device for LVGL 8 and LVGL 9.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+/* For TCA8418_FEATURE_LVGL, included first because tca8418_lvgl.h needs the LVGL headers */
+#include "tca8418_config.h"
+
+#if TCA8418_FEATURE_LVGL
+
+#include "tca8418_lvgl.h"
+
+/* For NULL */
+#include <stddef.h>
+
+const uint32_t TCA8418_Lvgl_DefaultKeymap[TCA8418_LVGL_KEYMAP_SIZE] = {
+    [1] = LV_KEY_UP,
+    [2] = LV_KEY_DOWN,
+    [3] = LV_KEY_LEFT,
+    [4] = LV_KEY_RIGHT,
+    [5] = LV_KEY_ENTER,
+    [6] = LV_KEY_ESC,
+    [7] = LV_KEY_NEXT,
+};
+
+/**
+ * @brief Fill one LVGL read from the event source
+ * @param lvgl Input device state
+ * @param data LVGL input data to fill
+ * @note Reports one event per read as a keypad device must. Events of keys mapped to 0 are
+ *       skipped. Without new events the last key is repeated with its state, as LVGL expects.
+ */
+void TCA8418_Lvgl_Read(TCA8418_Lvgl *lvgl, lv_indev_data_t *data){
+    uint8_t event;
+    while(lvgl->take(&event, 1) == 1){
+        uint32_t key = lvgl->keymap[event & 0x7F];
+        if(key != 0){
+            lvgl->lastKey = key;
+            lvgl->lastPressed = (event & 0x80) ? 1 : 0;
+            break;
+        }
+    }
+    data->key = lvgl->lastKey;
+    data->state = lvgl->lastPressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+    /* LVGL calls the callback again in this cycle, so a drained batch is delivered at once */
+    data->continue_reading = (lvgl->pending != NULL) && (lvgl->pending() > 0);
+}
+
+#if LVGL_VERSION_MAJOR >= 9
+/**
+ * @brief LVGL 9 read callback
+ * @param indev Input device
+ * @param data LVGL input data to fill
+ */
+static void TCA8418_Lvgl_ReadCallback(lv_indev_t *indev, lv_indev_data_t *data){
+    TCA8418_Lvgl_Read((TCA8418_Lvgl *)lv_indev_get_user_data(indev), data);
+}
+#else
+/**
+ * @brief LVGL 8 read callback
+ * @param driver Input device driver
+ * @param data LVGL input data to fill
+ */
+static void TCA8418_Lvgl_ReadCallback(lv_indev_drv_t *driver, lv_indev_data_t *data){
+    TCA8418_Lvgl_Read((TCA8418_Lvgl *)driver->user_data, data);
+}
+#endif
+
+/**
+ * @brief Create the LVGL keypad input device
+ * @param lvgl Input device state, must outlive the input device
+ * @param keymap Table of TCA8418_LVGL_KEYMAP_SIZE key codes indexed by key number, NULL for the default keymap
+ * @param take Event source, TCA8418_TakeEvents on the target
+ * @param pending Events left in the source, TCA8418_PendingEvents on the target
+ * @return lv_indev_t* Input device to add to a group with lv_indev_set_group(), NULL on failure
+ */
+lv_indev_t *TCA8418_Lvgl_Create(TCA8418_Lvgl *lvgl, const uint32_t *keymap, TCA8418_LvglTake take,
+                                TCA8418_LvglPending pending){
+    lv_indev_t *indev;
+    if(take == NULL){
+        return NULL;
+    }
+    lvgl->keymap = (keymap != NULL) ? keymap : TCA8418_Lvgl_DefaultKeymap;
+    lvgl->take = take;
+    lvgl->pending = pending;
+    lvgl->lastKey = 0;
+    lvgl->lastPressed = 0;
+#if LVGL_VERSION_MAJOR >= 9
+    indev = lv_indev_create();
+    if(indev == NULL){
+        return NULL;
+    }
+    lv_indev_set_type(indev, LV_INDEV_TYPE_KEYPAD);
+    lv_indev_set_read_cb(indev, TCA8418_Lvgl_ReadCallback);
+    lv_indev_set_user_data(indev, lvgl);
+#else
+    lv_indev_drv_init(&lvgl->driver);
+    lvgl->driver.type = LV_INDEV_TYPE_KEYPAD;
+    lvgl->driver.read_cb = TCA8418_Lvgl_ReadCallback;
+    lvgl->driver.user_data = lvgl;
+    indev = lv_indev_drv_register(&lvgl->driver);
+#endif
+    return indev;
+}
+
+#endif
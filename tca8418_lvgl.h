@@ -0,0 +1,86 @@
+/**
+ * @file tca8418_lvgl.h
+ * @brief TCA8418 LVGL keypad input device header
+ * @details This header file contains the declarations of an LVGL keypad input
+ *          device fed from the driver's event ring. LVGL polls its read callback
+ *          on every input tick, the callback only takes events already drained
+ *          into RAM, so no I2C transaction runs in the LVGL context. When more
+ *          events are queued the callback asks LVGL to read again in the same
+ *          cycle. The event source is passed in, so the adapter has no HAL
+ *          dependency and runs on the host against a scripted source.
+ *          Supports LVGL 8 and 9.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_LVGL_H__
+#define __TCA8418_LVGL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint32_t */
+#include <stdint.h>
+/* For lv_indev_t, lv_indev_data_t and the LV_KEY_* codes */
+#include "lvgl.h"
+
+/* Number of entries of a keymap, indexed by key number (bits 6:0 of an event) */
+#define TCA8418_LVGL_KEYMAP_SIZE 128
+
+/**
+ * @brief Source taking drained events without bus access, e.g. TCA8418_TakeEvents()
+ * @param keyEvents Array to store key events
+ * @param maxEvents Capacity of keyEvents
+ * @return uint8_t Number of events taken
+ */
+typedef uint8_t (*TCA8418_LvglTake)(uint8_t *keyEvents, uint8_t maxEvents);
+
+/**
+ * @brief Source counting drained events still waiting, e.g. TCA8418_PendingEvents()
+ * @return uint8_t Events waiting
+ */
+typedef uint8_t (*TCA8418_LvglPending)(void);
+
+/**
+ * @brief Input device state
+ */
+typedef struct {
+    const uint32_t *keymap;     //< Key number to LVGL key code or character, 0 for ignored keys
+    TCA8418_LvglTake take;      //< Event source
+    TCA8418_LvglPending pending;//< Events left in the source
+    uint32_t lastKey;           //< Key code of the last reported event
+    uint8_t lastPressed;        //< State of the last reported event
+#if LVGL_VERSION_MAJOR < 9
+    lv_indev_drv_t driver;      //< LVGL 8 driver, must outlive the input device
+#endif
+} TCA8418_Lvgl;
+
+/* Default keymap: the 7 keys of the default configuration, ROW0 with COL0 to COL6 */
+extern const uint32_t TCA8418_Lvgl_DefaultKeymap[TCA8418_LVGL_KEYMAP_SIZE];
+
+/**
+ * @brief Create the LVGL keypad input device
+ * @param lvgl Input device state, must outlive the input device
+ * @param keymap Table of TCA8418_LVGL_KEYMAP_SIZE key codes indexed by key number, NULL for the default keymap
+ * @param take Event source, TCA8418_TakeEvents on the target
+ * @param pending Events left in the source, TCA8418_PendingEvents on the target
+ * @return lv_indev_t* Input device to add to a group with lv_indev_set_group(), NULL on failure
+ */
+lv_indev_t *TCA8418_Lvgl_Create(TCA8418_Lvgl *lvgl, const uint32_t *keymap, TCA8418_LvglTake take,
+                                TCA8418_LvglPending pending);
+
+/**
+ * @brief Fill one LVGL read from the event source
+ * @param lvgl Input device state
+ * @param data LVGL input data to fill
+ * @note Called by the read callback of the input device, exposed for host tests.
+ */
+void TCA8418_Lvgl_Read(TCA8418_Lvgl *lvgl, lv_indev_data_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file tca8418_mux.c
+ * @brief TCA8418 I2C multiplexer channel selection implementation
+ * @details This file contains the cached channel selection and the drain
+ *          scheduler. The TCA9548A control register is a single byte written
+ *          without a register address, so one selection is one short write.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_mux.h"
+/* For TCA8418_FEATURE_MUX */
+#include "tca8418_config.h"
+
+#if TCA8418_FEATURE_MUX
+
+/**
+ * @brief Initialize the multiplexer state
+ * @param mux Multiplexer state
+ * @param write Control register write
+ * @param cache 1 to skip redundant selections, 0 to write on every selection
+ */
+void TCA8418_Mux_Init(TCA8418_Mux *mux, TCA8418_MuxWrite write, uint8_t cache){
+    mux->write = write;
+    mux->channel = TCA8418_MUX_NONE;
+    mux->cache = cache ? 1 : 0;
+    mux->stats = (TCA8418_MuxStats){0};
+}
+
+/**
+ * @brief Connect one channel
+ * @param mux Multiplexer state
+ * @param channel Channel to connect, 0 to TCA8418_MUX_CHANNELS - 1
+ * @return int 0 if successful, otherwise the error of the control register write
+ * @note A failed write leaves the multiplexer state unknown, so the next selection writes.
+ */
+int TCA8418_Mux_Select(TCA8418_Mux *mux, uint8_t channel){
+    int result;
+    if(channel >= TCA8418_MUX_CHANNELS){
+        return -1;
+    }
+    mux->stats.selects++;
+    if(mux->cache && (mux->channel == channel)){
+        mux->stats.skipped++;
+        return 0;
+    }
+    mux->stats.writes++;
+    result = mux->write((uint8_t)(1U << channel));
+    if(result != 0){
+        mux->stats.errors++;
+        mux->channel = TCA8418_MUX_NONE;
+        return result;
+    }
+    mux->channel = channel;
+    return 0;
+}
+
+/**
+ * @brief Forget the cached channel
+ * @param mux Multiplexer state
+ */
+void TCA8418_Mux_Invalidate(TCA8418_Mux *mux){
+    mux->channel = TCA8418_MUX_NONE;
+}
+
+/**
+ * @brief Order the drains of the keypads with pending events
+ * @param mux Multiplexer state
+ * @param pending Channels with pending events, bit n for channel n
+ * @param order Array of TCA8418_MUX_CHANNELS to store the channels in drain order
+ * @return uint8_t Number of channels stored
+ */
+uint8_t TCA8418_Mux_Schedule(const TCA8418_Mux *mux, uint8_t pending, uint8_t *order){
+    uint8_t count = 0;
+    uint8_t start = (mux->channel < TCA8418_MUX_CHANNELS) ? mux->channel : 0;
+    for(uint8_t i = 0; i < TCA8418_MUX_CHANNELS; i++){
+        uint8_t channel = (uint8_t)((start + i) % TCA8418_MUX_CHANNELS);
+        if(pending & (1U << channel)){
+            order[count++] = channel;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Drain every keypad with pending events in scheduled order
+ * @param mux Multiplexer state
+ * @param pending Channels with pending events, bit n for channel n
+ * @param drain Drain of one keypad, e.g. a wrapper of TCA8418_ReadKeyEvents()
+ * @param context Passed to drain
+ * @return int 0 if successful, otherwise the first error; the remaining channels are still drained
+ * @note A channel whose selection fails is skipped, its keypad is drained in a later round.
+ */
+int TCA8418_Mux_DrainPending(TCA8418_Mux *mux, uint8_t pending, TCA8418_MuxDrain drain, void *context){
+    uint8_t order[TCA8418_MUX_CHANNELS];
+    uint8_t count = TCA8418_Mux_Schedule(mux, pending, order);
+    int first = 0;
+    for(uint8_t i = 0; i < count; i++){
+        int result = TCA8418_Mux_Select(mux, order[i]);
+        if(result == 0){
+            result = drain(order[i], context);
+        }
+        if((result != 0) && (first == 0)){
+            first = result;
+        }
+    }
+    return first;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file tca8418_mux.h
+ * @brief TCA8418 I2C multiplexer channel selection header
+ * @details This header file contains the declarations of the TCA9548A channel
+ *          selection for several TCA8418s behind one multiplexer, each on its
+ *          own channel since they share the fixed address 0x34. The channel
+ *          last written is cached, so selecting the keypad already connected
+ *          costs no bus transaction, and a scheduler orders the drains of the
+ *          keypads with pending events to start on the connected channel.
+ *          The multiplexer is written through a callback, so the module has no
+ *          HAL dependency and runs on the host against a simulated bus.
+ *          The driver keeps the state of one device, so the module is enabled
+ *          on its own with TCA8418_FEATURE_MUX and not with the ring, hot-plug,
+ *          outputs, asynchronous initialization or calibration. The remaining
+ *          shared state is the same for every keypad: TCA8418_Init() configures
+ *          each one alike, the interrupt mode stays latched and the drain
+ *          strategy only sets how the MCU reads. Locking and unlocking act on
+ *          the selected keypad.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_MUX_H__
+#define __TCA8418_MUX_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint32_t */
+#include <stdint.h>
+
+/* Channels of a TCA9548A */
+#define TCA8418_MUX_CHANNELS 8
+
+/* Channel value while the multiplexer state is unknown */
+#define TCA8418_MUX_NONE 0xFF
+
+/**
+ * @brief Write the multiplexer control register
+ * @param mask Channel enable bits, bit n connects channel n
+ * @return int 0 if successful, otherwise an error code
+ */
+typedef int (*TCA8418_MuxWrite)(uint8_t mask);
+
+/**
+ * @brief Drain the keypad on the selected channel
+ * @param channel Channel of the keypad, already selected
+ * @param context Context passed to TCA8418_Mux_DrainPending()
+ * @return int 0 if successful, otherwise an error code
+ */
+typedef int (*TCA8418_MuxDrain)(uint8_t channel, void *context);
+
+/**
+ * @brief Counters of the channel selections
+ */
+typedef struct {
+    uint32_t selects;       //< Channel selections requested
+    uint32_t writes;        //< Control register writes issued
+    uint32_t skipped;       //< Selections of the cached channel, no write needed
+    uint32_t errors;        //< Control register writes that failed
+} TCA8418_MuxStats;
+
+/**
+ * @brief Multiplexer state
+ */
+typedef struct {
+    TCA8418_MuxWrite write; //< Control register write
+    uint8_t channel;        //< Channel last written, TCA8418_MUX_NONE when unknown
+    uint8_t cache;          //< 1 to skip writes selecting the cached channel
+    TCA8418_MuxStats stats; //< Selection counters
+} TCA8418_Mux;
+
+/**
+ * @brief Initialize the multiplexer state
+ * @param mux Multiplexer state
+ * @param write Control register write
+ * @param cache 1 to skip redundant selections, 0 to write on every selection
+ * @note The channel is unknown until the first selection, which always writes.
+ */
+void TCA8418_Mux_Init(TCA8418_Mux *mux, TCA8418_MuxWrite write, uint8_t cache);
+
+/**
+ * @brief Connect one channel
+ * @param mux Multiplexer state
+ * @param channel Channel to connect, 0 to TCA8418_MUX_CHANNELS - 1
+ * @return int 0 if successful, otherwise the error of the control register write
+ */
+int TCA8418_Mux_Select(TCA8418_Mux *mux, uint8_t channel);
+
+/**
+ * @brief Forget the cached channel
+ * @param mux Multiplexer state
+ * @note Call after a bus recovery, a multiplexer reset or a control register write
+ *       made outside this module. The next selection writes again.
+ */
+void TCA8418_Mux_Invalidate(TCA8418_Mux *mux);
+
+/**
+ * @brief Order the drains of the keypads with pending events
+ * @param mux Multiplexer state
+ * @param pending Channels with pending events, bit n for channel n
+ * @param order Array of TCA8418_MUX_CHANNELS to store the channels in drain order
+ * @return uint8_t Number of channels stored
+ * @note Each pending channel is drained once, so a round costs one switch per pending
+ *       channel other than the connected one. The round starts on the connected channel
+ *       and continues upwards, wrapping around, which also serves every channel in turn.
+ */
+uint8_t TCA8418_Mux_Schedule(const TCA8418_Mux *mux, uint8_t pending, uint8_t *order);
+
+/**
+ * @brief Drain every keypad with pending events in scheduled order
+ * @param mux Multiplexer state
+ * @param pending Channels with pending events, bit n for channel n
+ * @param drain Drain of one keypad, e.g. a wrapper of TCA8418_ReadKeyEvents()
+ * @param context Passed to drain
+ * @return int 0 if successful, otherwise the first error; the remaining channels are still drained
+ */
+int TCA8418_Mux_DrainPending(TCA8418_Mux *mux, uint8_t pending, TCA8418_MuxDrain drain, void *context);
+
+/**
+ * @brief Get the counters of the channel selections
+ * @param mux Multiplexer state
+ * @param stats Pointer to store the counters
+ */
+static inline void TCA8418_Mux_GetStats(const TCA8418_Mux *mux, TCA8418_MuxStats *stats){
+    *stats = mux->stats;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
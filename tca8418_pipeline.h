@@ -0,0 +1,326 @@
+/**
+ * @file tca8418_pipeline.h
+ * @brief TCA8418 fused event processing pipeline
+ * @details This header file contains event processing stages and a macro
+ *          that chains them into one function. Every stage is a static inline
+ *          function taking its own state and the event in flight, returning 1
+ *          to pass the event on and 0 to drop it. TCA8418_PIPELINE() expands
+ *          the chain into a single loop over the drained batch, so the compiler
+ *          inlines all stages into that loop: each event is decoded once, goes
+ *          through every stage in registers and only surviving events are
+ *          stored. There are no function pointers and no intermediate buffers.
+ *          The header has no HAL dependency, so pipelines also build on the host.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_PIPELINE_H__
+#define __TCA8418_PIPELINE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Number of tracked key numbers, events of higher key numbers pass the per-key stages unchanged */
+#ifndef TCA8418_PIPE_KEYS
+#define TCA8418_PIPE_KEYS 128
+#endif
+
+/* Event flags */
+#define TCA8418_PIPE_PRESSED    0x01 //< Press, otherwise release
+#define TCA8418_PIPE_LONG       0x02 //< Release of a key held at least the hold time
+#define TCA8418_PIPE_CHORD      0x04 //< Code is a chord code
+
+/* Chord index when no chord is active */
+#define TCA8418_PIPE_NO_CHORD   0xFF
+
+/**
+ * @brief Event passed through the stages
+ */
+typedef struct {
+    uint8_t key;        //< Key number, bits 6:0 of the FIFO byte
+    uint8_t flags;      //< TCA8418_PIPE_* flags
+    uint16_t code;      //< Application code, the key number until a keymap stage replaces it
+    uint32_t time;      //< Drain time in milliseconds
+} TCA8418_PipeEvent;
+
+/**
+ * @brief Debounce stage state
+ * @note Zero-initialize and set debounceMs.
+ */
+typedef struct {
+    uint16_t debounceMs;                        //< Edges closer than this to the last accepted edge are dropped
+    uint8_t pressed[(TCA8418_PIPE_KEYS + 7) / 8]; //< Accepted state per key number
+    uint8_t edged[(TCA8418_PIPE_KEYS + 7) / 8]; //< Key numbers with an accepted edge, lastEdge is valid
+    uint32_t lastEdge[TCA8418_PIPE_KEYS];       //< Time of the last accepted edge per key number
+} TCA8418_PipeDebounce;
+
+/**
+ * @brief Anti-ghost stage state
+ * @note Zero-initialize.
+ */
+typedef struct {
+    uint16_t rowCols[8];                        //< Columns pressed per row
+    uint8_t ghosts[(TCA8418_PIPE_KEYS + 7) / 8]; //< Keys whose press was dropped, their release is dropped too
+} TCA8418_PipeAntiGhost;
+
+/**
+ * @brief Keymap stage state
+ */
+typedef struct {
+    const uint16_t *codes;                      //< Code per key number, TCA8418_PIPE_KEYS entries, 0 drops the key
+} TCA8418_PipeKeymap;
+
+/**
+ * @brief Long-press stage state
+ * @note Zero-initialize and set holdMs.
+ */
+typedef struct {
+    uint16_t holdMs;                            //< Shortest press flagged as long
+    uint32_t pressTime[TCA8418_PIPE_KEYS];      //< Time of the last press per key number
+} TCA8418_PipeLongPress;
+
+/**
+ * @brief Chord definition, the members can be pressed in either order
+ */
+typedef struct {
+    uint16_t first;     //< Code of one member
+    uint16_t second;    //< Code of the other member
+    uint16_t code;      //< Code reported for the chord
+} TCA8418_PipeChordDef;
+
+/**
+ * @brief Chord stage state
+ * @note Zero-initialize, set chords, numChords and windowMs, and set active to TCA8418_PIPE_NO_CHORD.
+ */
+typedef struct {
+    const TCA8418_PipeChordDef *chords;         //< Chord definitions
+    uint8_t numChords;                          //< Number of definitions
+    uint16_t windowMs;                          //< Longest time between the two member presses
+    uint16_t lastCode;                          //< Code of the last press
+    uint8_t lastHeld;                           //< The last pressed code is still held
+    uint32_t lastTime;                          //< Time of the last press
+    uint8_t active;                             //< Index of the held chord, TCA8418_PIPE_NO_CHORD if none
+    uint8_t activeHeld;                         //< Members of the held chord not yet released, bit 0 first, bit 1 second
+    uint16_t leader;                            //< Code of the member pressed first
+} TCA8418_PipeChord;
+
+/**
+ * @brief Define a function running a fused pipeline over a batch of FIFO bytes
+ * @param name Name of the defined function
+ * @param State Type of the structure holding the stage states
+ * @param stages Stage calls joined with &&, usually written with TCA8418_STAGE()
+ * @note The defined function is
+ *       uint8_t name(State *pipe, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now, TCA8418_PipeEvent *out)
+ *       and returns the number of events stored in out, at most numEvents. Each event is decoded
+ *       and evaluated through the chain, && stops at the first stage that drops it.
+ */
+#define TCA8418_PIPELINE(name, State, stages) \
+    static inline uint8_t name(State *pipe, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now, \
+                               TCA8418_PipeEvent *out){ \
+        uint8_t count = 0; \
+        (void)pipe; \
+        for(uint8_t i = 0; i < numEvents; i++){ \
+            TCA8418_PipeEvent event; \
+            TCA8418_Pipe_Decode(&event, keyEvents[i], now); \
+            if(stages){ \
+                out[count++] = event; \
+            } \
+        } \
+        return count; \
+    }
+
+/**
+ * @brief Call a stage on the event in flight of a TCA8418_PIPELINE() function
+ * @param stage Stage function
+ * @param member Member of the pipeline state holding the stage state
+ */
+#define TCA8418_STAGE(stage, member) stage(&pipe->member, &event)
+
+/**
+ * @brief Decode a FIFO byte, the first step of every pipeline
+ * @param event Event to fill
+ * @param raw FIFO byte, bit 7 set for a press and bits 6:0 the key number
+ * @param now Drain time in milliseconds
+ */
+static inline void TCA8418_Pipe_Decode(TCA8418_PipeEvent *event, uint8_t raw, uint32_t now){
+    event->key = raw & 0x7F;
+    event->flags = (raw & 0x80) ? TCA8418_PIPE_PRESSED : 0;
+    event->code = event->key;
+    event->time = now;
+}
+
+/**
+ * @brief Debounce stage
+ * @param debounce Stage state
+ * @param event Event in flight
+ * @return uint8_t 1 to pass the event on, 0 to drop it
+ * @note Drops events repeating the accepted state of a key and edges within debounceMs of the
+ *       last accepted one. The TCA8418 already debounces in hardware, this filters switches
+ *       that chatter for longer. The events of one drain share its time, so the interval
+ *       between them is unknown: an edge at the time of the last accepted one passes, and a
+ *       press and release drained together are both reported instead of leaving the key held.
+ */
+static inline uint8_t TCA8418_Pipe_Debounce(TCA8418_PipeDebounce *debounce, TCA8418_PipeEvent *event){
+    uint8_t key = event->key;
+    uint8_t bit;
+    uint8_t pressed = (event->flags & TCA8418_PIPE_PRESSED) != 0;
+    uint32_t elapsed;
+    if(key >= TCA8418_PIPE_KEYS){
+        return 1;
+    }
+    bit = (uint8_t)(1U << (key & 7));
+    if(((debounce->pressed[key >> 3] & bit) != 0) == pressed){
+        return 0;
+    }
+    elapsed = event->time - debounce->lastEdge[key];
+    if((debounce->edged[key >> 3] & bit) && (elapsed != 0) && (elapsed < debounce->debounceMs)){
+        return 0;
+    }
+    debounce->pressed[key >> 3] ^= bit;
+    debounce->edged[key >> 3] |= bit;
+    debounce->lastEdge[key] = event->time;
+    return 1;
+}
+
+/**
+ * @brief Anti-ghost stage
+ * @param antiGhost Stage state
+ * @param event Event in flight
+ * @return uint8_t 1 to pass the event on, 0 to drop it
+ * @note Keypad key numbers 1 to 80 are (row * 10 + column + 1). A press completing a rectangle
+ *       with three pressed keys cannot be told from a ghost in a matrix without diodes, so it
+ *       is dropped together with its release. GPI events pass unchanged.
+ */
+static inline uint8_t TCA8418_Pipe_AntiGhost(TCA8418_PipeAntiGhost *antiGhost, TCA8418_PipeEvent *event){
+    uint8_t key = event->key;
+    uint8_t bit;
+    uint8_t row;
+    uint16_t col;
+    if((key == 0) || (key > 80) || (key >= TCA8418_PIPE_KEYS)){
+        return 1;
+    }
+    bit = (uint8_t)(1U << (key & 7));
+    row = (uint8_t)((key - 1) / 10);
+    col = (uint16_t)(1U << ((key - 1) % 10));
+    if(!(event->flags & TCA8418_PIPE_PRESSED)){
+        if(antiGhost->ghosts[key >> 3] & bit){
+            antiGhost->ghosts[key >> 3] &= (uint8_t)~bit;
+            return 0;
+        }
+        antiGhost->rowCols[row] &= (uint16_t)~col;
+        return 1;
+    }
+    if(antiGhost->rowCols[row] != 0){
+        for(uint8_t other = 0; other < 8; other++){
+            if((other != row) && (antiGhost->rowCols[other] & col) &&
+               (antiGhost->rowCols[other] & antiGhost->rowCols[row])){
+                antiGhost->ghosts[key >> 3] |= bit;
+                return 0;
+            }
+        }
+    }
+    antiGhost->rowCols[row] |= col;
+    return 1;
+}
+
+/**
+ * @brief Keymap stage
+ * @param keymap Stage state
+ * @param event Event in flight
+ * @return uint8_t 1 to pass the event on, 0 to drop it
+ * @note Replaces the code with the layout entry of the key, keys mapped to 0 are dropped.
+ */
+static inline uint8_t TCA8418_Pipe_Keymap(TCA8418_PipeKeymap *keymap, TCA8418_PipeEvent *event){
+    if(event->key >= TCA8418_PIPE_KEYS){
+        return 0;
+    }
+    event->code = keymap->codes[event->key];
+    return event->code != 0;
+}
+
+/**
+ * @brief Long-press stage
+ * @param longPress Stage state
+ * @param event Event in flight
+ * @return uint8_t Always 1
+ * @note Sets TCA8418_PIPE_LONG on the release of a key held at least holdMs. Holds are
+ *       reported only at release, use tca8418_gesture.h to report them while the key is held.
+ */
+static inline uint8_t TCA8418_Pipe_LongPress(TCA8418_PipeLongPress *longPress, TCA8418_PipeEvent *event){
+    uint8_t key = event->key;
+    if(key >= TCA8418_PIPE_KEYS){
+        return 1;
+    }
+    if(event->flags & TCA8418_PIPE_PRESSED){
+        longPress->pressTime[key] = event->time;
+    } else if((uint32_t)(event->time - longPress->pressTime[key]) >= longPress->holdMs){
+        event->flags |= TCA8418_PIPE_LONG;
+    }
+    return 1;
+}
+
+/**
+ * @brief Chord stage
+ * @param chord Stage state
+ * @param event Event in flight
+ * @return uint8_t 1 to pass the event on, 0 to drop it
+ * @note Works on codes, so place it after the keymap stage when there is one. The first member
+ *       press passes unchanged. A second member press within windowMs becomes the chord press.
+ *       The first member release becomes the chord release and the second one becomes the
+ *       release of the member pressed first, so every press is still balanced by a release
+ *       without holding events back. One chord is tracked at a time.
+ */
+static inline uint8_t TCA8418_Pipe_Chord(TCA8418_PipeChord *chord, TCA8418_PipeEvent *event){
+    uint16_t code = event->code;
+    if(event->flags & TCA8418_PIPE_PRESSED){
+        if(chord->lastHeld && (chord->active == TCA8418_PIPE_NO_CHORD) &&
+           ((uint32_t)(event->time - chord->lastTime) <= chord->windowMs)){
+            for(uint8_t i = 0; i < chord->numChords; i++){
+                const TCA8418_PipeChordDef *def = &chord->chords[i];
+                if(((def->first == chord->lastCode) && (def->second == code)) ||
+                   ((def->second == chord->lastCode) && (def->first == code))){
+                    chord->active = i;
+                    chord->activeHeld = 0x03;
+                    chord->leader = chord->lastCode;
+                    chord->lastHeld = 0;
+                    event->code = def->code;
+                    event->flags |= TCA8418_PIPE_CHORD;
+                    return 1;
+                }
+            }
+        }
+        chord->lastCode = code;
+        chord->lastTime = event->time;
+        chord->lastHeld = 1;
+        return 1;
+    }
+    if(code == chord->lastCode){
+        chord->lastHeld = 0;
+    }
+    if(chord->active != TCA8418_PIPE_NO_CHORD){
+        const TCA8418_PipeChordDef *def = &chord->chords[chord->active];
+        uint8_t member = (code == def->first) ? 0x01 : ((code == def->second) ? 0x02 : 0x00);
+        if(member & chord->activeHeld){
+            chord->activeHeld &= (uint8_t)~member;
+            if(chord->activeHeld != 0){
+                event->code = def->code;
+                event->flags |= TCA8418_PIPE_CHORD;
+            } else {
+                event->code = chord->leader;
+                chord->active = TCA8418_PIPE_NO_CHORD;
+            }
+        }
+    }
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
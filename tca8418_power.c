@@ -0,0 +1,225 @@
+/**
+ * @file tca8418_power.c
+ * @brief TCA8418 bus and energy budget model implementation
+ * @details This file contains the model of the transactions issued by
+ *          TCA8418_ServiceInterrupt() and TCA8418_ReadKeyEvents(). A register
+ *          read is START, address, register, repeated START, address, data,
+ *          STOP. A register write is START, address, register, data, STOP.
+ *          Every byte takes 9 clocks with its acknowledge and every START,
+ *          repeated START and STOP is counted as one clock.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_power.h"
+/* For TCA8418_FEATURE_MODELS */
+#include "tca8418_config.h"
+
+/* For snprintf */
+#include <stdio.h>
+
+#if TCA8418_FEATURE_MODELS
+
+/**
+ * @brief Accumulated cost of a sequence of transactions
+ */
+typedef struct {
+    uint32_t busClocks;     //< I2C clocks on the bus
+    uint32_t blockingClocks;//< I2C clocks the MCU spends waiting in blocking transactions
+    uint32_t starts;        //< START and repeated START conditions
+    uint32_t cpuCycles;     //< Core cycles spent outside the bus wait
+} Cost;
+
+/**
+ * @brief Add a register read to a cost
+ * @param cost Cost to add to
+ * @param cpu MCU costs
+ * @param length Bytes read
+ * @param strategy TCA8418_POWER_* strategy of the transaction
+ */
+static void TCA8418_Power_Read(Cost *cost, const TCA8418_PowerCpu *cpu, uint8_t length, uint8_t strategy){
+    uint32_t bytes = 3U + length; // Address, register, address, data
+    uint32_t clocks = 9U * bytes + 3U; // START, repeated START, STOP
+    cost->busClocks += clocks;
+    cost->starts += 2;
+    cost->cpuCycles += cpu->transferCycles;
+    if(strategy == TCA8418_POWER_IT){
+        cost->cpuCycles += (uint32_t)cpu->byteCycles * bytes + cpu->wakeupCycles;
+    } else if(strategy == TCA8418_POWER_DMA){
+        cost->cpuCycles += cpu->wakeupCycles;
+    } else {
+        cost->blockingClocks += clocks;
+    }
+}
+
+/**
+ * @brief Add a register write to a cost
+ * @param cost Cost to add to
+ * @param cpu MCU costs
+ * @param length Bytes written
+ * @param strategy TCA8418_POWER_IT for an interrupt driven write, otherwise blocking
+ */
+static void TCA8418_Power_Write(Cost *cost, const TCA8418_PowerCpu *cpu, uint8_t length, uint8_t strategy){
+    uint32_t bytes = 2U + length; // Address, register, data
+    uint32_t clocks = 9U * bytes + 2U; // START, STOP
+    cost->busClocks += clocks;
+    cost->starts += 1;
+    cost->cpuCycles += cpu->transferCycles;
+    if(strategy == TCA8418_POWER_IT){
+        cost->cpuCycles += (uint32_t)cpu->byteCycles * bytes + cpu->wakeupCycles;
+    } else {
+        cost->blockingClocks += clocks;
+    }
+}
+
+/**
+ * @brief Convert a number of ticks to nanoseconds
+ * @param ticks Clocks or cycles
+ * @param hz Frequency of the ticks
+ * @param scale Multiplier applied before dividing, e.g. a rate per second
+ * @param divisor Divisor applied after scaling, e.g. events sharing the cost
+ * @return uint32_t Nanoseconds, saturated
+ */
+static uint32_t TCA8418_Power_Ns(uint32_t ticks, uint32_t hz, uint32_t scale, uint32_t divisor){
+    uint64_t ns;
+    if((hz == 0) || (divisor == 0)){
+        return 0;
+    }
+    ns = ((uint64_t)ticks * 1000000000ULL * scale) / ((uint64_t)hz * divisor);
+    return (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+}
+
+/**
+ * @brief Model the bus traffic and awake time of a configuration
+ * @param config Driver configuration
+ * @param cpu MCU costs
+ * @param report Pointer to store the modeled cost
+ * @note Interrupt driven drains cost nothing while idle and read INT_STAT, the event count,
+ *       the FIFO and clear INT_STAT per drain, plus a second count read in latched mode.
+ *       IT and DMA drains chain the clear and the recheck from the FIFO read completion as
+ *       IT transfers, as TCA8418_I2C_MemRxCpltCallback() does, so the MCU sleeps through them.
+ *       Polling reads INT_STAT every period and only reads further when events are pending,
+ *       always with blocking transactions as TCA8418_ReadKeyEvents() does.
+ */
+void TCA8418_Power_Model(const TCA8418_PowerConfig *config, const TCA8418_PowerCpu *cpu, TCA8418_PowerReport *report){
+    Cost drain = {0};
+    Cost idle = {0};
+    uint8_t events = config->eventsPerDrain;
+    uint8_t strategy = config->drainStrategy;
+    uint8_t chained;
+    uint32_t pollsPerS = 0;
+    if(events == 0){
+        events = 1;
+    }
+    if(config->pollPeriodMs > 0){
+        /* The INT_STAT read of every poll is the idle cost, the rest is paid per drain */
+        pollsPerS = 1000U / config->pollPeriodMs;
+        idle.cpuCycles += cpu->wakeupCycles;
+        TCA8418_Power_Read(&idle, cpu, 1, TCA8418_POWER_BURST);
+        if(strategy != TCA8418_POWER_PER_REGISTER){
+            strategy = TCA8418_POWER_BURST;
+        }
+    } else {
+        drain.cpuCycles += cpu->wakeupCycles;
+        TCA8418_Power_Read(&drain, cpu, 1, TCA8418_POWER_BURST); // INT_STAT
+    }
+    TCA8418_Power_Read(&drain, cpu, 1, TCA8418_POWER_BURST); // KEY_LCK_EC
+    if(strategy == TCA8418_POWER_PER_REGISTER){
+        for(uint8_t i = 0; i < events; i++){
+            TCA8418_Power_Read(&drain, cpu, 1, TCA8418_POWER_PER_REGISTER);
+        }
+    } else {
+        TCA8418_Power_Read(&drain, cpu, events, strategy);
+    }
+    /* The clear and recheck of an IT or DMA drain are IT transfers started from its callbacks */
+    chained = ((strategy == TCA8418_POWER_IT) || (strategy == TCA8418_POWER_DMA)) ? TCA8418_POWER_IT : TCA8418_POWER_BURST;
+    TCA8418_Power_Write(&drain, cpu, 1, chained); // INT_STAT clear
+    if(config->latched && (config->pollPeriodMs == 0)){
+        TCA8418_Power_Read(&drain, cpu, 1, chained); // KEY_LCK_EC recheck
+    }
+    report->busNsPerEvent = TCA8418_Power_Ns(drain.busClocks, config->busHz, 1, events);
+    report->startsPerEventX100 = (drain.starts * 100U) / events;
+    report->blockingNsPerEvent = TCA8418_Power_Ns(drain.blockingClocks, config->busHz, 1, events);
+    report->awakeNsPerEvent = report->blockingNsPerEvent + TCA8418_Power_Ns(drain.cpuCycles, cpu->cpuHz, 1, events);
+    report->busNsPerIdleS = TCA8418_Power_Ns(idle.busClocks, config->busHz, pollsPerS, 1);
+    report->startsPerIdleS = idle.starts * pollsPerS;
+    report->awakeNsPerIdleS = TCA8418_Power_Ns(idle.blockingClocks, config->busHz, pollsPerS, 1) +
+                              TCA8418_Power_Ns(idle.cpuCycles, cpu->cpuHz, pollsPerS, 1);
+}
+
+/**
+ * @brief Write a comparison table of several configurations
+ * @param configs Configurations, one table row each
+ * @param numConfigs Number of configurations
+ * @param cpu MCU costs
+ * @param write Sink of the table text, e.g. a UART write or fwrite on the host
+ * @note Times are printed in microseconds.
+ */
+void TCA8418_Power_WriteTable(const TCA8418_PowerConfig *configs, uint8_t numConfigs, const TCA8418_PowerCpu *cpu,
+                              TCA8418_PowerWrite write){
+    char line[128];
+    int length;
+    TCA8418_PowerReport report;
+    length = snprintf(line, sizeof(line), "%-24s %8s %8s %8s %10s %8s %10s\n",
+                      "configuration", "bus/ev", "STARTs", "awake/ev", "bus/s", "STARTs/s", "awake/s");
+    write(line, (uint16_t)length);
+    for(uint8_t i = 0; i < numConfigs; i++){
+        TCA8418_Power_Model(&configs[i], cpu, &report);
+        length = snprintf(line, sizeof(line), "%-24.24s %8lu %5lu.%02lu %8lu %10lu %8lu %10lu\n",
+                          (configs[i].name != NULL) ? configs[i].name : "",
+                          (unsigned long)(report.busNsPerEvent / 1000U),
+                          (unsigned long)(report.startsPerEventX100 / 100U),
+                          (unsigned long)(report.startsPerEventX100 % 100U),
+                          (unsigned long)(report.awakeNsPerEvent / 1000U),
+                          (unsigned long)(report.busNsPerIdleS / 1000U),
+                          (unsigned long)report.startsPerIdleS,
+                          (unsigned long)(report.awakeNsPerIdleS / 1000U));
+        write(line, (uint16_t)length);
+    }
+}
+
+/**
+ * @brief Write the bus utilization of LED animations driven through GPIO outputs
+ * @param busHz I2C clock frequency
+ * @param frameHz Animation frame rate, every LED changes once per frame
+ * @param pins Pins driving LEDs in the layout of TCA8418_GPIO_ROW() and TCA8418_GPIO_COL()
+ * @param write Sink of the table text, e.g. a UART write or fwrite on the host
+ * @note Row n adds the n-th pin of pins, lowest bit first, and a frame writes each
+ *       GPIO_DAT_OUT byte holding one of the first n pins. Utilization is printed in
+ *       hundredths of a percent of the bus time.
+ */
+void TCA8418_Power_WriteOutputTable(uint32_t busHz, uint16_t frameHz, uint32_t pins, TCA8418_PowerWrite write){
+    static const TCA8418_PowerCpu noCpu = {0, 0, 0, 0};
+    char line[96];
+    char name[6];
+    int length;
+    Cost single = {0};
+    uint8_t leds = 0;
+    uint8_t bytes = 0;
+    TCA8418_Power_Write(&single, &noCpu, 1, TCA8418_POWER_BURST);
+    length = snprintf(line, sizeof(line), "%4s %5s %10s %8s %10s %8s\n", "LEDs", "pin", "writes/s", "bus %",
+                      "frame w/s", "bus %");
+    write(line, (uint16_t)length);
+    for(uint8_t pin = 0; pin < TCA8418_POWER_GPIO_PINS; pin++){
+        if(!(pins & (1UL << pin))){
+            continue;
+        }
+        leds++;
+        /* The first pin of a GPIO_DAT_OUT byte adds a write to every frame */
+        if(!(pins & ((1UL << pin) - 1U) & ~((1UL << (pin & ~7U)) - 1U))){
+            bytes++;
+        }
+        uint32_t perChange = (uint32_t)leds * frameHz;
+        uint32_t perFrame = (uint32_t)bytes * frameHz;
+        uint32_t perChangePct = (busHz != 0) ? (uint32_t)(((uint64_t)perChange * single.busClocks * 10000U) / busHz) : 0;
+        uint32_t perFramePct = (busHz != 0) ? (uint32_t)(((uint64_t)perFrame * single.busClocks * 10000U) / busHz) : 0;
+        (void)snprintf(name, sizeof(name), "%s%u", (pin < 8) ? "ROW" : "COL", (pin < 8) ? pin : (pin - 8U));
+        length = snprintf(line, sizeof(line), "%4u %5s %10lu %5lu.%02lu %10lu %5lu.%02lu\n", leds, name,
+                          (unsigned long)perChange, (unsigned long)(perChangePct / 100U), (unsigned long)(perChangePct % 100U),
+                          (unsigned long)perFrame, (unsigned long)(perFramePct / 100U), (unsigned long)(perFramePct % 100U));
+        write(line, (uint16_t)length);
+    }
+}
+
+#endif
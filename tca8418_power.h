@@ -0,0 +1,114 @@
+/**
+ * @file tca8418_power.h
+ * @brief TCA8418 bus and energy budget model header
+ * @details This header file contains the declarations of a model of the I2C
+ *          traffic the driver generates. For a driver configuration it counts
+ *          the transactions and START conditions of every drain, and estimates
+ *          the bus busy time and the MCU awake time per key event and per idle
+ *          second, so configurations can be compared before measuring current.
+ *          The module has no HAL dependency and also builds on the host.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_POWER_H__
+#define __TCA8418_POWER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Drain strategies, same values as TCA8418_DrainStrategy */
+#define TCA8418_POWER_PER_REGISTER  0 //< One transaction per event
+#define TCA8418_POWER_BURST         1 //< One blocking transaction for all events
+#define TCA8418_POWER_IT            2 //< One interrupt driven transaction, one interrupt per byte
+#define TCA8418_POWER_DMA           3 //< One DMA transaction, one completion interrupt
+
+/* GPIO pins, bits 7:0 ROW7:0 and bits 17:8 COL9:0 as in TCA8418_GPIO_ROW() and TCA8418_GPIO_COL() */
+#define TCA8418_POWER_GPIO_PINS     18
+/* Pins the keypad matrix of TCA8418_Init() (ROW0, COL6:0) leaves free: ROW7:1, COL7 and COL9:8 */
+#define TCA8418_POWER_FREE_PINS     0x380FEUL
+
+/**
+ * @brief Driver configuration to model
+ */
+typedef struct {
+    const char *name;           //< Label of the configuration in the table
+    uint8_t drainStrategy;      //< TCA8418_POWER_* drain strategy
+    uint8_t latched;            //< 1 for TCA8418_INT_LATCHED, adds the recheck of the event count
+    uint16_t pollPeriodMs;      //< Period of TCA8418_ReadKeyEvents() polling, 0 for interrupt driven drains
+    uint8_t eventsPerDrain;     //< Events collected by one drain, 1 to 10
+    uint32_t busHz;             //< I2C clock frequency
+} TCA8418_PowerConfig;
+
+/**
+ * @brief MCU costs of the target, measured once e.g. with TCA8418_GetCycles()
+ */
+typedef struct {
+    uint32_t cpuHz;             //< Core clock frequency
+    uint16_t wakeupCycles;      //< Interrupt entry, handler dispatch and exit
+    uint16_t transferCycles;    //< HAL call overhead of one I2C transaction outside the bus time
+    uint16_t byteCycles;        //< Interrupt handling of one byte of an IT transfer
+} TCA8418_PowerCpu;
+
+/**
+ * @brief Modeled cost of a configuration
+ * @note Times are in nanoseconds. Blocking transactions keep the MCU awake for their
+ *       whole bus time, IT and DMA transfers let it sleep while the bytes are shifted.
+ */
+typedef struct {
+    uint32_t busNsPerEvent;         //< Bus busy time per key event
+    uint32_t startsPerEventX100;    //< START and repeated START conditions per key event, times 100
+    uint32_t awakeNsPerEvent;       //< MCU awake time per key event
+    uint32_t blockingNsPerEvent;    //< Bus time of the blocking transactions per key event, part of awakeNsPerEvent
+    uint32_t busNsPerIdleS;         //< Bus busy time per second without key activity
+    uint32_t startsPerIdleS;        //< START and repeated START conditions per second without key activity
+    uint32_t awakeNsPerIdleS;       //< MCU awake time per second without key activity
+} TCA8418_PowerReport;
+
+/**
+ * @brief Callback receiving table text
+ * @param text Text chunk, not NUL terminated
+ * @param length Length in bytes
+ */
+typedef void (*TCA8418_PowerWrite)(const char *text, uint16_t length);
+
+/**
+ * @brief Model the bus traffic and awake time of a configuration
+ * @param config Driver configuration
+ * @param cpu MCU costs
+ * @param report Pointer to store the modeled cost
+ */
+void TCA8418_Power_Model(const TCA8418_PowerConfig *config, const TCA8418_PowerCpu *cpu, TCA8418_PowerReport *report);
+
+/**
+ * @brief Write a comparison table of several configurations
+ * @param configs Configurations, one table row each
+ * @param numConfigs Number of configurations
+ * @param cpu MCU costs
+ * @param write Sink of the table text, e.g. a UART write or fwrite on the host
+ */
+void TCA8418_Power_WriteTable(const TCA8418_PowerConfig *configs, uint8_t numConfigs, const TCA8418_PowerCpu *cpu,
+                              TCA8418_PowerWrite write);
+
+/**
+ * @brief Write the bus utilization of LED animations driven through GPIO outputs
+ * @param busHz I2C clock frequency
+ * @param frameHz Animation frame rate, every LED changes once per frame
+ * @param pins Pins driving LEDs in the layout of TCA8418_GPIO_ROW() and TCA8418_GPIO_COL(),
+ *        e.g. TCA8418_POWER_FREE_PINS
+ * @param write Sink of the table text, e.g. a UART write or fwrite on the host
+ * @note Compares one GPIO_DAT_OUT write per LED change against TCA8418_FlushOutputs(),
+ *       which writes each changed register byte once per frame, for 1 LED up to one per pin.
+ */
+void TCA8418_Power_WriteOutputTable(uint32_t busHz, uint16_t frameHz, uint32_t pins, TCA8418_PowerWrite write);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,241 @@
+/**
+ * @file tca8418_stream.c
+ * @brief TCA8418 binary event stream implementation
+ * @details This file contains the implementation of the COBS framed event
+ *          stream encoder and decoder.
+ *          Frame payload before COBS encoding:
+ *          - Byte 0: sequence number
+ *          - Byte 1: number of events N
+ *          - Bytes 2 to 2N+1: per event the event byte and the delta time in milliseconds
+ *          - Last 2 bytes: CRC-16/CCITT-FALSE of the preceding bytes, big endian
+ *          The encoded frame ends with a 0x00 delimiter.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_stream.h"
+/* For TCA8418_FEATURE_STREAM */
+#include "tca8418_config.h"
+
+#if TCA8418_FEATURE_STREAM
+
+/* Payload offsets */
+#define PAYLOAD_SEQUENCE    0 //< Sequence number
+#define PAYLOAD_COUNT       1 //< Number of events
+#define PAYLOAD_EVENTS      2 //< First event
+
+/**
+ * @brief Compute the CRC-16/CCITT-FALSE of a buffer
+ * @param data Buffer
+ * @param length Length in bytes
+ * @return uint16_t CRC
+ */
+static uint16_t TCA8418_Stream_CRC16(const uint8_t *data, uint16_t length){
+    uint16_t crc = 0xFFFF;
+    for(uint16_t i = 0; i < length; i++){
+        crc ^= (uint16_t)(data[i] << 8);
+        for(uint8_t bit = 0; bit < 8; bit++){
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS encode a buffer and append the 0x00 delimiter
+ * @param src Buffer to encode
+ * @param length Length in bytes
+ * @param dst Destination of at least length + length / 254 + 2 bytes
+ * @return uint16_t Encoded length including the delimiter
+ */
+static uint16_t TCA8418_Stream_COBSEncode(const uint8_t *src, uint16_t length, uint8_t *dst){
+    uint16_t codeIndex = 0;
+    uint16_t out = 1;
+    uint8_t code = 1;
+    for(uint16_t i = 0; i < length; i++){
+        if(src[i] != 0){
+            dst[out++] = src[i];
+            code++;
+        }
+        if((src[i] == 0) || (code == 0xFF)){
+            dst[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        }
+    }
+    dst[codeIndex] = code;
+    dst[out++] = 0x00;
+    return out;
+}
+
+/**
+ * @brief COBS decode a frame in place
+ * @param data Encoded bytes without the delimiter, replaced by the decoded bytes
+ * @param length Encoded length in bytes
+ * @param decoded Pointer to store the decoded length
+ * @return uint8_t 1 if the encoding is valid, otherwise 0
+ */
+static uint8_t TCA8418_Stream_COBSDecode(uint8_t *data, uint16_t length, uint16_t *decoded){
+    uint16_t in = 0;
+    uint16_t out = 0;
+    while(in < length){
+        uint8_t code = data[in++];
+        if((code == 0) || ((uint16_t)(in + code - 1) > length)){
+            return 0;
+        }
+        for(uint8_t i = 1; i < code; i++){
+            data[out++] = data[in++];
+        }
+        if((code != 0xFF) && (in < length)){
+            data[out++] = 0x00;
+        }
+    }
+    *decoded = out;
+    return 1;
+}
+
+/**
+ * @brief Initialize the encoder
+ * @param encoder Encoder state
+ * @param write Sink of encoded frames
+ * @param now Current time in milliseconds
+ */
+void TCA8418_StreamEncoder_Init(TCA8418_StreamEncoder *encoder, TCA8418_StreamWrite write, uint32_t now){
+    encoder->write = write;
+    encoder->numEvents = 0;
+    encoder->sequence = 0;
+    encoder->lastTick = now;
+    encoder->firstTick = now;
+}
+
+/**
+ * @brief Encode and emit the current frame if it holds events
+ * @param encoder Encoder state
+ */
+void TCA8418_StreamEncoder_Flush(TCA8418_StreamEncoder *encoder){
+    uint16_t length;
+    uint16_t crc;
+    if(encoder->numEvents == 0){
+        return;
+    }
+    encoder->payload[PAYLOAD_SEQUENCE] = encoder->sequence++;
+    encoder->payload[PAYLOAD_COUNT] = encoder->numEvents;
+    length = (uint16_t)(PAYLOAD_EVENTS + 2 * encoder->numEvents);
+    crc = TCA8418_Stream_CRC16(encoder->payload, length);
+    encoder->payload[length++] = (uint8_t)(crc >> 8);
+    encoder->payload[length++] = (uint8_t)crc;
+    length = TCA8418_Stream_COBSEncode(encoder->payload, length, encoder->frame);
+    encoder->numEvents = 0;
+    encoder->write(encoder->frame, length);
+}
+
+/**
+ * @brief Add drained key events to the current frame
+ * @param encoder Encoder state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ * @note Events of one drain share its timestamp, so only the first one carries a delta.
+ *       The frame is flushed as soon as it holds TCA8418_STREAM_MAX_EVENTS events.
+ */
+void TCA8418_StreamEncoder_Push(TCA8418_StreamEncoder *encoder, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now){
+    for(uint8_t i = 0; i < numEvents; i++){
+        uint32_t delta = now - encoder->lastTick;
+        uint8_t *slot = &encoder->payload[PAYLOAD_EVENTS + 2 * encoder->numEvents];
+        if(encoder->numEvents == 0){
+            encoder->firstTick = now;
+        }
+        slot[0] = keyEvents[i];
+        slot[1] = (delta > TCA8418_STREAM_DELTA_MAX) ? TCA8418_STREAM_DELTA_MAX : (uint8_t)delta;
+        encoder->lastTick = now;
+        encoder->numEvents++;
+        if(encoder->numEvents == TCA8418_STREAM_MAX_EVENTS){
+            TCA8418_StreamEncoder_Flush(encoder);
+        }
+    }
+}
+
+/**
+ * @brief Flush the current frame if its oldest event reached the latency deadline
+ * @param encoder Encoder state
+ * @param now Current time in milliseconds
+ */
+void TCA8418_StreamEncoder_Poll(TCA8418_StreamEncoder *encoder, uint32_t now){
+    if((encoder->numEvents > 0) && ((now - encoder->firstTick) >= TCA8418_STREAM_DEADLINE_MS)){
+        TCA8418_StreamEncoder_Flush(encoder);
+    }
+}
+
+/**
+ * @brief Initialize the decoder
+ * @param decoder Decoder state
+ * @param read Sink of decoded frames
+ */
+void TCA8418_StreamDecoder_Init(TCA8418_StreamDecoder *decoder, TCA8418_StreamRead read){
+    decoder->read = read;
+    decoder->length = 0;
+    decoder->overrun = 0;
+    decoder->badFrames = 0;
+}
+
+/**
+ * @brief Check and deliver one received frame
+ * @param decoder Decoder state
+ */
+static void TCA8418_StreamDecoder_Frame(TCA8418_StreamDecoder *decoder){
+    TCA8418_StreamEvent events[TCA8418_STREAM_MAX_EVENTS];
+    uint8_t *payload = decoder->buffer;
+    uint16_t length;
+    uint16_t crc;
+    uint8_t numEvents;
+    if(!TCA8418_Stream_COBSDecode(payload, decoder->length, &length) || (length < PAYLOAD_EVENTS + 2)){
+        decoder->badFrames++;
+        return;
+    }
+    numEvents = payload[PAYLOAD_COUNT];
+    if((numEvents > TCA8418_STREAM_MAX_EVENTS) || (length != (uint16_t)(PAYLOAD_EVENTS + 2 * numEvents + 2))){
+        decoder->badFrames++;
+        return;
+    }
+    crc = TCA8418_Stream_CRC16(payload, (uint16_t)(length - 2));
+    if((payload[length - 2] != (uint8_t)(crc >> 8)) || (payload[length - 1] != (uint8_t)crc)){
+        decoder->badFrames++;
+        return;
+    }
+    for(uint8_t i = 0; i < numEvents; i++){
+        events[i].keyEvent = payload[PAYLOAD_EVENTS + 2 * i];
+        events[i].deltaMs = payload[PAYLOAD_EVENTS + 2 * i + 1];
+    }
+    decoder->read(payload[PAYLOAD_SEQUENCE], events, numEvents);
+}
+
+/**
+ * @brief Feed received bytes to the decoder
+ * @param decoder Decoder state
+ * @param data Received bytes
+ * @param length Number of bytes
+ * @note Frames are delimited by 0x00, so the decoder resynchronizes on the next
+ *       delimiter after corrupted or truncated data.
+ */
+void TCA8418_StreamDecoder_Feed(TCA8418_StreamDecoder *decoder, const uint8_t *data, uint16_t length){
+    for(uint16_t i = 0; i < length; i++){
+        if(data[i] == 0x00){
+            if(decoder->overrun){
+                decoder->badFrames++;
+            } else if(decoder->length > 0){
+                TCA8418_StreamDecoder_Frame(decoder);
+            }
+            decoder->length = 0;
+            decoder->overrun = 0;
+            continue;
+        }
+        if(decoder->length >= TCA8418_STREAM_FRAME_MAX){
+            decoder->overrun = 1;
+            continue;
+        }
+        decoder->buffer[decoder->length++] = data[i];
+    }
+}
+
+#endif
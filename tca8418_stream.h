@@ -0,0 +1,139 @@
+/**
+ * @file tca8418_stream.h
+ * @brief TCA8418 binary event stream header
+ * @details This header file contains the declarations of an encoder that
+ *          batches key events into compact COBS framed binary frames with a
+ *          CRC for transmission over a UART, and of the matching decoder for
+ *          the receiving side. It has no HAL dependency, so the decoder also
+ *          builds on the host.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_STREAM_H__
+#define __TCA8418_STREAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Maximum number of events per frame */
+#ifndef TCA8418_STREAM_MAX_EVENTS
+#define TCA8418_STREAM_MAX_EVENTS 32
+#endif
+
+/* Maximum time an event waits in the encoder before its frame is flushed, in milliseconds */
+#ifndef TCA8418_STREAM_DEADLINE_MS
+#define TCA8418_STREAM_DEADLINE_MS 10
+#endif
+
+/* Payload: sequence, event count, 2 bytes per event, CRC-16 */
+#define TCA8418_STREAM_PAYLOAD_MAX  (2 + 2 * TCA8418_STREAM_MAX_EVENTS + 2)
+
+/* Encoded frame: COBS overhead and the 0x00 delimiter */
+#define TCA8418_STREAM_FRAME_MAX    (TCA8418_STREAM_PAYLOAD_MAX + (TCA8418_STREAM_PAYLOAD_MAX / 254) + 2)
+
+/* Largest delta time carried by one event, longer gaps are clamped */
+#define TCA8418_STREAM_DELTA_MAX    255
+
+/**
+ * @brief Callback receiving a complete encoded frame, including the delimiter
+ * @param frame Encoded frame
+ * @param length Length in bytes
+ */
+typedef void (*TCA8418_StreamWrite)(const uint8_t *frame, uint16_t length);
+
+/**
+ * @brief Stream encoder state
+ */
+typedef struct {
+    TCA8418_StreamWrite write;                       //< Sink of encoded frames, e.g. a UART DMA transmit
+    uint8_t payload[TCA8418_STREAM_PAYLOAD_MAX];     //< Frame being assembled
+    uint8_t frame[TCA8418_STREAM_FRAME_MAX];         //< Last encoded frame, valid until the next flush
+    uint8_t numEvents;                               //< Events in the payload
+    uint8_t sequence;                                //< Sequence number of the next frame
+    uint32_t lastTick;                               //< Time of the previous event in milliseconds
+    uint32_t firstTick;                              //< Time of the oldest event in the payload
+} TCA8418_StreamEncoder;
+
+/**
+ * @brief Decoded key event
+ */
+typedef struct {
+    uint8_t keyEvent;   //< Event byte: bits 6:0 key number, bit 7 press
+    uint8_t deltaMs;    //< Milliseconds since the previous event, clamped to TCA8418_STREAM_DELTA_MAX
+} TCA8418_StreamEvent;
+
+/**
+ * @brief Callback receiving a decoded frame
+ * @param sequence Frame sequence number, gaps reveal lost frames
+ * @param events Decoded events
+ * @param numEvents Number of events
+ */
+typedef void (*TCA8418_StreamRead)(uint8_t sequence, const TCA8418_StreamEvent *events, uint8_t numEvents);
+
+/**
+ * @brief Stream decoder state
+ */
+typedef struct {
+    TCA8418_StreamRead read;                         //< Sink of decoded frames
+    uint8_t buffer[TCA8418_STREAM_FRAME_MAX];        //< Encoded bytes received since the last delimiter
+    uint16_t length;                                 //< Bytes in buffer
+    uint8_t overrun;                                 //< Current frame exceeded the buffer and is discarded
+    uint32_t badFrames;                              //< Frames rejected by COBS or CRC checks
+} TCA8418_StreamDecoder;
+
+/**
+ * @brief Initialize the encoder
+ * @param encoder Encoder state
+ * @param write Sink of encoded frames
+ * @param now Current time in milliseconds
+ */
+void TCA8418_StreamEncoder_Init(TCA8418_StreamEncoder *encoder, TCA8418_StreamWrite write, uint32_t now);
+
+/**
+ * @brief Add drained key events to the current frame
+ * @param encoder Encoder state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ */
+void TCA8418_StreamEncoder_Push(TCA8418_StreamEncoder *encoder, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now);
+
+/**
+ * @brief Flush the current frame if its oldest event reached the latency deadline
+ * @param encoder Encoder state
+ * @param now Current time in milliseconds
+ */
+void TCA8418_StreamEncoder_Poll(TCA8418_StreamEncoder *encoder, uint32_t now);
+
+/**
+ * @brief Encode and emit the current frame if it holds events
+ * @param encoder Encoder state
+ */
+void TCA8418_StreamEncoder_Flush(TCA8418_StreamEncoder *encoder);
+
+/**
+ * @brief Initialize the decoder
+ * @param decoder Decoder state
+ * @param read Sink of decoded frames
+ */
+void TCA8418_StreamDecoder_Init(TCA8418_StreamDecoder *decoder, TCA8418_StreamRead read);
+
+/**
+ * @brief Feed received bytes to the decoder
+ * @param decoder Decoder state
+ * @param data Received bytes
+ * @param length Number of bytes
+ */
+void TCA8418_StreamDecoder_Feed(TCA8418_StreamDecoder *decoder, const uint8_t *data, uint16_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+/**
+ * @file tca8418_text.c
+ * @brief TCA8418 phone keypad text entry implementation
+ * @details This file contains the implementation of the multi-tap and
+ *          predictive text entry engine and of the dictionary trie lookup.
+ *          Keys: '2'-'9' letters, '0' space, '1' punctuation, '*' next word
+ *          while composing a predictive word, otherwise backspace, '#' switches
+ *          between multi-tap and predictive input.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_text.h"
+/* For TCA8418_FEATURE_TEXT */
+#include "tca8418_config.h"
+
+/* For NULL */
+#include <stddef.h>
+
+#if TCA8418_FEATURE_TEXT
+
+/* Letters cycled by each digit in multi-tap mode */
+static const char *const multiTapLetters[10] = {
+    " 0", ".,?!'1", "abc2", "def3", "ghi4", "jkl5", "mno6", "pqrs7", "tuv8", "wxyz9"
+};
+
+/**
+ * @brief Read a 24-bit little endian offset from the dictionary
+ * @param p First byte
+ * @return uint32_t Offset
+ */
+static inline uint32_t TCA8418_Text_ReadOffset(const uint8_t *p){
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+/**
+ * @brief Follow one digit from a dictionary node
+ * @param dictionary Predictive dictionary
+ * @param node Node offset
+ * @param digit Digit '2' to '9'
+ * @return uint32_t Child node offset, 0 if no word continues with this digit
+ */
+static uint32_t TCA8418_Text_Child(const uint8_t *dictionary, uint32_t node, char digit){
+    uint8_t mask;
+    uint8_t bit;
+    if((node == 0) || (digit < '2') || (digit > '9')){
+        return 0;
+    }
+    mask = dictionary[node];
+    bit = (uint8_t)(1U << (digit - '2'));
+    if(!(mask & bit)){
+        return 0;
+    }
+    return TCA8418_Text_ReadOffset(&dictionary[node + 2 + 3 * __builtin_popcount(mask & (bit - 1))]);
+}
+
+/**
+ * @brief Find the dictionary node of a digit sequence
+ * @param dictionary Predictive dictionary
+ * @param digits Digits '2' to '9'
+ * @param count Number of digits
+ * @param wordCount Pointer to store the number of words of the node, may be NULL
+ * @return uint32_t Node offset, 0 if no word starts with these digits
+ * @note One child lookup per digit, reading the dictionary in place.
+ */
+uint32_t TCA8418_Text_Lookup(const uint8_t *dictionary, const char *digits, uint8_t count, uint8_t *wordCount){
+    uint32_t node = TCA8418_TEXT_DICT_HEADER;
+    for(uint8_t i = 0; (i < count) && (node != 0); i++){
+        node = TCA8418_Text_Child(dictionary, node, digits[i]);
+    }
+    if(wordCount != NULL){
+        *wordCount = (node != 0) ? dictionary[node + 1] : 0;
+    }
+    return node;
+}
+
+/**
+ * @brief Get a word of a dictionary node, read in place from the dictionary
+ * @param dictionary Predictive dictionary
+ * @param node Node offset returned by TCA8418_Text_Lookup()
+ * @param count Number of digits of the node, which is also the word length
+ * @param index Word index, 0 is the most frequent
+ * @return const uint8_t* count letters of the word, NULL if index is out of range
+ */
+const uint8_t *TCA8418_Text_Word(const uint8_t *dictionary, uint32_t node, uint8_t count, uint8_t index){
+    uint32_t words;
+    if((node == 0) || (index >= dictionary[node + 1])){
+        return NULL;
+    }
+    words = node + 2 + 3 * (uint32_t)__builtin_popcount(dictionary[node]);
+    return &dictionary[words + (uint32_t)index * count];
+}
+
+/**
+ * @brief Append a character to the committed text
+ * @param engine Engine state
+ * @param c Character
+ */
+static void TCA8418_Text_Append(TCA8418_TextEngine *engine, char c){
+    if(engine->length >= TCA8418_TEXT_MAX){
+        return;
+    }
+    engine->text[engine->length++] = c;
+    engine->text[engine->length] = '\0';
+}
+
+/**
+ * @brief Commit the multi-tap letter or predictive word being composed
+ * @param engine Engine state
+ * @note A predictive sequence without a dictionary word is committed as its digits.
+ */
+static void TCA8418_Text_Commit(TCA8418_TextEngine *engine){
+    if(engine->lastDigit != 0){
+        TCA8418_Text_Append(engine, multiTapLetters[engine->lastDigit - '0'][engine->tapIndex]);
+        engine->lastDigit = 0;
+    }
+    if(engine->digitCount != 0){
+        const uint8_t *word = TCA8418_Text_Word(engine->dictionary, engine->node, engine->digitCount, engine->candidate);
+        for(uint8_t i = 0; i < engine->digitCount; i++){
+            TCA8418_Text_Append(engine, (word != NULL) ? (char)word[i] : engine->digits[i]);
+        }
+        engine->digitCount = 0;
+    }
+}
+
+/**
+ * @brief Delete the last committed character
+ * @param engine Engine state
+ */
+static void TCA8418_Text_Backspace(TCA8418_TextEngine *engine){
+    if(engine->length > 0){
+        engine->text[--engine->length] = '\0';
+    }
+}
+
+/**
+ * @brief Handle a digit in multi-tap mode
+ * @param engine Engine state
+ * @param digit Digit '0' to '9'
+ * @param now Time of the press in milliseconds
+ */
+static void TCA8418_Text_MultiTap(TCA8418_TextEngine *engine, char digit, uint32_t now){
+    if(engine->lastDigit == (uint8_t)digit){
+        engine->tapIndex++;
+        if(multiTapLetters[digit - '0'][engine->tapIndex] == '\0'){
+            engine->tapIndex = 0;
+        }
+    } else {
+        TCA8418_Text_Commit(engine);
+        engine->lastDigit = (uint8_t)digit;
+        engine->tapIndex = 0;
+    }
+    engine->lastTick = now;
+}
+
+/**
+ * @brief Handle a digit in predictive mode
+ * @param engine Engine state
+ * @param digit Digit '0' to '9'
+ */
+static void TCA8418_Text_Predictive(TCA8418_TextEngine *engine, char digit){
+    if((digit == '0') || (digit == '1')){
+        TCA8418_Text_Commit(engine);
+        TCA8418_Text_Append(engine, (digit == '0') ? ' ' : '.');
+        return;
+    }
+    if(engine->digitCount >= TCA8418_TEXT_WORD_MAX){
+        return;
+    }
+    engine->node = (engine->digitCount == 0) ? TCA8418_Text_Lookup(engine->dictionary, &digit, 1, NULL)
+                                             : TCA8418_Text_Child(engine->dictionary, engine->node, digit);
+    engine->digits[engine->digitCount++] = digit;
+    engine->candidate = 0;
+}
+
+/**
+ * @brief Handle one key symbol
+ * @param engine Engine state
+ * @param symbol '0'-'9', '*' or '#'
+ * @param now Time of the press in milliseconds
+ */
+static void TCA8418_Text_Symbol(TCA8418_TextEngine *engine, char symbol, uint32_t now){
+    if(symbol == '#'){
+        TCA8418_Text_Commit(engine);
+        if((engine->mode == TCA8418_TEXT_MULTITAP) && (engine->dictionary != NULL)){
+            engine->mode = TCA8418_TEXT_PREDICTIVE;
+        } else {
+            engine->mode = TCA8418_TEXT_MULTITAP;
+        }
+    } else if(symbol == '*'){
+        if(engine->lastDigit != 0){
+            engine->lastDigit = 0; // Drop the pending letter
+        } else if(engine->digitCount != 0){
+            uint8_t words = (engine->node != 0) ? engine->dictionary[engine->node + 1] : 0;
+            if(words > 1){
+                engine->candidate = (uint8_t)((engine->candidate + 1) % words);
+            } else {
+                engine->digitCount--; // Nothing to cycle through, remove the last digit
+                engine->node = TCA8418_Text_Lookup(engine->dictionary, engine->digits, engine->digitCount, NULL);
+                engine->candidate = 0;
+            }
+        } else {
+            TCA8418_Text_Backspace(engine);
+        }
+    } else if((symbol >= '0') && (symbol <= '9')){
+        if(engine->mode == TCA8418_TEXT_PREDICTIVE){
+            TCA8418_Text_Predictive(engine, symbol);
+        } else {
+            TCA8418_Text_MultiTap(engine, symbol, now);
+        }
+    }
+}
+
+/**
+ * @brief Initialize the engine
+ * @param engine Engine state
+ * @param keySymbols Table of 128 symbols indexed by key number
+ * @param dictionary Predictive dictionary, NULL for multi-tap only
+ * @param multiTapTimeoutMs Pause that commits the multi-tap letter in milliseconds
+ */
+void TCA8418_Text_Init(TCA8418_TextEngine *engine, const uint8_t *keySymbols, const uint8_t *dictionary,
+                       uint16_t multiTapTimeoutMs){
+    engine->keySymbols = keySymbols;
+    engine->dictionary = dictionary;
+    engine->multiTapTimeoutMs = multiTapTimeoutMs;
+    engine->mode = TCA8418_TEXT_MULTITAP;
+    engine->text[0] = '\0';
+    engine->length = 0;
+    engine->lastDigit = 0;
+    engine->tapIndex = 0;
+    engine->lastTick = 0;
+    engine->digitCount = 0;
+    engine->node = 0;
+    engine->candidate = 0;
+}
+
+/**
+ * @brief Commit the pending multi-tap letter once its timeout has passed
+ * @param engine Engine state
+ * @param now Current time in milliseconds
+ */
+void TCA8418_Text_Poll(TCA8418_TextEngine *engine, uint32_t now){
+    if((engine->lastDigit != 0) && ((now - engine->lastTick) >= engine->multiTapTimeoutMs)){
+        TCA8418_Text_Commit(engine);
+    }
+}
+
+/**
+ * @brief Feed drained key events to the engine
+ * @param engine Engine state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ * @note Only presses are used, releases are ignored.
+ */
+void TCA8418_Text_ProcessEvents(TCA8418_TextEngine *engine, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now){
+    TCA8418_Text_Poll(engine, now);
+    for(uint8_t i = 0; i < numEvents; i++){
+        if(!(keyEvents[i] & 0x80)){ // Bit 7
+            continue;
+        }
+        TCA8418_Text_Symbol(engine, (char)engine->keySymbols[keyEvents[i] & 0x7F], now);
+    }
+}
+
+/**
+ * @brief Get the text being composed, not yet part of the committed text
+ * @param engine Engine state
+ * @param buffer Destination of at least TCA8418_TEXT_WORD_MAX + 1 characters
+ * @return uint8_t Length of the composition
+ */
+uint8_t TCA8418_Text_GetComposition(const TCA8418_TextEngine *engine, char *buffer){
+    uint8_t length = 0;
+    if(engine->lastDigit != 0){
+        buffer[length++] = multiTapLetters[engine->lastDigit - '0'][engine->tapIndex];
+    } else if(engine->digitCount != 0){
+        const uint8_t *word = TCA8418_Text_Word(engine->dictionary, engine->node, engine->digitCount, engine->candidate);
+        for(; length < engine->digitCount; length++){
+            buffer[length] = (word != NULL) ? (char)word[length] : engine->digits[length];
+        }
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file tca8418_text.h
+ * @brief TCA8418 phone keypad text entry header
+ * @details This header file contains the declarations of a text entry engine
+ *          for 12-key phone keypads, supporting multi-tap input and T9-style
+ *          predictive input from a flash-resident dictionary trie. It has no
+ *          HAL dependency, so it also builds on the host.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_TEXT_H__
+#define __TCA8418_TEXT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Capacity of the committed text, excluding the terminator */
+#ifndef TCA8418_TEXT_MAX
+#define TCA8418_TEXT_MAX 64
+#endif
+
+/* Longest word typed in predictive mode */
+#ifndef TCA8418_TEXT_WORD_MAX
+#define TCA8418_TEXT_WORD_MAX 24
+#endif
+
+/* Dictionary layout, see tools/t9dict.c for the builder:
+ * - Header: the 4 bytes "T9D1", the root node follows
+ * - Node: child mask (bit i set when digit '2' + i continues a word), word count,
+ *   a 24-bit little endian offset per child in digit order, then word count words
+ *   of node depth letters each, most frequent first
+ */
+#define TCA8418_TEXT_DICT_HEADER 4
+
+/**
+ * @brief Input modes
+ */
+typedef enum {
+    TCA8418_TEXT_MULTITAP = 0,  //< Each press of a digit cycles through its letters
+    TCA8418_TEXT_PREDICTIVE     //< One press per letter, words resolved from the dictionary
+} TCA8418_TextMode;
+
+/**
+ * @brief Text entry engine state
+ */
+typedef struct {
+    const uint8_t *keySymbols;              //< Key number to '0'-'9', '*', '#', 0 for other keys
+    const uint8_t *dictionary;              //< Predictive dictionary, NULL disables predictive mode
+    uint16_t multiTapTimeoutMs;             //< Pause that commits the multi-tap letter
+    TCA8418_TextMode mode;                  //< Current input mode
+    char text[TCA8418_TEXT_MAX + 1];        //< Committed text, NUL terminated
+    uint8_t length;                         //< Committed characters
+    uint8_t lastDigit;                      //< Digit of the pending multi-tap letter, 0 if none
+    uint8_t tapIndex;                       //< Letter index of the pending multi-tap letter
+    uint32_t lastTick;                      //< Time of the last multi-tap press
+    char digits[TCA8418_TEXT_WORD_MAX];     //< Digits of the predictive word being composed
+    uint8_t digitCount;                     //< Digits typed, 0 if no word is composed
+    uint32_t node;                          //< Dictionary node of the digits, 0 if there is no match
+    uint8_t candidate;                      //< Selected word of the node
+} TCA8418_TextEngine;
+
+/**
+ * @brief Initialize the engine
+ * @param engine Engine state
+ * @param keySymbols Table of 128 symbols indexed by key number
+ * @param dictionary Predictive dictionary, NULL for multi-tap only
+ * @param multiTapTimeoutMs Pause that commits the multi-tap letter in milliseconds
+ */
+void TCA8418_Text_Init(TCA8418_TextEngine *engine, const uint8_t *keySymbols, const uint8_t *dictionary,
+                       uint16_t multiTapTimeoutMs);
+
+/**
+ * @brief Feed drained key events to the engine
+ * @param engine Engine state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ */
+void TCA8418_Text_ProcessEvents(TCA8418_TextEngine *engine, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now);
+
+/**
+ * @brief Commit the pending multi-tap letter once its timeout has passed
+ * @param engine Engine state
+ * @param now Current time in milliseconds
+ */
+void TCA8418_Text_Poll(TCA8418_TextEngine *engine, uint32_t now);
+
+/**
+ * @brief Get the text being composed, not yet part of the committed text
+ * @param engine Engine state
+ * @param buffer Destination of at least TCA8418_TEXT_WORD_MAX + 1 characters
+ * @return uint8_t Length of the composition
+ */
+uint8_t TCA8418_Text_GetComposition(const TCA8418_TextEngine *engine, char *buffer);
+
+/**
+ * @brief Find the dictionary node of a digit sequence
+ * @param dictionary Predictive dictionary
+ * @param digits Digits '2' to '9'
+ * @param count Number of digits
+ * @param wordCount Pointer to store the number of words of the node, may be NULL
+ * @return uint32_t Node offset, 0 if no word starts with these digits
+ */
+uint32_t TCA8418_Text_Lookup(const uint8_t *dictionary, const char *digits, uint8_t count, uint8_t *wordCount);
+
+/**
+ * @brief Get a word of a dictionary node, read in place from the dictionary
+ * @param dictionary Predictive dictionary
+ * @param node Node offset returned by TCA8418_Text_Lookup()
+ * @param count Number of digits of the node, which is also the word length
+ * @param index Word index, 0 is the most frequent
+ * @return const uint8_t* count letters of the word, NULL if index is out of range
+ */
+const uint8_t *TCA8418_Text_Word(const uint8_t *dictionary, uint32_t node, uint8_t count, uint8_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file tca8418_trace.c
+ * @brief TCA8418 timeline trace implementation
+ * @details This file contains the trace record buffer, the Chrome trace
+ *          event JSON export and the stage latency report of the event stamps.
+ *          Nothing is compiled unless TCA8418_TRACE or TCA8418_STAMPS is 1.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_trace.h"
+
+#if TCA8418_TRACE
+
+/* For TCA8418_GetCycles and the CMSIS interrupt masking */
+#include "tca8418.h"
+/* For snprintf */
+#include <stdio.h>
+
+/* Timeline rows of the exported trace */
+#define TRACK_INTERRUPTS    1 //< INT edges and interrupt handlers
+#define TRACK_DRIVER        2 //< Drains and ring enqueues
+#define TRACK_BUS           3 //< I2C transactions
+#define TRACK_APPLICATION   4 //< Ring dequeues and application handling
+
+/* Name and timeline row of each activity */
+static const struct {
+    const char *name;
+    uint8_t track;
+} activities[TCA8418_TRACE_COUNT] = {
+    [TCA8418_TRACE_INT]       = {"INT edge", TRACK_INTERRUPTS},
+    [TCA8418_TRACE_ISR]       = {"EXTI handler", TRACK_INTERRUPTS},
+    [TCA8418_TRACE_DEFERRED]  = {"Deferred handler", TRACK_INTERRUPTS},
+    [TCA8418_TRACE_DRAIN]     = {"Drain", TRACK_DRIVER},
+    [TCA8418_TRACE_I2C_READ]  = {"I2C read", TRACK_BUS},
+    [TCA8418_TRACE_I2C_WRITE] = {"I2C write", TRACK_BUS},
+    [TCA8418_TRACE_ENQUEUE]   = {"Ring enqueue", TRACK_DRIVER},
+    [TCA8418_TRACE_DEQUEUE]   = {"Ring dequeue", TRACK_APPLICATION},
+    [TCA8418_TRACE_CONSUMER]  = {"Consumer", TRACK_APPLICATION},
+};
+
+/* Names of the timeline rows, indexed by track */
+static const char *const trackNames[] = {"", "Interrupts", "Driver", "I2C bus", "Application"};
+
+static TCA8418_TraceRecord records[TCA8418_TRACE_DEPTH];
+static uint32_t recordCount; //< Records added since the last clear
+
+/**
+ * @brief Add a record to the trace
+ * @param activity Traced activity
+ * @param phase TCA8418_TRACE_BEGIN_PHASE, TCA8418_TRACE_END_PHASE or TCA8418_TRACE_INSTANT_PHASE
+ * @param reg Register of I2C activities, otherwise 0
+ * @param arg Length or event count, otherwise 0
+ * @note Safe to call from interrupt handlers, the slot is claimed with interrupts masked.
+ */
+void TCA8418_Trace_Record(TCA8418_TraceActivity activity, uint8_t phase, uint8_t reg, uint8_t arg){
+    TCA8418_TraceRecord *record;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    record = &records[recordCount % TCA8418_TRACE_DEPTH];
+    recordCount++;
+    record->cycles = TCA8418_GetCycles();
+    record->activity = (uint8_t)activity;
+    record->phase = phase;
+    record->reg = reg;
+    record->arg = arg;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Discard every record
+ */
+void TCA8418_Trace_Clear(void){
+    recordCount = 0;
+}
+
+/**
+ * @brief Export the records as Chrome trace event JSON
+ * @param write Sink of the JSON text, e.g. a UART or semihosting file write
+ * @param cyclesPerUs Cycle counter ticks per microsecond, e.g. SystemCoreClock / 1000000
+ * @note Records are exported oldest first with timestamps relative to the oldest one.
+ *       Load the output in https://ui.perfetto.dev or chrome://tracing.
+ */
+void TCA8418_Trace_Export(TCA8418_TraceWrite write, uint32_t cyclesPerUs){
+    char line[160];
+    int length;
+    uint32_t count = (recordCount < TCA8418_TRACE_DEPTH) ? recordCount : TCA8418_TRACE_DEPTH;
+    uint32_t first = recordCount - count;
+    uint32_t base = (count > 0) ? records[first % TCA8418_TRACE_DEPTH].cycles : 0;
+    if(cyclesPerUs == 0){
+        cyclesPerUs = 1;
+    }
+    length = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    write(line, (uint16_t)length);
+    for(uint8_t track = TRACK_INTERRUPTS; track <= TRACK_APPLICATION; track++){
+        length = snprintf(line, sizeof(line),
+                          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}%s\n",
+                          track, trackNames[track], ((track < TRACK_APPLICATION) || (count > 0)) ? "," : "");
+        write(line, (uint16_t)length);
+    }
+    for(uint32_t i = 0; i < count; i++){
+        const TCA8418_TraceRecord *record = &records[(first + i) % TCA8418_TRACE_DEPTH];
+        uint32_t ns = (uint32_t)(((uint64_t)(record->cycles - base) * 1000U) / cyclesPerUs);
+        length = snprintf(line, sizeof(line),
+                          "{\"name\":\"%s\",\"ph\":\"%c\",%s\"ts\":%lu.%03lu,\"pid\":1,\"tid\":%u,"
+                          "\"args\":{\"reg\":\"0x%02X\",\"arg\":%u}}%s\n",
+                          activities[record->activity].name, record->phase,
+                          (record->phase == TCA8418_TRACE_INSTANT_PHASE) ? "\"s\":\"t\"," : "",
+                          (unsigned long)(ns / 1000U), (unsigned long)(ns % 1000U),
+                          activities[record->activity].track, record->reg, record->arg,
+                          (i + 1 < count) ? "," : "");
+        write(line, (uint16_t)length);
+    }
+    write("]}\n", 3);
+}
+
+#endif
+
+#if TCA8418_STAMPS
+
+/* For snprintf */
+#include <stdio.h>
+
+/* Names of the intervals, indexed by the stage that ends them minus 1 */
+static const char *const intervalNames[TCA8418_STAGE_COUNT - 1] = {
+    "INT -> drain",
+    "drain -> FIFO read",
+    "FIFO read -> enqueue",
+    "enqueue -> dequeue",
+    "dequeue -> handled",
+};
+
+/**
+ * @brief Add the stamps of a completed event to the stage statistics
+ * @param stats Statistics to update
+ * @param stamps Stamps of the event
+ */
+void TCA8418_Stamps_Add(TCA8418_StageStats *stats, const TCA8418_EventStamps *stamps){
+    uint32_t total = 0;
+    uint8_t saturated = 0;
+    for(uint8_t i = 0; i < TCA8418_STAGE_COUNT - 1; i++){
+        uint32_t cycles = (uint32_t)stamps->interval[i] << TCA8418_STAMP_SHIFT;
+        if(stamps->interval[i] == 0xFFFF){
+            saturated = 1;
+        }
+        stats->totalCycles[i] += cycles;
+        if(cycles > stats->maxCycles[i]){
+            stats->maxCycles[i] = cycles;
+        }
+        total += cycles;
+    }
+    stats->events++;
+    stats->saturated += saturated;
+    if(total >= stats->worstCycles){
+        stats->worstCycles = total;
+        stats->worst = *stamps;
+    }
+}
+
+/**
+ * @brief Write the latency attribution table of the stage statistics
+ * @param stats Statistics to report
+ * @param write Sink of the table text, e.g. a UART write
+ * @param cyclesPerUs Cycle counter ticks per microsecond, e.g. SystemCoreClock / 1000000
+ * @note One row per interval with its mean, its share of the mean total latency, its
+ *       maximum and its value in the slowest event, which tells which stage made it slow.
+ */
+void TCA8418_Stamps_WriteReport(const TCA8418_StageStats *stats, TCA8418_TraceWrite write, uint32_t cyclesPerUs){
+    char line[96];
+    int length;
+    uint64_t total = 0;
+    if(cyclesPerUs == 0){
+        cyclesPerUs = 1;
+    }
+    for(uint8_t i = 0; i < TCA8418_STAGE_COUNT - 1; i++){
+        total += stats->totalCycles[i];
+    }
+    length = snprintf(line, sizeof(line), "%lu events, %lu saturated, times in us\n",
+                      (unsigned long)stats->events, (unsigned long)stats->saturated);
+    write(line, (uint16_t)length);
+    length = snprintf(line, sizeof(line), "%-22s %10s %6s %10s %10s\n", "stage", "mean", "share", "max", "slowest");
+    write(line, (uint16_t)length);
+    for(uint8_t i = 0; i < TCA8418_STAGE_COUNT - 1; i++){
+        uint32_t mean = (stats->events > 0) ? (uint32_t)(stats->totalCycles[i] / stats->events) : 0;
+        uint32_t share = (total > 0) ? (uint32_t)((stats->totalCycles[i] * 100U) / total) : 0;
+        length = snprintf(line, sizeof(line), "%-22s %10lu %5lu%% %10lu %10lu\n", intervalNames[i],
+                          (unsigned long)(mean / cyclesPerUs), (unsigned long)share,
+                          (unsigned long)(stats->maxCycles[i] / cyclesPerUs),
+                          (unsigned long)(((uint32_t)stats->worst.interval[i] << TCA8418_STAMP_SHIFT) / cyclesPerUs));
+        write(line, (uint16_t)length);
+    }
+    length = snprintf(line, sizeof(line), "%-22s %10lu %6s %10s %10lu\n", "total",
+                      (unsigned long)((stats->events > 0) ? (uint32_t)(total / stats->events) / cyclesPerUs : 0), "", "",
+                      (unsigned long)(stats->worstCycles / cyclesPerUs));
+    write(line, (uint16_t)length);
+}
+
+#endif
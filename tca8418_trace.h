@@ -0,0 +1,180 @@
+/**
+ * @file tca8418_trace.h
+ * @brief TCA8418 timeline trace header
+ * @details This header file contains the declarations of the driver timeline
+ *          trace: INT edges, interrupt handlers, drains, I2C transactions,
+ *          ring enqueues and dequeues and application handling are recorded
+ *          with cycle timestamps and exported as Chrome trace event JSON,
+ *          which Perfetto and chrome://tracing display as a timeline.
+ *          Tracing is compiled in with TCA8418_TRACE set to 1, otherwise every
+ *          trace point compiles to nothing.
+ *          Per-event stage stamps are compiled in with TCA8418_STAMPS set to 1:
+ *          every event carries the cycle times of its pipeline stages from the
+ *          INT edge to the end of its handling, and completed events are
+ *          summed per stage to attribute latency.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_TRACE_H__
+#define __TCA8418_TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Set to 1 to compile the trace points in */
+#ifndef TCA8418_TRACE
+#define TCA8418_TRACE 0
+#endif
+
+/* Number of records kept, the oldest are overwritten */
+#ifndef TCA8418_TRACE_DEPTH
+#define TCA8418_TRACE_DEPTH 256
+#endif
+
+/* Set to 1 to stamp every event at each pipeline stage, needs TCA8418_FEATURE_RING */
+#ifndef TCA8418_STAMPS
+#define TCA8418_STAMPS 0
+#endif
+
+/* Stage intervals are stored in units of 2^TCA8418_STAMP_SHIFT cycles, 16 bits each */
+#ifndef TCA8418_STAMP_SHIFT
+#define TCA8418_STAMP_SHIFT 4
+#endif
+
+/**
+ * @brief Traced activities
+ */
+typedef enum {
+    TCA8418_TRACE_INT = 0,      //< INT edge seen, instant
+    TCA8418_TRACE_ISR,          //< TCA8418_IRQHandler(), or TCA8418_ReadKeyEvents() or TCA8418_ServiceInterrupt() called from EXTI
+    TCA8418_TRACE_DEFERRED,     //< TCA8418_DeferredHandler()
+    TCA8418_TRACE_DRAIN,        //< A pass of TCA8418_ServiceInterrupt() or TCA8418_ReadKeyEvents()
+    TCA8418_TRACE_I2C_READ,     //< Register read, arg is the length
+    TCA8418_TRACE_I2C_WRITE,    //< Register write, arg is the length
+    TCA8418_TRACE_ENQUEUE,      //< Events put in the ring, instant, arg is the count
+    TCA8418_TRACE_DEQUEUE,      //< Events taken from the ring, instant, arg is the count
+    TCA8418_TRACE_CONSUMER,     //< Application handling, recorded by the application
+    TCA8418_TRACE_COUNT
+} TCA8418_TraceActivity;
+
+/* Record phases, as in the Chrome trace event format */
+#define TCA8418_TRACE_BEGIN_PHASE   'B'
+#define TCA8418_TRACE_END_PHASE     'E'
+#define TCA8418_TRACE_INSTANT_PHASE 'i'
+
+/**
+ * @brief One trace record
+ */
+typedef struct {
+    uint32_t cycles;    //< TCA8418_GetCycles() timestamp
+    uint8_t activity;   //< TCA8418_TraceActivity
+    uint8_t phase;      //< Begin, end or instant
+    uint8_t reg;        //< Register of I2C activities
+    uint8_t arg;        //< Length or event count
+} TCA8418_TraceRecord;
+
+/**
+ * @brief Pipeline stages of a key event, in order
+ */
+typedef enum {
+    TCA8418_STAGE_INT = 0,      //< INT edge, or drain start when the drain runs from the EXTI callback
+    TCA8418_STAGE_DRAIN,        //< TCA8418_ServiceInterrupt() entered
+    TCA8418_STAGE_FIFO,         //< Event byte read from KEY_EVENT_A
+    TCA8418_STAGE_ENQUEUE,      //< Event put in the ring
+    TCA8418_STAGE_DEQUEUE,      //< Event taken from the ring
+    TCA8418_STAGE_HANDLED,      //< Application done with the event
+    TCA8418_STAGE_COUNT
+} TCA8418_Stage;
+
+/**
+ * @brief Stage stamps of one event
+ * @note interval[s - 1] is the time from stage s - 1 to stage s in units of
+ *       2^TCA8418_STAMP_SHIFT cycles, 0xFFFF when it did not fit.
+ */
+typedef struct {
+    uint32_t intCycles;                             //< TCA8418_GetCycles() at TCA8418_STAGE_INT
+    uint16_t interval[TCA8418_STAGE_COUNT - 1];     //< Intervals between consecutive stages
+} TCA8418_EventStamps;
+
+/**
+ * @brief Latency of completed events attributed to their stages
+ */
+typedef struct {
+    uint32_t events;                                //< Events summed
+    uint32_t saturated;                             //< Events with an interval that did not fit, summed as 0xFFFF
+    uint64_t totalCycles[TCA8418_STAGE_COUNT - 1];  //< Sum per interval
+    uint32_t maxCycles[TCA8418_STAGE_COUNT - 1];    //< Longest of each interval
+    TCA8418_EventStamps worst;                      //< Stamps of the event with the longest total latency
+    uint32_t worstCycles;                           //< Total latency of that event
+} TCA8418_StageStats;
+
+/**
+ * @brief Callback receiving exported JSON text
+ * @param text Text chunk, not NUL terminated
+ * @param length Length in bytes
+ */
+typedef void (*TCA8418_TraceWrite)(const char *text, uint16_t length);
+
+/**
+ * @brief Add a record to the trace
+ * @param activity Traced activity
+ * @param phase TCA8418_TRACE_BEGIN_PHASE, TCA8418_TRACE_END_PHASE or TCA8418_TRACE_INSTANT_PHASE
+ * @param reg Register of I2C activities, otherwise 0
+ * @param arg Length or event count, otherwise 0
+ */
+void TCA8418_Trace_Record(TCA8418_TraceActivity activity, uint8_t phase, uint8_t reg, uint8_t arg);
+
+/**
+ * @brief Discard every record
+ */
+void TCA8418_Trace_Clear(void);
+
+/**
+ * @brief Export the records as Chrome trace event JSON
+ * @param write Sink of the JSON text, e.g. a UART or semihosting file write
+ * @param cyclesPerUs Cycle counter ticks per microsecond, e.g. SystemCoreClock / 1000000
+ */
+void TCA8418_Trace_Export(TCA8418_TraceWrite write, uint32_t cyclesPerUs);
+
+/**
+ * @brief Add the stamps of a completed event to the stage statistics
+ * @param stats Statistics to update
+ * @param stamps Stamps of the event
+ */
+void TCA8418_Stamps_Add(TCA8418_StageStats *stats, const TCA8418_EventStamps *stamps);
+
+/**
+ * @brief Write the latency attribution table of the stage statistics
+ * @param stats Statistics to report
+ * @param write Sink of the table text, e.g. a UART write
+ * @param cyclesPerUs Cycle counter ticks per microsecond, e.g. SystemCoreClock / 1000000
+ */
+void TCA8418_Stamps_WriteReport(const TCA8418_StageStats *stats, TCA8418_TraceWrite write, uint32_t cyclesPerUs);
+
+#if TCA8418_TRACE
+#define TCA8418_TRACE_BEGIN(activity, reg, arg)   TCA8418_Trace_Record((activity), TCA8418_TRACE_BEGIN_PHASE, (reg), (arg))
+#define TCA8418_TRACE_END(activity, reg, arg)     TCA8418_Trace_Record((activity), TCA8418_TRACE_END_PHASE, (reg), (arg))
+#define TCA8418_TRACE_INSTANT(activity, reg, arg) TCA8418_Trace_Record((activity), TCA8418_TRACE_INSTANT_PHASE, (reg), (arg))
+#else
+#define TCA8418_TRACE_BEGIN(activity, reg, arg)   ((void)0)
+#define TCA8418_TRACE_END(activity, reg, arg)     ((void)0)
+#define TCA8418_TRACE_INSTANT(activity, reg, arg) ((void)0)
+#endif
+
+#if TCA8418_STAMPS
+#define TCA8418_STAMP(stamp)    ((stamp) = TCA8418_GetCycles())
+#else
+#define TCA8418_STAMP(stamp)    ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
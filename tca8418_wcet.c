@@ -0,0 +1,238 @@
+/**
+ * @file tca8418_wcet.c
+ * @brief TCA8418 worst-case execution time model implementation
+ * @details This file contains the longest transaction sequence of every
+ *          modeled driver function. Bus time is counted as in tca8418_power.c:
+ *          9 clocks per byte with its acknowledge and one clock per START,
+ *          repeated START and STOP. Clock stretching is not modeled, the
+ *          TCA8418 does not stretch the clock.
+ *          A failed attempt is bounded by the HAL bus busy wait plus
+ *          TCA8418_I2C_TIMEOUT, both measured with the 1 ms tick, so one tick
+ *          of granularity is added.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_wcet.h"
+/* For TCA8418_FEATURE_MODELS */
+#include "tca8418_config.h"
+
+/* For snprintf */
+#include <stdio.h>
+
+#if TCA8418_FEATURE_MODELS
+
+/* Matrix diagnostic geometry, see TCA8418_RunMatrixDiagnostic() */
+#define DIAG_PINS       18 //< Pins driven in turn
+#define DIAG_BLOCK_SIZE 24 //< GPIO_DAT_OUT1 to GPIO_PULL3
+
+/* Names of the modeled functions in the table */
+static const char *const apiNames[TCA8418_WCET_COUNT] = {
+    [TCA8418_WCET_INIT]               = "Init",
+    [TCA8418_WCET_READ_KEY_EVENTS]    = "ReadKeyEvents",
+    [TCA8418_WCET_SERVICE_INTERRUPT]  = "ServiceInterrupt/pass",
+    [TCA8418_WCET_LOCK_KEYPAD]        = "Lock/UnlockKeypad",
+    [TCA8418_WCET_SET_INTERRUPT_MODE] = "SetInterruptMode",
+    [TCA8418_WCET_MATRIX_DIAGNOSTIC]  = "RunMatrixDiagnostic",
+    [TCA8418_WCET_CONFIGURE_OUTPUTS]  = "ConfigureOutputs",
+    [TCA8418_WCET_FLUSH_OUTPUTS]      = "FlushOutputs",
+    [TCA8418_WCET_REATTACH]           = "PollPresence/reattach",
+    [TCA8418_WCET_POP_EVENTS]         = "PopEvents/resume",
+    [TCA8418_WCET_PROBE_BUS]          = "ProbeBus",
+};
+
+/* Write and readback patterns of TCA8418_ProbeBus() per round */
+#define PROBE_PATTERNS  8
+
+/**
+ * @brief Add a register read to a bound
+ * @param bound Bound to add to
+ * @param length Bytes read
+ */
+static void TCA8418_Wcet_Read(TCA8418_WcetBound *bound, uint8_t length){
+    bound->transactions++;
+    bound->busClocks += 9U * (3U + length) + 3U;
+}
+
+/**
+ * @brief Add a register write to a bound
+ * @param bound Bound to add to
+ * @param length Bytes written
+ */
+static void TCA8418_Wcet_Write(TCA8418_WcetBound *bound, uint8_t length){
+    bound->transactions++;
+    bound->busClocks += 9U * (2U + length) + 2U;
+}
+
+/**
+ * @brief Add an address-only probe to a bound
+ * @param bound Bound to add to
+ */
+static void TCA8418_Wcet_Probe(TCA8418_WcetBound *bound){
+    bound->transactions++;
+    bound->busClocks += 9U + 2U;
+}
+
+/**
+ * @brief Add a full FIFO drain to a bound
+ * @param bound Bound to add to
+ * @param config Target and driver parameters
+ */
+static void TCA8418_Wcet_ReadFIFO(TCA8418_WcetBound *bound, const TCA8418_WcetConfig *config){
+    if(!config->perRegister){
+        TCA8418_Wcet_Read(bound, config->fifoDepth);
+        return;
+    }
+    for(uint8_t i = 0; i < config->fifoDepth; i++){
+        TCA8418_Wcet_Read(bound, 1);
+    }
+}
+
+/**
+ * @brief Add one drain pass to a bound
+ * @param bound Bound to add to
+ * @param config Target and driver parameters
+ */
+static void TCA8418_Wcet_DrainPass(TCA8418_WcetBound *bound, const TCA8418_WcetConfig *config){
+    TCA8418_Wcet_Read(bound, 1); // INT_STAT
+    TCA8418_Wcet_Read(bound, 1); // KEY_LCK_EC
+    TCA8418_Wcet_ReadFIFO(bound, config);
+    TCA8418_Wcet_Write(bound, 1); // INT_STAT clear
+    if(config->latched){
+        TCA8418_Wcet_Read(bound, 1); // KEY_LCK_EC recheck
+    }
+}
+
+/**
+ * @brief Bound the execution time of a driver function
+ * @param api Modeled function
+ * @param config Target and driver parameters
+ * @param bound Pointer to store the bound
+ * @note The FIFO is assumed full. IT and DMA drains are bounded like burst drains, the
+ *       interrupt context then only runs the blocking INT_STAT and count accesses.
+ *       In latched mode TCA8418_ServiceInterrupt() and TCA8418_ReadKeyEvents() run another
+ *       pass only for events that arrived during the previous one, so multiply the pass
+ *       bound by the passes the key rate allows. The fault bound assumes every transaction exhausts
+ *       its retries, the driver actually returns at the first failed one.
+ *       TCA8418_ProbeBus() is bounded at probeHz, the slowest speed it tests, and without the
+ *       time TCA8418_SetBusSpeed() takes to reprogram the peripheral.
+ */
+void TCA8418_Wcet_Bound(TCA8418_WcetApi api, const TCA8418_WcetConfig *config, TCA8418_WcetBound *bound){
+    uint64_t ns;
+    uint32_t busHz = config->busHz;
+    uint32_t attemptMs = (uint32_t)config->busyTimeoutMs + config->timeoutMs + 1U;
+    bound->transactions = 0;
+    bound->busClocks = 0;
+    switch(api){
+    case TCA8418_WCET_INIT:
+        TCA8418_Wcet_Write(bound, 1); // CFG with AI set
+        TCA8418_Wcet_Write(bound, 6); // GPIO_INT_EN1 to KP_GPIO3
+        TCA8418_Wcet_Write(bound, 1); // CFG
+        break;
+    case TCA8418_WCET_READ_KEY_EVENTS:
+        TCA8418_Wcet_Read(bound, 1); // INT_STAT
+        TCA8418_Wcet_Read(bound, 1); // KEY_LCK_EC
+        TCA8418_Wcet_ReadFIFO(bound, config);
+        TCA8418_Wcet_Write(bound, 1); // INT_STAT clear
+        if(config->latched){
+            TCA8418_Wcet_Read(bound, 1); // KEY_LCK_EC recheck
+            TCA8418_Wcet_Write(bound, 1); // CFG with KE_IEN cleared when the 10 events are read
+            TCA8418_Wcet_Write(bound, 1); // CFG
+        }
+        break;
+    case TCA8418_WCET_SERVICE_INTERRUPT:
+        TCA8418_Wcet_DrainPass(bound, config);
+        break;
+    case TCA8418_WCET_LOCK_KEYPAD:
+        TCA8418_Wcet_Write(bound, 1); // KP_GPIO2
+        TCA8418_Wcet_Write(bound, 1); // GPIO_INT_EN2
+        break;
+    case TCA8418_WCET_SET_INTERRUPT_MODE:
+        TCA8418_Wcet_Write(bound, 1); // CFG
+        break;
+    case TCA8418_WCET_MATRIX_DIAGNOSTIC:
+        TCA8418_Wcet_Write(bound, 1); // CFG
+        TCA8418_Wcet_Read(bound, DIAG_BLOCK_SIZE); // Save
+        TCA8418_Wcet_Write(bound, DIAG_BLOCK_SIZE); // GPIO setup
+        TCA8418_Wcet_Read(bound, 3); // Stuck low check
+        for(uint8_t pin = 0; pin < DIAG_PINS; pin++){
+            TCA8418_Wcet_Write(bound, 3); // GPIO_DIR delta
+            TCA8418_Wcet_Read(bound, 3); // GPIO_DAT_STAT
+        }
+        TCA8418_Wcet_Write(bound, DIAG_BLOCK_SIZE); // Restore
+        TCA8418_Wcet_Read(bound, 1); // KEY_LCK_EC
+        for(uint8_t i = 0; i < config->fifoDepth; i++){
+            TCA8418_Wcet_Read(bound, 1); // Discarded events
+        }
+        TCA8418_Wcet_Write(bound, 1); // CFG
+        TCA8418_Wcet_Write(bound, 1); // INT_STAT clear
+        break;
+    case TCA8418_WCET_CONFIGURE_OUTPUTS:
+        for(uint8_t i = 0; i < 3; i++){
+            TCA8418_Wcet_Write(bound, 1); // GPIO_DAT_OUT
+            TCA8418_Wcet_Write(bound, 1); // GPIO_DIR
+        }
+        break;
+    case TCA8418_WCET_FLUSH_OUTPUTS:
+        for(uint8_t i = 0; i < 3; i++){
+            TCA8418_Wcet_Write(bound, 1); // GPIO_DAT_OUT
+        }
+        break;
+    case TCA8418_WCET_REATTACH:
+        TCA8418_Wcet_Probe(bound);
+        TCA8418_Wcet_Write(bound, 1);  // CFG with AI set
+        TCA8418_Wcet_Write(bound, 15); // GPIO_DAT_OUT1 to GPIO_DIR3
+        TCA8418_Wcet_Write(bound, 1);  // CFG
+        break;
+    case TCA8418_WCET_POP_EVENTS:
+        /* With the deferred handler the resume is only pended */
+        if(!config->deferred){
+            TCA8418_Wcet_DrainPass(bound, config);
+        }
+        break;
+    case TCA8418_WCET_PROBE_BUS:
+        TCA8418_Wcet_Probe(bound);
+        TCA8418_Wcet_Read(bound, 1); // Save the probe register
+        for(uint16_t i = 0; i < (uint16_t)config->probeSpeeds * config->probeRounds * PROBE_PATTERNS; i++){
+            TCA8418_Wcet_Write(bound, 1); // Pattern
+            TCA8418_Wcet_Read(bound, 1); // Readback
+        }
+        TCA8418_Wcet_Write(bound, 1); // Restore the probe register
+        busHz = (config->probeHz > 0) ? config->probeHz : config->busHz;
+        break;
+    default:
+        break;
+    }
+    ns = 0;
+    if(busHz > 0){
+        ns += ((uint64_t)bound->busClocks * 1000000000ULL) / busHz;
+    }
+    if(config->cpuHz > 0){
+        ns += ((uint64_t)bound->transactions * config->transferCycles * 1000000000ULL) / config->cpuHz;
+    }
+    bound->nominalUs = (uint32_t)((ns + 999U) / 1000U);
+    ns = (uint64_t)bound->transactions * (config->retries + 1U) * attemptMs * 1000U + bound->nominalUs;
+    bound->faultUs = (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+}
+
+/**
+ * @brief Write the bounds of every modeled function as a table
+ * @param config Target and driver parameters
+ * @param write Sink of the table text, e.g. a UART write or fwrite on the host
+ */
+void TCA8418_Wcet_WriteTable(const TCA8418_WcetConfig *config, TCA8418_WcetWrite write){
+    char line[96];
+    int length;
+    TCA8418_WcetBound bound;
+    length = snprintf(line, sizeof(line), "%-22s %6s %8s %10s %10s\n", "function", "xfers", "clocks", "nominal us", "fault us");
+    write(line, (uint16_t)length);
+    for(uint8_t api = 0; api < TCA8418_WCET_COUNT; api++){
+        TCA8418_Wcet_Bound((TCA8418_WcetApi)api, config, &bound);
+        length = snprintf(line, sizeof(line), "%-22s %6u %8lu %10lu %10lu\n", apiNames[api], bound.transactions,
+                          (unsigned long)bound.busClocks, (unsigned long)bound.nominalUs, (unsigned long)bound.faultUs);
+        write(line, (uint16_t)length);
+    }
+}
+
+#endif
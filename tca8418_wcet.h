@@ -0,0 +1,98 @@
+/**
+ * @file tca8418_wcet.h
+ * @brief TCA8418 worst-case execution time model header
+ * @details This header file contains the declarations of a model bounding the
+ *          execution time of the public driver functions. The bound follows
+ *          from the longest transaction sequence of each function, the bus
+ *          frequency, the FIFO depth, the HAL call overhead and, when the bus
+ *          fails, from TCA8418_I2C_TIMEOUT and TCA8418_I2C_RETRIES.
+ *          The module has no HAL dependency and also builds on the host.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_WCET_H__
+#define __TCA8418_WCET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/**
+ * @brief Modeled driver functions
+ */
+typedef enum {
+    TCA8418_WCET_INIT = 0,              //< TCA8418_Init() without calibration
+    TCA8418_WCET_READ_KEY_EVENTS,       //< TCA8418_ReadKeyEvents()
+    TCA8418_WCET_SERVICE_INTERRUPT,     //< One drain pass of TCA8418_ServiceInterrupt(), TCA8418_DeferredHandler() or TCA8418_PopEvents()
+    TCA8418_WCET_LOCK_KEYPAD,           //< TCA8418_LockKeypad() or TCA8418_UnlockKeypad()
+    TCA8418_WCET_SET_INTERRUPT_MODE,    //< TCA8418_SetInterruptMode()
+    TCA8418_WCET_MATRIX_DIAGNOSTIC,     //< TCA8418_RunMatrixDiagnostic()
+    TCA8418_WCET_CONFIGURE_OUTPUTS,     //< TCA8418_ConfigureOutputs() with outputs in every GPIO byte
+    TCA8418_WCET_FLUSH_OUTPUTS,         //< TCA8418_FlushOutputs() of a frame changing every GPIO byte
+    TCA8418_WCET_REATTACH,              //< TCA8418_PollPresence() call that finds the TCA8418 and reconfigures it
+    TCA8418_WCET_POP_EVENTS,            //< TCA8418_PopEvents() resuming a throttled drain
+    TCA8418_WCET_PROBE_BUS,             //< TCA8418_ProbeBus() when every speed passes
+    TCA8418_WCET_COUNT
+} TCA8418_WcetApi;
+
+/**
+ * @brief Target and driver parameters of the bound
+ */
+typedef struct {
+    uint32_t busHz;             //< I2C clock frequency
+    uint32_t cpuHz;             //< Core clock frequency
+    uint16_t transferCycles;    //< HAL call overhead of one transaction outside the bus time
+    uint16_t timeoutMs;         //< TCA8418_I2C_TIMEOUT
+    uint16_t busyTimeoutMs;     //< Bus busy wait of the HAL before each transaction, 25 ms in STM32Cube
+    uint8_t retries;            //< TCA8418_I2C_RETRIES
+    uint8_t fifoDepth;          //< Events drained at most, TCA8418_FIFO_DEPTH
+    uint8_t perRegister;        //< 1 for TCA8418_DRAIN_PER_REGISTER, otherwise one transaction reads the FIFO
+    uint8_t latched;            //< 1 for TCA8418_INT_LATCHED, adds the recheck of the event count
+    uint8_t deferred;           //< 1 with TCA8418_FEATURE_DEFERRED, TCA8418_PopEvents() then leaves the drain to PendSV
+    uint32_t probeHz;           //< First entry of TCA8418_PROBE_SPEEDS, the slowest speed TCA8418_ProbeBus() tests
+    uint8_t probeSpeeds;        //< TCA8418_PROBE_SPEED_COUNT
+    uint8_t probeRounds;        //< TCA8418_PROBE_ROUNDS
+} TCA8418_WcetConfig;
+
+/**
+ * @brief Execution time bound of a function
+ */
+typedef struct {
+    uint16_t transactions;      //< Blocking transactions on the longest path
+    uint32_t busClocks;         //< I2C clocks of those transactions
+    uint32_t nominalUs;         //< Bound when the TCA8418 acknowledges every transaction
+    uint32_t faultUs;           //< Bound when every attempt of every transaction fails
+} TCA8418_WcetBound;
+
+/**
+ * @brief Callback receiving table text
+ * @param text Text chunk, not NUL terminated
+ * @param length Length in bytes
+ */
+typedef void (*TCA8418_WcetWrite)(const char *text, uint16_t length);
+
+/**
+ * @brief Bound the execution time of a driver function
+ * @param api Modeled function
+ * @param config Target and driver parameters
+ * @param bound Pointer to store the bound
+ */
+void TCA8418_Wcet_Bound(TCA8418_WcetApi api, const TCA8418_WcetConfig *config, TCA8418_WcetBound *bound);
+
+/**
+ * @brief Write the bounds of every modeled function as a table
+ * @param config Target and driver parameters
+ * @param write Sink of the table text, e.g. a UART write or fwrite on the host
+ */
+void TCA8418_Wcet_WriteTable(const TCA8418_WcetConfig *config, TCA8418_WcetWrite write);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
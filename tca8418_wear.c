@@ -0,0 +1,329 @@
+/**
+ * @file tca8418_wear.c
+ * @brief TCA8418 key press counter implementation
+ * @details This file contains the implementation of the press counters and of
+ *          their append-only flash log.
+ *          Every sector starts with a header record holding its sequence number,
+ *          followed by a snapshot of the absolute counts and then delta records.
+ *          When a sector is full the next one is erased, the snapshot is written
+ *          and its header is programmed last, so a power loss during the move
+ *          leaves the previous sector as the newest valid one.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_wear.h"
+/* For TCA8418_FEATURE_WEAR */
+#include "tca8418_config.h"
+
+/* For memset, memmove */
+#include <string.h>
+
+#if TCA8418_FEATURE_WEAR
+
+/* Record types, an erased record reads 0xFF */
+#define RECORD_HEADER   0xA1 //< Sector header, value is the sequence number
+#define RECORD_SNAPSHOT 0x51 //< Absolute count of a key
+#define RECORD_DELTA    0xD1 //< Presses added to a key
+#define RECORD_ERASED   0xFF //< Free record
+
+/**
+ * @brief One log record
+ */
+typedef struct {
+    uint8_t type;       //< Record type
+    uint8_t key;        //< Key number
+    uint8_t check;      //< CRC-8 of the other bytes
+    uint8_t reserved;   //< Always 0
+    uint8_t value[4];   //< Little endian value
+} Record;
+
+/**
+ * @brief Compute the check byte of a record
+ * @param record Record
+ * @return uint8_t CRC-8 (polynomial 0x07) of every byte except the check byte
+ */
+static uint8_t TCA8418_Wear_Check(const Record *record){
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint8_t crc = 0;
+    for(uint8_t i = 0; i < TCA8418_WEAR_RECORD_SIZE; i++){
+        if(i == 2){
+            continue;
+        }
+        crc ^= bytes[i];
+        for(uint8_t bit = 0; bit < 8; bit++){
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Fill a record
+ * @param record Record to fill
+ * @param type Record type
+ * @param key Key number
+ * @param value Value
+ */
+static void TCA8418_Wear_MakeRecord(Record *record, uint8_t type, uint8_t key, uint32_t value){
+    record->type = type;
+    record->key = key;
+    record->reserved = 0;
+    record->value[0] = (uint8_t)value;
+    record->value[1] = (uint8_t)(value >> 8);
+    record->value[2] = (uint8_t)(value >> 16);
+    record->value[3] = (uint8_t)(value >> 24);
+    record->check = TCA8418_Wear_Check(record);
+}
+
+/**
+ * @brief Get the value of a record
+ * @param record Record
+ * @return uint32_t Value
+ */
+static inline uint32_t TCA8418_Wear_Value(const Record *record){
+    return (uint32_t)record->value[0] | ((uint32_t)record->value[1] << 8) |
+           ((uint32_t)record->value[2] << 16) | ((uint32_t)record->value[3] << 24);
+}
+
+/**
+ * @brief Check whether a record was never programmed
+ * @param record Record
+ * @return uint8_t 1 if every byte reads 0xFF, otherwise 0
+ */
+static uint8_t TCA8418_Wear_IsErased(const Record *record){
+    const uint8_t *bytes = (const uint8_t *)record;
+    for(uint8_t i = 0; i < TCA8418_WEAR_RECORD_SIZE; i++){
+        if(bytes[i] != RECORD_ERASED){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Forget the pending presses once they are in the log
+ * @param wear Counter state
+ */
+static void TCA8418_Wear_ClearPending(TCA8418_Wear *wear){
+    for(uint8_t i = 0; i < wear->numDirty; i++){
+        wear->pending[wear->dirty[i]] = 0;
+    }
+    wear->numDirty = 0;
+    wear->pendingTotal = 0;
+    wear->overflow = 0;
+}
+
+/**
+ * @brief Mark a record slot whose programming failed as bad
+ * @param wear Counter state
+ * @param address Address of the slot
+ * @note Clearing every bit is allowed over any content. A zeroed record has no valid
+ *       type and is skipped at boot, and unlike an erased slot it does not end the log.
+ */
+static void TCA8418_Wear_MarkBad(TCA8418_Wear *wear, uint32_t address){
+    static const Record zero = {0};
+    (void)wear->flash->program(address, &zero, TCA8418_WEAR_RECORD_SIZE);
+    wear->badRecords++;
+}
+
+/**
+ * @brief Move the log to the next sector, starting it with a snapshot of all counts
+ * @param wear Counter state
+ * @return int 0 if successful, otherwise the failing backend result
+ */
+static int TCA8418_Wear_Rotate(TCA8418_Wear *wear){
+    const TCA8418_WearFlash *flash = wear->flash;
+    uint8_t next = (uint8_t)((wear->sector + 1) % flash->numSectors);
+    uint32_t base = (uint32_t)next * flash->sectorSize;
+    uint32_t offset = TCA8418_WEAR_RECORD_SIZE;
+    Record record;
+    int result = flash->erase(next);
+    if(result != 0){
+        return result;
+    }
+    wear->sectorErases++;
+    for(uint16_t key = 0; key < TCA8418_WEAR_KEYS; key++){
+        if(wear->counts[key] == 0){
+            continue;
+        }
+        TCA8418_Wear_MakeRecord(&record, RECORD_SNAPSHOT, (uint8_t)key, wear->counts[key]);
+        result = flash->program(base + offset, &record, TCA8418_WEAR_RECORD_SIZE);
+        if(result != 0){
+            return result;
+        }
+        offset += TCA8418_WEAR_RECORD_SIZE;
+    }
+    /* The header makes the sector valid, so it is programmed last */
+    TCA8418_Wear_MakeRecord(&record, RECORD_HEADER, 0, wear->sequence + 1);
+    result = flash->program(base, &record, TCA8418_WEAR_RECORD_SIZE);
+    if(result != 0){
+        return result;
+    }
+    wear->sector = next;
+    wear->sequence++;
+    wear->writeOffset = offset;
+    TCA8418_Wear_ClearPending(wear);
+    return 0;
+}
+
+/**
+ * @brief Rebuild the counters from the log
+ * @param wear Counter state
+ * @param flash Flash backend
+ * @param threshold Pending presses that trigger a save
+ * @param idleMs Time without presses that triggers a save in milliseconds
+ * @return int 0 if successful, -1 if the flash geometry cannot hold a snapshot,
+ *         otherwise the failing backend result
+ * @note Records with a bad check byte, e.g. torn by a power loss, and zeroed bad
+ *       slots are skipped. The whole newest sector is read, so an erased slot left
+ *       by a failed program does not hide the records after it.
+ */
+int TCA8418_Wear_Init(TCA8418_Wear *wear, const TCA8418_WearFlash *flash, uint16_t threshold, uint32_t idleMs){
+    Record record;
+    uint8_t found = 0;
+    int result;
+    memset(wear, 0, sizeof(*wear));
+    wear->flash = flash;
+    wear->threshold = threshold;
+    wear->idleMs = idleMs;
+    if((flash->numSectors < 2) || (flash->sectorSize < (TCA8418_WEAR_KEYS + 1) * TCA8418_WEAR_RECORD_SIZE)){
+        return -1;
+    }
+    /* The newest sector is the valid one with the highest sequence number */
+    for(uint8_t sector = 0; sector < flash->numSectors; sector++){
+        result = flash->read((uint32_t)sector * flash->sectorSize, &record, TCA8418_WEAR_RECORD_SIZE);
+        if(result != 0){
+            return result;
+        }
+        if((record.type != RECORD_HEADER) || (record.check != TCA8418_Wear_Check(&record))){
+            continue;
+        }
+        if(!found || ((int32_t)(TCA8418_Wear_Value(&record) - wear->sequence) > 0)){
+            found = 1;
+            wear->sector = sector;
+            wear->sequence = TCA8418_Wear_Value(&record);
+        }
+    }
+    if(!found){
+        /* Blank log, start one from the last sector so the first rotation lands on sector 0 */
+        wear->sector = (uint8_t)(flash->numSectors - 1);
+        return TCA8418_Wear_Rotate(wear);
+    }
+    wear->writeOffset = flash->sectorSize;
+    for(uint32_t offset = TCA8418_WEAR_RECORD_SIZE; offset < flash->sectorSize; offset += TCA8418_WEAR_RECORD_SIZE){
+        result = flash->read((uint32_t)wear->sector * flash->sectorSize + offset, &record, TCA8418_WEAR_RECORD_SIZE);
+        if(result != 0){
+            return result;
+        }
+        if(TCA8418_Wear_IsErased(&record)){
+            /* A slot whose failed programming could not be marked bad reads erased,
+               the log only ends where a record is followed by no other record */
+            if(wear->writeOffset == flash->sectorSize){
+                wear->writeOffset = offset;
+            }
+            continue;
+        }
+        wear->writeOffset = flash->sectorSize;
+        if((record.check != TCA8418_Wear_Check(&record)) || (record.key >= TCA8418_WEAR_KEYS)){
+            continue;
+        }
+        if(record.type == RECORD_SNAPSHOT){
+            wear->counts[record.key] = TCA8418_Wear_Value(&record);
+        } else if(record.type == RECORD_DELTA){
+            wear->counts[record.key] += TCA8418_Wear_Value(&record);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Count the presses among drained key events
+ * @param wear Counter state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ * @note Only RAM is touched. A key whose pending count would overflow makes the
+ *       next save write a full snapshot instead of deltas.
+ */
+void TCA8418_Wear_ProcessEvents(TCA8418_Wear *wear, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now){
+    for(uint8_t i = 0; i < numEvents; i++){
+        uint8_t key = keyEvents[i] & 0x7F; // Bits 6:0
+        if(!(keyEvents[i] & 0x80) || (key >= TCA8418_WEAR_KEYS)){ // Bit 7
+            continue;
+        }
+        wear->counts[key]++;
+        wear->pendingTotal++;
+        wear->lastTick = now;
+        if(wear->pending[key] == 0){
+            wear->dirty[wear->numDirty++] = key;
+        }
+        if(wear->pending[key] == UINT16_MAX){
+            wear->overflow = 1;
+            continue;
+        }
+        wear->pending[key]++;
+    }
+}
+
+/**
+ * @brief Save the pending presses now, e.g. before entering standby
+ * @param wear Counter state
+ * @return int 0 if successful, otherwise the failing backend result
+ * @note Writes one delta record per key pressed since the last save, or moves to
+ *       the next sector with a snapshot when the current one cannot hold them.
+ *       When programming a record fails its slot is marked bad and skipped, the keys
+ *       not written yet stay pending and the next save appends them after it.
+ */
+int TCA8418_Wear_Flush(TCA8418_Wear *wear){
+    const TCA8418_WearFlash *flash = wear->flash;
+    uint32_t base = (uint32_t)wear->sector * flash->sectorSize;
+    Record record;
+    int result;
+    if(wear->pendingTotal == 0){
+        return 0;
+    }
+    if(wear->overflow ||
+       ((wear->writeOffset + (uint32_t)wear->numDirty * TCA8418_WEAR_RECORD_SIZE) > flash->sectorSize)){
+        return TCA8418_Wear_Rotate(wear);
+    }
+    for(uint8_t i = 0; i < wear->numDirty; i++){
+        uint8_t key = wear->dirty[i];
+        TCA8418_Wear_MakeRecord(&record, RECORD_DELTA, key, wear->pending[key]);
+        result = flash->program(base + wear->writeOffset, &record, TCA8418_WEAR_RECORD_SIZE);
+        if(result != 0){
+            /* The slot may hold a torn record that cannot be programmed again, so
+               it is zeroed to mark it bad and the retry uses the next slot */
+            TCA8418_Wear_MarkBad(wear, base + wear->writeOffset);
+            wear->writeOffset += TCA8418_WEAR_RECORD_SIZE;
+            /* Keep only the keys not written yet, so a retry does not count twice */
+            memmove(wear->dirty, &wear->dirty[i], wear->numDirty - i);
+            wear->numDirty = (uint8_t)(wear->numDirty - i);
+            return result;
+        }
+        wear->writeOffset += TCA8418_WEAR_RECORD_SIZE;
+        wear->pendingTotal -= wear->pending[key];
+        wear->pending[key] = 0;
+    }
+    TCA8418_Wear_ClearPending(wear);
+    return 0;
+}
+
+/**
+ * @brief Save the pending presses when the threshold or the idle time is reached
+ * @param wear Counter state
+ * @param now Current time in milliseconds
+ * @return int 0 if successful, otherwise the failing backend result
+ */
+int TCA8418_Wear_Poll(TCA8418_Wear *wear, uint32_t now){
+    if(wear->pendingTotal == 0){
+        return 0;
+    }
+    if((wear->pendingTotal >= wear->threshold) || ((now - wear->lastTick) >= wear->idleMs)){
+        return TCA8418_Wear_Flush(wear);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file tca8418_wear.h
+ * @brief TCA8418 key press counter header
+ * @details This header file contains the declarations of per-key press
+ *          counters kept in RAM and persisted in batches to a wear-leveled,
+ *          append-only log spread over several flash sectors. The flash is
+ *          accessed through callbacks, so the module has no HAL dependency
+ *          and runs on the host against a simulated flash.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_WEAR_H__
+#define __TCA8418_WEAR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+
+/* Number of counted key numbers, events of higher key numbers are ignored */
+#ifndef TCA8418_WEAR_KEYS
+#define TCA8418_WEAR_KEYS 128
+#endif
+
+/* Size of one log record in bytes, also the flash programming unit */
+#define TCA8418_WEAR_RECORD_SIZE 8
+
+/**
+ * @brief Flash backend of the log
+ * @note Every callback returns 0 on success. Addresses are offsets from the start
+ *       of the log area, which spans numSectors sectors of sectorSize bytes.
+ *       Programming only clears bits of erased (0xFF) bytes.
+ */
+typedef struct {
+    uint32_t sectorSize;                                            //< Bytes per erasable sector
+    uint8_t numSectors;                                             //< Sectors used by the log, at least 2
+    int (*read)(uint32_t address, void *data, uint32_t length);     //< Read bytes
+    int (*program)(uint32_t address, const void *data, uint32_t length); //< Program whole records
+    int (*erase)(uint8_t sector);                                   //< Erase one sector to 0xFF
+} TCA8418_WearFlash;
+
+/**
+ * @brief Counter state
+ */
+typedef struct {
+    const TCA8418_WearFlash *flash;         //< Flash backend
+    uint32_t counts[TCA8418_WEAR_KEYS];     //< Presses per key number, including unsaved ones
+    uint16_t pending[TCA8418_WEAR_KEYS];    //< Presses not yet in the log
+    uint8_t dirty[TCA8418_WEAR_KEYS];       //< Key numbers with pending presses
+    uint8_t numDirty;                       //< Entries in dirty
+    uint32_t pendingTotal;                  //< Presses not yet in the log
+    uint8_t overflow;                       //< A pending count saturated, the next save writes a snapshot
+    uint16_t threshold;                     //< Pending presses that trigger a save
+    uint32_t idleMs;                        //< Time without presses that triggers a save
+    uint32_t lastTick;                      //< Time of the last press
+    uint8_t sector;                         //< Sector currently appended to
+    uint32_t sequence;                      //< Sequence number of that sector
+    uint32_t writeOffset;                   //< Next free record in that sector
+    uint32_t sectorErases;                  //< Sectors erased since initialization
+    uint32_t badRecords;                    //< Record slots skipped after a failed program since initialization
+} TCA8418_Wear;
+
+/**
+ * @brief Rebuild the counters from the log
+ * @param wear Counter state
+ * @param flash Flash backend
+ * @param threshold Pending presses that trigger a save
+ * @param idleMs Time without presses that triggers a save in milliseconds
+ * @return int 0 if successful, otherwise the failing backend result
+ */
+int TCA8418_Wear_Init(TCA8418_Wear *wear, const TCA8418_WearFlash *flash, uint16_t threshold, uint32_t idleMs);
+
+/**
+ * @brief Count the presses among drained key events
+ * @param wear Counter state
+ * @param keyEvents Events as returned by TCA8418_ReadKeyEvents()
+ * @param numEvents Number of events
+ * @param now Time the events were drained in milliseconds
+ */
+void TCA8418_Wear_ProcessEvents(TCA8418_Wear *wear, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now);
+
+/**
+ * @brief Save the pending presses when the threshold or the idle time is reached
+ * @param wear Counter state
+ * @param now Current time in milliseconds
+ * @return int 0 if successful, otherwise the failing backend result
+ */
+int TCA8418_Wear_Poll(TCA8418_Wear *wear, uint32_t now);
+
+/**
+ * @brief Save the pending presses now, e.g. before entering standby
+ * @param wear Counter state
+ * @return int 0 if successful, otherwise the failing backend result
+ */
+int TCA8418_Wear_Flush(TCA8418_Wear *wear);
+
+/**
+ * @brief Get the number of presses of a key
+ * @param wear Counter state
+ * @param key Key number (bits 6:0 of an event)
+ * @return uint32_t Presses, including unsaved ones
+ */
+static inline uint32_t TCA8418_Wear_Count(const TCA8418_Wear *wear, uint8_t key){
+    return (key < TCA8418_WEAR_KEYS) ? wear->counts[key] : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file tca8418_xcore.c
+ * @brief TCA8418 cross-core event delivery implementation
+ * @details This file contains the implementation of the shared memory ring
+ *          that carries drained key events from the core owning the TCA8418
+ *          to the core running the application.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418_xcore.h"
+/* For TCA8418_FEATURE_XCORE */
+#include "tca8418_config.h"
+
+#if TCA8418_FEATURE_XCORE
+
+#if (TCA8418_XCORE_SLOTS & (TCA8418_XCORE_SLOTS - 1)) || (TCA8418_XCORE_SLOTS == 0)
+#error "TCA8418_XCORE_SLOTS must be a power of two"
+#endif
+
+/**
+ * @brief Write back cached data so the other core sees it
+ * @param addr Start address, aligned to TCA8418_XCORE_CACHE_LINE
+ * @param size Size in bytes, a multiple of TCA8418_XCORE_CACHE_LINE
+ * @note Cleans the data cache when the core has one. Override it when the shared
+ *       region is non-cacheable or the cache is managed differently.
+ */
+__weak void TCA8418_XCore_CleanCache(volatile void *addr, uint32_t size){
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    SCB_CleanDCache_by_Addr((void *)addr, (int32_t)size);
+#else
+    (void)addr;
+    (void)size;
+#endif
+    __DSB();
+}
+
+/**
+ * @brief Discard cached data so the next read fetches what the other core wrote
+ * @param addr Start address, aligned to TCA8418_XCORE_CACHE_LINE
+ * @param size Size in bytes, a multiple of TCA8418_XCORE_CACHE_LINE
+ * @note Invalidates the data cache when the core has one.
+ */
+__weak void TCA8418_XCore_InvalidateCache(volatile void *addr, uint32_t size){
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    SCB_InvalidateDCache_by_Addr((void *)addr, (int32_t)size);
+#else
+    (void)addr;
+    (void)size;
+#endif
+    __DSB();
+}
+
+/**
+ * @brief Notify the consumer core that a batch was published
+ * @note With TCA8418_XCORE_HSEM_ID defined, takes and releases that hardware semaphore
+ *       so the other core gets an HSEM free notification. Otherwise it does nothing
+ *       and the consumer polls TCA8418_XCore_Peek(). Override it for other mailboxes.
+ */
+__weak void TCA8418_XCore_RingDoorbell(void){
+#ifdef TCA8418_XCORE_HSEM_ID
+    if(HAL_HSEM_FastTake(TCA8418_XCORE_HSEM_ID) == HAL_OK){
+        HAL_HSEM_Release(TCA8418_XCORE_HSEM_ID, 0);
+    }
+#endif
+}
+
+/**
+ * @brief Reset the ring cursors, call once before either core uses the ring
+ * @param ring Shared ring
+ */
+void TCA8418_XCore_Init(TCA8418_XCoreRing *ring){
+    ring->head = 0;
+    ring->tail = 0;
+    TCA8418_XCore_CleanCache(&ring->head, TCA8418_XCORE_CACHE_LINE);
+    TCA8418_XCore_CleanCache(&ring->tail, TCA8418_XCORE_CACHE_LINE);
+}
+
+/**
+ * @brief Get the next free batch for the producer to fill in place
+ * @param ring Shared ring
+ * @return TCA8418_XCoreBatch* Free batch, NULL if the ring is full
+ */
+TCA8418_XCoreBatch *TCA8418_XCore_Reserve(TCA8418_XCoreRing *ring){
+    uint32_t head = ring->head;
+    TCA8418_XCore_InvalidateCache(&ring->tail, TCA8418_XCORE_CACHE_LINE);
+    if((head - ring->tail) >= TCA8418_XCORE_SLOTS){
+        return NULL;
+    }
+    return &ring->slots[head & (TCA8418_XCORE_SLOTS - 1)];
+}
+
+/**
+ * @brief Publish the batch returned by TCA8418_XCore_Reserve() and ring the doorbell
+ * @param ring Shared ring
+ * @note The batch is written back before the head moves, so the consumer never
+ *       sees the new head with stale batch contents.
+ */
+void TCA8418_XCore_Commit(TCA8418_XCoreRing *ring){
+    uint32_t head = ring->head;
+    TCA8418_XCore_CleanCache(&ring->slots[head & (TCA8418_XCORE_SLOTS - 1)], sizeof(TCA8418_XCoreBatch));
+    __DMB();
+    ring->head = head + 1;
+    TCA8418_XCore_CleanCache(&ring->head, TCA8418_XCORE_CACHE_LINE);
+    TCA8418_XCore_RingDoorbell();
+}
+
+/**
+ * @brief Get the oldest published batch for the consumer to read in place
+ * @param ring Shared ring
+ * @return TCA8418_XCoreBatch* Oldest batch, NULL if the ring is empty
+ */
+TCA8418_XCoreBatch *TCA8418_XCore_Peek(TCA8418_XCoreRing *ring){
+    uint32_t tail = ring->tail;
+    TCA8418_XCoreBatch *batch;
+    TCA8418_XCore_InvalidateCache(&ring->head, TCA8418_XCORE_CACHE_LINE);
+    if(ring->head == tail){
+        return NULL;
+    }
+    __DMB();
+    batch = &ring->slots[tail & (TCA8418_XCORE_SLOTS - 1)];
+    TCA8418_XCore_InvalidateCache(batch, sizeof(TCA8418_XCoreBatch));
+    return batch;
+}
+
+/**
+ * @brief Return the batch returned by TCA8418_XCore_Peek() to the producer
+ * @param ring Shared ring
+ */
+void TCA8418_XCore_Release(TCA8418_XCoreRing *ring){
+    __DMB();
+    ring->tail = ring->tail + 1;
+    TCA8418_XCore_CleanCache(&ring->tail, TCA8418_XCORE_CACHE_LINE);
+}
+
+/**
+ * @brief Drain the TCA8418 FIFO straight into the next free batch of the ring
+ * @param ring Shared ring
+ * @return HAL_StatusTypeDef HAL_OK if successful, HAL_BUSY if the ring is full, otherwise error code
+ * @note When the ring is full the FIFO is not read, so the events wait in the chip.
+ *       Empty drains are not published.
+ */
+HAL_StatusTypeDef TCA8418_XCore_Drain(TCA8418_XCoreRing *ring){
+    HAL_StatusTypeDef status;
+    TCA8418_XCoreBatch *batch = TCA8418_XCore_Reserve(ring);
+    if(batch == NULL){
+        return HAL_BUSY;
+    }
+    status = TCA8418_ReadKeyEvents(batch->keyEvents, &batch->numEvents);
+    /* Events read before a failure have left the chip and are published too */
+    if(batch->numEvents > 0){
+        TCA8418_XCore_Commit(ring);
+    }
+    return status;
+}
+
+#endif
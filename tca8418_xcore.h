@@ -0,0 +1,116 @@
+/**
+ * @file tca8418_xcore.h
+ * @brief TCA8418 cross-core event delivery header
+ * @details This header file contains the declarations of a lock-free single
+ *          producer, single consumer ring placed in memory shared by the two
+ *          cores of a dual-core MCU, so key events drained on one core reach
+ *          the other without locks or intermediate copies.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418_XCORE_H__
+#define __TCA8418_XCORE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint32_t */
+#include <stdint.h>
+/* For TCA8418_ReadKeyEvents and TCA8418_FIFO_DEPTH */
+#include "tca8418.h"
+
+/* Data cache line size in bytes, cursors and batches never share a line */
+#ifndef TCA8418_XCORE_CACHE_LINE
+#define TCA8418_XCORE_CACHE_LINE 32
+#endif
+
+/* Number of batches in the ring, must be a power of two */
+#ifndef TCA8418_XCORE_SLOTS
+#define TCA8418_XCORE_SLOTS 16
+#endif
+
+/**
+ * @brief One drained batch of key events, padded to whole cache lines
+ */
+typedef struct {
+    __ALIGNED(TCA8418_XCORE_CACHE_LINE) uint8_t numEvents; //< Number of valid events
+    uint8_t keyEvents[TCA8418_FIFO_DEPTH];                 //< Events as returned by TCA8418_ReadKeyEvents()
+} TCA8418_XCoreBatch;
+
+/**
+ * @brief Ring shared between the producer and the consumer core
+ * @note Place it in a memory region both cores can reach, e.g. a dedicated
+ *       linker section in D3 SRAM, and align it to TCA8418_XCORE_CACHE_LINE.
+ */
+typedef struct {
+    __ALIGNED(TCA8418_XCORE_CACHE_LINE) volatile uint32_t head; //< Written by the producer only
+    __ALIGNED(TCA8418_XCORE_CACHE_LINE) volatile uint32_t tail; //< Written by the consumer only
+    TCA8418_XCoreBatch slots[TCA8418_XCORE_SLOTS];
+} TCA8418_XCoreRing;
+
+/**
+ * @brief Reset the ring cursors, call once before either core uses the ring
+ * @param ring Shared ring
+ */
+void TCA8418_XCore_Init(TCA8418_XCoreRing *ring);
+
+/**
+ * @brief Get the next free batch for the producer to fill in place
+ * @param ring Shared ring
+ * @return TCA8418_XCoreBatch* Free batch, NULL if the ring is full
+ */
+TCA8418_XCoreBatch *TCA8418_XCore_Reserve(TCA8418_XCoreRing *ring);
+
+/**
+ * @brief Publish the batch returned by TCA8418_XCore_Reserve() and ring the doorbell
+ * @param ring Shared ring
+ */
+void TCA8418_XCore_Commit(TCA8418_XCoreRing *ring);
+
+/**
+ * @brief Get the oldest published batch for the consumer to read in place
+ * @param ring Shared ring
+ * @return TCA8418_XCoreBatch* Oldest batch, NULL if the ring is empty
+ */
+TCA8418_XCoreBatch *TCA8418_XCore_Peek(TCA8418_XCoreRing *ring);
+
+/**
+ * @brief Return the batch returned by TCA8418_XCore_Peek() to the producer
+ * @param ring Shared ring
+ */
+void TCA8418_XCore_Release(TCA8418_XCoreRing *ring);
+
+/**
+ * @brief Drain the TCA8418 FIFO straight into the next free batch of the ring
+ * @param ring Shared ring
+ * @return HAL_StatusTypeDef HAL_OK if successful, HAL_BUSY if the ring is full, otherwise error code
+ */
+HAL_StatusTypeDef TCA8418_XCore_Drain(TCA8418_XCoreRing *ring);
+
+/**
+ * @brief Write back cached data so the other core sees it
+ * @param addr Start address, aligned to TCA8418_XCORE_CACHE_LINE
+ * @param size Size in bytes, a multiple of TCA8418_XCORE_CACHE_LINE
+ */
+void TCA8418_XCore_CleanCache(volatile void *addr, uint32_t size);
+
+/**
+ * @brief Discard cached data so the next read fetches what the other core wrote
+ * @param addr Start address, aligned to TCA8418_XCORE_CACHE_LINE
+ * @param size Size in bytes, a multiple of TCA8418_XCORE_CACHE_LINE
+ */
+void TCA8418_XCore_InvalidateCache(volatile void *addr, uint32_t size);
+
+/**
+ * @brief Notify the consumer core that a batch was published
+ */
+void TCA8418_XCore_RingDoorbell(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * @file bootbench.c
+ * @brief Simulated boot time of TCA8418_InitAsync() against the blocking TCA8418_Init()
+ * @details Runs tca8418.c against the simulator of tools/sim from a reset at
+ *          cycle 0. The firmware initializes the keypad, then brings up other
+ *          peripherals for a given time, then enters its main loop, which calls
+ *          TCA8418_PopEvents() every 100 us. With TCA8418_Init() the bring-up
+ *          starts after the three configuration writes. With TCA8418_InitAsync()
+ *          it overlaps them, and the main loop waits for the ready flag of
+ *          TCA8418_GetInitState() if the bring-up ends first. A key is pressed
+ *          1.5 ms after reset, once the keypad is configured at both speeds,
+ *          as the chip ignores keys pressed before. For each bus speed and
+ *          bring-up time it prints the time from reset to ready and to the
+ *          first key event in the ring, from TCA8418_GetBootStats(), to the
+ *          main loop and to the first event popped by the main loop. Each run
+ *          checks that the ready callback came once with HAL_OK at the ready
+ *          time of the boot stats and that the key was delivered, and with a
+ *          bring-up to overlap, that the asynchronous boot enters the main
+ *          loop first.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 bootbench.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o bootbench
+ *          Usage: bootbench
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_ASYNC_INIT || !TCA8418_FEATURE_RING || !TCA8418_FEATURE_DEFERRED
+#error "bootbench needs the full profile"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Cycles to microseconds */
+#define TO_US(cycles)   ((double)(cycles) / (TCA8418SIM_CPU_HZ / 1e6))
+
+/* Key pressed after reset */
+#define KEY_EVENT       0x81
+#define KEY_US          1500U
+
+/* Period of the main loop */
+#define LOOP_US         100U
+
+/* Main loop iterations before giving up on the key */
+#define LOOPS_MAX       1000U
+
+/* Bus speeds measured */
+static const uint32_t busSpeeds[] = { 100000, 400000 };
+
+/* Time spent bringing up other peripherals after the keypad initialization is started */
+static const uint32_t bringUpUs[] = { 0, 5000 };
+
+/* Ready callbacks of the current run */
+static uint32_t readyCalls;
+static HAL_StatusTypeDef readyStatus;
+static uint64_t readyAt;
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin == TCA8418_INT_Pin){
+        TCA8418_IRQHandler();
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_ErrorCallback(hi2c);
+}
+
+static void OnReady(HAL_StatusTypeDef status){
+    readyCalls++;
+    readyStatus = status;
+    readyAt = TCA8418Sim_Now();
+}
+
+/**
+ * @brief Boot once and measure the keypad times
+ * @param busHz Bus speed
+ * @param bringUp Microseconds of other peripheral bring-up
+ * @param async 1 for TCA8418_InitAsync(), 0 for TCA8418_Init()
+ * @param loop Pointer to store the cycles from reset to the main loop
+ * @return int 0 if the boot passed every check, otherwise 1
+ */
+static int Boot(uint32_t busHz, uint32_t bringUp, uint8_t async, uint64_t *loop){
+    TCA8418_BootStats boot;
+    uint8_t events[TCA8418_RING_SIZE];
+    uint8_t numEvents = 0;
+    uint32_t loops;
+    uint64_t popped;
+    int errors = 0;
+    /* Events left in the ring by the previous boot */
+    (void)TCA8418_PopEvents(events, sizeof(events), &numEvents);
+    TCA8418Sim_Reset(busHz);
+    readyCalls = 0;
+    (void)TCA8418Sim_Key(US(KEY_US), KEY_EVENT);
+    if(async){
+        if(TCA8418_InitAsync(OnReady) != HAL_OK){
+            fprintf(stderr, "InitAsync failed to start\n");
+            return 1;
+        }
+    } else if(TCA8418_Init() != HAL_OK){
+        fprintf(stderr, "Init failed\n");
+        return 1;
+    }
+    TCA8418Sim_Run(US(bringUp));
+    while(TCA8418_GetInitState() == TCA8418_INIT_BUSY){
+        TCA8418Sim_Run(US(1));
+    }
+    *loop = TCA8418Sim_Now();
+    numEvents = 0;
+    for(loops = 0; (loops < LOOPS_MAX) && (numEvents == 0); loops++){
+        if(TCA8418_PopEvents(events, sizeof(events), &numEvents) != HAL_OK){
+            numEvents = 0;
+        }
+        if(numEvents == 0){
+            TCA8418Sim_Run(US(LOOP_US));
+        }
+    }
+    popped = TCA8418Sim_Now();
+    TCA8418_GetBootStats(&boot);
+    if((TCA8418_GetInitState() != TCA8418_INIT_READY) || !boot.ready || !boot.firstEvent ||
+       (boot.initStartCycles != 0)){
+        fprintf(stderr, "state %d, ready %u, first event %u, start %lu\n", (int)TCA8418_GetInitState(), boot.ready,
+                boot.firstEvent, (unsigned long)boot.initStartCycles);
+        errors++;
+    }
+    if(async && ((readyCalls != 1) || (readyStatus != HAL_OK) || (readyAt != boot.readyCycles))){
+        fprintf(stderr, "%lu ready callbacks, status %d at %.1f us, boot stats ready at %.1f us\n",
+                (unsigned long)readyCalls, (int)readyStatus, TO_US(readyAt), TO_US(boot.readyCycles));
+        errors++;
+    }
+    if(!async && (readyCalls != 0)){
+        fprintf(stderr, "ready callback after TCA8418_Init()\n");
+        errors++;
+    }
+    if((numEvents != 1) || (events[0] != KEY_EVENT)){
+        fprintf(stderr, "%u events popped, expected the key press\n", numEvents);
+        errors++;
+    }
+    printf("%7lu %8lu %-9s %10.1f %13.1f %10.1f %10.1f%s\n", (unsigned long)(busHz / 1000U), (unsigned long)bringUp,
+           async ? "async" : "blocking", TO_US(boot.readyCycles), TO_US(boot.firstEventCycles), TO_US(*loop),
+           TO_US(popped),
+           (errors != 0) ? " FAIL" : "");
+    return (errors != 0) ? 1 : 0;
+}
+
+int main(void){
+    int failed = 0;
+    printf("key pressed %u us after reset, main loop every %u us\n", KEY_US, LOOP_US);
+    printf("%7s %8s %-9s %10s %13s %10s %10s\n", "bus kHz", "bring-up", "init", "ready us", "first key us", "loop us",
+           "popped us");
+    for(uint8_t s = 0; s < sizeof(busSpeeds) / sizeof(busSpeeds[0]); s++){
+        for(uint8_t b = 0; b < sizeof(bringUpUs) / sizeof(bringUpUs[0]); b++){
+            uint64_t blocking = 0;
+            uint64_t async = 0;
+            failed += Boot(busSpeeds[s], bringUpUs[b], 0, &blocking);
+            failed += Boot(busSpeeds[s], bringUpUs[b], 1, &async);
+            /* With other work to overlap, the async boot must reach the main loop sooner */
+            if((bringUpUs[b] > 0) && (async >= blocking)){
+                fprintf(stderr, "async boot entered the main loop at %.1f us, blocking at %.1f us\n", TO_US(async),
+                        TO_US(blocking));
+                failed++;
+            }
+        }
+    }
+    return (failed != 0) ? 1 : 0;
+}
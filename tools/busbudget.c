@@ -0,0 +1,70 @@
+/**
+ * @file busbudget.c
+ * @brief Host tool printing the bus and energy budget of driver configurations
+ * @details Runs the model of tca8418_power over the drain strategies, the
+ *          interrupt output modes and polling, at 100 kHz and 400 kHz, and
+ *          prints one comparison table per bus speed. The MCU costs default to
+ *          a Cortex-M4 at 80 MHz and can be replaced by values measured on the
+ *          target with TCA8418_GetCycles(). A last table compares the bus
+ *          utilization of 50 Hz LED animations written per change and written
+ *          by the GPIO output frames at 400 kHz.
+ *          Build: cc -O2 -I.. busbudget.c ../tca8418_power.c -o busbudget
+ *          Usage: busbudget [cpuHz wakeupCycles transferCycles byteCycles]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418_power.h"
+
+/**
+ * @brief Write table text to stdout
+ * @param text Text chunk
+ * @param length Length in bytes
+ */
+static void WriteStdout(const char *text, uint16_t length){
+    fwrite(text, 1, length, stdout);
+}
+
+int main(int argc, char **argv){
+    static const uint32_t speeds[] = {100000, 400000};
+    TCA8418_PowerCpu cpu = {80000000, 60, 400, 80};
+    TCA8418_PowerConfig configs[] = {
+        {"interrupt per-register", TCA8418_POWER_PER_REGISTER, 0, 0, 1, 0},
+        {"interrupt burst", TCA8418_POWER_BURST, 0, 0, 1, 0},
+        {"interrupt burst latched", TCA8418_POWER_BURST, 1, 0, 1, 0},
+        {"interrupt IT", TCA8418_POWER_IT, 0, 0, 1, 0},
+        {"interrupt IT latched", TCA8418_POWER_IT, 1, 0, 1, 0},
+        {"interrupt DMA", TCA8418_POWER_DMA, 0, 0, 1, 0},
+        {"interrupt DMA latched", TCA8418_POWER_DMA, 1, 0, 1, 0},
+        {"interrupt per-reg x4", TCA8418_POWER_PER_REGISTER, 0, 0, 4, 0},
+        {"interrupt burst x4", TCA8418_POWER_BURST, 0, 0, 4, 0},
+        {"interrupt DMA x4", TCA8418_POWER_DMA, 0, 0, 4, 0},
+        {"poll 10 ms burst", TCA8418_POWER_BURST, 0, 10, 1, 0},
+        {"poll 50 ms burst", TCA8418_POWER_BURST, 0, 50, 1, 0},
+    };
+    if(argc == 5){
+        cpu.cpuHz = (uint32_t)strtoul(argv[1], NULL, 0);
+        cpu.wakeupCycles = (uint16_t)strtoul(argv[2], NULL, 0);
+        cpu.transferCycles = (uint16_t)strtoul(argv[3], NULL, 0);
+        cpu.byteCycles = (uint16_t)strtoul(argv[4], NULL, 0);
+    } else if(argc != 1){
+        fprintf(stderr, "usage: busbudget [cpuHz wakeupCycles transferCycles byteCycles]\n");
+        return 1;
+    }
+    for(size_t s = 0; s < sizeof(speeds) / sizeof(speeds[0]); s++){
+        for(size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++){
+            configs[c].busHz = speeds[s];
+        }
+        printf("%s%lu kHz I2C, %lu MHz core, times in us\n", s ? "\n" : "",
+               (unsigned long)(speeds[s] / 1000), (unsigned long)(cpu.cpuHz / 1000000));
+        TCA8418_Power_WriteTable(configs, (uint8_t)(sizeof(configs) / sizeof(configs[0])), &cpu, WriteStdout);
+    }
+    printf("\nGPIO outputs at 50 Hz, 400 kHz I2C, per LED change vs per frame\n");
+    TCA8418_Power_WriteOutputTable(400000, 50, TCA8418_POWER_FREE_PINS, WriteStdout);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file diagrate.c
+ * @brief Simulated pattern rate of the matrix diagnostic at each bus speed
+ * @details Runs TCA8418_RunMatrixDiagnostic() against the simulator of
+ *          tools/sim at 100 kHz, 400 kHz and 1 MHz. The simulated matrix has
+ *          no shorts, so every run must find the keypad pins of TCA8418_Init()
+ *          free of connections and drive one pattern per pin. For each speed it
+ *          prints the patterns driven, the time of the pattern walk from
+ *          diag.cycles, the patterns per second and the time of the whole call
+ *          with the save, restore and event discard.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 diagrate.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o diagrate
+ *          Usage: diagrate
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_DIAG
+#error "diagrate needs TCA8418_FEATURE_DIAG"
+#endif
+
+/* Cycles to microseconds */
+#define TO_US(cycles)   ((double)(cycles) / (TCA8418SIM_CPU_HZ / 1e6))
+
+/* Bus speeds measured */
+static const uint32_t busSpeeds[] = { 100000, 400000, 1000000 };
+
+/**
+ * @brief Count the pins of a mask
+ */
+static uint8_t PinCount(uint32_t pins){
+    uint8_t count = 0;
+    for(; pins != 0; pins &= pins - 1U){
+        count++;
+    }
+    return count;
+}
+
+int main(void){
+    int failed = 0;
+    printf("%8s %8s %10s %12s %10s\n", "bus Hz", "patterns", "walk us", "patterns/s", "call us");
+    for(uint8_t s = 0; s < sizeof(busSpeeds) / sizeof(busSpeeds[0]); s++){
+        TCA8418_MatrixDiag diag;
+        HAL_StatusTypeDef status;
+        uint64_t start;
+        uint64_t call;
+        uint32_t connections = 0;
+        TCA8418Sim_Reset(busSpeeds[s]);
+        if(TCA8418_Init() != HAL_OK){
+            fprintf(stderr, "initialization failed\n");
+            return 1;
+        }
+        start = TCA8418Sim_Now();
+        status = TCA8418_RunMatrixDiagnostic(&diag);
+        call = TCA8418Sim_Now() - start;
+        for(uint8_t pin = 0; pin < TCA8418_DIAG_PINS; pin++){
+            connections |= diag.connections[pin];
+        }
+        if((status != HAL_OK) || (diag.patterns != PinCount(diag.pins)) || (diag.patterns == 0) ||
+           (diag.stuckLow != 0) || (connections != 0) || (diag.cycles == 0)){
+            fprintf(stderr, "%lu Hz: status %d, %lu patterns for %u pins, stuck 0x%05lX, connections 0x%05lX\n",
+                    (unsigned long)busSpeeds[s], (int)status, (unsigned long)diag.patterns, PinCount(diag.pins),
+                    (unsigned long)diag.stuckLow, (unsigned long)connections);
+            failed++;
+            continue;
+        }
+        printf("%8lu %8lu %10.1f %12.0f %10.1f\n", (unsigned long)busSpeeds[s], (unsigned long)diag.patterns,
+               TO_US(diag.cycles), (double)diag.patterns * TCA8418SIM_CPU_HZ / diag.cycles, TO_US(call));
+    }
+    return (failed != 0) ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+#!/bin/sh
+# Compile every library source once per profile and report text, data and bss,
+# then report what each feature costs in the full profile: the size saved by
+# building the full profile with that feature set to 0. Features no profile
+# enables are measured in the minimal profile: the size added by setting them to 1.
+#
+# The HAL-free modules compile on any host. tca8418.c and tca8418_xcore.c need
+# the main.h of an STM32Cube project, pass its include paths in CFLAGS.
+# A source is only reported as skipped when main.h is missing. Any other
+# compiler error is printed and makes the script exit with status 1.
+#
+# Usage: CC=arm-none-eabi-gcc CFLAGS="-mcpu=cortex-m0plus -mthumb -I../Core/Inc ..." tools/footprint.sh
+#        CC=cc tools/footprint.sh      (host build, sources needing main.h are reported as skipped)
+#        CC=cc CFLAGS=-Itools/sim tools/footprint.sh   (host build against the simulator's main.h)
+# Extra -D options in CFLAGS override single features, e.g. -DTCA8418_FEATURE_DIAG=0.
+#
+# The instrumentation options are measured last, as the size added by setting
+# them to 1 in the full profile. With them at 0 the objects of the full profile
+# must not hold a single instrumentation symbol, otherwise the script fails:
+# the driver then has the same code size and event ring as without them.
+
+CC=${CC:-arm-none-eabi-gcc}
+SIZE=${SIZE:-$(echo "$CC" | sed 's/gcc$/size/; s/^cc$/size/')}
+NM=${NM:-$(echo "$CC" | sed 's/gcc$/nm/; s/^cc$/nm/')}
+case "$CC" in
+    arm-none-eabi-*) CFLAGS=${CFLAGS:--mcpu=cortex-m0plus -mthumb} ;;
+esac
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+# Features measured in the full profile. A feature others depend on is
+# switched off together with them, e.g. the deferred drain needs the ring.
+FEATURES="RING:DEFERRED DEFERRED ASYNC_INIT CALIBRATION PROBE HOTPLUG OUTPUTS DIAG
+          HID GESTURE XCORE STREAM TEXT WEAR MODELS"
+
+# Features outside every profile, measured in the minimal profile. The
+# multiplexer module cannot be combined with the ring, hot-plug, outputs,
+# asynchronous initialization or calibration.
+SEPARATE="MUX"
+
+# Instrumentation options, off in every profile, and the symbols they add
+INSTRUMENTATION="STAMPS TRACE"
+INSTRUMENTATION_SYMBOLS="[Ss]tamp|[Tt]race_|recordCount|trackNames|intervalNames|edgeCycles|edgePending"
+
+ERRORS=0
+SKIPPED=""
+
+# Compile every source with the options in $1 and add up the sizes in TEXT,
+# DATA and BSS. With $2 set to 1 every source is printed.
+build() {
+    TEXT=0
+    DATA=0
+    BSS=0
+    for src in "$ROOT"/tca8418*.c; do
+        name=$(basename "$src" .c)
+        obj="$OUT/$name.o"
+        if ! $CC -Os -ffunction-sections -fdata-sections -I"$ROOT" $CFLAGS $1 \
+                -c "$src" -o "$obj" 2>"$OUT/errors"; then
+            if grep -q "main.h: No such file" "$OUT/errors"; then
+                [ "$2" = 1 ] && printf '%-22s %8s\n' "$name" "skipped"
+                case " $SKIPPED " in
+                    *" $name "*) ;;
+                    *) SKIPPED="$SKIPPED $name" ;;
+                esac
+                continue
+            fi
+            echo "$name: compile error with $1" >&2
+            cat "$OUT/errors" >&2
+            ERRORS=$((ERRORS + 1))
+            continue
+        fi
+        set -- "$1" "$2" $($SIZE "$obj" | tail -n 1)
+        [ "$2" = 1 ] && printf '%-22s %8s %8s %8s\n' "$name" "$3" "$4" "$5"
+        TEXT=$((TEXT + $3))
+        DATA=$((DATA + $4))
+        BSS=$((BSS + $5))
+    done
+}
+
+for profile in MINIMAL STANDARD FULL; do
+    echo "TCA8418_PROFILE_$profile"
+    printf '%-22s %8s %8s %8s\n' "source" "text" "data" "bss"
+    build "-DTCA8418_PROFILE=TCA8418_PROFILE_$profile" 1
+    printf '%-22s %8s %8s %8s\n\n' "total" "$TEXT" "$DATA" "$BSS"
+done
+
+build "-DTCA8418_PROFILE=TCA8418_PROFILE_FULL" 0
+fullText=$TEXT
+fullData=$DATA
+fullBss=$BSS
+echo "Feature cost in TCA8418_PROFILE_FULL, size saved by setting it to 0"
+printf '%-22s %8s %8s %8s\n' "feature" "text" "data" "bss"
+for feature in $FEATURES; do
+    flags="-DTCA8418_PROFILE=TCA8418_PROFILE_FULL"
+    for off in $(echo "$feature" | tr ':' ' '); do
+        flags="$flags -DTCA8418_FEATURE_$off=0"
+    done
+    build "$flags" 0
+    printf '%-22s %8s %8s %8s\n' "$(echo "$feature" | sed 's/:/+/g')" \
+        "$((fullText - TEXT))" "$((fullData - DATA))" "$((fullBss - BSS))"
+done
+
+build "-DTCA8418_PROFILE=TCA8418_PROFILE_MINIMAL" 0
+minText=$TEXT
+minData=$DATA
+minBss=$BSS
+echo
+echo "Feature cost in TCA8418_PROFILE_MINIMAL, size added by setting it to 1"
+printf '%-22s %8s %8s %8s\n' "feature" "text" "data" "bss"
+for feature in $SEPARATE; do
+    build "-DTCA8418_PROFILE=TCA8418_PROFILE_MINIMAL -DTCA8418_FEATURE_$feature=1" 0
+    printf '%-22s %8s %8s %8s\n' "$feature" "$((TEXT - minText))" "$((DATA - minData))" "$((BSS - minBss))"
+done
+
+echo
+echo "Instrumentation cost in TCA8418_PROFILE_FULL, size added by setting it to 1"
+printf '%-22s %8s %8s %8s\n' "option" "text" "data" "bss"
+for option in $INSTRUMENTATION; do
+    build "-DTCA8418_PROFILE=TCA8418_PROFILE_FULL -DTCA8418_$option=1" 0
+    printf '%-22s %8s %8s %8s\n' "$option" "$((TEXT - fullText))" "$((DATA - fullData))" "$((BSS - fullBss))"
+done
+build "-DTCA8418_PROFILE=TCA8418_PROFILE_FULL" 0
+if [ "$TEXT" -ne "$fullText" ] || [ "$DATA" -ne "$fullData" ] || [ "$BSS" -ne "$fullBss" ]; then
+    echo "instrumentation off: size differs from the full profile" >&2
+    ERRORS=$((ERRORS + 1))
+fi
+LEFT=$(for obj in "$OUT"/*.o; do $NM "$obj"; done 2>/dev/null | grep -E "$INSTRUMENTATION_SYMBOLS")
+if [ -n "$LEFT" ]; then
+    echo "instrumentation off: symbols left in the objects" >&2
+    echo "$LEFT" >&2
+    ERRORS=$((ERRORS + 1))
+else
+    echo "Instrumentation off: no instrumentation symbol in the objects"
+fi
+if [ -n "$SKIPPED" ]; then
+    echo "Skipped without main.h, not counted:$SKIPPED"
+fi
+
+if [ "$ERRORS" -ne 0 ]; then
+    echo "$ERRORS errors" >&2
+    exit 1
+fi
@@ -0,0 +1,192 @@
+/**
+ * @file gesturetest.c
+ * @brief Deterministic host test of the gesture recognizer of tca8418_gesture.h
+ * @details Each script is a list of timed batches of key events. The test
+ *          drives the recognizer like a main loop that sleeps until the next
+ *          batch or until TCA8418_Gesture_NextDeadline(), whichever comes
+ *          first, and records every reported gesture with the time it was
+ *          reported. The record must match the expected gestures and times
+ *          exactly, and no deadline may be left pending at the end. Some scripts
+ *          resolve deadlines only with the batches, as a main loop that missed
+ *          them, and check that the late drain reports them first. The scripts
+ *          use a 250 ms tap gap and a 600 ms hold time.
+ *          Build: cc -O2 -I.. -DTCA8418_PROFILE=2 gesturetest.c ../tca8418_gesture.c -o gesturetest
+ *          Usage: gesturetest
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418_gesture.h"
+
+/* Recognizer timing of the scripts */
+#define TAP_GAP_MS  250
+#define HOLD_MS     600
+
+/* Largest batch, the TCA8418 FIFO depth */
+#define BATCH_MAX   10
+
+/* Most gestures recorded per script */
+#define RECORD_MAX  16
+
+/* Key events of key number k */
+#define P(k)    ((uint8_t)(0x80 | (k)))
+#define R(k)    ((uint8_t)(k))
+
+/**
+ * @brief One timed batch of key events
+ */
+typedef struct {
+    uint32_t tick;                  //< Drain time in milliseconds
+    uint8_t events[BATCH_MAX];      //< Key events
+    uint8_t numEvents;              //< Events in the batch
+} Batch;
+
+/**
+ * @brief One reported gesture
+ */
+typedef struct {
+    uint32_t tick;                  //< Time it was reported
+    uint8_t key;                    //< Key number
+    TCA8418_Gesture gesture;        //< Gesture
+    uint8_t taps;                   //< Taps of the sequence
+} Report;
+
+/**
+ * @brief Scripted event stream and the gestures it must produce
+ */
+typedef struct {
+    const char *name;
+    uint32_t start;                 //< Time offset added to every tick, tests wrap around
+    uint8_t batchesOnly;            //< Deadlines are only resolved with the batches, as by a late main loop
+    const Batch *batches;
+    uint8_t numBatches;
+    const Report *reports;
+    uint8_t numReports;
+} Script;
+
+#define LIST(type, ...) (const type[]){ __VA_ARGS__ }, sizeof((const type[]){ __VA_ARGS__ }) / sizeof(type)
+#define TAP         TCA8418_GESTURE_TAP
+#define HOLD        TCA8418_GESTURE_HOLD
+#define HOLD_END    TCA8418_GESTURE_HOLD_END
+
+static const Script scripts[] = {
+    { "single tap", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }),
+      LIST(Report, { 300, 1, TAP, 1 }) },
+    { "double tap", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }, { 200, { P(1) }, 1 }, { 260, { R(1) }, 1 }),
+      LIST(Report, { 510, 1, TAP, 2 }) },
+    { "triple tap reported at once", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }, { 100, { P(1) }, 1 }, { 150, { R(1) }, 1 },
+                  { 200, { P(1) }, 1 }, { 250, { R(1) }, 1 }),
+      LIST(Report, { 250, 1, TAP, 3 }) },
+    { "gap too long splits taps", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }, { 301, { P(1) }, 1 }, { 350, { R(1) }, 1 }),
+      LIST(Report, { 300, 1, TAP, 1 }, { 600, 1, TAP, 1 }) },
+    { "hold", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 900, { R(1) }, 1 }),
+      LIST(Report, { 600, 1, HOLD, 0 }, { 900, 1, HOLD_END, 0 }) },
+    { "tap-hold", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }, { 200, { P(1) }, 1 }, { 1000, { R(1) }, 1 }),
+      LIST(Report, { 800, 1, HOLD, 1 }, { 1000, 1, HOLD_END, 1 }) },
+    { "press and release in one batch", 0, 0,
+      LIST(Batch, { 0, { P(1), R(1) }, 2 }),
+      LIST(Report, { 250, 1, TAP, 1 }) },
+    { "late drain still reports the hold first", 0, 1,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 700, { R(1) }, 1 }),
+      LIST(Report, { 700, 1, HOLD, 0 }, { 700, 1, HOLD_END, 0 }) },
+    { "late drain ends the tap sequence first", 0, 1,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }, { 400, { P(1), R(1) }, 2 }),
+      LIST(Report, { 400, 1, TAP, 1 }, { 650, 1, TAP, 1 }) },
+    { "interleaved keys in deadline order", 0, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 10, { P(2) }, 1 }, { 40, { R(2) }, 1 }, { 100, { R(1) }, 1 },
+                  { 120, { P(2) }, 1 }, { 130, { R(2) }, 1 }),
+      LIST(Report, { 350, 1, TAP, 1 }, { 380, 2, TAP, 2 }) },
+    { "all slots busy", 0, 0,
+      LIST(Batch, { 0, { P(1), P(2), P(3), P(4), P(5), P(6), P(7), P(8), P(9) }, 9 },
+                  { 10, { R(9), R(1), R(2), R(3), R(4), R(5), R(6), R(7), R(8) }, 9 }),
+      LIST(Report, { 260, 1, TAP, 1 }, { 260, 2, TAP, 1 }, { 260, 3, TAP, 1 }, { 260, 4, TAP, 1 },
+                   { 260, 5, TAP, 1 }, { 260, 6, TAP, 1 }, { 260, 7, TAP, 1 }, { 260, 8, TAP, 1 }) },
+    { "tick counter wraps", 0xFFFFFF00UL, 0,
+      LIST(Batch, { 0, { P(1) }, 1 }, { 50, { R(1) }, 1 }, { 200, { P(1) }, 1 }, { 1000, { R(1) }, 1 }),
+      LIST(Report, { 800, 1, HOLD, 1 }, { 1000, 1, HOLD_END, 1 }) },
+};
+
+static Report record[RECORD_MAX];
+static uint8_t recorded;
+static uint32_t now;
+
+/**
+ * @brief Record a reported gesture
+ */
+static void OnGesture(uint8_t key, TCA8418_Gesture gesture, uint8_t taps){
+    if(recorded < RECORD_MAX){
+        record[recorded] = (Report){ now, key, gesture, taps };
+    }
+    recorded++;
+}
+
+/**
+ * @brief Run one script, sleeping between batches and deadlines
+ * @return int 0 if the recorded gestures match
+ */
+static int RunScript(const Script *script){
+    static const char *const names[] = { "TAP", "HOLD", "HOLD_END" };
+    TCA8418_GestureRecognizer recognizer;
+    uint8_t next = 0;
+    uint32_t deadline;
+    int failed = 0;
+    recorded = 0;
+    TCA8418_Gesture_Init(&recognizer, OnGesture, TAP_GAP_MS, HOLD_MS);
+    for(;;){
+        uint8_t pending = TCA8418_Gesture_NextDeadline(&recognizer, &deadline);
+        if(script->batchesOnly && (next < script->numBatches)){
+            pending = 0;
+        }
+        if((next < script->numBatches) &&
+           (!pending || ((int32_t)((script->start + script->batches[next].tick) - deadline) <= 0))){
+            now = script->start + script->batches[next].tick;
+            TCA8418_Gesture_ProcessEvents(&recognizer, script->batches[next].events, script->batches[next].numEvents, now);
+            next++;
+        }else if(pending){
+            now = deadline;
+            TCA8418_Gesture_Poll(&recognizer, now);
+        }else{
+            break;
+        }
+    }
+    if(recorded != script->numReports){
+        failed = 1;
+    }
+    for(uint8_t i = 0; (i < recorded) && (i < script->numReports) && (i < RECORD_MAX); i++){
+        const Report *expected = &script->reports[i];
+        if((record[i].tick != script->start + expected->tick) || (record[i].key != expected->key) ||
+           (record[i].gesture != expected->gesture) || (record[i].taps != expected->taps)){
+            failed = 1;
+        }
+    }
+    if(failed){
+        printf("FAIL %s:", script->name);
+        for(uint8_t i = 0; (i < recorded) && (i < RECORD_MAX); i++){
+            printf(" %lu key %u %s %u,", (unsigned long)(record[i].tick - script->start), record[i].key,
+                   names[record[i].gesture], record[i].taps);
+        }
+        printf(" expected %u reports\n", script->numReports);
+        return 1;
+    }
+    printf("ok   %s\n", script->name);
+    return 0;
+}
+
+int main(void){
+    int failed = 0;
+    for(uint8_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++){
+        failed += RunScript(&scripts[i]);
+    }
+    printf("%d failed scripts\n", failed);
+    return (failed != 0) ? 1 : 0;
+}
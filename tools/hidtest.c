@@ -0,0 +1,165 @@
+/**
+ * @file hidtest.c
+ * @brief Host test of the HID keyboard reports of tca8418_hid.h with scripted event streams
+ * @details Each script feeds batches of key events to TCA8418_HID_ProcessEvents()
+ *          and checks after every batch the boot report, the NKRO report and the
+ *          changed flag against the expected state. The scripts cover keys
+ *          sharing a usage or a modifier, rollover past 6 keys, repeated and
+ *          stray events and the press order of the boot slots.
+ *          Build: cc -O2 -I.. -DTCA8418_PROFILE=2 hidtest.c ../tca8418_hid.c -o hidtest
+ *          Usage: hidtest
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tca8418_hid.h"
+
+/* Largest batch, the TCA8418 FIFO depth */
+#define BATCH_MAX   10
+
+/* Key events of key number k */
+#define P(k)    ((uint8_t)(0x80 | (k)))
+#define R(k)    ((uint8_t)(k))
+
+/* HID usages of the test keymap */
+#define KEY_A       0x04
+#define KEY_B       0x05
+#define LEFT_SHIFT  0xE1
+#define RIGHT_SHIFT 0xE5
+
+/* Usage of key 3 to 10: KEY_B to 0x0C */
+#define USAGE(k)    ((uint8_t)(KEY_B + (k) - 3))
+
+/**
+ * @brief One batch of a script and the state expected after it
+ */
+typedef struct {
+    uint8_t events[BATCH_MAX];              //< Batch of key events
+    uint8_t numEvents;                      //< Events in the batch
+    uint8_t modifiers;                      //< Expected modifier byte of both reports
+    uint8_t boot[6];                        //< Expected boot key slots
+    uint8_t nkro[10];                       //< Expected usages set in the NKRO bitmap, 0 terminated
+    uint8_t changed;                        //< Expected TCA8418_HID_TakeChanged() result
+} Step;
+
+/**
+ * @brief Scripted event stream
+ */
+typedef struct {
+    const char *name;
+    const Step *steps;
+    uint8_t numSteps;
+} Script;
+
+#define STEPS(...)  (const Step[]){ __VA_ARGS__ }, sizeof((const Step[]){ __VA_ARGS__ }) / sizeof(Step)
+
+static const Script scripts[] = {
+    { "two keys share a usage", STEPS(
+        { { P(1) }, 1, 0, { KEY_A }, { KEY_A }, 1 },
+        { { P(2) }, 1, 0, { KEY_A }, { KEY_A }, 0 },
+        { { R(1) }, 1, 0, { KEY_A }, { KEY_A }, 0 },
+        { { R(2) }, 1, 0, { 0 }, { 0 }, 1 }) },
+    { "shared usage within one batch", STEPS(
+        { { P(1), P(2), R(2) }, 3, 0, { KEY_A }, { KEY_A }, 1 },
+        { { R(1), P(3) }, 2, 0, { KEY_B }, { KEY_B }, 1 },
+        { { R(3) }, 1, 0, { 0 }, { 0 }, 1 }) },
+    { "two keys share a modifier", STEPS(
+        { { P(11) }, 1, 0x02, { 0 }, { 0 }, 1 },
+        { { P(12), P(13) }, 2, 0x22, { 0 }, { 0 }, 1 },
+        { { R(11) }, 1, 0x22, { 0 }, { 0 }, 0 },
+        { { R(13), R(12) }, 2, 0x00, { 0 }, { 0 }, 1 }) },
+    { "rollover past 6 keys", STEPS(
+        { { P(3), P(4), P(5), P(6), P(7), P(8) }, 6, 0,
+          { USAGE(3), USAGE(4), USAGE(5), USAGE(6), USAGE(7), USAGE(8) },
+          { USAGE(3), USAGE(4), USAGE(5), USAGE(6), USAGE(7), USAGE(8) }, 1 },
+        { { P(9) }, 1, 0, { 1, 1, 1, 1, 1, 1 },
+          { USAGE(3), USAGE(4), USAGE(5), USAGE(6), USAGE(7), USAGE(8), USAGE(9) }, 1 },
+        { { P(1), P(2), R(1) }, 3, 0, { 1, 1, 1, 1, 1, 1 },
+          { KEY_A, USAGE(3), USAGE(4), USAGE(5), USAGE(6), USAGE(7), USAGE(8), USAGE(9) }, 1 },
+        { { R(2), R(4) }, 2, 0, { USAGE(3), USAGE(5), USAGE(6), USAGE(7), USAGE(8), USAGE(9) },
+          { USAGE(3), USAGE(5), USAGE(6), USAGE(7), USAGE(8), USAGE(9) }, 1 },
+        { { R(3), R(5), R(6), R(7), R(8), R(9) }, 6, 0, { 0 }, { 0 }, 1 }) },
+    { "repeated and stray events", STEPS(
+        { { R(3) }, 1, 0, { 0 }, { 0 }, 0 },
+        { { P(3), P(3) }, 2, 0, { KEY_B }, { KEY_B }, 1 },
+        { { R(3), R(3) }, 2, 0, { 0 }, { 0 }, 1 },
+        { { P(20), R(20) }, 2, 0, { 0 }, { 0 }, 0 }) },
+    { "boot slots keep the press order", STEPS(
+        { { P(5), P(3), P(4) }, 3, 0, { USAGE(5), USAGE(3), USAGE(4) }, { USAGE(3), USAGE(4), USAGE(5) }, 1 },
+        { { R(3) }, 1, 0, { USAGE(5), USAGE(4) }, { USAGE(4), USAGE(5) }, 1 },
+        { { P(1), R(5) }, 2, 0, { USAGE(4), KEY_A }, { KEY_A, USAGE(4) }, 1 },
+        { { R(4), R(1) }, 2, 0, { 0 }, { 0 }, 1 }) },
+};
+
+/**
+ * @brief Build the test keymap
+ * @param keymap Table of TCA8418_HID_KEYMAP_SIZE usages
+ */
+static void BuildKeymap(uint8_t *keymap){
+    memset(keymap, 0, TCA8418_HID_KEYMAP_SIZE);
+    keymap[1] = KEY_A;
+    keymap[2] = KEY_A;
+    for(uint8_t k = 3; k <= 10; k++){
+        keymap[k] = USAGE(k);
+    }
+    keymap[11] = LEFT_SHIFT;
+    keymap[12] = LEFT_SHIFT;
+    keymap[13] = RIGHT_SHIFT;
+}
+
+/**
+ * @brief Run one script
+ * @return int Failed steps
+ */
+static int RunScript(const Script *script, const uint8_t *keymap){
+    TCA8418_HID hid;
+    int failed = 0;
+    TCA8418_HID_Init(&hid, keymap);
+    (void)TCA8418_HID_TakeChanged(&hid);
+    for(uint8_t s = 0; s < script->numSteps; s++){
+        const Step *step = &script->steps[s];
+        uint8_t boot[TCA8418_HID_BOOT_SIZE] = { step->modifiers, 0 };
+        uint8_t nkro[TCA8418_HID_NKRO_SIZE] = { step->modifiers };
+        uint8_t changed;
+        memcpy(&boot[2], step->boot, sizeof(step->boot));
+        for(uint8_t i = 0; (i < sizeof(step->nkro)) && (step->nkro[i] != 0); i++){
+            nkro[1 + (step->nkro[i] >> 3)] |= (uint8_t)(1U << (step->nkro[i] & 7));
+        }
+        TCA8418_HID_ProcessEvents(&hid, step->events, step->numEvents);
+        changed = TCA8418_HID_TakeChanged(&hid);
+        if((memcmp(TCA8418_HID_BootReport(&hid), boot, sizeof(boot)) != 0) ||
+           (memcmp(TCA8418_HID_NkroReport(&hid), nkro, sizeof(nkro)) != 0) || (changed != step->changed)){
+            const uint8_t *report = TCA8418_HID_BootReport(&hid);
+            printf("FAIL %s, step %u: boot", script->name, s + 1);
+            for(uint8_t i = 0; i < TCA8418_HID_BOOT_SIZE; i++){
+                printf(" %02X", report[i]);
+            }
+            printf(", expected");
+            for(uint8_t i = 0; i < TCA8418_HID_BOOT_SIZE; i++){
+                printf(" %02X", boot[i]);
+            }
+            printf(", changed %u expected %u\n", changed, step->changed);
+            failed++;
+        }
+    }
+    if(failed == 0){
+        printf("ok   %s\n", script->name);
+    }
+    return failed;
+}
+
+int main(void){
+    uint8_t keymap[TCA8418_HID_KEYMAP_SIZE];
+    int failed = 0;
+    BuildKeymap(keymap);
+    for(uint8_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++){
+        failed += RunScript(&scripts[i], keymap);
+    }
+    printf("%d failed steps\n", failed);
+    return (failed != 0) ? 1 : 0;
+}
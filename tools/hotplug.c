@@ -0,0 +1,273 @@
+/**
+ * @file hotplug.c
+ * @brief Simulated unplug and plug of the keypad board with the reattach-to-first-key time
+ * @details Runs tca8418.c against the simulator of tools/sim with the deferred
+ *          drain, outputs in every free GPIO byte and the per-register or IT
+ *          drain. The board is unplugged while the driver is idle, while the
+ *          ring is full and the drain throttled, and with the IT strategy while
+ *          the FIFO read is in flight. The main loop calls TCA8418_PollPresence()
+ *          every millisecond. Once the board answers again, each run checks that
+ *          the reattach took one probe and three writes, that CFG and the
+ *          registers from GPIO_DAT_OUT1 to GPIO_DIR3 are back at their values
+ *          from before the unplug, that the ring is empty, that the outputs can
+ *          be flushed and that a key pressed 1 ms after the reattach is
+ *          delivered. It prints the time from the probe that found the board to
+ *          the restored configuration and to the first key event in the ring.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 hotplug.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o hotplug
+ *          Usage: hotplug [busHz]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_HOTPLUG || !TCA8418_FEATURE_OUTPUTS || !TCA8418_FEATURE_DEFERRED
+#error "hotplug needs the full profile"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Cycles to microseconds */
+#define TO_US(cycles)   ((double)(cycles) / (TCA8418SIM_CPU_HZ / 1e6))
+
+/* Registers restored by a reattach: CFG, then GPIO_DAT_OUT1 to GPIO_DIR3 */
+#define REG_CFG         0x01
+#define REG_FIRST       0x17
+#define REG_LAST        0x25
+
+/* Transactions of a reattach: the probe, CFG, the burst and CFG again */
+#define REATTACH_TRANSACTIONS   4
+
+/* Polls of TCA8418_PollPresence() before giving up on a reattach */
+#define POLLS_MAX       (4U * TCA8418_PRESENCE_PROBE_MS)
+
+/**
+ * @brief Driver state when the board is unplugged
+ */
+typedef enum {
+    UNPLUG_IDLE = 0,    //< Nothing pending
+    UNPLUG_THROTTLED,   //< Ring full, events held in the FIFO
+    UNPLUG_DRAIN,       //< IT FIFO read in flight
+    UNPLUG_COUNT
+} Unplug;
+
+static const char *const unplugNames[UNPLUG_COUNT] = { "idle", "throttled", "drain" };
+
+/* Presence events reported */
+static uint32_t detached;
+static uint32_t attached;
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin == TCA8418_INT_Pin){
+        TCA8418_IRQHandler();
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_ErrorCallback(hi2c);
+}
+
+static void OnPresence(TCA8418_PresenceEvent event){
+    if(event == TCA8418_DETACHED){
+        detached++;
+    } else {
+        attached++;
+    }
+}
+
+/**
+ * @brief Schedule presses and releases of key 1 and let them reach the FIFO
+ * @param count Events to add
+ */
+static void Keys(uint8_t count){
+    uint64_t now = TCA8418Sim_Now();
+    for(uint8_t i = 0; i < count; i++){
+        (void)TCA8418Sim_Key(now + 1U + i, (uint8_t)(((i & 1U) ? 0x00 : 0x80) | 1U));
+    }
+}
+
+/**
+ * @brief Unplug the board in one driver state and plug it in again
+ * @param busHz Bus speed
+ * @param strategy Drain strategy
+ * @param unplug Driver state when unplugged
+ * @return int 0 if the reattach passed every check, otherwise 1
+ */
+static int Run(uint32_t busHz, TCA8418_DrainStrategy strategy, Unplug unplug){
+    const TCA8418Sim_Transaction *log;
+    TCA8418_PresenceStats presence;
+    uint8_t saved[REG_LAST - REG_FIRST + 1];
+    uint8_t savedCfg;
+    uint8_t events[TCA8418_RING_SIZE];
+    uint8_t numEvents = 0;
+    uint32_t outputs;
+    uint32_t transactions = 0;
+    uint32_t polls;
+    uint8_t inFlight = 0;
+    int errors = 0;
+    TCA8418Sim_Reset(busHz);
+    detached = 0;
+    attached = 0;
+    TCA8418_SetPresenceCallback(OnPresence);
+    if((TCA8418_Init() != HAL_OK) || (TCA8418_SetDrainStrategy(strategy) != HAL_OK)){
+        fprintf(stderr, "initialization failed\n");
+        return 1;
+    }
+    /* Every pin the keypad leaves free becomes an output, driven in a pattern */
+    outputs = ~((uint32_t)TCA8418Sim_Register(0x1D) | ((uint32_t)TCA8418Sim_Register(0x1E) << 8) |
+                ((uint32_t)TCA8418Sim_Register(0x1F) << 16)) & ((1UL << TCA8418_DIAG_PINS) - 1U);
+    if((TCA8418_ConfigureOutputs(outputs, 0) != HAL_OK)){
+        fprintf(stderr, "output configuration failed\n");
+        return 1;
+    }
+    TCA8418_SetOutputs(outputs, outputs & 0x2AAAAUL);
+    if(TCA8418_FlushOutputs(HAL_GetTick() + TCA8418_OUTPUT_FRAME_MS) != HAL_OK){
+        fprintf(stderr, "output flush failed\n");
+        return 1;
+    }
+    savedCfg = TCA8418Sim_Register(REG_CFG);
+    for(uint8_t reg = REG_FIRST; reg <= REG_LAST; reg++){
+        saved[reg - REG_FIRST] = TCA8418Sim_Register(reg);
+    }
+
+    switch(unplug){
+    case UNPLUG_THROTTLED:
+        /* Nothing is taken out of the ring until it is full and the drain holds events back */
+        while(TCA8418_PendingEvents() + TCA8418_FIFO_DEPTH <= TCA8418_RING_SIZE){
+            Keys(TCA8418_FIFO_DEPTH);
+            TCA8418Sim_Run(US(1000));
+        }
+        Keys(TCA8418_FIFO_DEPTH);
+        TCA8418Sim_Run(US(1000));
+        break;
+    case UNPLUG_DRAIN:
+        /* Unplug at the first IT read of the FIFO, before it completes */
+        Keys(2);
+        TCA8418Sim_ClearStats();
+        for(uint32_t step = 0; step < 10000U; step++){
+            uint16_t count = TCA8418Sim_GetLog(&log);
+            if((count > 0) && log[count - 1].async){
+                inFlight = 1;
+                break;
+            }
+            TCA8418Sim_Run(US(1));
+        }
+        if(!inFlight){
+            fprintf(stderr, "%s: no IT read started\n", unplugNames[unplug]);
+            errors++;
+        }
+        break;
+    default:
+        break;
+    }
+
+    /* Unplugged, the next transaction sees the detach */
+    TCA8418Sim_Attach(0);
+    if(unplug == UNPLUG_DRAIN){
+        TCA8418Sim_Run(US(1000));
+    } else {
+        (void)TCA8418_SetInterruptMode(TCA8418_INT_LATCHED);
+    }
+    (void)TCA8418_PollPresence(HAL_GetTick());
+    if(TCA8418_IsPresent() || (detached != 1)){
+        fprintf(stderr, "%s: detach not reported\n", unplugNames[unplug]);
+        errors++;
+    }
+    TCA8418Sim_Run(US(50000));
+    TCA8418Sim_Attach(1);
+
+    /* The main loop polls every millisecond until the probe finds the board */
+    for(polls = 0; (polls < POLLS_MAX) && !TCA8418_IsPresent(); polls++){
+        TCA8418Sim_Run(US(1000));
+        transactions = TCA8418Sim_GetStats()->transactions;
+        (void)TCA8418_PollPresence(HAL_GetTick());
+        transactions = TCA8418Sim_GetStats()->transactions - transactions;
+    }
+    if(!TCA8418_IsPresent() || (attached != 1)){
+        fprintf(stderr, "%s: no reattach\n", unplugNames[unplug]);
+        return 1;
+    }
+    if(transactions != REATTACH_TRANSACTIONS){
+        fprintf(stderr, "%s: reattach took %lu transactions\n", unplugNames[unplug], (unsigned long)transactions);
+        errors++;
+    }
+    if(TCA8418Sim_Register(REG_CFG) != savedCfg){
+        fprintf(stderr, "%s: CFG 0x%02X, was 0x%02X\n", unplugNames[unplug], TCA8418Sim_Register(REG_CFG), savedCfg);
+        errors++;
+    }
+    for(uint8_t reg = REG_FIRST; reg <= REG_LAST; reg++){
+        if(TCA8418Sim_Register(reg) != saved[reg - REG_FIRST]){
+            fprintf(stderr, "%s: register 0x%02X is 0x%02X, was 0x%02X\n", unplugNames[unplug], reg,
+                    TCA8418Sim_Register(reg), saved[reg - REG_FIRST]);
+            errors++;
+        }
+    }
+    if(TCA8418_PendingEvents() != 0){
+        fprintf(stderr, "%s: %u events from before the unplug left in the ring\n", unplugNames[unplug],
+                TCA8418_PendingEvents());
+        errors++;
+    }
+    TCA8418_SetOutputs(outputs, outputs & 0x15555UL);
+    if(TCA8418_FlushOutputs(HAL_GetTick() + TCA8418_OUTPUT_FRAME_MS) != HAL_OK){
+        fprintf(stderr, "%s: outputs not flushed after the reattach\n", unplugNames[unplug]);
+        errors++;
+    }
+
+    /* A key pressed 1 ms after the reattach */
+    (void)TCA8418Sim_Key(TCA8418Sim_Now() + US(1000), 0x81);
+    TCA8418Sim_Run(US(5000));
+    if((TCA8418_PopEvents(events, sizeof(events), &numEvents) != HAL_OK) || (numEvents != 1) || (events[0] != 0x81)){
+        fprintf(stderr, "%s: %u events after the reattach, expected the press of key 1\n", unplugNames[unplug],
+                numEvents);
+        errors++;
+    }
+    TCA8418_GetPresenceStats(&presence);
+    if(!presence.firstEvent){
+        fprintf(stderr, "%s: first event after the reattach not recorded\n", unplugNames[unplug]);
+        errors++;
+    }
+    printf("%-13s %-10s %6lu %12.1f %12.1f%s\n", (strategy == TCA8418_DRAIN_IT) ? "IT" : "per-register",
+           unplugNames[unplug], (unsigned long)transactions, TO_US(presence.readyCycles - presence.reattachCycles),
+           TO_US(presence.firstEventCycles - presence.reattachCycles), (errors != 0) ? " FAIL" : "");
+    return (errors != 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t busHz = 400000;
+    int result = 0;
+    if(argc > 1){
+        busHz = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if((argc > 2) || (busHz == 0)){
+        fprintf(stderr, "usage: hotplug [busHz]\n");
+        return 1;
+    }
+    printf("%lu Hz, key pressed 1 ms after the reattach\n", (unsigned long)busHz);
+    printf("%-13s %-10s %6s %12s %12s\n", "drain", "unplugged", "xfers", "ready us", "first key us");
+    for(uint8_t u = 0; u < UNPLUG_COUNT; u++){
+        if(u != UNPLUG_DRAIN){
+            result |= Run(busHz, TCA8418_DRAIN_PER_REGISTER, (Unplug)u);
+        }
+        result |= Run(busHz, TCA8418_DRAIN_IT, (Unplug)u);
+    }
+    return result;
+}
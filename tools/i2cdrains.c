@@ -0,0 +1,739 @@
+/**
+ * @file i2cdrains.c
+ * @brief Host tool measuring the driver's bus efficiency from logic analyzer captures
+ * @details Reads the annotations of the sigrok I2C decoder, exported as CSV
+ *          from PulseView or printed by sigrok-cli with sample numbers, and
+ *          rebuilds the transactions. Transactions to the TCA8418 are grouped
+ *          into drains: an INT_STAT read, the KEY_LCK_EC read, the KEY_EVENT_A
+ *          reads and the INT_STAT clear, plus the recheck and redrain of the
+ *          latched interrupt mode. It reports the transactions per drain, the
+ *          bus bytes per key event, the idle gaps between the transactions of a
+ *          drain per register pair, which is the MCU and HAL time between the
+ *          calls, and the SCL time beyond the nominal bit period, which is
+ *          clock stretching by the TCA8418 or SCL held low by the master,
+ *          and the drains whose INT_STAT read shows a FIFO overflow.
+ *          A line is taken as one annotation when it holds a known annotation
+ *          (start, repeat start, stop, ack, nack, address or data read or write,
+ *          as class or text). Its first two numbers are the start and end time:
+ *          sample numbers when -r gives the sample rate, otherwise seconds, or
+ *          any unit among ns, us, ms and s written after the number. The last 1
+ *          or 2 digit hexadecimal token is the byte value.
+ *          With -c the report is compared line by line with an expected report
+ *          instead of printed, and the tool fails on the first difference.
+ *          captures/drains.txt is a capture of known drains, an overflow and a
+ *          NACK, with its report in captures/drains.expected.
+ *          Build: cc -O2 i2cdrains.c -o i2cdrains
+ *          Usage: i2cdrains [-r sampleRate] [-a address] [-g gapUs] [-v] [-c expected] capture.csv
+ *          Check: i2cdrains -r 1000000 -c captures/drains.expected captures/drains.txt
+ *          e.g. sigrok-cli -i capture.sr -P i2c:scl=D0:sda=D1 -A i2c=start:repeat-start:stop:ack:nack:address-read:address-write:data-read:data-write --protocol-decoder-samplenum > capture.txt
+ *               i2cdrains -r 8000000 capture.txt
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* TCA8418 registers of a drain */
+#define INT_STAT        0x02
+#define KEY_LCK_EC      0x03
+#define KEY_EVENT_A     0x04
+
+/* INT_STAT bit of a FIFO overflow */
+#define OVR_FLOW_INT    0x08
+
+/* Data bytes kept per transaction, longer reads are counted but not stored */
+#define TXN_DATA_MAX    32
+
+/* Register pairs tracked in the gap table */
+#define PAIRS_MAX       16
+
+/**
+ * @brief Kinds of decoder annotations
+ */
+typedef enum {
+    ANN_START,
+    ANN_RESTART,
+    ANN_STOP,
+    ANN_ADDRESS_WRITE,
+    ANN_ADDRESS_READ,
+    ANN_DATA_WRITE,
+    ANN_DATA_READ,
+    ANN_ACK,
+    ANN_NACK
+} AnnKind;
+
+/**
+ * @brief Annotation names, lowercase with '-' read as ' ', longer names first
+ */
+static const struct {
+    const char *name;
+    AnnKind kind;
+} annNames[] = {
+    {"start repeat", ANN_RESTART},
+    {"repeat start", ANN_RESTART},
+    {"address write", ANN_ADDRESS_WRITE},
+    {"address read", ANN_ADDRESS_READ},
+    {"data write", ANN_DATA_WRITE},
+    {"data read", ANN_DATA_READ},
+    {"start", ANN_START},
+    {"stop", ANN_STOP},
+    {"nack", ANN_NACK},
+    {"ack", ANN_ACK},
+};
+
+/**
+ * @brief One decoder annotation
+ */
+typedef struct {
+    AnnKind kind;
+    uint8_t value;      //< Byte of address and data annotations, 7-bit address for addresses
+    double start;       //< Start time in seconds
+    double end;         //< End time in seconds
+} Annotation;
+
+/**
+ * @brief One transaction from START to STOP
+ */
+typedef struct {
+    uint8_t address;        //< 7-bit address of the first address byte
+    uint8_t read;           //< A read phase followed a repeated START
+    uint8_t nack;           //< A byte was not acknowledged
+    uint8_t hasRegister;    //< The first written data byte is present
+    uint8_t reg;            //< First written data byte, the register
+    uint32_t bytes;         //< Address and data bytes on the bus
+    uint32_t writeBytes;    //< Data bytes written after the register
+    uint32_t readBytes;     //< Data bytes read
+    uint8_t data[TXN_DATA_MAX]; //< First data bytes read, or written after the register
+    double start;           //< Start of the START condition
+    double end;             //< End of the STOP condition
+    double minByte;         //< Shortest address or data byte, 8 nominal bit periods
+    double byteTime;        //< Sum of the address and data byte durations
+    double ackTime;         //< Sum of the ACK and NACK durations
+    uint32_t acks;          //< ACK and NACK annotations
+    double gapTime;         //< Time between an ACK and the next byte or condition
+} Transaction;
+
+/**
+ * @brief Idle gaps between two kinds of transactions inside drains
+ */
+typedef struct {
+    char label[24];     //< e.g. "R02 -> R03", W for writes
+    uint32_t count;
+    double sum;
+    double max;
+} Pair;
+
+/**
+ * @brief Drain being assembled and the totals over all drains
+ */
+typedef struct {
+    /* Current drain */
+    uint8_t open;
+    uint32_t transactions;
+    uint32_t events;
+    uint32_t bytes;
+    uint8_t overflow;       //< The INT_STAT read showed OVR_FLOW_INT
+    double start;
+    double end;
+    double busy;
+    double gaps;
+    Transaction last;       //< Previous transaction of the drain
+    /* Totals */
+    uint32_t drains;
+    uint32_t emptyPolls;
+    uint32_t overflows;     //< Drains with OVR_FLOW_INT
+    uint32_t totalTransactions;
+    uint32_t minTransactions;
+    uint32_t maxTransactions;
+    uint32_t totalEvents;
+    uint32_t totalBytes;
+    double totalDuration;
+    double totalBusy;
+    double totalGaps;
+    double maxGap;
+    uint32_t numGaps;
+    Pair pairs[PAIRS_MAX];
+    uint32_t numPairs;
+} Drains;
+
+/**
+ * @brief Totals over every transaction of the capture
+ */
+typedef struct {
+    uint32_t transactions;
+    uint32_t device;        //< Transactions to the TCA8418
+    uint32_t nacked;        //< Transactions to the TCA8418 with a NACK outside the last read byte
+    uint32_t aborted;       //< Transactions without STOP
+    uint32_t stretched;     //< Transactions to the TCA8418 with SCL held beyond half a bit
+    double stretch;         //< SCL time beyond the nominal bit periods
+    double minByte;         //< Shortest byte of the capture
+    double firstStart;
+    double lastEnd;
+    double deviceBusy;      //< Bus time of the transactions to the TCA8418
+} Totals;
+
+static double sampleRate;   //< Samples per second, 0 when times are in seconds
+static uint8_t deviceAddress = 0x34;
+static double drainGap = 2e-3;
+static int verbose;
+
+/**
+ * @brief Find the annotation named in a line
+ * @param line Line of the capture
+ * @param kind Pointer to store the kind
+ * @param at Pointer to store the offset of the name
+ * @return int 1 if found, otherwise 0
+ */
+static int FindAnnotation(const char *line, AnnKind *kind, size_t *at){
+    char lower[1024];
+    size_t length = strlen(line);
+    size_t best = length;
+    if(length >= sizeof(lower)){
+        length = sizeof(lower) - 1;
+    }
+    for(size_t i = 0; i < length; i++){
+        char c = (char)tolower((unsigned char)line[i]);
+        lower[i] = (c == '-') ? ' ' : c;
+    }
+    lower[length] = '\0';
+    for(size_t n = 0; n < sizeof(annNames) / sizeof(annNames[0]); n++){
+        size_t nameLength = strlen(annNames[n].name);
+        const char *p = lower;
+        while((p = strstr(p, annNames[n].name)) != NULL){
+            size_t offset = (size_t)(p - lower);
+            /* Whole words only: "ack" is not part of "nack", "start" not part of "restart" */
+            if(((offset == 0) || !isalpha((unsigned char)lower[offset - 1])) &&
+               !isalpha((unsigned char)lower[offset + nameLength])){
+                /* The first name in the line wins, longer names win at the same offset */
+                if(offset < best){
+                    best = offset;
+                    *kind = annNames[n].kind;
+                }
+                break;
+            }
+            p++;
+        }
+    }
+    *at = best;
+    return best < length;
+}
+
+/**
+ * @brief Read up to two times before the annotation name
+ * @param line Line of the capture
+ * @param limit Offset of the annotation name
+ * @param times Array to store the times in seconds
+ * @return int Number of times read
+ * @note Digits glued to a name, as in "i2c-1", are not numbers, "100-200" are two.
+ */
+static int ReadTimes(const char *line, size_t limit, double *times){
+    int count = 0;
+    size_t i = 0;
+    while((i < limit) && (count < 2)){
+        char *end;
+        double value;
+        double scale;
+        int glued = (i > 0) && (isalpha((unsigned char)line[i - 1]) || (line[i - 1] == '_') ||
+                    ((line[i - 1] == '-') && (i > 1) && isalpha((unsigned char)line[i - 2])));
+        if(!isdigit((unsigned char)line[i]) || glued){
+            /* Skip the rest of a glued token */
+            if(glued){
+                while((i < limit) && isalnum((unsigned char)line[i])){
+                    i++;
+                }
+            } else {
+                i++;
+            }
+            continue;
+        }
+        value = strtod(&line[i], &end);
+        i = (size_t)(end - line);
+        while(line[i] == ' '){
+            i++;
+        }
+        scale = (sampleRate > 0) ? 1.0 / sampleRate : 1.0;
+        if(strncmp(&line[i], "ns", 2) == 0){
+            scale = 1e-9;
+        } else if((strncmp(&line[i], "us", 2) == 0) || (strncmp(&line[i], "\xC2\xB5s", 3) == 0) ||
+                  (strncmp(&line[i], "\xCE\xBCs", 3) == 0)){
+            scale = 1e-6;
+        } else if(strncmp(&line[i], "ms", 2) == 0){
+            scale = 1e-3;
+        } else if((line[i] == 's') && !isalpha((unsigned char)line[i + 1])){
+            scale = 1.0;
+        }
+        times[count++] = value * scale;
+    }
+    return count;
+}
+
+/**
+ * @brief Read the byte value of an address or data annotation
+ * @param line Line of the capture
+ * @param from Offset of the annotation name
+ * @param value Pointer to store the value
+ * @return int 1 if found, otherwise 0
+ * @note The last standalone token of 1 or 2 hexadecimal digits, with or without 0x.
+ */
+static int ReadValue(const char *line, size_t from, uint8_t *value){
+    size_t i = strlen(line);
+    while(i > from){
+        size_t end = i;
+        size_t start;
+        while((end > from) && !isalnum((unsigned char)line[end - 1])){
+            end--;
+        }
+        start = end;
+        while((start > from) && isalnum((unsigned char)line[start - 1])){
+            start--;
+        }
+        if(start == end){
+            return 0;
+        }
+        if(((end - start) == 4) && (line[start] == '0') && ((line[start + 1] == 'x') || (line[start + 1] == 'X'))){
+            start += 2;
+        }
+        if(((end - start) <= 2) && isxdigit((unsigned char)line[start]) && isxdigit((unsigned char)line[end - 1])){
+            *value = (uint8_t)strtoul(&line[start], NULL, 16);
+            return 1;
+        }
+        i = start;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse one line of the capture
+ * @param line Line of the capture
+ * @param ann Pointer to store the annotation
+ * @return int 1 for an annotation, 0 for other lines, -1 for an annotation without time or value
+ */
+static int ParseLine(const char *line, Annotation *ann){
+    size_t at;
+    double times[2];
+    int count;
+    if(!FindAnnotation(line, &ann->kind, &at)){
+        return 0;
+    }
+    count = ReadTimes(line, at, times);
+    if(count == 0){
+        /* Header lines name the columns, e.g. "Start" */
+        return 0;
+    }
+    ann->start = times[0];
+    ann->end = (count > 1) ? times[1] : times[0];
+    ann->value = 0;
+    if((ann->kind == ANN_ADDRESS_WRITE) || (ann->kind == ANN_ADDRESS_READ) ||
+       (ann->kind == ANN_DATA_WRITE) || (ann->kind == ANN_DATA_READ)){
+        if(!ReadValue(line, at, &ann->value)){
+            return -1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Label of a transaction for the gap table
+ */
+static void TransactionLabel(const Transaction *txn, char *label, size_t size){
+    if(txn->hasRegister){
+        snprintf(label, size, "%c%02X", txn->read ? 'R' : 'W', txn->reg);
+    } else {
+        snprintf(label, size, "%s", txn->read ? "R??" : "W??");
+    }
+}
+
+/**
+ * @brief Add the idle gap between two transactions of a drain
+ */
+static void AddGap(Drains *d, const Transaction *prev, const Transaction *next){
+    char from[8];
+    char to[8];
+    char label[24];
+    double gap = next->start - prev->end;
+    Pair *pair = NULL;
+    TransactionLabel(prev, from, sizeof(from));
+    TransactionLabel(next, to, sizeof(to));
+    snprintf(label, sizeof(label), "%s -> %s", from, to);
+    for(uint32_t i = 0; i < d->numPairs; i++){
+        if(strcmp(d->pairs[i].label, label) == 0){
+            pair = &d->pairs[i];
+            break;
+        }
+    }
+    if((pair == NULL) && (d->numPairs < PAIRS_MAX)){
+        pair = &d->pairs[d->numPairs++];
+        snprintf(pair->label, sizeof(pair->label), "%s", label);
+    }
+    if(pair != NULL){
+        pair->count++;
+        pair->sum += gap;
+        if(gap > pair->max){
+            pair->max = gap;
+        }
+    }
+    d->gaps += gap;
+    d->numGaps++;
+    if(gap > d->maxGap){
+        d->maxGap = gap;
+    }
+}
+
+/**
+ * @brief Close the current drain and add it to the totals
+ */
+static void CloseDrain(Drains *d){
+    if(!d->open){
+        return;
+    }
+    d->open = 0;
+    if(d->events == 0){
+        /* A poll of TCA8418_ReadKeyEvents() finding no events, or a drain of an empty FIFO */
+        d->emptyPolls++;
+        return;
+    }
+    d->drains++;
+    if(d->overflow){
+        d->overflows++;
+    }
+    d->totalTransactions += d->transactions;
+    if((d->drains == 1) || (d->transactions < d->minTransactions)){
+        d->minTransactions = d->transactions;
+    }
+    if(d->transactions > d->maxTransactions){
+        d->maxTransactions = d->transactions;
+    }
+    d->totalEvents += d->events;
+    d->totalBytes += d->bytes;
+    d->totalDuration += d->end - d->start;
+    d->totalBusy += d->busy;
+    d->totalGaps += d->gaps;
+    if(verbose){
+        printf("drain %4lu at %12.6f s: %2lu transactions, %2lu events, %3lu bytes, %8.1f us, gaps %8.1f us\n",
+               (unsigned long)d->drains, d->start, (unsigned long)d->transactions, (unsigned long)d->events,
+               (unsigned long)d->bytes, (d->end - d->start) * 1e6, d->gaps * 1e6);
+    }
+}
+
+/**
+ * @brief Check whether a transaction is part of a drain
+ */
+static int IsDrainTransaction(const Transaction *txn){
+    if(!txn->hasRegister){
+        return 0;
+    }
+    if(txn->read){
+        return (txn->reg == INT_STAT) || (txn->reg == KEY_LCK_EC) || (txn->reg == KEY_EVENT_A);
+    }
+    return txn->reg == INT_STAT;
+}
+
+/**
+ * @brief Add a TCA8418 transaction to the drains
+ * @note A drain starts with an INT_STAT read and ends before the next one, before any other
+ *       register access, or after an idle gap longer than drainGap.
+ */
+static void AddToDrain(Drains *d, const Transaction *txn){
+    if(d->open && (!IsDrainTransaction(txn) || ((txn->start - d->end) > drainGap) ||
+                   (txn->read && (txn->reg == INT_STAT)))){
+        CloseDrain(d);
+    }
+    if(!d->open){
+        if(!txn->read || (txn->reg != INT_STAT)){
+            return;
+        }
+        d->open = 1;
+        d->transactions = 0;
+        d->events = 0;
+        d->bytes = 0;
+        d->overflow = (txn->readBytes > 0) && (txn->data[0] & OVR_FLOW_INT);
+        d->busy = 0;
+        d->gaps = 0;
+        d->start = txn->start;
+    } else {
+        AddGap(d, &d->last, txn);
+    }
+    d->transactions++;
+    d->bytes += txn->bytes;
+    d->busy += txn->end - txn->start;
+    d->end = txn->end;
+    if(txn->read && (txn->reg == KEY_EVENT_A)){
+        for(uint32_t i = 0; (i < txn->readBytes) && (i < TXN_DATA_MAX); i++){
+            if(txn->data[i] != 0){
+                d->events++;
+            }
+        }
+    }
+    d->last = *txn;
+}
+
+/**
+ * @brief Add a completed transaction to the totals and the drains
+ */
+static void EndTransaction(Totals *t, Drains *d, Transaction *txn){
+    double stretch;
+    double bit;
+    t->transactions++;
+    if(t->transactions == 1){
+        t->firstStart = txn->start;
+    }
+    t->lastEnd = txn->end;
+    if((txn->bytes > 0) && ((t->minByte == 0) || (txn->minByte < t->minByte))){
+        t->minByte = txn->minByte;
+    }
+    if(txn->address != deviceAddress){
+        return;
+    }
+    t->device++;
+    t->deviceBusy += txn->end - txn->start;
+    if(txn->nack){
+        t->nacked++;
+    }
+    /* Nominal bit period from the shortest byte, the rest is SCL held low */
+    bit = txn->minByte / 8.0;
+    stretch = (txn->byteTime - 8.0 * bit * txn->bytes) + (txn->ackTime - bit * txn->acks) + txn->gapTime;
+    if(stretch > bit / 2.0){
+        t->stretched++;
+        t->stretch += stretch;
+    }
+    AddToDrain(d, txn);
+}
+
+/**
+ * @brief Print the report
+ * @param out Stream to print to
+ */
+static void Report(FILE *out, const Totals *t, const Drains *d){
+    fprintf(out, "transactions        %lu, %lu to 0x%02X (%lu with NACK), %lu without STOP\n",
+           (unsigned long)t->transactions, (unsigned long)t->device, deviceAddress,
+           (unsigned long)t->nacked, (unsigned long)t->aborted);
+    if(t->minByte > 0){
+        fprintf(out, "estimated SCL       %.0f kHz\n", 8.0 / t->minByte / 1000.0);
+    }
+    if(t->lastEnd > t->firstStart){
+        fprintf(out, "TCA8418 bus load    %.3f %% of %.3f s\n", 100.0 * t->deviceBusy / (t->lastEnd - t->firstStart),
+               t->lastEnd - t->firstStart);
+    }
+    fprintf(out, "clock stretching    %lu transactions, %.1f us in total\n", (unsigned long)t->stretched, t->stretch * 1e6);
+    fprintf(out, "empty polls         %lu\n", (unsigned long)d->emptyPolls);
+    fprintf(out, "drains              %lu\n", (unsigned long)d->drains);
+    fprintf(out, "overflows           %lu drains\n", (unsigned long)d->overflows);
+    if(d->drains == 0){
+        return;
+    }
+    fprintf(out, "transactions/drain  %.2f (min %lu, max %lu)\n", (double)d->totalTransactions / d->drains,
+           (unsigned long)d->minTransactions, (unsigned long)d->maxTransactions);
+    fprintf(out, "events/drain        %.2f\n", (double)d->totalEvents / d->drains);
+    fprintf(out, "transactions/event  %.2f\n", (double)d->totalTransactions / d->totalEvents);
+    fprintf(out, "bytes/event         %.2f\n", (double)d->totalBytes / d->totalEvents);
+    fprintf(out, "drain time          %.1f us mean, %.1f us on the bus, %.1f us idle between transactions\n",
+           d->totalDuration * 1e6 / d->drains, d->totalBusy * 1e6 / d->drains, d->totalGaps * 1e6 / d->drains);
+    if(d->numGaps > 0){
+        fprintf(out, "idle gaps           %.1f us mean, %.1f us max\n", d->totalGaps * 1e6 / d->numGaps, d->maxGap * 1e6);
+        fprintf(out, "%-14s %8s %10s %10s\n", "between", "count", "mean us", "max us");
+        for(uint32_t i = 0; i < d->numPairs; i++){
+            fprintf(out, "%-14s %8lu %10.1f %10.1f\n", d->pairs[i].label, (unsigned long)d->pairs[i].count,
+                   d->pairs[i].sum * 1e6 / d->pairs[i].count, d->pairs[i].max * 1e6);
+        }
+    }
+}
+
+/**
+ * @brief Compare a report with the expected report
+ * @param report Stream holding the report, rewound
+ * @param path Expected report
+ * @return int 0 if every line is equal, otherwise 1
+ */
+static int CheckReport(FILE *report, const char *path){
+    FILE *expected = fopen(path, "r");
+    char got[256];
+    char want[256];
+    unsigned long lineNumber = 0;
+    int result = 0;
+    if(expected == NULL){
+        perror(path);
+        return 1;
+    }
+    for(;;){
+        char *g = fgets(got, sizeof(got), report);
+        char *w = fgets(want, sizeof(want), expected);
+        lineNumber++;
+        if((g == NULL) && (w == NULL)){
+            break;
+        }
+        if((g == NULL) || (w == NULL) || (strcmp(got, want) != 0)){
+            fprintf(stderr, "line %lu differs\n  got:      %s  expected: %s", lineNumber,
+                    (g != NULL) ? got : "end of report\n", (w != NULL) ? want : "end of report\n");
+            result = 1;
+            break;
+        }
+    }
+    fclose(expected);
+    if(result == 0){
+        printf("report matches %s, %lu lines\n", path, lineNumber - 1);
+    }
+    return result;
+}
+
+int main(int argc, char **argv){
+    static Drains drains;
+    Totals totals = {0};
+    Transaction txn = {0};
+    Annotation ann = {0};
+    FILE *in;
+    FILE *out = stdout;
+    const char *expected = NULL;
+    char line[1024];
+    unsigned long lineNumber = 0;
+    int inTransaction = 0;
+    int addressSeen = 0;
+    double lastEnd = 0;     //< End of the last ACK or NACK, for the gap to the next byte
+    int i;
+    for(i = 1; (i < argc - 1) && (argv[i][0] == '-'); i++){
+        if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc - 1)){
+            sampleRate = strtod(argv[++i], NULL);
+        } else if((strcmp(argv[i], "-a") == 0) && (i + 1 < argc - 1)){
+            deviceAddress = (uint8_t)strtoul(argv[++i], NULL, 0);
+        } else if((strcmp(argv[i], "-g") == 0) && (i + 1 < argc - 1)){
+            drainGap = strtod(argv[++i], NULL) * 1e-6;
+        } else if((strcmp(argv[i], "-c") == 0) && (i + 1 < argc - 1)){
+            expected = argv[++i];
+        } else if(strcmp(argv[i], "-v") == 0){
+            verbose = 1;
+        } else {
+            break;
+        }
+    }
+    if(i != argc - 1){
+        fprintf(stderr, "usage: i2cdrains [-r sampleRate] [-a address] [-g gapUs] [-v] [-c expected] capture.csv\n");
+        return 1;
+    }
+    in = (strcmp(argv[i], "-") == 0) ? stdin : fopen(argv[i], "r");
+    if(in == NULL){
+        perror(argv[i]);
+        return 1;
+    }
+    while(fgets(line, sizeof(line), in) != NULL){
+        int parsed;
+        lineNumber++;
+        parsed = ParseLine(line, &ann);
+        if(parsed < 0){
+            fprintf(stderr, "line %lu: no byte value\n", lineNumber);
+            continue;
+        }
+        if(parsed == 0){
+            continue;
+        }
+        switch(ann.kind){
+        case ANN_START:
+            if(inTransaction){
+                totals.aborted++;
+            }
+            memset(&txn, 0, sizeof(txn));
+            txn.start = ann.start;
+            inTransaction = 1;
+            addressSeen = 0;
+            lastEnd = 0;
+            break;
+        case ANN_RESTART:
+        case ANN_STOP:
+            if(!inTransaction){
+                break;
+            }
+            if(lastEnd > 0){
+                txn.gapTime += ann.start - lastEnd;
+                lastEnd = 0;
+            }
+            if(ann.kind == ANN_STOP){
+                txn.end = ann.end;
+                EndTransaction(&totals, &drains, &txn);
+                inTransaction = 0;
+            }
+            break;
+        case ANN_ADDRESS_WRITE:
+        case ANN_ADDRESS_READ:
+        case ANN_DATA_WRITE:
+        case ANN_DATA_READ:
+            if(!inTransaction){
+                break;
+            }
+            if(lastEnd > 0){
+                txn.gapTime += ann.start - lastEnd;
+                lastEnd = 0;
+            }
+            txn.bytes++;
+            txn.byteTime += ann.end - ann.start;
+            if((txn.minByte == 0) || ((ann.end - ann.start) < txn.minByte)){
+                txn.minByte = ann.end - ann.start;
+            }
+            if(ann.kind == ANN_ADDRESS_WRITE){
+                if(!addressSeen){
+                    txn.address = ann.value;
+                    addressSeen = 1;
+                }
+            } else if(ann.kind == ANN_ADDRESS_READ){
+                if(!addressSeen){
+                    txn.address = ann.value;
+                    addressSeen = 1;
+                }
+                txn.read = 1;
+            } else if(ann.kind == ANN_DATA_WRITE){
+                if(!txn.hasRegister){
+                    txn.hasRegister = 1;
+                    txn.reg = ann.value;
+                } else {
+                    if(txn.writeBytes < TXN_DATA_MAX){
+                        txn.data[txn.writeBytes] = ann.value;
+                    }
+                    txn.writeBytes++;
+                }
+            } else {
+                if(txn.readBytes < TXN_DATA_MAX){
+                    txn.data[txn.readBytes] = ann.value;
+                }
+                txn.readBytes++;
+            }
+            break;
+        case ANN_ACK:
+        case ANN_NACK:
+            if(!inTransaction){
+                break;
+            }
+            txn.ackTime += ann.end - ann.start;
+            txn.acks++;
+            lastEnd = ann.end;
+            /* The master ends a read with a NACK on its last byte, that is no error */
+            if((ann.kind == ANN_NACK) && !(txn.read && (txn.readBytes > 0))){
+                txn.nack = 1;
+            }
+            break;
+        }
+    }
+    if(in != stdin){
+        fclose(in);
+    }
+    if(inTransaction){
+        totals.aborted++;
+    }
+    CloseDrain(&drains);
+    if(expected != NULL){
+        int result;
+        out = tmpfile();
+        if(out == NULL){
+            perror("tmpfile");
+            return 1;
+        }
+        Report(out, &totals, &drains);
+        rewind(out);
+        result = CheckReport(out, expected);
+        fclose(out);
+        return result;
+    }
+    Report(out, &totals, &drains);
+    return 0;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file intrace.c
+ * @brief Simulated bus race test of the drain recheck in both interrupt output modes
+ * @details Runs tca8418.c against the simulator of tools/sim. A key event is
+ *          scheduled at every offset from 0 to 600 us after the one that starts
+ *          a drain, so one offset falls between the event count read and the
+ *          INT_STAT clear. The drain is done by TCA8418_ServiceInterrupt() from
+ *          the EXTI callback, or by TCA8418_ReadKeyEvents() from the main loop
+ *          when the EXTI callback saw an edge. Each case checks that every event
+ *          is delivered in order and that the FIFO and INT are idle afterwards.
+ *          A full FIFO with 4 more events arriving while it is read checks that
+ *          TCA8418_ReadKeyEvents() gives a new edge after filling its 10 events. Then random bursts measure the
+ *          transactions per drain and per event of each mode.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=2 intrace.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o intrace
+ *          Usage: intrace [bursts [busHz]]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Offsets of the second event swept by the race test */
+#define RACE_SPAN_US    600U
+#define RACE_STEP_US    1U
+
+/* Events of the burst that overfills one TCA8418_ReadKeyEvents() call */
+#define BURST_EVENTS    14U
+
+/* Drain used by the EXTI callback */
+static enum {
+    DRAIN_SERVICE,          //< TCA8418_ServiceInterrupt() in the EXTI callback
+    DRAIN_READ              //< TCA8418_ReadKeyEvents() in the main loop after an edge
+} drainApi;
+
+static volatile uint8_t edgeSeen; //< Edge not yet handled by the main loop
+static uint32_t drains;           //< Drains run
+
+/* Event delivery check */
+static uint32_t received;
+static uint32_t errors;
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin != TCA8418_INT_Pin){
+        return;
+    }
+    if(drainApi == DRAIN_SERVICE){
+        drains++;
+        (void)TCA8418_ServiceInterrupt();
+    }else{
+        edgeSeen = 1;
+    }
+}
+
+/**
+ * @brief Event number n as scheduled, press and release alternating over keys 1 to 80
+ */
+static uint8_t EventAt(uint32_t n){
+    return (uint8_t)((1U + ((n / 2U) % 80U)) | ((n & 1U) ? 0x00 : 0x80));
+}
+
+/**
+ * @brief Check events against the scheduled order
+ */
+static void Check(const uint8_t *events, uint8_t count){
+    for(uint8_t i = 0; i < count; i++){
+        if(events[i] != EventAt(received)){
+            errors++;
+        }
+        received++;
+    }
+}
+
+/**
+ * @brief Run the main loop until a time, draining as the configured API does
+ * @param until Time to stop
+ */
+static void MainLoop(uint64_t until){
+    uint8_t events[TCA8418_FIFO_DEPTH];
+    uint8_t count;
+    while(TCA8418Sim_Now() < until){
+        if(drainApi == DRAIN_SERVICE){
+            Check(events, TCA8418_TakeEvents(events, sizeof(events)));
+        }else if(edgeSeen){
+            edgeSeen = 0;
+            drains++;
+            (void)TCA8418_ReadKeyEvents(events, &count);
+            Check(events, count);
+        }
+        TCA8418Sim_Run(US(10));
+    }
+}
+
+/**
+ * @brief Power up the simulator and the driver in a mode
+ * @return int 0 if initialized
+ */
+static int Start(uint32_t busHz, TCA8418_IntMode mode){
+    TCA8418Sim_Reset(busHz);
+    edgeSeen = 0;
+    drains = 0;
+    received = 0;
+    errors = 0;
+    if((TCA8418_Init() != HAL_OK) || (TCA8418_SetInterruptMode(mode) != HAL_OK)){
+        fprintf(stderr, "initialization failed\n");
+        return 1;
+    }
+    TCA8418Sim_ClearStats();
+    return 0;
+}
+
+/**
+ * @brief Check that a case delivered everything and left the chip idle
+ * @return int 0 if so
+ */
+static int Verify(const char *name, uint32_t sent, uint32_t offset){
+    if((received == sent) && (errors == 0) && (TCA8418Sim_FifoCount() == 0) && !TCA8418Sim_IntAsserted()){
+        return 0;
+    }
+    fprintf(stderr, "%s at %lu us: %lu of %lu events, %lu out of order, %u stranded, INT %s\n", name,
+            (unsigned long)offset, (unsigned long)received, (unsigned long)sent, (unsigned long)errors,
+            TCA8418Sim_FifoCount(), TCA8418Sim_IntAsserted() ? "asserted" : "idle");
+    return 1;
+}
+
+/**
+ * @brief Race a second event against the drain started by a first one
+ * @return int Failed cases
+ */
+static int Race(uint32_t busHz, TCA8418_IntMode mode, const char *name){
+    int failed = 0;
+    for(uint32_t offset = 0; offset <= RACE_SPAN_US; offset += RACE_STEP_US){
+        if(Start(busHz, mode) != 0){
+            return 1;
+        }
+        uint64_t at = TCA8418Sim_Now() + US(100);
+        (void)TCA8418Sim_Key(at, EventAt(0));
+        (void)TCA8418Sim_Key(at + US(offset), EventAt(1));
+        MainLoop(at + US(RACE_SPAN_US + 5000U));
+        failed += Verify(name, 2, offset);
+    }
+    /* More events than one TCA8418_ReadKeyEvents() call takes */
+    if(Start(busHz, mode) != 0){
+        return failed + 1;
+    }
+    uint64_t at = TCA8418Sim_Now() + US(100);
+    for(uint32_t i = 0; i < TCA8418_FIFO_DEPTH; i++){
+        (void)TCA8418Sim_Key(at + US(i * 20U), EventAt(i));
+    }
+    /* The main loop is late, the FIFO is full and the rest arrive while it is read */
+    TCA8418Sim_Run(US(100 + TCA8418_FIFO_DEPTH * 20U));
+    at = TCA8418Sim_Now();
+    for(uint32_t i = TCA8418_FIFO_DEPTH; i < BURST_EVENTS; i++){
+        (void)TCA8418Sim_Key(at + US(500U + (i - TCA8418_FIFO_DEPTH) * 50U), EventAt(i));
+    }
+    MainLoop(at + US(20000));
+    failed += Verify(name, BURST_EVENTS, 0);
+    return failed;
+}
+
+/**
+ * @brief Measure the transactions of random bursts
+ * @return int 0 if every event was delivered in order
+ */
+static int Measure(uint32_t bursts, uint32_t busHz, TCA8418_IntMode mode, const char *name){
+    const TCA8418Sim_Stats *stats;
+    uint32_t seed = 1;
+    uint32_t sent = 0;
+    if(Start(busHz, mode) != 0){
+        return 1;
+    }
+    uint64_t at = TCA8418Sim_Now() + US(1000);
+    for(uint32_t b = 0; b < bursts; b++){
+        /* A burst of 1 to 8 events 20 to 400 us apart, then a pause of 2 to 10 ms */
+        seed = seed * 1664525U + 1013904223U;
+        uint32_t count = 1U + ((seed >> 8) % 8U);
+        for(uint32_t i = 0; i < count; i++){
+            seed = seed * 1664525U + 1013904223U;
+            at += US(20U + ((seed >> 8) % 380U));
+            (void)TCA8418Sim_Key(at, EventAt(sent++));
+        }
+        seed = seed * 1664525U + 1013904223U;
+        at += US(2000U + ((seed >> 8) % 8000U));
+        MainLoop(at);
+    }
+    stats = TCA8418Sim_GetStats();
+    printf("%-16s %-9s %8lu %8lu %12lu %10.2f %10.2f\n", name, (mode == TCA8418_INT_LATCHED) ? "latched" : "reassert",
+           (unsigned long)received, (unsigned long)drains, (unsigned long)stats->transactions,
+           (double)stats->transactions / (drains ? drains : 1), (double)stats->transactions / (received ? received : 1));
+    return Verify(name, sent, 0);
+}
+
+int main(int argc, char **argv){
+    static const char *const names[] = { "ServiceInterrupt", "ReadKeyEvents" };
+    uint32_t bursts = 2000;
+    uint32_t busHz = 400000;
+    int failed = 0;
+    if(argc > 1){
+        bursts = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2){
+        busHz = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if((argc > 3) || (bursts == 0) || (busHz == 0)){
+        fprintf(stderr, "usage: intrace [bursts [busHz]]\n");
+        return 1;
+    }
+    for(uint8_t api = DRAIN_SERVICE; api <= DRAIN_READ; api++){
+        drainApi = api;
+        failed += Race(busHz, TCA8418_INT_LATCHED, names[api]);
+        failed += Race(busHz, TCA8418_INT_REASSERT, names[api]);
+    }
+    printf("race: %u of %u cases failed\n", (unsigned)failed, 4U * (RACE_SPAN_US / RACE_STEP_US + 2U));
+    printf("%lu bursts at %lu Hz\n", (unsigned long)bursts, (unsigned long)busHz);
+    printf("%-16s %-9s %8s %8s %12s %10s %10s\n", "", "mode", "events", "drains", "transactions", "per drain", "per event");
+    for(uint8_t api = DRAIN_SERVICE; api <= DRAIN_READ; api++){
+        drainApi = api;
+        failed += Measure(bursts, busHz, TCA8418_INT_LATCHED, names[api]);
+        failed += Measure(bursts, busHz, TCA8418_INT_REASSERT, names[api]);
+    }
+    return (failed != 0) ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file irqlat.c
+ * @brief Simulated interrupt latency of the deferred drain while the main loop uses the bus
+ * @details Runs tca8418.c against the simulator of tools/sim with the deferred
+ *          drain in both interrupt output modes. Key events arrive at random,
+ *          the EXTI callback calls TCA8418_IRQHandler() and PendSV runs
+ *          TCA8418_DeferredHandler(). The main loop takes the events out of the
+ *          ring and issues a blocking driver transaction after every idle gap of
+ *          0 to a given maximum, so PendSV often preempts one and gets HAL_BUSY.
+ *          For each configuration it prints the latency from FIFO arrival to
+ *          the drain, the events still undelivered 50 ms after the last key and
+ *          the drains retried after a preempted transaction.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=2 irqlat.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o irqlat
+ *          Usage: irqlat [events [busHz]], at most TCA8418SIM_KEY_QUEUE events
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Cycles to microseconds */
+#define TO_US(cycles)   ((double)(cycles) / (TCA8418SIM_CPU_HZ / 1e6))
+
+/* Longest idle gap between two blocking driver calls of the main loop */
+static const uint32_t gapsUs[] = { 0, 200, 2000 };
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin == TCA8418_INT_Pin){
+        TCA8418_IRQHandler();
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+/**
+ * @brief Run one configuration
+ * @return int 0 if every event was delivered in order, otherwise 1
+ */
+static int Run(uint32_t count, uint32_t busHz, TCA8418_IntMode mode, uint32_t gapUs){
+    const TCA8418Sim_Stats *stats;
+    TCA8418_DeferredStats deferred;
+    uint32_t blocked;
+    uint32_t seed = 1;
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    uint64_t at;
+    uint8_t events[TCA8418_FIFO_DEPTH];
+    TCA8418Sim_Reset(busHz);
+    if((TCA8418_Init() != HAL_OK) || (TCA8418_SetInterruptMode(mode) != HAL_OK)){
+        fprintf(stderr, "initialization failed\n");
+        return 1;
+    }
+    TCA8418Sim_ClearStats();
+    TCA8418_GetDeferredStats(&deferred);
+    blocked = deferred.blocked;
+    /* Key events 100 us to 5 ms apart */
+    at = TCA8418Sim_Now();
+    for(uint32_t i = 0; i < count; i++){
+        seed = seed * 1664525U + 1013904223U;
+        at += US(100U + ((seed >> 8) % 4900U));
+        (void)TCA8418Sim_Key(at, (uint8_t)((i & 0x7F) | ((i & 1U) ? 0x00 : 0x80)));
+    }
+    at += US(50000);
+    while(TCA8418Sim_Now() < at){
+        uint8_t n = TCA8418_TakeEvents(events, sizeof(events));
+        for(uint8_t i = 0; i < n; i++){
+            if(events[i] != (uint8_t)((received & 0x7F) | ((received & 1U) ? 0x00 : 0x80))){
+                errors++;
+            }
+            received++;
+        }
+        (void)TCA8418_SetInterruptMode(mode);
+        seed = seed * 1664525U + 1013904223U;
+        TCA8418Sim_Run(US((gapUs > 0) ? ((seed >> 8) % (gapUs + 1U)) : 0U));
+    }
+    stats = TCA8418Sim_GetStats();
+    TCA8418_GetDeferredStats(&deferred);
+    printf("%-9s %6lu %8lu %10.1f %10.1f %8lu %8lu %8lu\n", (mode == TCA8418_INT_LATCHED) ? "latched" : "reassert",
+           (unsigned long)gapUs, (unsigned long)received,
+           TO_US(stats->latencySum) / (stats->eventsRead ? stats->eventsRead : 1), TO_US(stats->latencyMax),
+           (unsigned long)(count - received), (unsigned long)stats->busyReturns, (unsigned long)(deferred.blocked - blocked));
+    if((received != count) || (errors != 0)){
+        fprintf(stderr, "%lu of %lu events delivered, %lu out of order\n", (unsigned long)received, (unsigned long)count,
+                (unsigned long)errors);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t count = TCA8418SIM_KEY_QUEUE;
+    uint32_t busHz = 400000;
+    int result = 0;
+    if(argc > 1){
+        count = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2){
+        busHz = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if((argc > 3) || (count == 0) || (count > TCA8418SIM_KEY_QUEUE) || (busHz == 0)){
+        fprintf(stderr, "usage: irqlat [events [busHz]]\n");
+        return 1;
+    }
+    printf("%lu events at %lu Hz, latency from FIFO arrival to drain\n", (unsigned long)count, (unsigned long)busHz);
+    printf("%-9s %6s %8s %10s %10s %8s %8s %8s\n", "mode", "gap us", "events", "mean us", "max us", "stalled",
+           "HAL_BUSY", "retried");
+    for(uint8_t g = 0; g < sizeof(gapsUs) / sizeof(gapsUs[0]); g++){
+        result |= Run(count, busHz, TCA8418_INT_LATCHED, gapsUs[g]);
+        result |= Run(count, busHz, TCA8418_INT_REASSERT, gapsUs[g]);
+    }
+    return result;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file isrbus.c
+ * @brief Simulated bus measurement of the blocking I2C time spent in interrupt context by IT and DMA drains
+ * @details Runs tca8418.c against the simulator of tools/sim with the deferred
+ *          drain and the IT or DMA strategy, in both interrupt output modes.
+ *          Bursts of key events arrive at random, the EXTI callback calls
+ *          TCA8418_IRQHandler(), PendSV runs TCA8418_DeferredHandler() and the
+ *          main loop takes the events out of the ring. For each configuration
+ *          it prints the blocking bus time spent at EXTI and I2C interrupt
+ *          priority, the longest one handler run, and checks that every event
+ *          reached the ring in order.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=2 isrbus.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o isrbus
+ *          Usage: isrbus [bursts [busHz]]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin == TCA8418_INT_Pin){
+        TCA8418_IRQHandler();
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_ErrorCallback(hi2c);
+}
+
+/**
+ * @brief Run one configuration
+ * @return int 0 if every event was delivered in order, otherwise 1
+ */
+static int Run(uint32_t bursts, uint32_t busHz, TCA8418_DrainStrategy strategy, TCA8418_IntMode mode){
+    const TCA8418Sim_Stats *stats;
+    uint32_t seed = 1;
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    uint64_t at = US(1000);
+    uint8_t events[TCA8418_FIFO_DEPTH];
+    TCA8418Sim_Reset(busHz);
+    if((TCA8418_Init() != HAL_OK) || (TCA8418_SetInterruptMode(mode) != HAL_OK) ||
+       (TCA8418_SetDrainStrategy(strategy) != HAL_OK)){
+        fprintf(stderr, "initialization failed\n");
+        return 1;
+    }
+    TCA8418Sim_ClearStats();
+    for(uint32_t b = 0; b < bursts; b++){
+        /* A burst of 1 to 8 events 20 to 400 us apart, then a pause of 2 to 10 ms */
+        seed = seed * 1664525U + 1013904223U;
+        uint32_t count = 1U + ((seed >> 8) % 8U);
+        for(uint32_t i = 0; i < count; i++){
+            seed = seed * 1664525U + 1013904223U;
+            at += US(20U + ((seed >> 8) % 380U));
+            (void)TCA8418Sim_Key(at, (uint8_t)((sent & 0x7F) | ((sent & 1U) ? 0x00 : 0x80)));
+            sent++;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        at += US(2000U + ((seed >> 8) % 8000U));
+        /* Main loop: take events every 500 us until the burst is over */
+        while(TCA8418Sim_Now() < at){
+            uint8_t n = TCA8418_TakeEvents(events, sizeof(events));
+            for(uint8_t i = 0; i < n; i++){
+                if(events[i] != (uint8_t)((received & 0x7F) | ((received & 1U) ? 0x00 : 0x80))){
+                    errors++;
+                }
+                received++;
+            }
+            TCA8418Sim_Run(US(500));
+        }
+    }
+    stats = TCA8418Sim_GetStats();
+    printf("%-4s %-9s %8lu %8lu %10.1f %10.2f %8.1f %9.1f\n",
+           (strategy == TCA8418_DRAIN_IT) ? "IT" : "DMA", (mode == TCA8418_INT_LATCHED) ? "latched" : "reassert",
+           (unsigned long)received, (unsigned long)stats->handlerRuns[TCA8418SIM_ISR],
+           stats->blockingCycles[TCA8418SIM_ISR] / (TCA8418SIM_CPU_HZ / 1e6),
+           (stats->blockingCycles[TCA8418SIM_ISR] / (TCA8418SIM_CPU_HZ / 1e6)) / (received ? received : 1),
+           stats->maxHandlerCycles[TCA8418SIM_ISR] / (TCA8418SIM_CPU_HZ / 1e6),
+           stats->maxHandlerCycles[TCA8418SIM_PENDSV] / (TCA8418SIM_CPU_HZ / 1e6));
+    if((received != sent) || (errors != 0)){
+        fprintf(stderr, "%lu of %lu events delivered, %lu out of order\n", (unsigned long)received, (unsigned long)sent,
+                (unsigned long)errors);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t bursts = 2000;
+    uint32_t busHz = 400000;
+    int result = 0;
+    if(argc > 1){
+        bursts = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2){
+        busHz = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if((argc > 3) || (bursts == 0) || (busHz == 0)){
+        fprintf(stderr, "usage: isrbus [bursts [busHz]]\n");
+        return 1;
+    }
+    printf("%lu bursts at %lu Hz, blocking bus time in interrupt context\n", (unsigned long)bursts, (unsigned long)busHz);
+    printf("%-4s %-9s %8s %8s %10s %10s %8s %9s\n", "", "mode", "events", "ISR runs", "ISR us", "us/event", "max ISR",
+           "max PendSV");
+    for(uint8_t s = TCA8418_DRAIN_IT; s <= TCA8418_DRAIN_DMA; s++){
+        result |= Run(bursts, busHz, (TCA8418_DrainStrategy)s, TCA8418_INT_LATCHED);
+        result |= Run(bursts, busHz, (TCA8418_DrainStrategy)s, TCA8418_INT_REASSERT);
+    }
+    return result;
+}
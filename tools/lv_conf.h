@@ -0,0 +1,24 @@
+/**
+ * @file lv_conf.h
+ * @brief Headless LVGL configuration of the host tools
+ * @details Used by lvglkeys.c: no display or input backend, no logging, and
+ *          the tick is advanced by the tool with lv_tick_inc(). Options not set
+ *          here take the LVGL defaults. Works with LVGL 8 and 9.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+#define LV_COLOR_DEPTH      16
+#define LV_MEM_SIZE         (128U * 1024U)
+#define LV_TICK_CUSTOM      0
+#define LV_USE_LOG          0
+#define LV_USE_SDL          0
+#define LV_USE_LINUX_FBDEV  0
+#define LV_USE_X11          0
+#define LV_BUILD_EXAMPLES   0
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * @file lvglkeys.c
+ * @brief Host check of the LVGL input device of tca8418_lvgl
+ * @details Runs LVGL headless with a display that discards its frames and a
+ *          focused object recording LV_EVENT_KEY. Scripted batches of drained
+ *          events are served through the adapter, and after each batch one
+ *          LVGL input cycle must deliver every press of the batch in order,
+ *          skipping unmapped keys. Prints the result per batch and exits with 1
+ *          on a mismatch.
+ *          Build: with LVGL 8 or 9 built headless from its sources,
+ *          cc -O2 -DLV_CONF_INCLUDE_SIMPLE -DTCA8418_FEATURE_LVGL=1 -I. -I.. -I<dir containing lvgl>
+ *             lvglkeys.c ../tca8418_lvgl.c <liblvgl.a> -o lvglkeys
+ *          Usage: lvglkeys
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tca8418_lvgl.h"
+
+/* Display size, nothing is looked at */
+#define HOR_RES     64
+#define VER_RES     32
+
+/* Largest scripted batch and key history */
+#define BATCH_MAX   16
+#define KEYS_MAX    64
+
+/* Scripted source standing in for the driver's event ring */
+static uint8_t source[BATCH_MAX];
+static uint8_t sourceHead;
+static uint8_t sourceCount;
+
+/* Keys received by the focused object */
+static uint32_t received[KEYS_MAX];
+static uint8_t numReceived;
+
+/**
+ * @brief Scripted TCA8418_TakeEvents()
+ */
+static uint8_t Take(uint8_t *keyEvents, uint8_t maxEvents){
+    uint8_t count = 0;
+    while((count < maxEvents) && (sourceHead < sourceCount)){
+        keyEvents[count++] = source[sourceHead++];
+    }
+    return count;
+}
+
+/**
+ * @brief Scripted TCA8418_PendingEvents()
+ */
+static uint8_t Pending(void){
+    return (uint8_t)(sourceCount - sourceHead);
+}
+
+/**
+ * @brief Record the keys sent to the focused object
+ */
+static void OnKey(lv_event_t *e){
+    if(numReceived < KEYS_MAX){
+        received[numReceived++] = lv_event_get_key(e);
+    }
+}
+
+#if LVGL_VERSION_MAJOR >= 9
+static void Flush(lv_display_t *display, const lv_area_t *area, uint8_t *pixels){
+    (void)area;
+    (void)pixels;
+    lv_display_flush_ready(display);
+}
+#else
+static void Flush(lv_disp_drv_t *driver, const lv_area_t *area, lv_color_t *pixels){
+    (void)area;
+    (void)pixels;
+    lv_disp_flush_ready(driver);
+}
+#endif
+
+/**
+ * @brief Create a display discarding its frames
+ */
+static void CreateDisplay(void){
+#if LVGL_VERSION_MAJOR >= 9
+    static uint8_t buffer[HOR_RES * VER_RES * 4];
+    lv_display_t *display = lv_display_create(HOR_RES, VER_RES);
+    lv_display_set_buffers(display, buffer, NULL, sizeof(buffer), LV_DISPLAY_RENDER_MODE_FULL);
+    lv_display_set_flush_cb(display, Flush);
+#else
+    static lv_color_t buffer[HOR_RES * VER_RES];
+    static lv_disp_draw_buf_t drawBuffer;
+    static lv_disp_drv_t driver;
+    lv_disp_draw_buf_init(&drawBuffer, buffer, NULL, HOR_RES * VER_RES);
+    lv_disp_drv_init(&driver);
+    driver.hor_res = HOR_RES;
+    driver.ver_res = VER_RES;
+    driver.flush_cb = Flush;
+    driver.draw_buf = &drawBuffer;
+    lv_disp_drv_register(&driver);
+#endif
+}
+
+/**
+ * @brief Serve one batch and run one LVGL input cycle
+ * @param events Drained events of the batch
+ * @param numEvents Number of events
+ * @param expected Keys the focused object must receive, in order
+ * @param numExpected Number of keys
+ * @return int 0 if the keys match
+ */
+static int RunBatch(const uint8_t *events, uint8_t numEvents, const uint32_t *expected, uint8_t numExpected){
+    if(numEvents > 0){
+        memcpy(source, events, numEvents);
+    }
+    sourceHead = 0;
+    sourceCount = numEvents;
+    numReceived = 0;
+    lv_tick_inc(100);
+    lv_timer_handler();
+    printf("batch of %u events: %u keys, %u left in the source, ", numEvents, numReceived, Pending());
+    if((numReceived != numExpected) || (Pending() != 0) ||
+       ((numExpected > 0) && (memcmp(received, expected, numExpected * sizeof(expected[0])) != 0))){
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
+
+int main(void){
+    static uint32_t keymap[TCA8418_LVGL_KEYMAP_SIZE];
+    static TCA8418_Lvgl lvgl;
+    /* Press and release of keys 1 to 3, key 4 is unmapped */
+    static const uint8_t typing[] = {0x81, 0x01, 0x82, 0x84, 0x02, 0x04, 0x83, 0x03};
+    static const uint32_t typingKeys[] = {'a', 'b', 'c'};
+    /* A full FIFO of presses and releases of the same key */
+    static const uint8_t repeat[] = {0x81, 0x01, 0x81, 0x01, 0x81, 0x01, 0x81, 0x01, 0x81, 0x01};
+    static const uint32_t repeatKeys[] = {'a', 'a', 'a', 'a', 'a'};
+    lv_indev_t *indev;
+    lv_group_t *group;
+    lv_obj_t *obj;
+    int failures = 0;
+    keymap[1] = 'a';
+    keymap[2] = 'b';
+    keymap[3] = 'c';
+    lv_init();
+    CreateDisplay();
+    indev = TCA8418_Lvgl_Create(&lvgl, keymap, Take, Pending);
+    if(indev == NULL){
+        printf("input device not created\n");
+        return 1;
+    }
+    group = lv_group_create();
+#if LVGL_VERSION_MAJOR >= 9
+    obj = lv_obj_create(lv_screen_active());
+#else
+    obj = lv_obj_create(lv_scr_act());
+#endif
+    lv_obj_add_event_cb(obj, OnKey, LV_EVENT_KEY, NULL);
+    lv_group_add_obj(group, obj);
+    lv_indev_set_group(indev, group);
+    failures += RunBatch(typing, sizeof(typing), typingKeys, 3);
+    failures += RunBatch(repeat, sizeof(repeat), repeatKeys, 5);
+    failures += RunBatch(NULL, 0, NULL, 0);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file muxbench.c
+ * @brief Simulated benchmark of the multiplexer channel cache and drain scheduler of tca8418_mux.h
+ * @details Runs tca8418.c and tca8418_mux.c against the simulator of tools/sim
+ *          with eight TCA8418s behind a TCA9548A, one per channel. Single key
+ *          events arrive on random keypads, so most drains read one event and
+ *          nearly every drain follows one on another channel. The main
+ *          loop reads the eight INT lines every 500 us and drains the keypads
+ *          with events pending with TCA8418_ReadKeyEvents(). Three
+ *          configurations are compared: without the cache, so every drain
+ *          writes the multiplexer, with the cache and a fixed ascending drain
+ *          order, and with the cache and TCA8418_Mux_DrainPending(). For each
+ *          bus speed and mean time between events it prints the multiplexer
+ *          writes and the bus time per event, the share of the bus time spent
+ *          on multiplexer writes and the time from FIFO arrival to the read of
+ *          the event. Each run checks that every event is read once from the
+ *          keypad it arrived on and that every multiplexer write reached the
+ *          bus. It also checks that an interrupt mode other than the shared
+ *          latched one is refused.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=1 -DTCA8418_FEATURE_MUX=1 muxbench.c sim/tca8418sim.c ../tca8418.c ../tca8418_mux.c ../tca8418_trace.c -o muxbench
+ *          Usage: muxbench [events]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418.h"
+#include "tca8418_mux.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_MUX
+#error "muxbench needs TCA8418_FEATURE_MUX"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Cycles to microseconds */
+#define TO_US(cycles)   ((double)(cycles) / (TCA8418SIM_CPU_HZ / 1e6))
+
+/* Keypads, one per multiplexer channel */
+#define KEYPADS         TCA8418_MUX_CHANNELS
+
+/* Period of the main loop */
+#define LOOP_US         500U
+
+/* Bus clocks of one multiplexer write: address and control byte, START and STOP, as the simulator counts */
+#define MUX_CLOCKS      20U
+
+/* Main loop iterations after the last event before giving up on the rest */
+#define SETTLE_LOOPS    100U
+
+/* Bus speeds measured */
+static const uint32_t busSpeeds[] = { 100000, 400000 };
+
+/* Mean microseconds between two events, on any keypad */
+static const uint32_t gapUs[] = { 8000, 4000, 2000 };
+
+/**
+ * @brief Drain configuration
+ */
+typedef struct {
+    const char *name;
+    uint8_t cache;              //< 1 to skip selections of the connected channel
+    uint8_t schedule;           //< 1 to drain with TCA8418_Mux_DrainPending(), 0 in ascending order
+} Mode;
+
+static const Mode modes[] = {
+    {"uncached", 0, 0},
+    {"cached", 1, 0},
+    {"scheduled", 1, 1},
+};
+
+/* Events read back and misrouted in the current run */
+static uint32_t delivered[KEYPADS];
+static uint32_t misrouted;
+
+/**
+ * @brief Write the multiplexer control register
+ */
+static int Mux_Write(uint8_t mask){
+    return (HAL_I2C_Master_Transmit(&hi2c1, TCA8418SIM_MUX_ADDRESS << 1, &mask, 1, TCA8418_I2C_TIMEOUT) == HAL_OK) ? 0 : -1;
+}
+
+/**
+ * @brief Drain the keypad on the selected channel, its key codes name the channel
+ */
+static int Keypad_Drain(uint8_t channel, void *context){
+    uint8_t keyEvents[TCA8418_FIFO_DEPTH];
+    uint8_t numEvents;
+    (void)context;
+    if(TCA8418_ReadKeyEvents(keyEvents, &numEvents) != HAL_OK){
+        return -1;
+    }
+    for(uint8_t i = 0; i < numEvents; i++){
+        if((keyEvents[i] & 0x7FU) != channel + 1U){
+            misrouted++;
+        }
+    }
+    delivered[channel] += numEvents;
+    return 0;
+}
+
+/**
+ * @brief Get the keypads with INT asserted
+ * @return uint8_t Bit n set while the INT line of channel n is low
+ */
+static uint8_t PendingKeypads(void){
+    uint8_t pending = 0;
+    for(uint8_t channel = 0; channel < KEYPADS; channel++){
+        if(HAL_GPIO_ReadPin(TCA8418_INT_GPIO_Port, TCA8418SIM_INT_PIN(channel)) == GPIO_PIN_RESET){
+            pending |= (uint8_t)(1U << channel);
+        }
+    }
+    return pending;
+}
+
+/**
+ * @brief Run one configuration
+ * @param busHz Bus speed
+ * @param gap Mean microseconds between events
+ * @param mode Drain configuration
+ * @param events Events to schedule
+ * @return int 0 if every check passed, otherwise 1
+ */
+static int Run(uint32_t busHz, uint32_t gap, const Mode *mode, uint32_t events){
+    TCA8418_Mux mux;
+    TCA8418_MuxStats initStats;
+    TCA8418_MuxStats muxStats;
+    const TCA8418Sim_Stats *stats;
+    uint32_t scheduled[KEYPADS] = {0};
+    uint32_t total = 0;
+    uint32_t seed = 1;
+    uint64_t at = US(1000);
+    uint64_t last;
+    int errors = 0;
+    TCA8418Sim_Reset(busHz);
+    TCA8418Sim_SetChannels(KEYPADS);
+    TCA8418_Mux_Init(&mux, Mux_Write, mode->cache);
+    for(uint8_t channel = 0; channel < KEYPADS; channel++){
+        if((TCA8418_Mux_Select(&mux, channel) != 0) || (TCA8418_Init() != HAL_OK)){
+            fprintf(stderr, "keypad %u: initialization failed\n", channel);
+            return 1;
+        }
+    }
+    /* The CFG shadow is shared, so a keypad cannot leave latched mode on its own */
+    if((TCA8418_SetInterruptMode(TCA8418_INT_REASSERT) != HAL_ERROR) ||
+       (TCA8418_SetInterruptMode(TCA8418_INT_LATCHED) != HAL_OK)){
+        fprintf(stderr, "interrupt mode change not refused\n");
+        errors++;
+    }
+    /* Gaps uniform over 0 to twice the mean, each event on a random keypad */
+    for(uint32_t e = 0; e < events; e++){
+        uint8_t channel;
+        seed = seed * 1664525U + 1013904223U;
+        channel = (uint8_t)((seed >> 8) % KEYPADS);
+        seed = seed * 1664525U + 1013904223U;
+        at += US(1) + US((seed >> 8) % (2U * gap));
+        if(TCA8418Sim_ChannelKey(channel, at, (uint8_t)(((scheduled[channel] & 1U) ? 0x00 : 0x80) | (channel + 1U))) != 0){
+            fprintf(stderr, "event %lu not scheduled\n", (unsigned long)e);
+            return 1;
+        }
+        scheduled[channel]++;
+    }
+    last = at;
+    misrouted = 0;
+    for(uint8_t channel = 0; channel < KEYPADS; channel++){
+        delivered[channel] = 0;
+    }
+    TCA8418Sim_ClearStats();
+    TCA8418_Mux_GetStats(&mux, &initStats);
+    for(uint32_t settle = 0; settle < SETTLE_LOOPS; ){
+        uint8_t pending = PendingKeypads();
+        if(mode->schedule){
+            (void)TCA8418_Mux_DrainPending(&mux, pending, Keypad_Drain, NULL);
+        } else {
+            for(uint8_t channel = 0; channel < KEYPADS; channel++){
+                if((pending & (1U << channel)) && (TCA8418_Mux_Select(&mux, channel) == 0)){
+                    (void)Keypad_Drain(channel, NULL);
+                }
+            }
+        }
+        TCA8418Sim_Run(US(LOOP_US));
+        if(TCA8418Sim_Now() > last){
+            settle++;
+        }
+    }
+    stats = TCA8418Sim_GetStats();
+    TCA8418_Mux_GetStats(&mux, &muxStats);
+    muxStats.writes -= initStats.writes;
+    muxStats.errors -= initStats.errors;
+    for(uint8_t channel = 0; channel < KEYPADS; channel++){
+        if(delivered[channel] != scheduled[channel]){
+            fprintf(stderr, "keypad %u: %lu of %lu events read\n", channel, (unsigned long)delivered[channel],
+                    (unsigned long)scheduled[channel]);
+            errors++;
+        }
+        total += delivered[channel];
+    }
+    if((misrouted != 0) || (stats->eventsLost != 0) || (stats->eventsRead != total)){
+        fprintf(stderr, "%lu events from another keypad, %lu lost, %lu popped for %lu read\n",
+                (unsigned long)misrouted, (unsigned long)stats->eventsLost, (unsigned long)stats->eventsRead,
+                (unsigned long)total);
+        errors++;
+    }
+    if((muxStats.writes != stats->muxWrites) || (muxStats.errors != 0)){
+        fprintf(stderr, "%lu multiplexer writes issued, %lu on the bus, %lu failed\n", (unsigned long)muxStats.writes,
+                (unsigned long)stats->muxWrites, (unsigned long)muxStats.errors);
+        errors++;
+    }
+    if(total == 0){
+        return 1;
+    }
+    printf("%7lu %6lu %-10s %10.2f %10.1f %8.1f %11.1f %10.1f%s\n", (unsigned long)(busHz / 1000U),
+           (unsigned long)gap, mode->name, (double)stats->muxWrites / total,
+           (double)stats->busClocks * 1e6 / busHz / total, 100.0 * stats->muxWrites * MUX_CLOCKS / stats->busClocks,
+           TO_US(stats->latencySum) / stats->eventsRead, TO_US(stats->latencyMax), (errors != 0) ? " FAIL" : "");
+    return (errors != 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t events = 4000;
+    int failed = 0;
+    if(argc > 1){
+        events = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if((argc > 2) || (events == 0) || (events > KEYPADS * (TCA8418SIM_KEY_QUEUE - 1U) / 2U)){
+        fprintf(stderr, "usage: muxbench [events 1-%u]\n", KEYPADS * (TCA8418SIM_KEY_QUEUE - 1U) / 2U);
+        return 1;
+    }
+    printf("%u keypads, %lu single events on random keypads, INT lines polled every %u us\n", KEYPADS,
+           (unsigned long)events, LOOP_US);
+    printf("%7s %6s %-10s %10s %10s %8s %11s %10s\n", "bus kHz", "gap us", "mode", "mux/event", "bus us/ev",
+           "mux %", "latency us", "max us");
+    for(uint8_t s = 0; s < sizeof(busSpeeds) / sizeof(busSpeeds[0]); s++){
+        for(uint8_t g = 0; g < sizeof(gapUs) / sizeof(gapUs[0]); g++){
+            for(uint8_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++){
+                failed += Run(busSpeeds[s], gapUs[g], &modes[m], events);
+            }
+        }
+    }
+    return (failed != 0) ? 1 : 0;
+}
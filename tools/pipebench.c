@@ -0,0 +1,253 @@
+/**
+ * @file pipebench.c
+ * @brief Host benchmark of the fused event pipeline of tca8418_pipeline.h
+ * @details Runs the same stage chain, debounce, anti-ghost, keymap, long-press
+ *          and chord, over synthetic drained batches twice: fused with
+ *          TCA8418_PIPELINE() and sequentially, where every stage is a separate
+ *          pass over the batch called through a function pointer and compacting
+ *          the surviving events into a buffer. It checks that both produce the
+ *          same events and prints the time per event of each. Before that,
+ *          scripted batches check the debounce: a press and release drained
+ *          together both pass, chatter across drains is dropped and the first
+ *          edge of a key passes even at time 0.
+ *          Build: cc -O2 -I.. pipebench.c -o pipebench
+ *          Usage: pipebench [batches [batchSize]]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tca8418_pipeline.h"
+
+/* Largest batch, the TCA8418 FIFO depth */
+#define BATCH_MAX   10
+
+/**
+ * @brief States of the benchmarked stages
+ */
+typedef struct {
+    TCA8418_PipeDebounce debounce;
+    TCA8418_PipeAntiGhost antiGhost;
+    TCA8418_PipeKeymap keymap;
+    TCA8418_PipeLongPress longPress;
+    TCA8418_PipeChord chord;
+} Pipe;
+
+TCA8418_PIPELINE(Fused, Pipe,
+    TCA8418_STAGE(TCA8418_Pipe_Debounce, debounce) &&
+    TCA8418_STAGE(TCA8418_Pipe_AntiGhost, antiGhost) &&
+    TCA8418_STAGE(TCA8418_Pipe_Keymap, keymap) &&
+    TCA8418_STAGE(TCA8418_Pipe_LongPress, longPress) &&
+    TCA8418_STAGE(TCA8418_Pipe_Chord, chord))
+
+/* Sequential stages behind a common signature, as separate modules would be */
+static uint8_t Debounce(Pipe *pipe, TCA8418_PipeEvent *event){ return TCA8418_Pipe_Debounce(&pipe->debounce, event); }
+static uint8_t AntiGhost(Pipe *pipe, TCA8418_PipeEvent *event){ return TCA8418_Pipe_AntiGhost(&pipe->antiGhost, event); }
+static uint8_t Keymap(Pipe *pipe, TCA8418_PipeEvent *event){ return TCA8418_Pipe_Keymap(&pipe->keymap, event); }
+static uint8_t LongPress(Pipe *pipe, TCA8418_PipeEvent *event){ return TCA8418_Pipe_LongPress(&pipe->longPress, event); }
+static uint8_t Chord(Pipe *pipe, TCA8418_PipeEvent *event){ return TCA8418_Pipe_Chord(&pipe->chord, event); }
+
+static uint8_t (*volatile const stages[])(Pipe *, TCA8418_PipeEvent *) = {Debounce, AntiGhost, Keymap, LongPress, Chord};
+
+/**
+ * @brief Run the stages one pass each over a batch
+ * @return uint8_t Number of events stored in out
+ */
+static uint8_t Sequential(Pipe *pipe, const uint8_t *keyEvents, uint8_t numEvents, uint32_t now, TCA8418_PipeEvent *out){
+    TCA8418_PipeEvent buffer[BATCH_MAX];
+    uint8_t count = numEvents;
+    for(uint8_t i = 0; i < numEvents; i++){
+        TCA8418_Pipe_Decode(&buffer[i], keyEvents[i], now);
+    }
+    for(size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++){
+        uint8_t kept = 0;
+        for(uint8_t i = 0; i < count; i++){
+            if(stages[s](pipe, &buffer[i])){
+                buffer[kept++] = buffer[i];
+            }
+        }
+        count = kept;
+    }
+    memcpy(out, buffer, count * sizeof(buffer[0]));
+    return count;
+}
+
+/**
+ * @brief Reset the stage states
+ */
+static void Reset(Pipe *pipe, const uint16_t *codes, const TCA8418_PipeChordDef *chords, uint8_t numChords){
+    memset(pipe, 0, sizeof(*pipe));
+    pipe->debounce.debounceMs = 5;
+    pipe->keymap.codes = codes;
+    pipe->longPress.holdMs = 500;
+    pipe->chord.chords = chords;
+    pipe->chord.numChords = numChords;
+    pipe->chord.windowMs = 50;
+    pipe->chord.active = TCA8418_PIPE_NO_CHORD;
+}
+
+/**
+ * @brief One drained batch of a debounce script
+ */
+typedef struct {
+    uint32_t time;                  //< Drain time in milliseconds
+    uint8_t events[4];              //< FIFO bytes
+    uint8_t numEvents;              //< Events in the batch
+} Batch;
+
+/**
+ * @brief Debounce script and the events that must pass
+ */
+typedef struct {
+    const char *name;
+    Batch batches[4];
+    uint8_t numBatches;
+    uint8_t passed;                 //< Events expected out of the pipeline
+    uint8_t held;                   //< Expected state of key 5 afterwards
+} DebounceScript;
+
+/* Key 5 is in no chord, so the chord stage passes it unchanged */
+static const DebounceScript debounceScripts[] = {
+    { "press and release in one batch", { { 100, { 0x85, 0x05 }, 2 } }, 1, 2, 0 },
+    { "chatter in one batch", { { 100, { 0x85, 0x05, 0x85, 0x05 }, 4 } }, 1, 4, 0 },
+    { "chatter across batches", { { 100, { 0x85 }, 1 }, { 102, { 0x05 }, 1 }, { 103, { 0x85 }, 1 },
+                                  { 120, { 0x05 }, 1 } }, 4, 2, 0 },
+    { "edges debounceMs apart", { { 100, { 0x85 }, 1 }, { 105, { 0x05 }, 1 } }, 2, 2, 0 },
+    { "first press at time 0", { { 0, { 0x85 }, 1 }, { 3, { 0x05 }, 1 } }, 2, 1, 1 },
+};
+
+/**
+ * @brief Run the debounce scripts through both pipelines
+ * @return int Failed scripts
+ */
+static int CheckDebounce(const uint16_t *codes, const TCA8418_PipeChordDef *chords, uint8_t numChords){
+    static Pipe fusedPipe;
+    static Pipe sequentialPipe;
+    int failed = 0;
+    for(size_t i = 0; i < sizeof(debounceScripts) / sizeof(debounceScripts[0]); i++){
+        const DebounceScript *script = &debounceScripts[i];
+        uint8_t passed = 0;
+        uint8_t held = 0;
+        uint8_t same = 1;
+        Reset(&fusedPipe, codes, chords, numChords);
+        Reset(&sequentialPipe, codes, chords, numChords);
+        for(uint8_t b = 0; b < script->numBatches; b++){
+            const Batch *batch = &script->batches[b];
+            TCA8418_PipeEvent fusedOut[BATCH_MAX];
+            TCA8418_PipeEvent sequentialOut[BATCH_MAX];
+            uint8_t count = Fused(&fusedPipe, batch->events, batch->numEvents, batch->time, fusedOut);
+            if((Sequential(&sequentialPipe, batch->events, batch->numEvents, batch->time, sequentialOut) != count) ||
+               memcmp(fusedOut, sequentialOut, count * sizeof(fusedOut[0]))){
+                same = 0;
+            }
+            for(uint8_t e = 0; e < count; e++){
+                held = (fusedOut[e].flags & TCA8418_PIPE_PRESSED) ? 1 : 0;
+            }
+            passed += count;
+        }
+        if(!same || (passed != script->passed) || (held != script->held)){
+            printf("FAIL %s: %u events passed, key %s, expected %u events, key %s%s\n", script->name, passed,
+                   held ? "held" : "released", script->passed, script->held ? "held" : "released",
+                   same ? "" : ", pipelines differ");
+            failed++;
+        }else{
+            printf("ok   %s\n", script->name);
+        }
+    }
+    return failed;
+}
+
+/**
+ * @brief Get a monotonic time in nanoseconds
+ */
+static uint64_t Now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv){
+    static const TCA8418_PipeChordDef chords[] = {{0x101, 0x102, 0x200}, {0x103, 0x104, 0x201}};
+    static uint16_t codes[TCA8418_PIPE_KEYS];
+    static Pipe fusedPipe;
+    static Pipe sequentialPipe;
+    uint32_t batches = 1000000;
+    uint8_t batchSize = 4;
+    uint8_t *input;
+    uint8_t held[TCA8418_PIPE_KEYS] = {0};
+    uint32_t seed = 1;
+    uint64_t events = 0;
+    uint64_t start;
+    uint64_t fusedNs;
+    uint64_t sequentialNs;
+    uint64_t checksum = 0;
+    if(argc > 1){
+        batches = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2){
+        batchSize = (uint8_t)strtoul(argv[2], NULL, 0);
+    }
+    if((argc > 3) || (batches == 0) || (batchSize == 0) || (batchSize > BATCH_MAX)){
+        fprintf(stderr, "usage: pipebench [batches [batchSize 1-%d]]\n", BATCH_MAX);
+        return 1;
+    }
+    for(uint16_t key = 1; key <= 80; key++){
+        codes[key] = (uint16_t)(0x100 + key);
+    }
+    if(CheckDebounce(codes, chords, 2) != 0){
+        return 1;
+    }
+    /* Presses and releases of the 7 keypad keys of the default configuration, every batch 1 ms apart */
+    input = malloc((size_t)batches * batchSize);
+    if(input == NULL){
+        return 1;
+    }
+    for(uint32_t i = 0; i < batches * batchSize; i++){
+        uint8_t key;
+        seed = seed * 1664525U + 1013904223U;
+        key = (uint8_t)(1 + (seed >> 24) % 7);
+        held[key] ^= 1;
+        input[i] = (uint8_t)(key | (held[key] ? 0x80 : 0x00));
+    }
+    Reset(&fusedPipe, codes, chords, 2);
+    Reset(&sequentialPipe, codes, chords, 2);
+    for(uint32_t b = 0; b < batches; b++){
+        TCA8418_PipeEvent fusedOut[BATCH_MAX];
+        TCA8418_PipeEvent sequentialOut[BATCH_MAX];
+        uint8_t fusedCount = Fused(&fusedPipe, &input[b * batchSize], batchSize, b, fusedOut);
+        uint8_t sequentialCount = Sequential(&sequentialPipe, &input[b * batchSize], batchSize, b, sequentialOut);
+        if((fusedCount != sequentialCount) || memcmp(fusedOut, sequentialOut, fusedCount * sizeof(fusedOut[0]))){
+            fprintf(stderr, "outputs differ in batch %lu\n", (unsigned long)b);
+            return 1;
+        }
+        events += fusedCount;
+    }
+    Reset(&fusedPipe, codes, chords, 2);
+    start = Now();
+    for(uint32_t b = 0; b < batches; b++){
+        TCA8418_PipeEvent out[BATCH_MAX];
+        uint8_t count = Fused(&fusedPipe, &input[b * batchSize], batchSize, b, out);
+        checksum += count ? out[count - 1].code : 0;
+    }
+    fusedNs = Now() - start;
+    Reset(&sequentialPipe, codes, chords, 2);
+    start = Now();
+    for(uint32_t b = 0; b < batches; b++){
+        TCA8418_PipeEvent out[BATCH_MAX];
+        uint8_t count = Sequential(&sequentialPipe, &input[b * batchSize], batchSize, b, out);
+        checksum -= count ? out[count - 1].code : 0;
+    }
+    sequentialNs = Now() - start;
+    free(input);
+    printf("%lu batches of %u events, %lu events passed, outputs identical%s\n", (unsigned long)batches,
+           batchSize, (unsigned long)events, checksum ? " (checksum mismatch)" : "");
+    printf("fused      %8.2f ns/event\n", (double)fusedNs / ((double)batches * batchSize));
+    printf("sequential %8.2f ns/event\n", (double)sequentialNs / ((double)batches * batchSize));
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file powersim.c
+ * @brief Simulated check of the bus and energy budget model against the drains it models
+ * @details Runs the interrupt driven configurations of tools/busbudget.c
+ *          through the model of tca8418_power and through tca8418.c against
+ *          the simulator of tools/sim, with the deferred drain. Each drain
+ *          collects the configured number of events, scheduled together so
+ *          one drain reads them all. For every configuration and bus speed it
+ *          compares the bus time, the START conditions and the blocking
+ *          transaction time per event of the model with the busClocks,
+ *          reads, writes and blockingCycles counted by the simulator. The
+ *          blocking time of the simulator excludes the HAL overhead it charges
+ *          per blocking transaction, which the model counts as core cycles.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 powersim.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c ../tca8418_power.c -o powersim
+ *          Usage: powersim
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418.h"
+#include "tca8418_power.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_MODELS || !TCA8418_FEATURE_DEFERRED
+#error "powersim needs the full profile"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Drains measured per configuration */
+#define DRAINS          8
+
+/* Bus speeds measured */
+static const uint32_t busSpeeds[] = { 100000, 400000 };
+
+/* Interrupt driven rows of tools/busbudget.c */
+static const TCA8418_PowerConfig configs[] = {
+    {"interrupt per-register", TCA8418_POWER_PER_REGISTER, 0, 0, 1, 0},
+    {"interrupt burst", TCA8418_POWER_BURST, 0, 0, 1, 0},
+    {"interrupt burst latched", TCA8418_POWER_BURST, 1, 0, 1, 0},
+    {"interrupt IT", TCA8418_POWER_IT, 0, 0, 1, 0},
+    {"interrupt IT latched", TCA8418_POWER_IT, 1, 0, 1, 0},
+    {"interrupt DMA", TCA8418_POWER_DMA, 0, 0, 1, 0},
+    {"interrupt DMA latched", TCA8418_POWER_DMA, 1, 0, 1, 0},
+    {"interrupt per-reg x4", TCA8418_POWER_PER_REGISTER, 0, 0, 4, 0},
+    {"interrupt burst x4", TCA8418_POWER_BURST, 0, 0, 4, 0},
+    {"interrupt DMA x4", TCA8418_POWER_DMA, 0, 0, 4, 0},
+};
+
+/* MCU costs of the simulator: HAL overhead per transaction, nothing else is charged */
+static const TCA8418_PowerCpu simCpu = { TCA8418SIM_CPU_HZ, 0, TCA8418SIM_TRANSFER_CYCLES, 0 };
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin == TCA8418_INT_Pin){
+        TCA8418_IRQHandler();
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_ErrorCallback(hi2c);
+}
+
+/**
+ * @brief Measured cost of the drains of one configuration
+ */
+typedef struct {
+    uint64_t busClocks;         //< I2C clocks on the bus
+    uint64_t blockingCycles;    //< Core cycles waiting in blocking transactions, HAL overhead excluded
+    uint32_t starts;            //< START and repeated START conditions
+    uint32_t events;            //< Events delivered
+    uint32_t drains;            //< Drains started
+} Measured;
+
+/**
+ * @brief Drain the events of a configuration in the simulator
+ * @param config Configuration, its busHz set
+ * @param measured Pointer to store the cost of DRAINS drains
+ * @return int 0 if every drain read its events in one go, otherwise 1
+ */
+static int Measure(const TCA8418_PowerConfig *config, Measured *measured){
+    uint8_t events[TCA8418_RING_SIZE];
+    uint8_t numEvents;
+    TCA8418Sim_Reset(config->busHz);
+    if((TCA8418_Init() != HAL_OK) ||
+       (TCA8418_SetInterruptMode(config->latched ? TCA8418_INT_LATCHED : TCA8418_INT_REASSERT) != HAL_OK) ||
+       (TCA8418_SetDrainStrategy((TCA8418_DrainStrategy)config->drainStrategy) != HAL_OK)){
+        fprintf(stderr, "%s: initialization failed\n", config->name);
+        return 1;
+    }
+    /* Events left from the previous configuration */
+    TCA8418Sim_Run(US(5000));
+    (void)TCA8418_PopEvents(events, sizeof(events), &numEvents);
+    *measured = (Measured){0};
+    for(uint8_t d = 0; d < DRAINS; d++){
+        const TCA8418Sim_Stats *stats;
+        const TCA8418Sim_Transaction *log;
+        uint16_t count;
+        uint64_t now = TCA8418Sim_Now();
+        uint64_t blocking = 0;
+        TCA8418Sim_ClearStats();
+        for(uint8_t i = 0; i < config->eventsPerDrain; i++){
+            (void)TCA8418Sim_Key(now + 1U + i, (uint8_t)(((d & 1U) ? 0x00 : 0x80) | (i + 1U)));
+        }
+        TCA8418Sim_Run(US(10000));
+        stats = TCA8418Sim_GetStats();
+        count = TCA8418Sim_GetLog(&log);
+        for(uint8_t level = 0; level < TCA8418SIM_LEVELS; level++){
+            blocking += stats->blockingCycles[level];
+        }
+        for(uint16_t t = 0; t < count; t++){
+            if(!log[t].async){
+                blocking -= TCA8418SIM_TRANSFER_CYCLES;
+            }
+        }
+        (void)TCA8418_PopEvents(events, sizeof(events), &numEvents);
+        if((numEvents != config->eventsPerDrain) || (stats->handlerRuns[TCA8418SIM_PENDSV] != 1) ||
+           (count != stats->transactions)){
+            fprintf(stderr, "%s: %u events in %lu deferred runs and %lu transactions\n", config->name, numEvents,
+                    (unsigned long)stats->handlerRuns[TCA8418SIM_PENDSV], (unsigned long)stats->transactions);
+            return 1;
+        }
+        measured->busClocks += stats->busClocks;
+        measured->blockingCycles += blocking;
+        measured->starts += 2U * stats->reads + stats->writes;
+        measured->events += numEvents;
+        measured->drains++;
+    }
+    return 0;
+}
+
+int main(void){
+    int failed = 0;
+    printf("%-24s %7s %11s %11s %13s %13s %11s %11s\n", "configuration", "bus kHz", "model bus", "sim bus",
+           "model STARTs", "sim STARTs", "model block", "sim block");
+    for(uint8_t s = 0; s < sizeof(busSpeeds) / sizeof(busSpeeds[0]); s++){
+        for(uint8_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++){
+            TCA8418_PowerConfig config = configs[c];
+            TCA8418_PowerReport report;
+            Measured measured;
+            uint32_t busNs;
+            uint32_t startsX100;
+            uint32_t blockingNs;
+            config.busHz = busSpeeds[s];
+            TCA8418_Power_Model(&config, &simCpu, &report);
+            if(Measure(&config, &measured) != 0){
+                failed++;
+                continue;
+            }
+            /* Same rounding as the model: nanoseconds per event, truncated */
+            busNs = (uint32_t)((measured.busClocks * 1000000000ULL) / ((uint64_t)config.busHz * measured.events));
+            startsX100 = (measured.starts * 100U) / measured.events;
+            blockingNs = (uint32_t)((measured.blockingCycles * 1000000000ULL) / ((uint64_t)TCA8418SIM_CPU_HZ * measured.events));
+            printf("%-24s %7lu %11lu %11lu %10lu.%02lu %10lu.%02lu %11lu %11lu", config.name,
+                   (unsigned long)(config.busHz / 1000U), (unsigned long)report.busNsPerEvent, (unsigned long)busNs,
+                   (unsigned long)(report.startsPerEventX100 / 100U), (unsigned long)(report.startsPerEventX100 % 100U),
+                   (unsigned long)(startsX100 / 100U), (unsigned long)(startsX100 % 100U),
+                   (unsigned long)report.blockingNsPerEvent, (unsigned long)blockingNs);
+            if((busNs != report.busNsPerEvent) || (startsX100 != report.startsPerEventX100) ||
+               (blockingNs != report.blockingNsPerEvent)){
+                printf(" FAIL");
+                failed++;
+            }
+            printf("\n");
+        }
+    }
+    printf("times in ns per event over %u drains\n", DRAINS);
+    return (failed != 0) ? 1 : 0;
+}
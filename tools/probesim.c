@@ -0,0 +1,145 @@
+/**
+ * @file probesim.c
+ * @brief Simulated bus speed probe against cables with different reliable clocks
+ * @details Runs TCA8418_ProbeBus() against the simulator of tools/sim, which
+ *          corrupts every byte read above a reliable bus clock set with
+ *          TCA8418Sim_SetMaxReliableHz(). The bus starts at 100 kHz and
+ *          TCA8418_SetBusSpeed() is overridden to change hi2c1, as on a target.
+ *          For a reliable clock of 50 kHz, 100 kHz, 400 kHz and 1 MHz each run
+ *          checks that the probe selects the fastest passing speed, counts every
+ *          check of the first failing speed in probe.errors[] and none at the
+ *          speeds before it, leaves hi2c1 at the selected speed and restores the
+ *          probe register. It then initializes the driver at that speed and
+ *          checks that a key press is read back intact. Below the first speed
+ *          the probe must fail and leave hi2c1 at 100 kHz. It prints the errors
+ *          per speed, the selected and failed speeds and the margin between them.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 probesim.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o probesim
+ *          Usage: probesim
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_PROBE
+#error "probesim needs TCA8418_FEATURE_PROBE"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Register of the write and readback checks, GPIO_INT_LVL1 */
+#define REG_PROBE       0x26
+
+/* Key pressed once the driver runs at the selected speed */
+#define KEY_EVENT       0x81
+
+/* Speeds of TCA8418_ProbeBus() */
+static const uint32_t probeSpeeds[] = { TCA8418_PROBE_SPEEDS };
+
+/* Fastest clock each simulated cable reads without errors */
+static const uint32_t reliableHz[] = { 50000, 100000, 400000, 1000000 };
+
+/**
+ * @brief Set hi2c1 to a new speed, the simulator times and checks the next transactions with it
+ */
+HAL_StatusTypeDef TCA8418_SetBusSpeed(uint32_t hz){
+    hi2c1.Init.ClockSpeed = hz;
+    return HAL_OK;
+}
+
+/**
+ * @brief Probe a cable and use the bus at the selected speed
+ * @param reliable Fastest clock without read errors
+ * @return int 0 if the probe passed every check, otherwise 1
+ */
+static int Run(uint32_t reliable){
+    TCA8418_BusProbe probe;
+    HAL_StatusTypeDef status;
+    uint32_t expectedHz = 0;
+    uint32_t failingHz = 0;
+    uint8_t expectedTested = 0;
+    uint8_t events[TCA8418_FIFO_DEPTH];
+    uint8_t numEvents = 0;
+    int errors = 0;
+    TCA8418Sim_Reset(probeSpeeds[0]);
+    TCA8418Sim_SetMaxReliableHz(reliable);
+    /* The probe tests each speed in turn and stops at the first one that fails */
+    for(uint8_t s = 0; s < TCA8418_PROBE_SPEED_COUNT; s++){
+        expectedTested++;
+        if(probeSpeeds[s] > reliable){
+            failingHz = probeSpeeds[s];
+            break;
+        }
+        expectedHz = probeSpeeds[s];
+    }
+    status = TCA8418_ProbeBus(&probe);
+    if((status != ((expectedHz != 0) ? HAL_OK : HAL_ERROR)) || !probe.present || (probe.tested != expectedTested) ||
+       (probe.selectedHz != expectedHz) || (probe.failedHz != failingHz)){
+        fprintf(stderr, "%lu Hz: status %d, %u speeds tested, selected %lu Hz, failed %lu Hz\n", (unsigned long)reliable,
+                (int)status, probe.tested, (unsigned long)probe.selectedHz, (unsigned long)probe.failedHz);
+        errors++;
+    }
+    for(uint8_t s = 0; s < TCA8418_PROBE_SPEED_COUNT; s++){
+        uint16_t expected = ((s + 1U == expectedTested) && (failingHz != 0)) ? probe.checks : 0;
+        if(probe.errors[s] != expected){
+            fprintf(stderr, "%lu Hz: %u errors at %lu Hz, expected %u\n", (unsigned long)reliable, probe.errors[s],
+                    (unsigned long)probeSpeeds[s], expected);
+            errors++;
+        }
+    }
+    /* A failed probe leaves the initial speed, which is the one that failed */
+    if(hi2c1.Init.ClockSpeed != ((expectedHz != 0) ? expectedHz : probeSpeeds[0])){
+        fprintf(stderr, "%lu Hz: hi2c1 left at %lu Hz\n", (unsigned long)reliable, (unsigned long)hi2c1.Init.ClockSpeed);
+        errors++;
+    }
+    if(expectedHz != 0){
+        if(TCA8418Sim_Register(REG_PROBE) != 0){
+            fprintf(stderr, "%lu Hz: probe register left at 0x%02X\n", (unsigned long)reliable,
+                    TCA8418Sim_Register(REG_PROBE));
+            errors++;
+        }
+        /* The selected speed carries the driver's traffic intact */
+        (void)TCA8418Sim_Key(TCA8418Sim_Now() + US(10000), KEY_EVENT);
+        if(TCA8418_Init() != HAL_OK){
+            fprintf(stderr, "%lu Hz: initialization failed\n", (unsigned long)reliable);
+            errors++;
+        }
+        TCA8418Sim_Run(US(20000));
+        if((TCA8418_ReadKeyEvents(events, &numEvents) != HAL_OK) || (numEvents != 1) || (events[0] != KEY_EVENT)){
+            fprintf(stderr, "%lu Hz: %u events read at %lu Hz, expected the key press\n", (unsigned long)reliable,
+                    numEvents, (unsigned long)hi2c1.Init.ClockSpeed);
+            errors++;
+        }
+    }
+    printf("%9lu %6s", (unsigned long)reliable, (status == HAL_OK) ? "OK" : "ERROR");
+    for(uint8_t s = 0; s < TCA8418_PROBE_SPEED_COUNT; s++){
+        if(s < probe.tested){
+            printf(" %7u", probe.errors[s]);
+        } else {
+            printf(" %7s", "-");
+        }
+    }
+    printf(" %9lu %9lu %9lu %9lu%s\n", (unsigned long)probe.selectedHz, (unsigned long)probe.failedHz,
+           (unsigned long)(((probe.selectedHz != 0) && (probe.failedHz != 0)) ? probe.failedHz - probe.selectedHz : 0),
+           (unsigned long)hi2c1.Init.ClockSpeed, (errors != 0) ? " FAIL" : "");
+    return (errors != 0) ? 1 : 0;
+}
+
+int main(void){
+    int result = 0;
+    printf("%u checks per speed, errors per speed\n%9s %6s", TCA8418_PROBE_ROUNDS * 8U, "reliable", "status");
+    for(uint8_t s = 0; s < TCA8418_PROBE_SPEED_COUNT; s++){
+        printf(" %7lu", (unsigned long)probeSpeeds[s]);
+    }
+    printf(" %9s %9s %9s %9s\n", "selected", "failed", "margin", "hi2c1");
+    for(uint8_t r = 0; r < sizeof(reliableHz) / sizeof(reliableHz[0]); r++){
+        result |= Run(reliableHz[r]);
+    }
+    return result;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file main.h
+ * @brief Host stand-in for the STM32Cube main.h used by the simulator tools
+ * @details Declares the subset of the HAL, CMSIS and board definitions the
+ *          driver uses. The functions are implemented by tca8418sim.c against
+ *          a simulated TCA8418, so tca8418.c builds unchanged on the host.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint16_t, uint32_t */
+#include <stdint.h>
+/* For NULL */
+#include <stddef.h>
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+    uint32_t ClockSpeed;        //< I2C clock frequency in Hz
+} I2C_InitTypeDef;
+
+typedef struct {
+    I2C_InitTypeDef Init;
+    volatile uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    uint32_t IDR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+#define I2C_MEMADD_SIZE_8BIT    0x00000001U
+#define HAL_I2C_ERROR_NONE      0x00000000U
+#define HAL_I2C_ERROR_AF        0x00000004U
+#define HAL_MAX_DELAY           0xFFFFFFFFU
+
+#define __weak                  __attribute__((weak))
+#define __ALIGNED(x)            __attribute__((aligned(x)))
+#define __DSB()                 __sync_synchronize()
+#define __DMB()                 __sync_synchronize()
+
+/* TCA8418 INT line, read by the driver while it schedules GPIO output frames. Behind the
+   simulated multiplexer channel n uses TCA8418_INT_Pin << n */
+extern GPIO_TypeDef simIntPort;
+#define TCA8418_INT_GPIO_Port   (&simIntPort)
+#define TCA8418_INT_Pin         0x0001U
+
+/* PendSV pending bit, the simulator runs PendSV_Handler() when it is set */
+typedef struct {
+    volatile uint32_t ICSR;
+} SCB_Type;
+extern SCB_Type simScb;
+#define SCB                     (&simScb)
+#define SCB_ICSR_PENDSVSET_Msk  (1UL << 28)
+
+typedef int IRQn_Type;
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+
+/* Interrupt masking, the simulator never interrupts code that masked interrupts */
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+void __enable_irq(void);
+
+/* Active exception number: 0 in the main loop, 14 in PendSV, 16 and up in EXTI and I2C interrupts */
+uint32_t __get_IPSR(void);
+
+extern uint32_t SystemCoreClock;
+extern I2C_HandleTypeDef hi2c1;
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                   uint8_t *pData, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                    uint8_t *pData, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                      uint8_t *pData, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                       uint8_t *pData, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                       uint8_t *pData, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint8_t *pData, uint16_t size,
+                                          uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint32_t trials, uint32_t timeout);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_GetTick(void);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+
+/* Callbacks the application defines, weak and empty in the simulator */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+void HAL_GPIO_EXTI_Callback(uint16_t pin);
+void PendSV_Handler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,825 @@
+/**
+ * @file tca8418sim.c
+ * @brief Host simulator of the TCA8418 on an I2C bus, for the tools
+ * @details This file contains the register model, the event scheduler and the
+ *          HAL functions of tools/sim/main.h. Register accesses of a
+ *          transaction take effect when its bus time has passed, so events
+ *          arriving during a FIFO read stay in the FIFO and events arriving
+ *          before an INT_STAT clear are seen by it. Behind the multiplexer each
+ *          channel has its own TCA8418, and a transaction reaches the one on
+ *          the connected channel.
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include "tca8418sim.h"
+
+/* Registers of the model */
+#define REG_CFG         0x01
+#define REG_INT_STAT    0x02
+#define REG_KEY_LCK_EC  0x03
+#define REG_KEY_EVENT_A 0x04
+#define REG_GPIO_DAT_STAT1 0x14
+#define REG_GPIO_DAT_OUT1  0x17
+#define REG_KP_GPIO1    0x1D
+#define REG_GPIO_DIR1   0x23
+#define REG_COUNT       0x2F
+
+/* CFG bits */
+#define CFG_AI          0x80
+#define CFG_INT_CFG     0x10
+#define CFG_OVR_FLOW_IEN 0x08
+#define CFG_KE_IEN      0x01
+
+/* Bit flipped in every byte read above the reliable bus clock */
+#define READ_ERROR_BIT  0x10
+
+/* INT_STAT bits */
+#define STAT_OVR_FLOW   0x08
+#define STAT_K_INT      0x01
+
+#define FIFO_DEPTH      10
+
+/* Completion of an IT or DMA transfer waiting for its interrupt */
+#define I2C_IRQ_NONE    0
+#define I2C_IRQ_RX      1
+#define I2C_IRQ_TX      2
+#define I2C_IRQ_ERROR   3
+
+/**
+ * @brief State of one simulated TCA8418
+ */
+typedef struct {
+    uint8_t attached;
+    uint8_t regs[REG_COUNT];
+    uint8_t fifo[FIFO_DEPTH];
+    uint64_t fifoTime[FIFO_DEPTH];      //< Arrival of each FIFO entry
+    uint8_t fifoCount;
+    uint64_t intHighUntil;              //< End of the reassert pulse, 0 if none
+    uint8_t intLow;                     //< INT level last seen, 1 while asserted
+    uint64_t keyTime[TCA8418SIM_KEY_QUEUE];
+    uint8_t keyEvent[TCA8418SIM_KEY_QUEUE];
+    uint16_t keyHead;
+    uint16_t keyCount;
+} SimChip;
+
+/**
+ * @brief State of the simulation
+ */
+typedef struct {
+    uint64_t now;                       //< Core cycles
+    SimChip chips[TCA8418SIM_CHANNELS]; //< The TCA8418 of each channel, only chips[0] without a multiplexer
+    uint8_t channels;                   //< Channels of the multiplexer with a TCA8418, 0 without a multiplexer
+    uint8_t muxMask;                    //< Channels connected by the multiplexer
+    uint32_t maxReliableHz;             //< Fastest bus clock without read errors, 0 for no limit
+    uint8_t pendingExti;                //< Channels with an INT edge waiting for the EXTI interrupt
+    uint8_t pendingI2C;                 //< I2C_IRQ_* completion waiting for its interrupt
+    uint8_t busLocked;                  //< A transfer holds hi2c1
+    uint8_t asyncActive;
+    SimChip *asyncChip;                 //< TCA8418 of the transfer in flight, NULL if none answers
+    uint8_t asyncWrite;
+    uint8_t asyncReg;
+    uint8_t *asyncData;
+    uint16_t asyncLength;
+    uint64_t asyncDone;
+    TCA8418Sim_Level level;
+    uint32_t primask;
+    uint32_t handlerCycles;             //< Blocking wait of the running handler
+    TCA8418Sim_Stats stats;
+    TCA8418Sim_Transaction log[TCA8418SIM_LOG_SIZE];
+    uint16_t logCount;
+} Sim;
+
+static Sim sim;
+
+I2C_HandleTypeDef hi2c1;
+uint32_t SystemCoreClock = TCA8418SIM_CPU_HZ;
+SCB_Type simScb;
+GPIO_TypeDef simIntPort;
+
+static void SimDispatch(void);
+
+/**
+ * @brief Convert I2C clocks to core cycles, rounded up
+ * @note The clock is read from hi2c1, so a TCA8418_SetBusSpeed() override can change it.
+ */
+static uint64_t SimCycles(uint32_t clocks){
+    uint32_t busHz = hi2c1.Init.ClockSpeed;
+    return ((uint64_t)clocks * TCA8418SIM_CPU_HZ + busHz - 1U) / busHz;
+}
+
+/**
+ * @brief Number of simulated TCA8418s
+ */
+static uint8_t SimChipCount(void){
+    return (sim.channels != 0) ? sim.channels : 1U;
+}
+
+/**
+ * @brief TCA8418 answering at 0x34: the only one, or the one on the single connected channel
+ * @return SimChip* Chip, NULL when no channel or more than one is connected
+ */
+static SimChip *SimRouted(void){
+    if(sim.channels == 0){
+        return &sim.chips[0];
+    }
+    for(uint8_t channel = 0; channel < sim.channels; channel++){
+        if(sim.muxMask == (1U << channel)){
+            return &sim.chips[channel];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check whether the chip asserts INT, ignoring the reassert pulse
+ */
+static uint8_t SimIntPending(const SimChip *chip){
+    uint8_t stat = chip->regs[REG_INT_STAT];
+    uint8_t cfg = chip->regs[REG_CFG];
+    if(!chip->attached){
+        return 0;
+    }
+    return ((stat & STAT_K_INT) && (cfg & CFG_KE_IEN)) || ((stat & STAT_OVR_FLOW) && (cfg & CFG_OVR_FLOW_IEN));
+}
+
+/**
+ * @brief Update the INT line and latch a falling edge for the EXTI interrupt
+ */
+static void SimUpdateInt(SimChip *chip){
+    uint8_t low = SimIntPending(chip) && (sim.now >= chip->intHighUntil);
+    if(low && !chip->intLow){
+        sim.stats.edges++;
+        sim.pendingExti |= (uint8_t)(1U << (chip - sim.chips));
+    }
+    chip->intLow = low;
+}
+
+/**
+ * @brief Key event reaching the chip
+ */
+static void SimQueueEvent(SimChip *chip, uint8_t event){
+    if(!chip->attached || ((chip->regs[REG_KP_GPIO1] | chip->regs[REG_KP_GPIO1 + 1] | chip->regs[REG_KP_GPIO1 + 2]) == 0)){
+        sim.stats.eventsLost++;
+        return;
+    }
+    if(chip->fifoCount == FIFO_DEPTH){
+        /* CFG.OVR_FLOW_M = 0: the new event is discarded */
+        chip->regs[REG_INT_STAT] |= STAT_OVR_FLOW;
+        sim.stats.eventsLost++;
+    } else {
+        chip->fifo[chip->fifoCount] = event;
+        chip->fifoTime[chip->fifoCount] = sim.now;
+        chip->fifoCount++;
+        sim.stats.eventsQueued++;
+    }
+    chip->regs[REG_INT_STAT] |= STAT_K_INT;
+    SimUpdateInt(chip);
+}
+
+/**
+ * @brief Register read by a transaction
+ */
+static uint8_t SimReadRegister(SimChip *chip, uint8_t reg){
+    uint8_t value;
+    switch(reg){
+    case REG_KEY_EVENT_A:
+        if(chip->fifoCount == 0){
+            return 0;
+        }
+        value = chip->fifo[0];
+        {
+            uint64_t latency = sim.now - chip->fifoTime[0];
+            sim.stats.eventsRead++;
+            sim.stats.latencySum += latency;
+            if(latency > sim.stats.latencyMax){
+                sim.stats.latencyMax = (uint32_t)latency;
+            }
+        }
+        for(uint8_t i = 1; i < chip->fifoCount; i++){
+            chip->fifo[i - 1] = chip->fifo[i];
+            chip->fifoTime[i - 1] = chip->fifoTime[i];
+        }
+        chip->fifoCount--;
+        return value;
+    case REG_KEY_LCK_EC:
+        return (uint8_t)((chip->regs[REG_KEY_LCK_EC] & 0xF0) | chip->fifoCount);
+    case REG_GPIO_DAT_STAT1:
+    case REG_GPIO_DAT_STAT1 + 1:
+    case REG_GPIO_DAT_STAT1 + 2: {
+        /* Outputs read their level, inputs are pulled up */
+        uint8_t i = (uint8_t)(reg - REG_GPIO_DAT_STAT1);
+        uint8_t dir = chip->regs[REG_GPIO_DIR1 + i];
+        return (uint8_t)((chip->regs[REG_GPIO_DAT_OUT1 + i] & dir) | (uint8_t)~dir);
+    }
+    default:
+        return (reg < REG_COUNT) ? chip->regs[reg] : 0;
+    }
+}
+
+/**
+ * @brief Register write by a transaction
+ */
+static void SimWriteRegister(SimChip *chip, uint8_t reg, uint8_t value){
+    switch(reg){
+    case REG_INT_STAT:
+        chip->regs[REG_INT_STAT] &= (uint8_t)~value;
+        if(chip->fifoCount > 0){
+            /* Events still pending keep KE_INT set */
+            chip->regs[REG_INT_STAT] |= STAT_K_INT;
+        }
+        if((chip->regs[REG_CFG] & CFG_INT_CFG) && SimIntPending(chip)){
+            /* Reassert mode: INT deasserts for 50 us and asserts again with a new edge */
+            chip->intHighUntil = sim.now + TCA8418SIM_REASSERT_CYCLES;
+        }
+        break;
+    case REG_KEY_LCK_EC:
+    case REG_KEY_EVENT_A:
+        break;
+    default:
+        if(reg < REG_COUNT){
+            chip->regs[reg] = value;
+        }
+        break;
+    }
+    SimUpdateInt(chip);
+}
+
+/**
+ * @brief Apply the register accesses of a transaction, CFG.AI selecting the address increment
+ */
+static void SimAccess(SimChip *chip, uint8_t write, uint8_t reg, uint8_t *data, uint16_t length){
+    uint8_t increment = (chip->regs[REG_CFG] & CFG_AI) ? 1 : 0;
+    for(uint16_t i = 0; i < length; i++){
+        if(write){
+            SimWriteRegister(chip, reg, data[i]);
+        } else {
+            data[i] = SimReadRegister(chip, reg);
+            if((sim.maxReliableHz != 0) && (hi2c1.Init.ClockSpeed > sim.maxReliableHz)){
+                data[i] ^= READ_ERROR_BIT;
+            }
+        }
+        reg = (uint8_t)(reg + increment);
+    }
+}
+
+/**
+ * @brief Count and log a transaction
+ */
+static void SimLog(uint8_t write, uint8_t reg, uint16_t length, uint8_t async, uint32_t clocks, uint8_t mux){
+    sim.stats.transactions++;
+    sim.stats.busClocks += clocks;
+    if(mux){
+        sim.stats.muxWrites++;
+    } else if(length > 0){
+        if(write){
+            sim.stats.writes++;
+        } else {
+            sim.stats.reads++;
+        }
+    }
+    if(sim.logCount < TCA8418SIM_LOG_SIZE){
+        TCA8418Sim_Transaction *entry = &sim.log[sim.logCount++];
+        entry->cycles = sim.now;
+        entry->write = write;
+        entry->reg = reg;
+        entry->length = (uint8_t)length;
+        entry->async = async;
+        entry->level = (uint8_t)sim.level;
+        entry->mux = mux;
+    }
+}
+
+/**
+ * @brief Bus clocks of a transaction, address only when nothing acknowledges
+ */
+static uint32_t SimClocks(const SimChip *chip, uint8_t write, uint16_t length, uint8_t probe){
+    if(probe || (chip == NULL) || !chip->attached){
+        return 9U + 2U;
+    }
+    return write ? (9U * (2U + length) + 2U) : (9U * (3U + length) + 3U);
+}
+
+/**
+ * @brief Complete the IT or DMA transfer in flight
+ */
+static void SimAsyncComplete(void){
+    sim.asyncActive = 0;
+    sim.busLocked = 0;
+    if((sim.asyncChip == NULL) || !sim.asyncChip->attached){
+        hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+        sim.pendingI2C = I2C_IRQ_ERROR;
+        return;
+    }
+    SimAccess(sim.asyncChip, sim.asyncWrite, sim.asyncReg, sim.asyncData, sim.asyncLength);
+    sim.pendingI2C = sim.asyncWrite ? I2C_IRQ_TX : I2C_IRQ_RX;
+}
+
+/**
+ * @brief Advance time to end, applying key events, completions and INT changes as they become due
+ */
+static void SimAdvance(uint64_t end){
+    for(;;){
+        uint64_t next = end;
+        SimDispatch();
+        for(uint8_t c = 0; c < SimChipCount(); c++){
+            const SimChip *chip = &sim.chips[c];
+            if((chip->keyCount > 0) && (chip->keyTime[chip->keyHead] < next)){
+                next = chip->keyTime[chip->keyHead];
+            }
+            if((chip->intHighUntil != 0) && (chip->intHighUntil < next)){
+                next = chip->intHighUntil;
+            }
+        }
+        if(sim.asyncActive && (sim.asyncDone < next)){
+            next = sim.asyncDone;
+        }
+        if(next > sim.now){
+            sim.now = next;
+        }
+        for(uint8_t c = 0; c < SimChipCount(); c++){
+            SimChip *chip = &sim.chips[c];
+            while((chip->keyCount > 0) && (chip->keyTime[chip->keyHead] <= sim.now)){
+                SimQueueEvent(chip, chip->keyEvent[chip->keyHead]);
+                chip->keyHead = (uint16_t)((chip->keyHead + 1) % TCA8418SIM_KEY_QUEUE);
+                chip->keyCount--;
+            }
+        }
+        if(sim.asyncActive && (sim.asyncDone <= sim.now)){
+            SimAsyncComplete();
+        }
+        for(uint8_t c = 0; c < SimChipCount(); c++){
+            SimChip *chip = &sim.chips[c];
+            if((chip->intHighUntil != 0) && (chip->intHighUntil <= sim.now)){
+                chip->intHighUntil = 0;
+                SimUpdateInt(chip);
+            }
+        }
+        if(sim.now >= end){
+            SimDispatch();
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Run a handler at a priority and record its blocking wait
+ */
+static void SimHandler(TCA8418Sim_Level level, uint8_t source, uint8_t channel){
+    TCA8418Sim_Level saved = sim.level;
+    uint32_t savedCycles = sim.handlerCycles;
+    sim.level = level;
+    sim.handlerCycles = 0;
+    sim.stats.handlerRuns[level]++;
+    switch(source){
+    case I2C_IRQ_RX:
+        HAL_I2C_MemRxCpltCallback(&hi2c1);
+        break;
+    case I2C_IRQ_TX:
+        HAL_I2C_MemTxCpltCallback(&hi2c1);
+        break;
+    case I2C_IRQ_ERROR:
+        HAL_I2C_ErrorCallback(&hi2c1);
+        break;
+    default:
+        if(level == TCA8418SIM_PENDSV){
+            PendSV_Handler();
+        } else {
+            HAL_GPIO_EXTI_Callback(TCA8418SIM_INT_PIN(channel));
+        }
+        break;
+    }
+    if(sim.handlerCycles > sim.stats.maxHandlerCycles[level]){
+        sim.stats.maxHandlerCycles[level] = sim.handlerCycles;
+    }
+    sim.level = saved;
+    sim.handlerCycles = savedCycles;
+}
+
+/**
+ * @brief Run the pending interrupts of higher priority than the running code
+ */
+static void SimDispatch(void){
+    for(;;){
+        if(sim.primask){
+            return;
+        }
+        if((sim.level < TCA8418SIM_ISR) && sim.pendingExti){
+            uint8_t channel = 0;
+            while(!(sim.pendingExti & (1U << channel))){
+                channel++;
+            }
+            sim.pendingExti &= (uint8_t)~(1U << channel);
+            SimHandler(TCA8418SIM_ISR, I2C_IRQ_NONE, channel);
+            continue;
+        }
+        if((sim.level < TCA8418SIM_ISR) && (sim.pendingI2C != I2C_IRQ_NONE)){
+            uint8_t source = sim.pendingI2C;
+            sim.pendingI2C = I2C_IRQ_NONE;
+            SimHandler(TCA8418SIM_ISR, source, 0);
+            continue;
+        }
+        if((sim.level < TCA8418SIM_PENDSV) && (simScb.ICSR & SCB_ICSR_PENDSVSET_Msk)){
+            simScb.ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+            SimHandler(TCA8418SIM_PENDSV, I2C_IRQ_NONE, 0);
+            continue;
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Blocking transaction, the caller waits for its bus time while interrupts preempt it
+ */
+static HAL_StatusTypeDef SimBlocking(uint8_t write, uint16_t reg, uint8_t *data, uint16_t length, uint8_t probe){
+    uint32_t clocks;
+    uint64_t cycles;
+    SimChip *chip;
+    SimDispatch();
+    if(sim.busLocked){
+        sim.stats.busyReturns++;
+        return HAL_BUSY;
+    }
+    sim.busLocked = 1;
+    hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+    chip = SimRouted();
+    clocks = SimClocks(chip, write, length, probe);
+    cycles = SimCycles(clocks) + TCA8418SIM_TRANSFER_CYCLES;
+    SimLog(write, (uint8_t)reg, probe ? 0 : length, 0, clocks, 0);
+    sim.stats.blockingCycles[sim.level] += cycles;
+    sim.handlerCycles += (uint32_t)cycles;
+    SimAdvance(sim.now + cycles);
+    sim.busLocked = 0;
+    if((chip == NULL) || !chip->attached){
+        hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+        return HAL_ERROR;
+    }
+    if(!probe){
+        SimAccess(chip, write, (uint8_t)reg, data, length);
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Blocking write of the multiplexer control register, the last byte selects the channels
+ */
+static HAL_StatusTypeDef SimMuxWrite(uint8_t *data, uint16_t length){
+    uint32_t clocks;
+    uint64_t cycles;
+    SimDispatch();
+    if(sim.busLocked){
+        sim.stats.busyReturns++;
+        return HAL_BUSY;
+    }
+    sim.busLocked = 1;
+    hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+    clocks = (sim.channels != 0) ? (9U * (1U + length) + 2U) : (9U + 2U);
+    cycles = SimCycles(clocks) + TCA8418SIM_TRANSFER_CYCLES;
+    SimLog(1, (length > 0) ? data[length - 1] : 0, length, 0, clocks, 1);
+    sim.stats.blockingCycles[sim.level] += cycles;
+    sim.handlerCycles += (uint32_t)cycles;
+    SimAdvance(sim.now + cycles);
+    sim.busLocked = 0;
+    if((sim.channels == 0) || (length == 0)){
+        hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+        return HAL_ERROR;
+    }
+    sim.muxMask = data[length - 1];
+    return HAL_OK;
+}
+
+/**
+ * @brief Start an IT or DMA transfer, completed by its interrupt
+ */
+static HAL_StatusTypeDef SimAsync(uint8_t write, uint16_t reg, uint8_t *data, uint16_t length){
+    uint32_t clocks;
+    SimDispatch();
+    if(sim.busLocked){
+        sim.stats.busyReturns++;
+        return HAL_BUSY;
+    }
+    sim.busLocked = 1;
+    hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+    sim.asyncChip = SimRouted();
+    clocks = SimClocks(sim.asyncChip, write, length, 0);
+    SimLog(write, (uint8_t)reg, length, 1, clocks, 0);
+    sim.asyncActive = 1;
+    sim.asyncWrite = write;
+    sim.asyncReg = (uint8_t)reg;
+    sim.asyncData = data;
+    sim.asyncLength = length;
+    sim.asyncDone = sim.now + SimCycles(clocks);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                   uint8_t *pData, uint16_t size, uint32_t timeout){
+    (void)hi2c;
+    (void)devAddress;
+    (void)memAddSize;
+    (void)timeout;
+    return SimBlocking(0, memAddress, pData, size, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                    uint8_t *pData, uint16_t size, uint32_t timeout){
+    (void)hi2c;
+    (void)devAddress;
+    (void)memAddSize;
+    (void)timeout;
+    return SimBlocking(1, memAddress, pData, size, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                      uint8_t *pData, uint16_t size){
+    (void)hi2c;
+    (void)devAddress;
+    (void)memAddSize;
+    return SimAsync(0, memAddress, pData, size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                       uint8_t *pData, uint16_t size){
+    (void)hi2c;
+    (void)devAddress;
+    (void)memAddSize;
+    return SimAsync(1, memAddress, pData, size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress, uint16_t memAddSize,
+                                       uint8_t *pData, uint16_t size){
+    (void)hi2c;
+    (void)devAddress;
+    (void)memAddSize;
+    return SimAsync(0, memAddress, pData, size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint8_t *pData, uint16_t size,
+                                          uint32_t timeout){
+    (void)hi2c;
+    (void)timeout;
+    if((devAddress >> 1) != TCA8418SIM_MUX_ADDRESS){
+        /* Only the multiplexer is written without a register address */
+        hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+        return HAL_ERROR;
+    }
+    return SimMuxWrite(pData, size);
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint32_t trials, uint32_t timeout){
+    HAL_StatusTypeDef status = HAL_ERROR;
+    (void)hi2c;
+    (void)devAddress;
+    (void)timeout;
+    for(uint32_t i = 0; (i < trials) && (status != HAL_OK); i++){
+        status = SimBlocking(0, 0, NULL, 0, 1);
+        if(status == HAL_BUSY){
+            return HAL_BUSY;
+        }
+    }
+    return status;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c){
+    return hi2c->ErrorCode;
+}
+
+uint32_t HAL_GetTick(void){
+    return (uint32_t)(sim.now / (TCA8418SIM_CPU_HZ / 1000U));
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin){
+    (void)port;
+    for(uint8_t c = 0; c < SimChipCount(); c++){
+        if(pin == TCA8418SIM_INT_PIN(c)){
+            return sim.chips[c].intLow ? GPIO_PIN_RESET : GPIO_PIN_SET;
+        }
+    }
+    return GPIO_PIN_SET;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irq){
+    (void)irq;
+    simScb.ICSR |= SCB_ICSR_PENDSVSET_Msk;
+}
+
+uint32_t __get_PRIMASK(void){
+    return sim.primask;
+}
+
+void __set_PRIMASK(uint32_t primask){
+    sim.primask = primask;
+    if(!primask){
+        SimDispatch();
+    }
+}
+
+void __disable_irq(void){
+    sim.primask = 1;
+}
+
+void __enable_irq(void){
+    __set_PRIMASK(0);
+}
+
+uint32_t __get_IPSR(void){
+    static const uint32_t exceptions[TCA8418SIM_LEVELS] = {
+        [TCA8418SIM_THREAD] = 0,
+        [TCA8418SIM_PENDSV] = 14,
+        [TCA8418SIM_ISR]    = 16,
+    };
+    return exceptions[sim.level];
+}
+
+/**
+ * @brief Cycle counter of the simulated core, replaces the weak driver function
+ */
+uint32_t TCA8418_GetCycles(void){
+    return (uint32_t)sim.now;
+}
+
+__weak void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+}
+
+__weak void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    (void)pin;
+}
+
+__weak void PendSV_Handler(void){
+}
+
+/**
+ * @brief Power up the simulated TCA8418 and reset time and counters
+ * @param busHz I2C clock frequency
+ */
+void TCA8418Sim_Reset(uint32_t busHz){
+    sim = (Sim){0};
+    for(uint8_t c = 0; c < TCA8418SIM_CHANNELS; c++){
+        sim.chips[c].attached = 1;
+    }
+    sim.level = TCA8418SIM_THREAD;
+    hi2c1 = (I2C_HandleTypeDef){0};
+    hi2c1.Init.ClockSpeed = busHz;
+    simScb.ICSR = 0;
+    SystemCoreClock = TCA8418SIM_CPU_HZ;
+}
+
+/**
+ * @brief Get the current time
+ * @return uint64_t Core cycles since TCA8418Sim_Reset()
+ */
+uint64_t TCA8418Sim_Now(void){
+    return sim.now;
+}
+
+/**
+ * @brief Schedule a key event
+ * @param cycles Time of the event, not earlier than the previously scheduled one
+ * @param event Key event byte, bit 7 set for a press
+ * @return int 0 if scheduled, -1 if the queue is full or the time goes backwards
+ */
+int TCA8418Sim_Key(uint64_t cycles, uint8_t event){
+    return TCA8418Sim_ChannelKey(0, cycles, event);
+}
+
+/**
+ * @brief Schedule a key event on the TCA8418 of a multiplexer channel
+ * @param channel Channel of the TCA8418
+ * @param cycles Time of the event, not earlier than the previously scheduled one on that channel
+ * @param event Key event byte, bit 7 set for a press
+ * @return int 0 if scheduled, -1 if the channel has no TCA8418, the queue is full or the time goes backwards
+ */
+int TCA8418Sim_ChannelKey(uint8_t channel, uint64_t cycles, uint8_t event){
+    SimChip *chip;
+    uint16_t tail;
+    uint16_t last;
+    if(channel >= SimChipCount()){
+        return -1;
+    }
+    chip = &sim.chips[channel];
+    tail = (uint16_t)((chip->keyHead + chip->keyCount) % TCA8418SIM_KEY_QUEUE);
+    last = (uint16_t)((tail + TCA8418SIM_KEY_QUEUE - 1) % TCA8418SIM_KEY_QUEUE);
+    if((chip->keyCount == TCA8418SIM_KEY_QUEUE) || ((chip->keyCount > 0) && (cycles < chip->keyTime[last]))){
+        return -1;
+    }
+    chip->keyTime[tail] = cycles;
+    chip->keyEvent[tail] = event;
+    chip->keyCount++;
+    return 0;
+}
+
+/**
+ * @brief Let time pass in the calling code, running the interrupts that become due
+ * @param cycles Cycles to pass, 0 only runs the interrupts already pending
+ */
+void TCA8418Sim_Run(uint64_t cycles){
+    SimAdvance(sim.now + cycles);
+}
+
+/**
+ * @brief Plug or unplug the simulated TCA8418
+ * @param attached 1 to plug in, powering up with reset register values, 0 to unplug
+ */
+void TCA8418Sim_Attach(uint8_t attached){
+    SimChip *chip = &sim.chips[0];
+    for(uint8_t i = 0; i < REG_COUNT; i++){
+        chip->regs[i] = 0;
+    }
+    chip->fifoCount = 0;
+    chip->intHighUntil = 0;
+    chip->attached = attached ? 1 : 0;
+    SimUpdateInt(chip);
+}
+
+/**
+ * @brief Put TCA8418s behind a simulated TCA9548A, one per channel
+ * @param channels Channels with a TCA8418, 0 for the single TCA8418 directly on the bus
+ */
+void TCA8418Sim_SetChannels(uint8_t channels){
+    sim.channels = (channels > TCA8418SIM_CHANNELS) ? TCA8418SIM_CHANNELS : channels;
+    sim.muxMask = 0;
+}
+
+/**
+ * @brief Set the fastest bus clock at which reads return correct data
+ * @param hz Bus clock in Hz, 0 for no limit
+ */
+void TCA8418Sim_SetMaxReliableHz(uint32_t hz){
+    sim.maxReliableHz = hz;
+}
+
+/**
+ * @brief Read a register of the simulated TCA8418 without a transaction
+ * @param reg Register address
+ * @return uint8_t Register value, KEY_EVENT_A is not popped
+ */
+uint8_t TCA8418Sim_Register(uint8_t reg){
+    SimChip *chip = &sim.chips[0];
+    if(reg == REG_KEY_EVENT_A){
+        return (chip->fifoCount > 0) ? chip->fifo[0] : 0;
+    }
+    if(reg == REG_KEY_LCK_EC){
+        return SimReadRegister(chip, reg);
+    }
+    return (reg < REG_COUNT) ? chip->regs[reg] : 0;
+}
+
+/**
+ * @brief Get the number of events waiting in the simulated FIFO
+ * @return uint8_t Events waiting
+ */
+uint8_t TCA8418Sim_FifoCount(void){
+    return sim.chips[0].fifoCount;
+}
+
+/**
+ * @brief Check the INT line
+ * @return uint8_t 1 while INT is asserted (low)
+ */
+uint8_t TCA8418Sim_IntAsserted(void){
+    return sim.chips[0].intLow;
+}
+
+/**
+ * @brief Get the counters
+ * @return const TCA8418Sim_Stats* Counters since TCA8418Sim_Reset() or TCA8418Sim_ClearStats()
+ */
+const TCA8418Sim_Stats *TCA8418Sim_GetStats(void){
+    return &sim.stats;
+}
+
+/**
+ * @brief Reset the counters and the transaction log
+ */
+void TCA8418Sim_ClearStats(void){
+    sim.stats = (TCA8418Sim_Stats){0};
+    sim.logCount = 0;
+}
+
+/**
+ * @brief Get the transactions logged since the counters were cleared
+ * @param log Pointer to store the first entry, oldest first
+ * @return uint16_t Entries, at most TCA8418SIM_LOG_SIZE, later transactions are not logged
+ */
+uint16_t TCA8418Sim_GetLog(const TCA8418Sim_Transaction **log){
+    *log = sim.log;
+    return sim.logCount;
+}
+
+/**
+ * @brief Get the priority of the code running now
+ * @return TCA8418Sim_Level Current priority
+ */
+TCA8418Sim_Level TCA8418Sim_GetLevel(void){
+    return sim.level;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file tca8418sim.h
+ * @brief Host simulator of the TCA8418 on an I2C bus, for the tools
+ * @details This header file contains the declarations of a register level
+ *          model of the TCA8418 behind the HAL functions of tools/sim/main.h.
+ *          The model keeps the key event FIFO with its overflow, INT_STAT with
+ *          write 1 to clear, KEY_LCK_EC, CFG.AI address increment and the INT
+ *          line in both CFG.INT_CFG modes, and can be unplugged and plugged in
+ *          or limited to a bus clock above which reads are corrupted. It can
+ *          also put up to TCA8418SIM_CHANNELS TCA8418s behind a TCA9548A, one
+ *          per channel, each with its own INT line, where a transaction
+ *          reaches the TCA8418 of the connected channel.
+ *          Time is a cycle counter of a SystemCoreClock core, which also
+ *          replaces TCA8418_GetCycles(). Blocking transactions advance it by
+ *          their bus time, counted as in tca8418_power.c, plus
+ *          TCA8418SIM_TRANSFER_CYCLES, at the bus clock in hi2c1.Init.ClockSpeed.
+ *          IT and DMA transfers complete later.
+ *          Three priorities are modeled: thread mode, PendSV and the EXTI and
+ *          I2C interrupts. Interrupts due while time advances preempt lower
+ *          priority code, also in the middle of a blocking transaction, which
+ *          then holds the bus, so a preempting transaction gets HAL_BUSY as
+ *          from the HAL lock. A pended PendSV runs at the next HAL call or
+ *          TCA8418Sim_Run() of lower priority code.
+ *          Build a tool with: cc -I sim -I.. tool.c sim/tca8418sim.c ../tca8418.c
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#ifndef __TCA8418SIM_H__
+#define __TCA8418SIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For uint8_t, uint32_t, uint64_t */
+#include <stdint.h>
+/* For the HAL declarations */
+#include "main.h"
+
+/* Core clock of the simulated MCU */
+#define TCA8418SIM_CPU_HZ           64000000U
+
+/* HAL overhead of one transaction outside the bus time, in core cycles */
+#define TCA8418SIM_TRANSFER_CYCLES  400U
+
+/* Width of the INT deassertion in reassert mode, 50 us */
+#define TCA8418SIM_REASSERT_CYCLES  (TCA8418SIM_CPU_HZ / 20000U)
+
+/* Transactions kept in the log */
+#define TCA8418SIM_LOG_SIZE         64
+
+/* Key events that can be scheduled ahead, per TCA8418 */
+#define TCA8418SIM_KEY_QUEUE        1024
+
+/* Channels of the simulated TCA9548A */
+#define TCA8418SIM_CHANNELS         8
+
+/* 7 bit address of the simulated TCA9548A */
+#define TCA8418SIM_MUX_ADDRESS      0x70
+
+/* INT pin of the TCA8418 on a multiplexer channel, TCA8418_INT_Pin for channel 0 and the single TCA8418 */
+#define TCA8418SIM_INT_PIN(channel) ((uint16_t)(TCA8418_INT_Pin << (channel)))
+
+/**
+ * @brief Priority of the code running in the simulation
+ */
+typedef enum {
+    TCA8418SIM_THREAD = 0,      //< Main loop
+    TCA8418SIM_PENDSV,          //< Lowest priority interrupt, runs PendSV_Handler()
+    TCA8418SIM_ISR,             //< EXTI and I2C interrupts
+    TCA8418SIM_LEVELS
+} TCA8418Sim_Level;
+
+/**
+ * @brief One logged transaction
+ */
+typedef struct {
+    uint64_t cycles;            //< Start of the transaction
+    uint8_t write;              //< 1 for a register write, 0 for a read or an address probe
+    uint8_t reg;                //< First register
+    uint8_t length;             //< Bytes transferred after the register address, 0 for a probe
+    uint8_t async;              //< 1 for an IT or DMA transfer
+    uint8_t level;              //< TCA8418Sim_Level of the caller
+    uint8_t mux;                //< 1 for a write of the multiplexer, reg holds the channel mask
+} TCA8418Sim_Transaction;
+
+/**
+ * @brief Counters of the simulation
+ */
+typedef struct {
+    uint32_t transactions;                      //< Transactions put on the bus, probes included
+    uint32_t reads;                             //< Register reads
+    uint32_t writes;                            //< Register writes
+    uint32_t muxWrites;                         //< Writes of the multiplexer channel mask
+    uint32_t busyReturns;                       //< Calls refused with HAL_BUSY because the bus was in use
+    uint64_t busClocks;                         //< I2C clocks on the bus
+    uint64_t blockingCycles[TCA8418SIM_LEVELS]; //< Cycles spent waiting in blocking transactions, per priority
+    uint32_t maxHandlerCycles[TCA8418SIM_LEVELS]; //< Longest blocking wait within one handler run, per priority
+    uint32_t handlerRuns[TCA8418SIM_LEVELS];    //< Handler runs, per priority
+    uint32_t edges;                             //< Falling edges of INT
+    uint32_t eventsQueued;                      //< Key events put in the FIFO
+    uint32_t eventsLost;                        //< Key events lost to a full FIFO, a detached chip or an unconfigured matrix
+    uint32_t eventsRead;                        //< Key events popped by the driver
+    uint64_t latencySum;                        //< Cycles from FIFO arrival to pop, summed over eventsRead
+    uint32_t latencyMax;                        //< Longest cycles from FIFO arrival to pop
+} TCA8418Sim_Stats;
+
+/**
+ * @brief Power up the simulated TCA8418 and reset time and counters
+ * @param busHz I2C clock frequency
+ * @note Leaves a single TCA8418 directly on the bus, without a multiplexer
+ */
+void TCA8418Sim_Reset(uint32_t busHz);
+
+/**
+ * @brief Put TCA8418s behind a simulated TCA9548A at TCA8418SIM_MUX_ADDRESS, one per channel
+ * @param channels Channels with a TCA8418, up to TCA8418SIM_CHANNELS, 0 for the single TCA8418
+ *        directly on the bus
+ * @note Call right after TCA8418Sim_Reset(). No channel is connected until the control register
+ *       is written with HAL_I2C_Master_Transmit(), and a transaction to the TCA8418 with no channel
+ *       or more than one connected is not acknowledged. The functions without a channel act on
+ *       the TCA8418 of channel 0.
+ */
+void TCA8418Sim_SetChannels(uint8_t channels);
+
+/**
+ * @brief Get the current time
+ * @return uint64_t Core cycles since TCA8418Sim_Reset()
+ */
+uint64_t TCA8418Sim_Now(void);
+
+/**
+ * @brief Schedule a key event
+ * @param cycles Time of the event, not earlier than the previously scheduled one
+ * @param event Key event byte, bit 7 set for a press
+ * @return int 0 if scheduled, -1 if the queue is full or the time goes backwards
+ */
+int TCA8418Sim_Key(uint64_t cycles, uint8_t event);
+
+/**
+ * @brief Schedule a key event on the TCA8418 of a multiplexer channel
+ * @param channel Channel of the TCA8418
+ * @param cycles Time of the event, not earlier than the previously scheduled one on that channel
+ * @param event Key event byte, bit 7 set for a press
+ * @return int 0 if scheduled, -1 if the channel has no TCA8418, the queue is full or the time goes backwards
+ */
+int TCA8418Sim_ChannelKey(uint8_t channel, uint64_t cycles, uint8_t event);
+
+/**
+ * @brief Let time pass in the calling code, running the interrupts that become due
+ * @param cycles Cycles to pass, 0 only runs the interrupts already pending
+ */
+void TCA8418Sim_Run(uint64_t cycles);
+
+/**
+ * @brief Plug or unplug the simulated TCA8418
+ * @param attached 1 to plug in, powering up with reset register values, 0 to unplug
+ */
+void TCA8418Sim_Attach(uint8_t attached);
+
+/**
+ * @brief Set the fastest bus clock at which reads return correct data
+ * @param hz Bus clock in Hz, 0 for no limit, the default after TCA8418Sim_Reset()
+ * @note Above it every byte read has a bit flipped, as on a cable too long or too loaded
+ *       for the clock. Writes still reach the registers.
+ */
+void TCA8418Sim_SetMaxReliableHz(uint32_t hz);
+
+/**
+ * @brief Read a register of the simulated TCA8418 without a transaction
+ * @param reg Register address
+ * @return uint8_t Register value, KEY_EVENT_A is not popped
+ */
+uint8_t TCA8418Sim_Register(uint8_t reg);
+
+/**
+ * @brief Get the number of events waiting in the simulated FIFO
+ * @return uint8_t Events waiting
+ */
+uint8_t TCA8418Sim_FifoCount(void);
+
+/**
+ * @brief Check the INT line
+ * @return uint8_t 1 while INT is asserted (low)
+ */
+uint8_t TCA8418Sim_IntAsserted(void);
+
+/**
+ * @brief Get the counters
+ * @return const TCA8418Sim_Stats* Counters since TCA8418Sim_Reset() or TCA8418Sim_ClearStats()
+ */
+const TCA8418Sim_Stats *TCA8418Sim_GetStats(void);
+
+/**
+ * @brief Reset the counters and the transaction log
+ */
+void TCA8418Sim_ClearStats(void);
+
+/**
+ * @brief Get the transactions logged since the counters were cleared
+ * @param log Pointer to store the first entry, oldest first
+ * @return uint16_t Entries, at most TCA8418SIM_LOG_SIZE, later transactions are not logged
+ */
+uint16_t TCA8418Sim_GetLog(const TCA8418Sim_Transaction **log);
+
+/**
+ * @brief Get the priority of the code running now
+ * @return TCA8418Sim_Level Current priority
+ */
+TCA8418Sim_Level TCA8418Sim_GetLevel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,323 @@
+/**
+ * @file stampsim.c
+ * @brief Simulated check of the per-event stage stamps against the simulator's transaction times
+ * @details Runs tca8418.c built with TCA8418_STAMPS=1 against the simulator of
+ *          tools/sim with the deferred drain in latched mode. Each
+ *          configuration drains three batches: 4 keys at once, 3 keys arriving
+ *          while the application holds hi2c1 with a read of its own, and 2
+ *          keys followed by 2 more 500 us later, which at 100 kHz arrive
+ *          during the first drain. The main loop pops the ring every 100 us
+ *          and handles each event for 20 us before TCA8418_StampHandled().
+ *          The expected stage times of every event are rebuilt from what the
+ *          simulator did: the INT edges seen by the EXTI callback, the start of
+ *          the INT_STAT read of each drain, the end of the KEY_EVENT_A read
+ *          that carried the event, the start of the INT_STAT clear that
+ *          follows it, and the pop and handling times of the main loop. They
+ *          are stored with the same 2^TCA8418_STAMP_SHIFT truncation as the
+ *          driver, and the per-stage sums of TCA8418_GetStageStats() must equal
+ *          them exactly. It prints the measured sums per stage for every drain
+ *          strategy at 100 kHz and 400 kHz.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 -DTCA8418_STAMPS=1 stampsim.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o stampsim
+ *          Usage: stampsim
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418.h"
+#include "tca8418_trace.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_STAMPS || !TCA8418_FEATURE_DEFERRED
+#error "stampsim needs TCA8418_STAMPS and TCA8418_FEATURE_DEFERRED"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Cycles to microseconds */
+#define TO_US(cycles)   ((double)(cycles) / (TCA8418SIM_CPU_HZ / 1e6))
+
+/* TCA8418 registers of a drain */
+#define REG_INT_STAT    0x02
+#define REG_KEY_EVENT_A 0x04
+
+/* Read of the application holding hi2c1. The simulator answers every address as the
+ * TCA8418, so it reads registers without side effects */
+#define APP_ADDRESS     0x50
+#define APP_REG         0x1D
+#define APP_BYTES       16
+
+/* Main loop period and handling time per event */
+#define LOOP_US         100U
+#define HANDLE_US       20U
+
+/* Idle time after a batch */
+#define SETTLE_US       5000U
+
+/* Main loop iterations before giving up on a batch */
+#define LOOPS_MAX       200U
+
+/* Events and INT edges tracked per batch */
+#define EVENTS_MAX      16
+#define EDGES_MAX       16
+
+/**
+ * @brief Keys of one batch
+ */
+typedef struct {
+    uint8_t first;          //< Keys at the start of the batch
+    uint16_t secondUs;      //< Delay of the second keys
+    uint8_t second;         //< Keys after secondUs
+    uint8_t hold;           //< 1 if the application reads hi2c1 while the first keys arrive
+} Batch;
+
+static const Batch batches[] = {
+    {4, 0, 0, 0},
+    {3, 0, 0, 1},
+    {2, 500, 2, 0},
+};
+
+/* Bus speeds measured */
+static const uint32_t busSpeeds[] = { 100000, 400000 };
+
+/* Drain strategies measured */
+static const struct {
+    const char *name;
+    TCA8418_DrainStrategy strategy;
+} strategies[] = {
+    {"per-register", TCA8418_DRAIN_PER_REGISTER},
+    {"burst", TCA8418_DRAIN_BURST},
+    {"IT", TCA8418_DRAIN_IT},
+    {"DMA", TCA8418_DRAIN_DMA},
+};
+
+/* INT edges of the current batch */
+static uint64_t edges[EDGES_MAX];
+static uint8_t numEdges;
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    if(pin == TCA8418_INT_Pin){
+        if(numEdges < EDGES_MAX){
+            edges[numEdges++] = TCA8418Sim_Now();
+        }
+        TCA8418_IRQHandler();
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_ErrorCallback(hi2c);
+}
+
+/**
+ * @brief Time of a logged transaction on the bus and in the HAL, as the simulator charges it
+ */
+static uint64_t TransactionCycles(const TCA8418Sim_Transaction *txn, uint32_t busHz){
+    uint32_t clocks = txn->write ? (9U * (2U + txn->length) + 2U) : (9U * (3U + txn->length) + 3U);
+    uint64_t cycles = ((uint64_t)clocks * TCA8418SIM_CPU_HZ + busHz - 1U) / busHz;
+    return txn->async ? cycles : cycles + TCA8418SIM_TRANSFER_CYCLES;
+}
+
+/**
+ * @brief Pop and handle events until the expected number was handled
+ * @param expected Events of the batch
+ * @param times Stage times to store the dequeue and handled times in, in pop order
+ * @return uint8_t Events handled
+ */
+static uint8_t MainLoop(uint8_t expected, uint32_t times[][TCA8418_STAGE_COUNT]){
+    uint8_t handled = 0;
+    for(uint32_t loops = 0; (loops < LOOPS_MAX) && (handled < expected); loops++){
+        uint8_t events[TCA8418_RING_SIZE];
+        uint8_t numEvents = 0;
+        uint32_t popped;
+        TCA8418Sim_Run(US(LOOP_US));
+        if(TCA8418_PopEvents(events, sizeof(events), &numEvents) != HAL_OK){
+            numEvents = 0;
+        }
+        popped = (uint32_t)TCA8418Sim_Now();
+        for(uint8_t i = 0; i < numEvents; i++){
+            TCA8418Sim_Run(US(HANDLE_US));
+            if(handled < EVENTS_MAX){
+                times[handled][TCA8418_STAGE_DEQUEUE] = popped;
+                times[handled][TCA8418_STAGE_HANDLED] = (uint32_t)TCA8418Sim_Now();
+            }
+            handled++;
+            TCA8418_StampHandled();
+        }
+    }
+    return handled;
+}
+
+/**
+ * @brief Rebuild the INT, drain, FIFO and enqueue times of the events from the transaction log
+ * @param busHz Bus speed
+ * @param times Stage times to store, in FIFO order
+ * @return uint8_t Events read from KEY_EVENT_A
+ * @note A drain starts with its INT_STAT read and takes the oldest INT edge since the previous
+ *       drain, or its own start without one. Latched mode rechecks continue the drain. The
+ *       events of a pass are enqueued at the start of the INT_STAT clear that follows them.
+ */
+static uint8_t Rebuild(uint32_t busHz, uint32_t times[][TCA8418_STAGE_COUNT]){
+    const TCA8418Sim_Transaction *log;
+    uint16_t count = TCA8418Sim_GetLog(&log);
+    uint32_t drainAt = 0;
+    uint32_t intAt = 0;
+    uint8_t edge = 0;
+    uint8_t read = 0;
+    uint8_t enqueued = 0;
+    for(uint16_t t = 0; t < count; t++){
+        const TCA8418Sim_Transaction *txn = &log[t];
+        if(!txn->write && (txn->reg == REG_INT_STAT)){
+            drainAt = (uint32_t)txn->cycles;
+            intAt = drainAt;
+            if((edge < numEdges) && (edges[edge] <= txn->cycles)){
+                intAt = (uint32_t)edges[edge];
+            }
+            while((edge < numEdges) && (edges[edge] <= txn->cycles)){
+                edge++;
+            }
+        } else if(!txn->write && (txn->reg == REG_KEY_EVENT_A)){
+            uint32_t fifoAt = (uint32_t)(txn->cycles + TransactionCycles(txn, busHz));
+            for(uint8_t i = 0; (i < txn->length) && (read < EVENTS_MAX); i++, read++){
+                times[read][TCA8418_STAGE_INT] = intAt;
+                times[read][TCA8418_STAGE_DRAIN] = drainAt;
+                times[read][TCA8418_STAGE_FIFO] = fifoAt;
+            }
+        } else if(txn->write && (txn->reg == REG_INT_STAT)){
+            for(; enqueued < read; enqueued++){
+                times[enqueued][TCA8418_STAGE_ENQUEUE] = (uint32_t)txn->cycles;
+            }
+        }
+    }
+    return (enqueued == read) ? read : 0;
+}
+
+/**
+ * @brief Add the intervals of an event to the expected sums, truncated as the driver stores them
+ * @param at Stage times of the event
+ * @param sums Expected sum per interval
+ */
+static void AddExpected(const uint32_t at[TCA8418_STAGE_COUNT], uint64_t sums[TCA8418_STAGE_COUNT - 1]){
+    uint32_t rebuilt = at[TCA8418_STAGE_INT];
+    for(uint8_t s = 1; s < TCA8418_STAGE_COUNT; s++){
+        uint32_t interval = ((at[s] - rebuilt) >> TCA8418_STAMP_SHIFT) << TCA8418_STAMP_SHIFT;
+        sums[s - 1] += interval;
+        rebuilt += interval;
+    }
+}
+
+/**
+ * @brief Drain the batches of one configuration and compare the stage sums
+ * @param strategy Drain strategy
+ * @param busHz Bus speed
+ * @param name Name of the strategy
+ * @return int 0 if the stage statistics equal the expected sums, otherwise 1
+ */
+static int Measure(TCA8418_DrainStrategy strategy, uint32_t busHz, const char *name){
+    static uint32_t fifo[EVENTS_MAX][TCA8418_STAGE_COUNT];
+    static uint32_t popped[EVENTS_MAX][TCA8418_STAGE_COUNT];
+    uint64_t expected[TCA8418_STAGE_COUNT - 1] = {0};
+    uint32_t expectedEvents = 0;
+    TCA8418_StageStats stats;
+    int errors = 0;
+    uint8_t events[TCA8418_RING_SIZE];
+    uint8_t numEvents = 0;
+    /* Events left from the previous configuration, marked handled to empty the taken stamps */
+    (void)TCA8418_PopEvents(events, sizeof(events), &numEvents);
+    for(uint8_t i = 0; i < TCA8418_RING_SIZE; i++){
+        TCA8418_StampHandled();
+    }
+    TCA8418Sim_Reset(busHz);
+    if((TCA8418_Init() != HAL_OK) || (TCA8418_SetDrainStrategy(strategy) != HAL_OK)){
+        fprintf(stderr, "%s: initialization failed\n", name);
+        return 1;
+    }
+    /* A first drain takes any INT edge latched before the reset */
+    (void)TCA8418Sim_Key(TCA8418Sim_Now() + 1U, 0x81);
+    (void)MainLoop(1, popped);
+    TCA8418Sim_Run(US(SETTLE_US));
+    TCA8418_ClearStageStats();
+    for(uint8_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++){
+        const Batch *batch = &batches[b];
+        uint8_t keys = (uint8_t)(batch->first + batch->second);
+        uint8_t read;
+        uint8_t handled;
+        uint64_t start;
+        TCA8418Sim_ClearStats();
+        numEdges = 0;
+        start = TCA8418Sim_Now() + US(10);
+        for(uint8_t k = 0; k < batch->first; k++){
+            (void)TCA8418Sim_Key(start + k, (uint8_t)(0x81 + k));
+        }
+        for(uint8_t k = 0; k < batch->second; k++){
+            (void)TCA8418Sim_Key(start + US(batch->secondUs) + k, (uint8_t)(0x91 + k));
+        }
+        if(batch->hold){
+            uint8_t data[APP_BYTES];
+            /* The keys arrive 10 us into the read, the deferred drain is refused until it ends */
+            (void)HAL_I2C_Mem_Read(&hi2c1, (APP_ADDRESS << 1), APP_REG, I2C_MEMADD_SIZE_8BIT, data, APP_BYTES, 10);
+            TCA8418_BusReleased();
+        }
+        handled = MainLoop(keys, popped);
+        /* Let the last INT_STAT clear and recheck finish before the next batch or reset */
+        TCA8418Sim_Run(US(SETTLE_US));
+        read = Rebuild(busHz, fifo);
+        if((handled != keys) || (read != keys) || (TCA8418Sim_GetStats()->transactions > TCA8418SIM_LOG_SIZE)){
+            fprintf(stderr, "%s %lu Hz batch %u: %u keys, %u read, %u handled, %lu transactions\n", name,
+                    (unsigned long)busHz, b, keys, read, handled, (unsigned long)TCA8418Sim_GetStats()->transactions);
+            errors++;
+            continue;
+        }
+        for(uint8_t e = 0; e < keys; e++){
+            fifo[e][TCA8418_STAGE_DEQUEUE] = popped[e][TCA8418_STAGE_DEQUEUE];
+            fifo[e][TCA8418_STAGE_HANDLED] = popped[e][TCA8418_STAGE_HANDLED];
+            AddExpected(fifo[e], expected);
+        }
+        expectedEvents += keys;
+    }
+    TCA8418_GetStageStats(&stats);
+    printf("%-13s %7lu %6lu", name, (unsigned long)(busHz / 1000U), (unsigned long)stats.events);
+    for(uint8_t s = 0; s < TCA8418_STAGE_COUNT - 1; s++){
+        printf(" %10.1f", TO_US(stats.totalCycles[s]));
+        if(stats.totalCycles[s] != expected[s]){
+            fprintf(stderr, "%s %lu Hz interval %u: %llu cycles, expected %llu\n", name, (unsigned long)busHz, s + 1U,
+                    (unsigned long long)stats.totalCycles[s], (unsigned long long)expected[s]);
+            errors++;
+        }
+    }
+    if((stats.events != expectedEvents) || (stats.saturated != 0)){
+        fprintf(stderr, "%s %lu Hz: %lu events, %lu saturated, expected %lu events\n", name, (unsigned long)busHz,
+                (unsigned long)stats.events, (unsigned long)stats.saturated, (unsigned long)expectedEvents);
+        errors++;
+    }
+    printf("%s\n", (errors != 0) ? " FAIL" : "");
+    return (errors != 0) ? 1 : 0;
+}
+
+int main(void){
+    int failed = 0;
+    printf("stage sums in us over all events\n");
+    printf("%-13s %7s %6s %10s %10s %10s %10s %10s\n", "strategy", "bus kHz", "events", "INT>drain", "drain>FIFO",
+           "FIFO>ring", "ring>pop", "pop>done");
+    for(uint8_t s = 0; s < sizeof(busSpeeds) / sizeof(busSpeeds[0]); s++){
+        for(uint8_t d = 0; d < sizeof(strategies) / sizeof(strategies[0]); d++){
+            failed += Measure(strategies[d].strategy, busSpeeds[s], strategies[d].name);
+        }
+    }
+    return (failed != 0) ? 1 : 0;
+}
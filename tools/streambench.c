@@ -0,0 +1,262 @@
+/**
+ * @file streambench.c
+ * @brief Host benchmark of the bytes on the wire of the event stream of tca8418_stream.h
+ * @details Runs 60 s of simulated key activity per workload through three
+ *          encodings and prints the bytes per event and the UART load at
+ *          115200 baud (10 bits per byte) of each:
+ *          - batched: TCA8418_StreamEncoder_Push() after every drain and
+ *            TCA8418_StreamEncoder_Poll() every millisecond.
+ *          - per event: the same frames with a flush after every event.
+ *          - text: one "P 23 123456\r\n" line per event, key and tick.
+ *          Every frame is fed to the decoder, which must return the events and
+ *          their delta times unchanged. For the batched stream it also prints
+ *          the mean and longest time an event waited for its frame.
+ *          Build: cc -O2 -I.. -DTCA8418_PROFILE=3 streambench.c ../tca8418_stream.c -o streambench
+ *          Usage: streambench [seconds]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tca8418_stream.h"
+
+/* Largest drain, the TCA8418 FIFO depth */
+#define BATCH_MAX       10
+
+/* Events of one run kept for the round trip check */
+#define EVENTS_MAX      100000
+
+/* UART bits per byte with start and stop bit, and baud rate */
+#define UART_BITS       10U
+#define UART_BAUD       115200U
+
+/**
+ * @brief Simulated key activity
+ */
+typedef enum {
+    WORKLOAD_TYPING,        //< One key at a time, 150 to 300 ms apart
+    WORKLOAD_FAST,          //< Overlapping keys, 60 to 120 ms apart
+    WORKLOAD_CHORDS,        //< Three keys pressed and released in one drain each
+    WORKLOAD_FLOOD,         //< Full drains of 10 events every 5 ms
+    WORKLOAD_COUNT
+} Workload;
+
+static const char *const workloadNames[WORKLOAD_COUNT] = { "typing", "fast", "chords", "flood" };
+
+/* Events pushed in the current run, with their drain tick */
+static uint8_t sentEvents[EVENTS_MAX];
+static uint32_t sentTicks[EVENTS_MAX];
+static uint32_t sent;
+
+/* Round trip state */
+static TCA8418_StreamDecoder decoder;
+static uint32_t decoded;
+static uint32_t mismatches;
+static uint32_t now;
+static uint64_t waitSum;
+static uint32_t waitMax;
+
+/* Wire counters */
+static uint32_t frames;
+static uint32_t bytes;
+
+/**
+ * @brief Check decoded events against the pushed ones
+ */
+static void OnFrame(uint8_t sequence, const TCA8418_StreamEvent *events, uint8_t numEvents){
+    (void)sequence;
+    for(uint8_t i = 0; i < numEvents; i++){
+        uint32_t delta = (decoded > 0) ? (sentTicks[decoded] - sentTicks[decoded - 1]) : 0;
+        if(delta > TCA8418_STREAM_DELTA_MAX){
+            delta = TCA8418_STREAM_DELTA_MAX;
+        }
+        if((decoded >= sent) || (events[i].keyEvent != sentEvents[decoded]) ||
+           ((decoded > 0) && (events[i].deltaMs != delta))){
+            mismatches++;
+        }
+        if(decoded < sent){
+            uint32_t wait = now - sentTicks[decoded];
+            waitSum += wait;
+            if(wait > waitMax){
+                waitMax = wait;
+            }
+        }
+        decoded++;
+    }
+}
+
+/**
+ * @brief Count an encoded frame and decode it
+ */
+static void OnWrite(const uint8_t *frame, uint16_t length){
+    frames++;
+    bytes += length;
+    TCA8418_StreamDecoder_Feed(&decoder, frame, length);
+}
+
+/**
+ * @brief Produce the drains of one millisecond
+ * @param workload Key activity
+ * @param tick Current millisecond
+ * @param seed Random state
+ * @param events Pointer to store the drained events
+ * @return uint8_t Number of events drained
+ */
+static uint8_t Drain(Workload workload, uint32_t tick, uint32_t *seed, uint8_t *events){
+    static uint32_t nextTick;
+    static uint8_t held[3];
+    static uint8_t heldCount;
+    static uint32_t releaseTick[3];
+    uint8_t count = 0;
+    if(tick == 0){
+        nextTick = 0;
+        heldCount = 0;
+    }
+    /* Releases due */
+    for(uint8_t i = 0; i < heldCount; ){
+        if((workload != WORKLOAD_CHORDS) && (tick >= releaseTick[i])){
+            events[count++] = held[i];
+            held[i] = held[--heldCount];
+            releaseTick[i] = releaseTick[heldCount];
+            continue;
+        }
+        i++;
+    }
+    if(tick < nextTick){
+        return count;
+    }
+    *seed = *seed * 1664525U + 1013904223U;
+    uint32_t r = *seed >> 8;
+    switch(workload){
+    case WORKLOAD_TYPING:
+    case WORKLOAD_FAST:
+        if(heldCount < 3){
+            held[heldCount] = (uint8_t)(1U + (r % 80U));
+            releaseTick[heldCount] = tick + 40U + (r % 80U);
+            events[count++] = (uint8_t)(0x80 | held[heldCount++]);
+        }
+        nextTick = tick + ((workload == WORKLOAD_TYPING) ? (150U + (r % 150U)) : (60U + (r % 60U)));
+        break;
+    case WORKLOAD_CHORDS:
+        if(heldCount == 0){
+            for(uint8_t i = 0; i < 3; i++){
+                held[i] = (uint8_t)(1U + ((r >> (i * 7)) % 80U));
+                events[count++] = (uint8_t)(0x80 | held[i]);
+            }
+            heldCount = 3;
+            nextTick = tick + 80U + (r % 80U);
+        }else{
+            for(uint8_t i = 0; i < 3; i++){
+                events[count++] = held[i];
+            }
+            heldCount = 0;
+            nextTick = tick + 300U + (r % 300U);
+        }
+        break;
+    case WORKLOAD_FLOOD:
+        for(uint8_t i = 0; i < BATCH_MAX; i++){
+            events[count++] = (uint8_t)(((i & 1U) ? 0x00 : 0x80) | (1U + ((r + i / 2U) % 80U)));
+        }
+        nextTick = tick + 5U;
+        break;
+    default:
+        break;
+    }
+    return count;
+}
+
+/**
+ * @brief Run one workload with one encoding
+ * @param workload Key activity
+ * @param encoding 0 batched, 1 frame per event, 2 text line per event
+ * @param seconds Simulated duration
+ * @return int 0 if the round trip matched
+ */
+static int Run(Workload workload, uint8_t encoding, uint32_t seconds){
+    static const char *const encodingNames[] = { "batched", "per event", "text" };
+    TCA8418_StreamEncoder encoder;
+    uint8_t events[2 * BATCH_MAX];
+    uint32_t seed = 1;
+    sent = 0;
+    decoded = 0;
+    mismatches = 0;
+    waitSum = 0;
+    waitMax = 0;
+    frames = 0;
+    bytes = 0;
+    TCA8418_StreamEncoder_Init(&encoder, OnWrite, 0);
+    TCA8418_StreamDecoder_Init(&decoder, OnFrame);
+    for(now = 0; now < seconds * 1000U; now++){
+        uint8_t count = Drain(workload, now, &seed, events);
+        if((sent + count) > EVENTS_MAX){
+            break;
+        }
+        for(uint8_t i = 0; i < count; i++){
+            sentEvents[sent] = events[i];
+            sentTicks[sent++] = now;
+        }
+        switch(encoding){
+        case 0:
+            TCA8418_StreamEncoder_Push(&encoder, events, count, now);
+            TCA8418_StreamEncoder_Poll(&encoder, now);
+            break;
+        case 1:
+            for(uint8_t i = 0; i < count; i++){
+                TCA8418_StreamEncoder_Push(&encoder, &events[i], 1, now);
+                TCA8418_StreamEncoder_Flush(&encoder);
+            }
+            break;
+        default:
+            for(uint8_t i = 0; i < count; i++){
+                char line[24];
+                int length = snprintf(line, sizeof(line), "%c %u %lu\r\n", (events[i] & 0x80) ? 'P' : 'R',
+                                      events[i] & 0x7F, (unsigned long)now);
+                frames++;
+                bytes += (uint32_t)length;
+            }
+            decoded += count;
+            break;
+        }
+    }
+    TCA8418_StreamEncoder_Flush(&encoder);
+    printf("%-7s %-10s %8lu %8lu %9lu %8.2f %8.3f", workloadNames[workload], encodingNames[encoding],
+           (unsigned long)sent, (unsigned long)frames, (unsigned long)bytes, (double)bytes / (sent ? sent : 1),
+           100.0 * bytes * UART_BITS / ((double)UART_BAUD * (now / 1000.0)));
+    if(encoding == 0){
+        printf(" %8.2f %8lu", (double)waitSum / (decoded ? decoded : 1), (unsigned long)waitMax);
+    }
+    printf("\n");
+    if((decoded != sent) || (mismatches != 0) || (decoder.badFrames != 0)){
+        fprintf(stderr, "%s %s: %lu of %lu events decoded, %lu mismatches, %lu bad frames\n", workloadNames[workload],
+                encodingNames[encoding], (unsigned long)decoded, (unsigned long)sent, (unsigned long)mismatches,
+                (unsigned long)decoder.badFrames);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t seconds = 60;
+    int result = 0;
+    if(argc > 1){
+        seconds = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if((argc > 2) || (seconds == 0)){
+        fprintf(stderr, "usage: streambench [seconds]\n");
+        return 1;
+    }
+    printf("%lu s per workload, %u events per frame at most, %u ms deadline, UART %u baud\n", (unsigned long)seconds,
+           TCA8418_STREAM_MAX_EVENTS, TCA8418_STREAM_DEADLINE_MS, UART_BAUD);
+    printf("%-7s %-10s %8s %8s %9s %8s %8s %8s %8s\n", "load", "encoding", "events", "frames", "bytes", "B/event",
+           "UART %", "wait ms", "max ms");
+    for(uint8_t w = 0; w < WORKLOAD_COUNT; w++){
+        for(uint8_t e = 0; e < 3; e++){
+            result |= Run((Workload)w, e, seconds);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file t9dict.c
+ * @brief Host tool building the predictive text dictionary of tca8418_text
+ * @details Reads a word list, one word per line with the most frequent words
+ *          first, and writes a C source file holding the dictionary trie in
+ *          the layout described in tca8418_text.h. Words with characters
+ *          other than a-z are skipped. With -b it also reports the dictionary
+ *          size and the average lookup time of every word.
+ *          Build: cc -O2 -I.. t9dict.c ../tca8418_text.c -o t9dict
+ *          Usage: t9dict [-b] words.txt name output.c
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tca8418_text.h"
+
+/* Longest word accepted */
+#define WORD_MAX    TCA8418_TEXT_WORD_MAX
+
+/* Most words kept per digit sequence */
+#define NODE_WORDS  255
+
+/**
+ * @brief Trie node while building
+ */
+typedef struct {
+    int32_t children[8];    //< Node index per digit '2' to '9', -1 if none
+    int32_t *words;         //< Indexes of the words of this digit sequence
+    uint32_t numWords;      //< Words of this digit sequence
+    uint32_t depth;         //< Digits from the root
+    uint32_t offset;        //< Offset in the dictionary
+} Node;
+
+static Node *nodes;
+static uint32_t numNodes;
+static uint32_t capNodes;
+static char (*wordList)[WORD_MAX + 1];
+static uint32_t numWordList;
+
+/**
+ * @brief Get the digit of a lowercase letter
+ * @param c Letter a-z
+ * @return int Digit index 0 to 7 for '2' to '9'
+ */
+static int LetterDigit(char c){
+    static const char digits[] = "22233344455566677778889999";
+    return digits[c - 'a'] - '2';
+}
+
+/**
+ * @brief Append a new empty node
+ * @param depth Digits from the root
+ * @return int32_t Node index
+ */
+static int32_t NewNode(uint32_t depth){
+    if(numNodes == capNodes){
+        capNodes = capNodes ? capNodes * 2 : 1024;
+        nodes = realloc(nodes, capNodes * sizeof(Node));
+        if(nodes == NULL){
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memset(&nodes[numNodes], 0, sizeof(Node));
+    memset(nodes[numNodes].children, 0xFF, sizeof(nodes[numNodes].children));
+    nodes[numNodes].depth = depth;
+    return (int32_t)numNodes++;
+}
+
+/**
+ * @brief Add a word to the trie
+ * @param index Index of the word in wordList
+ */
+static void AddWord(int32_t index){
+    const char *word = wordList[index];
+    int32_t node = 0;
+    for(uint32_t i = 0; word[i] != '\0'; i++){
+        int digit = LetterDigit(word[i]);
+        if(nodes[node].children[digit] < 0){
+            int32_t child = NewNode(i + 1);
+            nodes[node].children[digit] = child;
+        }
+        node = nodes[node].children[digit];
+    }
+    if(nodes[node].numWords >= NODE_WORDS){
+        return;
+    }
+    nodes[node].words = realloc(nodes[node].words, (nodes[node].numWords + 1) * sizeof(int32_t));
+    nodes[node].words[nodes[node].numWords++] = index;
+}
+
+/**
+ * @brief Read and normalize the word list
+ * @param path Word list file
+ */
+static void ReadWords(const char *path){
+    char line[256];
+    uint32_t cap = 0;
+    FILE *f = fopen(path, "r");
+    if(f == NULL){
+        perror(path);
+        exit(1);
+    }
+    while(fgets(line, sizeof(line), f) != NULL){
+        size_t len = strcspn(line, " \t\r\n");
+        int valid = (len > 0) && (len <= WORD_MAX);
+        for(size_t i = 0; valid && (i < len); i++){
+            line[i] = (char)tolower((unsigned char)line[i]);
+            valid = (line[i] >= 'a') && (line[i] <= 'z');
+        }
+        if(!valid){
+            continue;
+        }
+        if(numWordList == cap){
+            cap = cap ? cap * 2 : 4096;
+            wordList = realloc(wordList, cap * sizeof(*wordList));
+            if(wordList == NULL){
+                perror("realloc");
+                exit(1);
+            }
+        }
+        memcpy(wordList[numWordList], line, len);
+        wordList[numWordList][len] = '\0';
+        numWordList++;
+    }
+    fclose(f);
+}
+
+/**
+ * @brief Lay out and serialize the trie
+ * @param size Pointer to store the dictionary size in bytes
+ * @return uint8_t* Dictionary
+ */
+static uint8_t *Serialize(uint32_t *size){
+    uint32_t offset = TCA8418_TEXT_DICT_HEADER;
+    uint8_t *dict;
+    /* Nodes are created parent first, so their index order is a valid layout */
+    for(uint32_t n = 0; n < numNodes; n++){
+        uint32_t children = 0;
+        for(int d = 0; d < 8; d++){
+            children += (nodes[n].children[d] >= 0) ? 1 : 0;
+        }
+        nodes[n].offset = offset;
+        offset += 2 + 3 * children + nodes[n].numWords * nodes[n].depth;
+    }
+    if(offset > 0xFFFFFF){
+        fprintf(stderr, "dictionary exceeds 24-bit offsets\n");
+        exit(1);
+    }
+    dict = calloc(offset, 1);
+    memcpy(dict, "T9D1", TCA8418_TEXT_DICT_HEADER);
+    for(uint32_t n = 0; n < numNodes; n++){
+        uint8_t *p = &dict[nodes[n].offset];
+        uint8_t mask = 0;
+        uint32_t pos = 2;
+        for(int d = 0; d < 8; d++){
+            int32_t child = nodes[n].children[d];
+            if(child < 0){
+                continue;
+            }
+            mask |= (uint8_t)(1U << d);
+            p[pos++] = (uint8_t)nodes[child].offset;
+            p[pos++] = (uint8_t)(nodes[child].offset >> 8);
+            p[pos++] = (uint8_t)(nodes[child].offset >> 16);
+        }
+        p[0] = mask;
+        p[1] = (uint8_t)nodes[n].numWords;
+        for(uint32_t w = 0; w < nodes[n].numWords; w++){
+            memcpy(&p[pos], wordList[nodes[n].words[w]], nodes[n].depth);
+            pos += nodes[n].depth;
+        }
+    }
+    *size = offset;
+    return dict;
+}
+
+/**
+ * @brief Look every word up in the dictionary and report the average time
+ * @param dict Dictionary
+ * @param size Dictionary size in bytes
+ */
+static void Benchmark(const uint8_t *dict, uint32_t size){
+    char (*digits)[WORD_MAX] = malloc(numWordList * sizeof(*digits));
+    uint32_t found = 0;
+    struct timespec start;
+    struct timespec end;
+    double ns;
+    for(uint32_t i = 0; i < numWordList; i++){
+        for(uint32_t c = 0; wordList[i][c] != '\0'; c++){
+            digits[i][c] = (char)('2' + LetterDigit(wordList[i][c]));
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(int round = 0; round < 10; round++){
+        for(uint32_t i = 0; i < numWordList; i++){
+            uint8_t count;
+            found += TCA8418_Text_Lookup(dict, digits[i], (uint8_t)strlen(wordList[i]), &count) ? 1 : 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+    printf("words: %u\nnodes: %u\nflash: %u bytes (%.2f bytes/word)\nlookup: %.1f ns/word (%u found)\n",
+           numWordList, numNodes, size, (double)size / numWordList, ns / (10.0 * numWordList), found / 10);
+    free(digits);
+}
+
+int main(int argc, char **argv){
+    int bench = 0;
+    uint32_t size;
+    uint8_t *dict;
+    FILE *out;
+    if((argc > 1) && (strcmp(argv[1], "-b") == 0)){
+        bench = 1;
+        argc--;
+        argv++;
+    }
+    if(argc != 4){
+        fprintf(stderr, "usage: t9dict [-b] words.txt name output.c\n");
+        return 1;
+    }
+    ReadWords(argv[1]);
+    NewNode(0);
+    for(uint32_t i = 0; i < numWordList; i++){
+        AddWord((int32_t)i);
+    }
+    dict = Serialize(&size);
+    out = fopen(argv[3], "w");
+    if(out == NULL){
+        perror(argv[3]);
+        return 1;
+    }
+    fprintf(out, "/* Generated by tools/t9dict.c from %s, %u words */\n\n#include <stdint.h>\n\n", argv[1], numWordList);
+    fprintf(out, "const uint8_t %s[%u] = {", argv[2], size);
+    for(uint32_t i = 0; i < size; i++){
+        fprintf(out, "%s0x%02X,", (i % 16) ? " " : "\n    ", dict[i]);
+    }
+    fprintf(out, "\n};\n");
+    fclose(out);
+    if(bench){
+        Benchmark(dict, size);
+    }
+    free(dict);
+    return 0;
+}
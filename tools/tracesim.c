@@ -0,0 +1,499 @@
+/**
+ * @file tracesim.c
+ * @brief Simulated timeline trace of every drain strategy with a check of the exported JSON
+ * @details Runs tca8418.c built with TCA8418_TRACE=1 against the simulator of
+ *          tools/sim. Bursts of 1, 4 and 8 key events are drained by
+ *          TCA8418_ReadKeyEvents() called from the EXTI callback with the
+ *          per-register and burst strategies, by TCA8418_ServiceInterrupt()
+ *          called from it with the burst strategy, and by the deferred drain with the
+ *          per-register, burst, IT and DMA strategies. The main loop takes the
+ *          events every millisecond and marks their handling as the consumer.
+ *          Each run is exported with TCA8418_Trace_Export() to
+ *          trace-<strategy>.json in the current directory and checked: the
+ *          JSON must be well-formed, every B record must be closed by an E
+ *          record of the same name on its timeline row, timestamps must not
+ *          decrease, every event must be delivered and the run must show the
+ *          drain spans of its strategy.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 -DTCA8418_TRACE=1 tracesim.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c -o tracesim
+ *          Usage: tracesim [busHz]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tca8418.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_TRACE
+#error "tracesim needs TCA8418_TRACE=1"
+#endif
+#if !TCA8418_FEATURE_RING || !TCA8418_FEATURE_DEFERRED
+#error "tracesim needs the event ring and the deferred drain"
+#endif
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Size of the exported JSON kept in memory */
+#define JSON_SIZE       65536U
+
+/* Deepest nesting of spans on one timeline row */
+#define SPAN_DEPTH      8
+
+/* Timeline rows, numbered from 1 as tid in the export */
+#define TRACKS          4
+
+/* Longest activity name */
+#define NAME_LENGTH     32
+
+/**
+ * @brief Call made by the EXTI callback
+ */
+typedef enum {
+    EXTI_DEFER = 0,     //< TCA8418_IRQHandler(), the drain runs in PendSV
+    EXTI_READ,          //< TCA8418_ReadKeyEvents()
+    EXTI_SERVICE        //< TCA8418_ServiceInterrupt()
+} ExtiCall;
+
+/**
+ * @brief Drain under trace
+ */
+typedef struct {
+    const char *name;                   //< Name in the table and the file name
+    TCA8418_DrainStrategy strategy;     //< Strategy set with TCA8418_SetDrainStrategy()
+    ExtiCall exti;                      //< Call made by the EXTI callback
+} Drain;
+
+static const Drain drains[] = {
+    { "exti-per-register",     TCA8418_DRAIN_PER_REGISTER, EXTI_READ },
+    { "exti-burst",            TCA8418_DRAIN_BURST,        EXTI_READ },
+    { "exti-service-burst",    TCA8418_DRAIN_BURST,        EXTI_SERVICE },
+    { "deferred-per-register", TCA8418_DRAIN_PER_REGISTER, EXTI_DEFER },
+    { "deferred-burst",        TCA8418_DRAIN_BURST,        EXTI_DEFER },
+    { "deferred-it",           TCA8418_DRAIN_IT,           EXTI_DEFER },
+    { "deferred-dma",          TCA8418_DRAIN_DMA,          EXTI_DEFER },
+};
+
+/* Events of each burst */
+static const uint8_t bursts[] = { 1, 4, 8 };
+
+/**
+ * @brief Records found in an export
+ */
+typedef struct {
+    uint32_t records;       //< B, E and instant records
+    uint32_t spans;         //< Closed B and E pairs
+    uint32_t drains;        //< Closed drain spans
+    uint32_t drainsInIsr;   //< Drain spans opened within an EXTI handler span
+    uint32_t deferred;      //< Closed deferred handler spans
+} TraceSummary;
+
+/* Drain of the current run, read by the EXTI callback */
+static const Drain *drain;
+
+/* Events drained by TCA8418_ReadKeyEvents() from the EXTI callback, not yet taken */
+static uint8_t extiEvents[TCA8418_RING_SIZE];
+static uint8_t extiCount;
+
+/* Exported JSON */
+static char json[JSON_SIZE + 1];
+static uint32_t jsonLength;
+static uint8_t jsonOverflow;
+
+void HAL_GPIO_EXTI_Callback(uint16_t pin){
+    uint8_t events[TCA8418_FIFO_DEPTH];
+    uint8_t numEvents = 0;
+    if(pin != TCA8418_INT_Pin){
+        return;
+    }
+    if(drain->exti == EXTI_DEFER){
+        TCA8418_IRQHandler();
+        return;
+    }
+    if(drain->exti == EXTI_SERVICE){
+        (void)TCA8418_ServiceInterrupt();
+        return;
+    }
+    (void)TCA8418_ReadKeyEvents(events, &numEvents);
+    for(uint8_t i = 0; (i < numEvents) && (extiCount < sizeof(extiEvents)); i++){
+        extiEvents[extiCount++] = events[i];
+    }
+}
+
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemRxCpltCallback(hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_MemTxCpltCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    TCA8418_I2C_ErrorCallback(hi2c);
+}
+
+/**
+ * @brief Sink of TCA8418_Trace_Export(), appends to the JSON buffer
+ */
+static void JsonWrite(const char *text, uint16_t length){
+    if(jsonLength + length > JSON_SIZE){
+        jsonOverflow = 1;
+        return;
+    }
+    memcpy(&json[jsonLength], text, length);
+    jsonLength += length;
+    json[jsonLength] = '\0';
+}
+
+/**
+ * @brief Skip white space
+ */
+static const char *JsonSpace(const char *p){
+    while((*p == ' ') || (*p == '\n') || (*p == '\r') || (*p == '\t')){
+        p++;
+    }
+    return p;
+}
+
+static const char *JsonValue(const char *p, uint8_t depth);
+
+/**
+ * @brief Parse a string
+ * @return const char* Text after the string, NULL if malformed
+ */
+static const char *JsonString(const char *p){
+    if(*p++ != '"'){
+        return NULL;
+    }
+    while(*p != '"'){
+        if((unsigned char)*p < 0x20){
+            return NULL;
+        }
+        if(*p == '\\'){
+            p++;
+            if((*p == '\0') || (strchr("\"\\/bfnrtu", *p) == NULL)){
+                return NULL;
+            }
+        }
+        p++;
+    }
+    return p + 1;
+}
+
+/**
+ * @brief Parse a number
+ * @return const char* Text after the number, NULL if malformed
+ */
+static const char *JsonNumber(const char *p){
+    const char *start;
+    if(*p == '-'){
+        p++;
+    }
+    start = p;
+    while((*p >= '0') && (*p <= '9')){
+        p++;
+    }
+    if((p == start) || ((*start == '0') && (p - start > 1))){
+        return NULL;
+    }
+    if(*p == '.'){
+        start = ++p;
+        while((*p >= '0') && (*p <= '9')){
+            p++;
+        }
+        if(p == start){
+            return NULL;
+        }
+    }
+    return p;
+}
+
+/**
+ * @brief Parse the members of an object or the elements of an array
+ * @param close '}' or ']'
+ * @return const char* Text after the closing bracket, NULL if malformed
+ */
+static const char *JsonContainer(const char *p, char close, uint8_t depth){
+    p = JsonSpace(p + 1);
+    if(*p == close){
+        return p + 1;
+    }
+    for(;;){
+        if(close == '}'){
+            p = JsonString(p);
+            if(p == NULL){
+                return NULL;
+            }
+            p = JsonSpace(p);
+            if(*p++ != ':'){
+                return NULL;
+            }
+        }
+        p = JsonValue(JsonSpace(p), depth);
+        if(p == NULL){
+            return NULL;
+        }
+        p = JsonSpace(p);
+        if(*p == close){
+            return p + 1;
+        }
+        if(*p++ != ','){
+            return NULL;
+        }
+        p = JsonSpace(p);
+    }
+}
+
+/**
+ * @brief Parse a value
+ * @param depth Nesting of the value
+ * @return const char* Text after the value, NULL if malformed
+ */
+static const char *JsonValue(const char *p, uint8_t depth){
+    if(depth > 16){
+        return NULL;
+    }
+    switch(*p){
+    case '{':
+        return JsonContainer(p, '}', (uint8_t)(depth + 1));
+    case '[':
+        return JsonContainer(p, ']', (uint8_t)(depth + 1));
+    case '"':
+        return JsonString(p);
+    case 't':
+        return (strncmp(p, "true", 4) == 0) ? p + 4 : NULL;
+    case 'f':
+        return (strncmp(p, "false", 5) == 0) ? p + 5 : NULL;
+    case 'n':
+        return (strncmp(p, "null", 4) == 0) ? p + 4 : NULL;
+    default:
+        return JsonNumber(p);
+    }
+}
+
+/**
+ * @brief Copy the string value of a member found on a record line
+ * @return int 0 if found, otherwise 1
+ */
+static int RecordString(const char *line, const char *key, char *value, size_t size){
+    const char *p = strstr(line, key);
+    size_t length = 0;
+    if(p == NULL){
+        return 1;
+    }
+    p += strlen(key);
+    while((*p != '"') && (*p != '\0') && (length + 1 < size)){
+        value[length++] = *p++;
+    }
+    value[length] = '\0';
+    return (*p == '"') ? 0 : 1;
+}
+
+/**
+ * @brief Check the exported JSON of a run
+ * @param summary Records found
+ * @return int Errors found
+ */
+static int CheckTrace(TraceSummary *summary){
+    char stacks[TRACKS][SPAN_DEPTH][NAME_LENGTH];
+    uint8_t depth[TRACKS] = { 0 };
+    uint64_t lastNs = 0;
+    int errors = 0;
+    const char *p;
+    memset(summary, 0, sizeof(*summary));
+    if(jsonOverflow){
+        fprintf(stderr, "export larger than %u bytes\n", JSON_SIZE);
+        return 1;
+    }
+    p = JsonValue(JsonSpace(json), 0);
+    if((p == NULL) || (*JsonSpace(p) != '\0')){
+        fprintf(stderr, "malformed JSON at byte %ld\n", (p == NULL) ? -1L : (long)(p - json));
+        return 1;
+    }
+    /* The export writes one record per line */
+    for(p = strchr(json, '\n'); p != NULL; p = strchr(p + 1, '\n')){
+        const char *line = p + 1;
+        char name[NAME_LENGTH];
+        char phase[2];
+        const char *ts = strstr(line, "\"ts\":");
+        const char *tid = strstr(line, "\"tid\":");
+        const char *next = strchr(line, '\n');
+        unsigned long us;
+        unsigned long ns;
+        unsigned track;
+        uint64_t at;
+        if((ts == NULL) || ((next != NULL) && (ts > next))){
+            continue;
+        }
+        if(RecordString(line, "\"name\":\"", name, sizeof(name)) || RecordString(line, "\"ph\":\"", phase, sizeof(phase)) ||
+           (tid == NULL) || (sscanf(ts, "\"ts\":%lu.%3lu", &us, &ns) != 2) || (sscanf(tid, "\"tid\":%u", &track) != 1) ||
+           (track < 1) || (track > TRACKS)){
+            fprintf(stderr, "unreadable record: %.*s\n", (int)((next != NULL) ? next - line : (long)strlen(line)), line);
+            errors++;
+            continue;
+        }
+        summary->records++;
+        at = (uint64_t)us * 1000U + ns;
+        if(at < lastNs){
+            fprintf(stderr, "%s at %lu.%03lu us after a record at %lu.%03lu us\n", name, us, ns,
+                    (unsigned long)(lastNs / 1000U), (unsigned long)(lastNs % 1000U));
+            errors++;
+        }
+        lastNs = at;
+        track--;
+        if(phase[0] == 'B'){
+            if(depth[track] == SPAN_DEPTH){
+                fprintf(stderr, "%s nested deeper than %u spans\n", name, SPAN_DEPTH);
+                errors++;
+                continue;
+            }
+            if(strcmp(name, "Drain") == 0){
+                for(uint8_t i = 0; i < depth[0]; i++){
+                    if(strcmp(stacks[0][i], "EXTI handler") == 0){
+                        summary->drainsInIsr++;
+                        break;
+                    }
+                }
+            }
+            strcpy(stacks[track][depth[track]++], name);
+        } else if(phase[0] == 'E'){
+            if((depth[track] == 0) || (strcmp(stacks[track][depth[track] - 1], name) != 0)){
+                fprintf(stderr, "%s ends at %lu.%03lu us on row %u without its begin\n", name, us, ns, track + 1U);
+                errors++;
+                continue;
+            }
+            depth[track]--;
+            summary->spans++;
+            summary->drains += (strcmp(name, "Drain") == 0) ? 1U : 0U;
+            summary->deferred += (strcmp(name, "Deferred handler") == 0) ? 1U : 0U;
+        } else if(phase[0] != 'i'){
+            fprintf(stderr, "%s has phase %s\n", name, phase);
+            errors++;
+        }
+    }
+    for(uint8_t track = 0; track < TRACKS; track++){
+        for(uint8_t i = 0; i < depth[track]; i++){
+            fprintf(stderr, "%s on row %u never ends\n", stacks[track][i], track + 1U);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/**
+ * @brief Take the events drained so far and trace their handling
+ * @return uint8_t Events taken
+ */
+static uint8_t Consume(void){
+    uint8_t events[TCA8418_RING_SIZE];
+    uint8_t numEvents = 0;
+    if(drain->exti == EXTI_READ){
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        numEvents = extiCount;
+        memcpy(events, extiEvents, numEvents);
+        extiCount = 0;
+        __set_PRIMASK(primask);
+    } else {
+        (void)TCA8418_PopEvents(events, sizeof(events), &numEvents);
+    }
+    if(numEvents > 0){
+        TCA8418_TRACE_BEGIN(TCA8418_TRACE_CONSUMER, 0, numEvents);
+        TCA8418Sim_Run(US(20));
+        TCA8418_TRACE_END(TCA8418_TRACE_CONSUMER, 0, numEvents);
+    }
+    return numEvents;
+}
+
+/**
+ * @brief Trace the bursts with one drain and check the export
+ * @return int 0 if the export passed every check, otherwise 1
+ */
+static int Run(uint32_t busHz, const Drain *run){
+    TraceSummary summary;
+    char path[64];
+    FILE *file;
+    uint32_t expected = 0;
+    uint32_t received = 0;
+    int errors;
+    drain = run;
+    extiCount = 0;
+    TCA8418Sim_Reset(busHz);
+    if((TCA8418_Init() != HAL_OK) || (TCA8418_SetDrainStrategy(run->strategy) != HAL_OK)){
+        fprintf(stderr, "%s: initialization failed\n", run->name);
+        return 1;
+    }
+    /* Events left from the previous run */
+    while(Consume() > 0){
+    }
+    TCA8418_Trace_Clear();
+    for(uint8_t b = 0; b < sizeof(bursts); b++){
+        uint64_t now = TCA8418Sim_Now();
+        for(uint8_t i = 0; i < bursts[b]; i++){
+            (void)TCA8418Sim_Key(now + US(100) + i, (uint8_t)(((i & 1U) ? 0x00 : 0x80) | (b + 1U)));
+        }
+        expected += bursts[b];
+        for(uint8_t ms = 0; ms < 3; ms++){
+            TCA8418Sim_Run(US(1000));
+            received += Consume();
+        }
+    }
+    jsonLength = 0;
+    jsonOverflow = 0;
+    TCA8418_Trace_Export(JsonWrite, TCA8418SIM_CPU_HZ / 1000000U);
+    errors = CheckTrace(&summary);
+    if(received != expected){
+        fprintf(stderr, "%s: %lu of %lu events delivered\n", run->name, (unsigned long)received, (unsigned long)expected);
+        errors++;
+    }
+    if(summary.records >= TCA8418_TRACE_DEPTH){
+        fprintf(stderr, "%s: %lu records, the oldest may be lost\n", run->name, (unsigned long)summary.records);
+        errors++;
+    }
+    if((summary.drains < sizeof(bursts)) || ((run->exti != EXTI_DEFER) && (summary.drainsInIsr != summary.drains)) ||
+       ((run->exti == EXTI_DEFER) && ((summary.drainsInIsr != 0) || (summary.deferred == 0)))){
+        fprintf(stderr, "%s: %lu drains, %lu within the EXTI handler, %lu deferred handler runs\n", run->name,
+                (unsigned long)summary.drains, (unsigned long)summary.drainsInIsr, (unsigned long)summary.deferred);
+        errors++;
+    }
+    snprintf(path, sizeof(path), "trace-%s.json", run->name);
+    file = fopen(path, "w");
+    if((file == NULL) || (fwrite(json, 1, jsonLength, file) != jsonLength)){
+        fprintf(stderr, "%s: cannot write %s\n", run->name, path);
+        errors++;
+    }
+    if(file != NULL){
+        fclose(file);
+    }
+    printf("%-22s %7lu %6lu %6lu %8lu %6lu  %s%s\n", run->name, (unsigned long)summary.records, (unsigned long)summary.spans,
+           (unsigned long)summary.drains, (unsigned long)summary.drainsInIsr, (unsigned long)received, path,
+           (errors != 0) ? " FAIL" : "");
+    return (errors != 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t busHz = 400000;
+    int result = 0;
+    if(argc > 1){
+        busHz = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if((argc > 2) || (busHz == 0)){
+        fprintf(stderr, "usage: tracesim [busHz]\n");
+        return 1;
+    }
+    printf("%lu Hz, bursts of 1, 4 and 8 events\n", (unsigned long)busHz);
+    printf("%-22s %7s %6s %6s %8s %6s  %s\n", "drain", "records", "spans", "drains", "in EXTI", "events", "file");
+    for(uint8_t d = 0; d < sizeof(drains) / sizeof(drains[0]); d++){
+        result |= Run(busHz, &drains[d]);
+    }
+    return result;
+}
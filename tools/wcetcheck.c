@@ -0,0 +1,212 @@
+/**
+ * @file wcetcheck.c
+ * @brief Check of the execution time bounds of tca8418_wcet.h against the simulator
+ * @details Runs every function modeled by TCA8418_Wcet_Bound() on its longest
+ *          path in the simulator of tools/sim and compares the simulated time
+ *          with the nominal bound, at 100 kHz, 400 kHz and 1 MHz, with per-register
+ *          and burst drains. The paths are a full FIFO for the drains, outputs in
+ *          every GPIO byte for the output functions, a ring filled until flow
+ *          control holds events in the FIFO for TCA8418_PopEvents(), an unplug
+ *          and plug for the TCA8418_PollPresence()
+ *          reattach and every probe speed passing for TCA8418_ProbeBus(), whose
+ *          speed changes go to hi2c1.
+ *          No EXTI callback is defined, so nothing drains behind the measured call,
+ *          and PendSV runs TCA8418_DeferredHandler() after a resumed drain is pended.
+ *          A measured time above its bound is a failure, and so is a function
+ *          whose bound has transactions but whose path took no time. Without
+ *          TCA8418_FEATURE_DEFERRED, TCA8418_PopEvents() resumes the held drain
+ *          itself, so build it both ways to cover that path.
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 wcetcheck.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c ../tca8418_wcet.c -o wcetcheck
+ *          Build: cc -O2 -I sim -I.. -DTCA8418_PROFILE=3 -DTCA8418_FEATURE_DEFERRED=0 wcetcheck.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c ../tca8418_wcet.c -o wcetcheck-nodefer
+ *          Usage: wcetcheck
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tca8418.h"
+#include "tca8418_wcet.h"
+#include "tca8418sim.h"
+
+#if !TCA8418_FEATURE_MODELS || !TCA8418_FEATURE_OUTPUTS || !TCA8418_FEATURE_HOTPLUG || !TCA8418_FEATURE_PROBE || \
+    !TCA8418_FEATURE_DIAG || !TCA8418_FEATURE_RING
+#error "wcetcheck needs the full profile"
+#endif
+
+/* Bus speeds checked */
+static const uint32_t busSpeeds[] = { 100000, 400000, 1000000 };
+
+/* Speeds of TCA8418_ProbeBus() */
+static const uint32_t probeSpeeds[] = { TCA8418_PROBE_SPEEDS };
+
+/* Simulated time of each modeled function in cycles */
+static uint64_t measured[TCA8418_WCET_COUNT];
+
+/**
+ * @brief Set hi2c1 to a new speed, the simulator times the next transactions with it
+ */
+HAL_StatusTypeDef TCA8418_SetBusSpeed(uint32_t hz){
+    hi2c1.Init.ClockSpeed = hz;
+    return HAL_OK;
+}
+
+#if TCA8418_FEATURE_DEFERRED
+void PendSV_Handler(void){
+    (void)TCA8418_DeferredHandler();
+}
+#endif
+
+/**
+ * @brief Fill the simulated FIFO with presses and releases
+ * @param count Events to add
+ */
+static void FillFifo(uint8_t count){
+    uint64_t now = TCA8418Sim_Now();
+    for(uint8_t i = 0; i < count; i++){
+        (void)TCA8418Sim_Key(now + 1U + i, (uint8_t)(((i & 1U) ? 0x00 : 0x80) | (1U + i / 2U)));
+    }
+    TCA8418Sim_Run(count + 1U);
+}
+
+/**
+ * @brief Run one call and keep the longest simulated time of its function
+ */
+#define MEASURE(api, call)                                      \
+    do{                                                         \
+        uint64_t start = TCA8418Sim_Now();                      \
+        HAL_StatusTypeDef status = (call);                      \
+        uint64_t cycles = TCA8418Sim_Now() - start;             \
+        if(status != HAL_OK){                                   \
+            printf("%s returned %d\n", #call, (int)status);      \
+            failed++;                                           \
+        }                                                       \
+        if(cycles > measured[api]){                             \
+            measured[api] = cycles;                             \
+        }                                                       \
+    }while(0)
+
+/**
+ * @brief Run every modeled function on its longest path
+ * @param busHz Bus speed
+ * @param strategy Drain strategy
+ * @return int Calls that failed
+ */
+static int Measure(uint32_t busHz, TCA8418_DrainStrategy strategy){
+    uint8_t events[TCA8418_RING_SIZE];
+    uint8_t numEvents;
+    TCA8418_MatrixDiag diag;
+    TCA8418_BusProbe probe;
+    TCA8418_FlowStats flow;
+    uint32_t engaged;
+    uint32_t outputs;
+    int failed = 0;
+    for(uint8_t i = 0; i < TCA8418_WCET_COUNT; i++){
+        measured[i] = 0;
+    }
+    TCA8418Sim_Reset(busHz);
+    MEASURE(TCA8418_WCET_INIT, TCA8418_Init());
+    (void)TCA8418_SetDrainStrategy(strategy);
+    /* Every pin the keypad leaves free in KP_GPIO1 to KP_GPIO3 becomes an output */
+    outputs = ~((uint32_t)TCA8418Sim_Register(0x1D) | ((uint32_t)TCA8418Sim_Register(0x1E) << 8) |
+                ((uint32_t)TCA8418Sim_Register(0x1F) << 16)) & ((1UL << TCA8418_DIAG_PINS) - 1U);
+
+    FillFifo(TCA8418_FIFO_DEPTH);
+    MEASURE(TCA8418_WCET_READ_KEY_EVENTS, TCA8418_ReadKeyEvents(events, &numEvents));
+    FillFifo(TCA8418_FIFO_DEPTH);
+    MEASURE(TCA8418_WCET_SERVICE_INTERRUPT, TCA8418_ServiceInterrupt());
+    /* Fill the ring until a drain is throttled with events held in the FIFO, then free it */
+    TCA8418_GetFlowStats(&flow);
+    engaged = flow.backpressureEngaged;
+    while(TCA8418_PendingEvents() + TCA8418_FIFO_DEPTH <= TCA8418_RING_SIZE){
+        FillFifo(TCA8418_FIFO_DEPTH);
+        (void)TCA8418_ServiceInterrupt();
+    }
+    FillFifo(TCA8418_FIFO_DEPTH);
+    (void)TCA8418_ServiceInterrupt();
+    TCA8418_GetFlowStats(&flow);
+    if((flow.backpressureEngaged == engaged) || (TCA8418Sim_FifoCount() == 0)){
+        printf("ring full without flow control holding events\n");
+        failed++;
+    }
+    MEASURE(TCA8418_WCET_POP_EVENTS, TCA8418_PopEvents(events, sizeof(events), &numEvents));
+    /* The resumed drain moves the held events into the ring, from PendSV when deferred */
+    TCA8418Sim_Run(1);
+    if((TCA8418_PendingEvents() == 0) || (TCA8418Sim_FifoCount() != 0)){
+        printf("PopEvents did not resume the drain\n");
+        failed++;
+    }
+    (void)TCA8418_PopEvents(events, sizeof(events), &numEvents);
+
+    MEASURE(TCA8418_WCET_LOCK_KEYPAD, TCA8418_LockKeypad());
+    MEASURE(TCA8418_WCET_LOCK_KEYPAD, TCA8418_UnlockKeypad());
+    MEASURE(TCA8418_WCET_SET_INTERRUPT_MODE, TCA8418_SetInterruptMode(TCA8418_INT_LATCHED));
+    MEASURE(TCA8418_WCET_MATRIX_DIAGNOSTIC, TCA8418_RunMatrixDiagnostic(&diag));
+
+    MEASURE(TCA8418_WCET_CONFIGURE_OUTPUTS, TCA8418_ConfigureOutputs(outputs, 0));
+    TCA8418_SetOutputs(outputs, outputs);
+    MEASURE(TCA8418_WCET_FLUSH_OUTPUTS, TCA8418_FlushOutputs(HAL_GetTick() + TCA8418_OUTPUT_FRAME_MS));
+
+    /* Unplug, let a transaction see it, report it, plug in and reattach */
+    TCA8418Sim_Attach(0);
+    (void)TCA8418_ReadKeyEvents(events, &numEvents);
+    (void)TCA8418_PollPresence(HAL_GetTick());
+    TCA8418Sim_Attach(1);
+    MEASURE(TCA8418_WCET_REATTACH, TCA8418_PollPresence(HAL_GetTick() + TCA8418_PRESENCE_PROBE_MS));
+    if(!TCA8418_IsPresent()){
+        printf("no reattach\n");
+        failed++;
+    }
+
+    /* The probe starts at the speed hi2c1 was initialized with */
+    TCA8418Sim_Reset(probeSpeeds[0]);
+    (void)TCA8418_Init();
+    MEASURE(TCA8418_WCET_PROBE_BUS, TCA8418_ProbeBus(&probe));
+    if(probe.tested != TCA8418_PROBE_SPEED_COUNT){
+        printf("probe tested %u speeds\n", probe.tested);
+        failed++;
+    }
+    return failed;
+}
+
+int main(void){
+    TCA8418_WcetConfig config = {
+        0, TCA8418SIM_CPU_HZ, TCA8418SIM_TRANSFER_CYCLES,
+        TCA8418_I2C_TIMEOUT, 25,
+        TCA8418_I2C_RETRIES, TCA8418_FIFO_DEPTH,
+        0, 1,                                   // Set per run, latched mode
+        TCA8418_FEATURE_DEFERRED,
+        probeSpeeds[0], TCA8418_PROBE_SPEED_COUNT, TCA8418_PROBE_ROUNDS
+    };
+    static const char *const names[TCA8418_WCET_COUNT] = {
+        "Init", "ReadKeyEvents", "ServiceInterrupt/pass", "Lock/UnlockKeypad", "SetInterruptMode",
+        "RunMatrixDiagnostic", "ConfigureOutputs", "FlushOutputs", "PollPresence/reattach", "PopEvents/resume",
+        "ProbeBus"
+    };
+    int failed = 0;
+    for(uint8_t perRegister = 1; perRegister <= 1; perRegister--){
+        config.perRegister = perRegister;
+        for(uint8_t s = 0; s < sizeof(busSpeeds) / sizeof(busSpeeds[0]); s++){
+            config.busHz = busSpeeds[s];
+            failed += Measure(busSpeeds[s], perRegister ? TCA8418_DRAIN_PER_REGISTER : TCA8418_DRAIN_BURST);
+            printf("\n%lu Hz, %s drain\n%-22s %6s %10s %10s %6s\n", (unsigned long)busSpeeds[s],
+                   perRegister ? "per-register" : "burst", "function", "xfers", "bound us", "sim us", "used");
+            for(uint8_t api = 0; api < TCA8418_WCET_COUNT; api++){
+                TCA8418_WcetBound bound;
+                double us = (double)measured[api] / (TCA8418SIM_CPU_HZ / 1000000U);
+                TCA8418_Wcet_Bound((TCA8418_WcetApi)api, &config, &bound);
+                uint8_t notRun = (bound.transactions > 0) && (measured[api] == 0);
+                printf("%-22s %6u %10lu %10.1f %5.0f%%%s\n", names[api], bound.transactions,
+                       (unsigned long)bound.nominalUs, us, (bound.nominalUs > 0) ? 100.0 * us / bound.nominalUs : 0.0,
+                       (us > bound.nominalUs) ? " FAIL" : (notRun ? " NOT RUN" : ""));
+                if((us > bound.nominalUs) || notRun){
+                    failed++;
+                }
+            }
+        }
+    }
+    printf("\n%d failed\n", failed);
+    return (failed != 0) ? 1 : 0;
+}
@@ -0,0 +1,393 @@
+/**
+ * @file wearbench.c
+ * @brief Host test and benchmark of the key press counters of tca8418_wear.h
+ * @details Runs the counters against a simulated flash held in RAM. Programming
+ *          only clears bits and, as on STM32 flash, is refused on a record that
+ *          is not erased unless every bit is cleared. The simulation injects:
+ *          - program failures: one program fails, either without touching the
+ *            record or after tearing it, optionally together with the program
+ *            that marks the slot bad. Saving is retried and the counts rebuilt
+ *            at boot must equal the counts in RAM.
+ *          - power losses: every flash operation in turn is torn and all later
+ *            ones fail. The counts rebuilt at boot must lie between the counts
+ *            of the last completed save and the counts in RAM, and counting
+ *            must go on from there.
+ *          It then prints the time per counted event, the time of a save and of
+ *          the rebuild at boot, and the flash programs and erases per 1000 presses.
+ *          Build: cc -O2 -I.. -DTCA8418_PROFILE=3 wearbench.c ../tca8418_wear.c -o wearbench
+ *          Usage: wearbench [presses]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tca8418_wear.h"
+
+/* Simulated flash geometry */
+#define SECTOR_SIZE     2048
+#define NUM_SECTORS     4
+
+/* Save policy of the runs */
+#define THRESHOLD       64
+#define IDLE_MS         5000
+
+/* Largest batch, the TCA8418 FIFO depth */
+#define BATCH_MAX       10
+
+/* Presses of each fault injection run */
+#define FAULT_PRESSES   3000
+
+/* Saves tried before a run gives up */
+#define RETRIES_MAX     8
+
+/**
+ * @brief Fault injected by the simulated flash
+ */
+typedef enum {
+    FAULT_NONE,         //< Every operation succeeds
+    FAULT_UNTOUCHED,    //< Program failAt fails without touching the record
+    FAULT_TORN,         //< Program failAt fails after programming half of the record
+    FAULT_UNMARKED,     //< Program failAt and the next one fail without touching their records
+    FAULT_POWER,        //< Operation failAt is torn and every later one fails
+    FAULT_COUNT
+} Fault;
+
+static const char *const faultNames[FAULT_COUNT] = { "none", "untouched", "torn", "unmarked", "power loss" };
+
+/* Simulated flash and its counters */
+static uint8_t flashMemory[NUM_SECTORS * SECTOR_SIZE];
+static Fault fault;
+static uint32_t failAt;
+static uint32_t programs;
+static uint32_t erases;
+static uint32_t operations;
+static uint32_t reads;
+
+/**
+ * @brief Check whether the injected fault hits the current operation
+ * @param isProgram 1 for a program, 0 for an erase
+ * @return int 0 if the operation succeeds, 1 if it is torn, 2 if it has no effect
+ */
+static int Flash_Fault(uint8_t isProgram){
+    uint32_t operation = operations++;
+    uint32_t program = isProgram ? programs++ : UINT32_MAX;
+    switch(fault){
+    case FAULT_UNTOUCHED:
+        return (program == failAt) ? 2 : 0;
+    case FAULT_TORN:
+        return (program == failAt) ? 1 : 0;
+    case FAULT_UNMARKED:
+        return ((program == failAt) || (program == failAt + 1)) ? 2 : 0;
+    case FAULT_POWER:
+        return (operation == failAt) ? 1 : ((operation > failAt) ? 2 : 0);
+    default:
+        return 0;
+    }
+}
+
+static int Flash_Read(uint32_t address, void *data, uint32_t length){
+    memcpy(data, &flashMemory[address], length);
+    reads++;
+    return 0;
+}
+
+static int Flash_Program(uint32_t address, const void *data, uint32_t length){
+    const uint8_t *bytes = data;
+    uint8_t erased = 1;
+    uint8_t zero = 1;
+    int hit = Flash_Fault(1);
+    for(uint32_t i = 0; i < length; i++){
+        erased &= (flashMemory[address + i] == 0xFF);
+        zero &= (bytes[i] == 0x00);
+    }
+    if(hit == 2){
+        return -1;
+    }
+    if(!erased && !zero){
+        return -2; // Programming error
+    }
+    for(uint32_t i = 0; i < ((hit == 1) ? length / 2 : length); i++){
+        flashMemory[address + i] &= bytes[i];
+    }
+    return (hit == 1) ? -1 : 0;
+}
+
+static int Flash_Erase(uint8_t sector){
+    int hit = Flash_Fault(0);
+    if(hit == 2){
+        return -1;
+    }
+    erases++;
+    memset(&flashMemory[(uint32_t)sector * SECTOR_SIZE], 0xFF, (hit == 1) ? SECTOR_SIZE / 2 : SECTOR_SIZE);
+    return (hit == 1) ? -1 : 0;
+}
+
+static const TCA8418_WearFlash flash = { SECTOR_SIZE, NUM_SECTORS, Flash_Read, Flash_Program, Flash_Erase };
+
+/**
+ * @brief Reset the simulated flash to erased and select the fault
+ */
+static void Flash_Reset(Fault newFault, uint32_t newFailAt){
+    memset(flashMemory, 0xFF, sizeof(flashMemory));
+    fault = newFault;
+    failAt = newFailAt;
+    programs = 0;
+    erases = 0;
+    operations = 0;
+    reads = 0;
+}
+
+/**
+ * @brief Produce one drained batch of press and release pairs
+ * @param seed Random state
+ * @param events Pointer to store the events
+ * @param presses Pointer to the number of presses, incremented
+ * @return uint8_t Number of events
+ */
+static uint8_t Batch(uint32_t *seed, uint8_t *events, uint32_t *presses){
+    uint8_t count;
+    *seed = *seed * 1664525U + 1013904223U;
+    count = (uint8_t)(2U * (1U + ((*seed >> 8) % (BATCH_MAX / 2))));
+    for(uint8_t i = 0; i < count; i += 2){
+        /* A few keys take most presses, as on a real keypad */
+        uint8_t key = (uint8_t)(((*seed >> (10 + i)) & 3U) ? (1U + ((*seed >> (12 + i)) % 8U)) :
+                                                             (1U + ((*seed >> (14 + i)) % 80U)));
+        events[i] = (uint8_t)(0x80 | key);
+        events[i + 1] = key;
+    }
+    *presses += count / 2U;
+    return count;
+}
+
+/**
+ * @brief Compare the counts of two states
+ * @return int 0 if every count is equal
+ */
+static int Compare(const TCA8418_Wear *a, const TCA8418_Wear *b){
+    for(uint8_t key = 0; key < TCA8418_WEAR_KEYS; key++){
+        if(TCA8418_Wear_Count(a, key) != TCA8418_Wear_Count(b, key)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Count presses with saves on threshold and idle time, then save the rest
+ * @param wear Counter state
+ * @param presses Presses to count
+ * @param saved Pointer to store the counts of the last completed save, may be NULL
+ * @return int 0 if the last save completed
+ */
+static int Run(TCA8418_Wear *wear, uint32_t presses, TCA8418_Wear *saved){
+    uint8_t events[BATCH_MAX];
+    uint32_t seed = 1;
+    uint32_t count = 0;
+    uint32_t tick = 0;
+    int result = 0;
+    while(count < presses){
+        uint8_t numEvents = Batch(&seed, events, &count);
+        tick += 5U + ((seed >> 20) % ((seed & 0x100U) ? 8000U : 300U));
+        TCA8418_Wear_ProcessEvents(wear, events, numEvents, tick);
+        if((TCA8418_Wear_Poll(wear, tick) == 0) && (wear->pendingTotal == 0) && (saved != NULL)){
+            *saved = *wear;
+        }
+    }
+    for(uint8_t i = 0; i < RETRIES_MAX; i++){
+        result = TCA8418_Wear_Flush(wear);
+        if(result == 0){
+            if(saved != NULL){
+                *saved = *wear;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Run every program of a workload once with a failing program
+ * @param mode Program fault
+ * @param numPrograms Programs of the workload without faults
+ * @return int Failed runs
+ */
+static int ProgramFaults(Fault mode, uint32_t numPrograms){
+    static TCA8418_Wear wear;
+    static TCA8418_Wear rebuilt;
+    int failed = 0;
+    for(uint32_t k = 0; k < numPrograms; k++){
+        Flash_Reset(mode, k);
+        int result = -1;
+        /* The failing programs may be the header written by the first boots */
+        for(uint8_t i = 0; (i < RETRIES_MAX) && (result != 0); i++){
+            result = TCA8418_Wear_Init(&wear, &flash, THRESHOLD, IDLE_MS);
+        }
+        if((result != 0) || (Run(&wear, FAULT_PRESSES, NULL) != 0) ||
+           (TCA8418_Wear_Init(&rebuilt, &flash, THRESHOLD, IDLE_MS) != 0) || (Compare(&wear, &rebuilt) != 0)){
+            if(failed == 0){
+                printf("  %s: program %lu, counts lost\n", faultNames[mode], (unsigned long)k);
+            }
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/**
+ * @brief Cut the power at every flash operation of a workload in turn
+ * @param numOperations Operations of the workload without faults
+ * @return int Failed runs
+ */
+static int PowerLosses(uint32_t numOperations){
+    static TCA8418_Wear wear;
+    static TCA8418_Wear saved;
+    static TCA8418_Wear rebuilt;
+    int failed = 0;
+    for(uint32_t k = 0; k < numOperations; k++){
+        uint8_t bad = 0;
+        Flash_Reset(FAULT_POWER, k);
+        memset(&saved, 0, sizeof(saved));
+        if(TCA8418_Wear_Init(&wear, &flash, THRESHOLD, IDLE_MS) == 0){
+            (void)Run(&wear, FAULT_PRESSES, &saved);
+        }
+        /* Power back, rebuild and keep counting */
+        fault = FAULT_NONE;
+        if(TCA8418_Wear_Init(&rebuilt, &flash, THRESHOLD, IDLE_MS) != 0){
+            bad = 1;
+        }
+        for(uint8_t key = 0; key < TCA8418_WEAR_KEYS; key++){
+            uint32_t count = TCA8418_Wear_Count(&rebuilt, key);
+            if((count < TCA8418_Wear_Count(&saved, key)) || (count > TCA8418_Wear_Count(&wear, key))){
+                bad = 1;
+            }
+        }
+        if((Run(&rebuilt, FAULT_PRESSES, NULL) != 0) || (TCA8418_Wear_Init(&wear, &flash, THRESHOLD, IDLE_MS) != 0) ||
+           (Compare(&wear, &rebuilt) != 0)){
+            bad = 1;
+        }
+        if(bad){
+            if(failed == 0){
+                printf("  power loss: operation %lu, counts out of range\n", (unsigned long)k);
+            }
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static uint64_t Now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Time counting, saving and rebuilding over a long workload
+ * @param presses Presses to count
+ * @return int 0 if the rebuilt counts match
+ */
+static int Benchmark(uint32_t presses){
+    static TCA8418_Wear wear;
+    static TCA8418_Wear rebuilt;
+    static uint8_t events[1024][BATCH_MAX];
+    static uint8_t numEvents[1024];
+    uint32_t seed = 1;
+    uint32_t count = 0;
+    uint32_t batches = 0;
+    uint64_t countNs = 0;
+    uint64_t saveNs = 0;
+    uint32_t saves = 0;
+    uint64_t start;
+    uint32_t tick = 0;
+    uint32_t bootReads;
+    uint64_t bootNs;
+    int failed;
+    Flash_Reset(FAULT_NONE, 0);
+    (void)TCA8418_Wear_Init(&wear, &flash, THRESHOLD, IDLE_MS);
+    programs = 0;
+    erases = 0;
+    while(count < presses){
+        /* Generate a block of batches first, so only the counting is timed */
+        uint16_t block = 0;
+        for(; (block < 1024) && (count < presses); block++){
+            numEvents[block] = Batch(&seed, events[block], &count);
+        }
+        start = Now();
+        for(uint16_t i = 0; i < block; i++){
+            TCA8418_Wear_ProcessEvents(&wear, events[i], numEvents[i], tick);
+            if(wear.pendingTotal >= THRESHOLD){
+                /* Saved outside the timed loop below */
+                countNs += Now() - start;
+                start = Now();
+                (void)TCA8418_Wear_Flush(&wear);
+                saveNs += Now() - start;
+                saves++;
+                start = Now();
+            }
+        }
+        countNs += Now() - start;
+        batches += block;
+        tick += 1000;
+    }
+    (void)TCA8418_Wear_Flush(&wear);
+    reads = 0;
+    start = Now();
+    (void)TCA8418_Wear_Init(&rebuilt, &flash, THRESHOLD, IDLE_MS);
+    bootNs = Now() - start;
+    bootReads = reads;
+    failed = Compare(&wear, &rebuilt);
+    printf("\n%lu presses in %lu batches, threshold %u, %u sectors of %u bytes\n", (unsigned long)count,
+           (unsigned long)batches, THRESHOLD, NUM_SECTORS, SECTOR_SIZE);
+    printf("count     %8.1f ns per event\n", (double)countNs / (2.0 * count));
+    printf("save      %8.1f ns per save, %lu saves\n", (double)saveNs / (saves ? saves : 1), (unsigned long)saves);
+    printf("boot      %8.1f us, %lu record reads\n", bootNs / 1000.0, (unsigned long)bootReads);
+    printf("flash     %8.1f programs, %.3f erases per 1000 presses\n", 1000.0 * programs / count,
+           1000.0 * erases / count);
+    if(failed){
+        printf("FAIL rebuilt counts differ\n");
+    }
+    return failed;
+}
+
+int main(int argc, char **argv){
+    static TCA8418_Wear wear;
+    uint32_t presses = 1000000;
+    uint32_t numPrograms;
+    uint32_t numOperations;
+    int failed = 0;
+    if(argc > 1){
+        presses = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if((argc > 2) || (presses == 0)){
+        fprintf(stderr, "usage: wearbench [presses]\n");
+        return 1;
+    }
+    /* Count the flash operations of the fault injection workload */
+    Flash_Reset(FAULT_NONE, 0);
+    (void)TCA8418_Wear_Init(&wear, &flash, THRESHOLD, IDLE_MS);
+    (void)Run(&wear, FAULT_PRESSES, NULL);
+    numPrograms = programs;
+    numOperations = operations;
+    printf("%u presses per run, %lu programs and %lu erases without faults\n", FAULT_PRESSES,
+           (unsigned long)numPrograms, (unsigned long)erases);
+    for(Fault mode = FAULT_UNTOUCHED; mode <= FAULT_UNMARKED; mode++){
+        int runFailed = ProgramFaults(mode, numPrograms);
+        printf("%-4s %-10s %5lu runs, %d failed\n", (runFailed == 0) ? "ok" : "FAIL", faultNames[mode],
+               (unsigned long)numPrograms, runFailed);
+        failed += runFailed;
+    }
+    {
+        int runFailed = PowerLosses(numOperations);
+        printf("%-4s %-10s %5lu runs, %d failed\n", (runFailed == 0) ? "ok" : "FAIL", faultNames[FAULT_POWER],
+               (unsigned long)numOperations, runFailed);
+        failed += runFailed;
+    }
+    failed += Benchmark(presses);
+    return (failed != 0) ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+/**
+ * @file xcorering.c
+ * @brief Two-thread test of the cross-core ring of tca8418_xcore.h on a Linux host
+ * @details A producer and a consumer thread stand in for the two cores. They
+ *          share one TCA8418_XCoreRing and only use the ring functions, with the
+ *          barriers of tools/sim/main.h. Two phases are run:
+ *          - Batches: the producer fills batches of 1 to 10 numbered events in
+ *            place as fast as the ring allows.
+ *          - Drain: the producer runs TCA8418_XCore_Drain() against the
+ *            simulator of tools/sim whenever INT is asserted. Keys arrive
+ *            slower than a drain and simulated time stands still while the
+ *            ring is full, so the chip FIFO never overflows.
+ *          The consumer sometimes pauses, so the ring fills up. It checks that
+ *          every event arrives exactly once and in order. Each phase prints the
+ *          batches, the waits on a full and on an empty ring, and the throughput.
+ *          Build: cc -O2 -pthread -I sim -I.. -DTCA8418_PROFILE=2 -DTCA8418_FEATURE_XCORE=1 xcorering.c sim/tca8418sim.c ../tca8418.c ../tca8418_trace.c ../tca8418_xcore.c -o xcorering
+ *          Usage: xcorering [batchEvents [drainEvents]]
+ * @author Cengiz Sinan Kostakoglu
+ * @version 1.0
+ * @date 2025-06-08
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tca8418_xcore.h"
+#include "tca8418sim.h"
+
+/* Microseconds to simulated cycles */
+#define US(us)  ((uint64_t)(us) * (TCA8418SIM_CPU_HZ / 1000000U))
+
+/* Key events scheduled ahead of the simulated time */
+#define KEYS_AHEAD  (TCA8418SIM_KEY_QUEUE / 2)
+
+static TCA8418_XCoreRing ring __ALIGNED(TCA8418_XCORE_CACHE_LINE);
+
+/**
+ * @brief Counters of one phase
+ */
+typedef struct {
+    uint32_t events;            //< Events to deliver
+    uint32_t batches;           //< Batches published
+    uint32_t fullWaits;         //< Producer retries on a full ring
+    uint32_t emptyWaits;        //< Consumer polls of an empty ring
+    uint32_t received;          //< Events taken by the consumer
+    uint32_t errors;            //< Events out of order
+} Phase;
+
+static Phase phase;
+static volatile uint8_t stop;   //< Set by the producer when events were lost and the consumer cannot finish
+
+/**
+ * @brief Event number n, press and release alternating over keys 1 to 80
+ */
+static uint8_t EventAt(uint32_t n){
+    return (uint8_t)((1U + ((n / 2U) % 80U)) | ((n & 1U) ? 0x00 : 0x80));
+}
+
+/**
+ * @brief Consumer core: take batches in place until every event arrived
+ */
+static void *Consumer(void *arg){
+    uint32_t seed = 7;
+    (void)arg;
+    while((phase.received < phase.events) && !stop){
+        TCA8418_XCoreBatch *batch = TCA8418_XCore_Peek(&ring);
+        if(batch == NULL){
+            phase.emptyWaits++;
+            sched_yield();
+            continue;
+        }
+        for(uint8_t i = 0; i < batch->numEvents; i++){
+            if(batch->keyEvents[i] != EventAt(phase.received)){
+                phase.errors++;
+            }
+            phase.received++;
+        }
+        TCA8418_XCore_Release(&ring);
+        /* Pause now and then so the producer finds the ring full */
+        seed = seed * 1664525U + 1013904223U;
+        if(((seed >> 8) % 64U) == 0){
+            for(volatile uint32_t spin = 0; spin < 20000U; spin++){
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Producer core, batches phase: fill numbered batches in place
+ */
+static void *ProduceBatches(void *arg){
+    uint32_t seed = 1;
+    uint32_t sent = 0;
+    (void)arg;
+    while(sent < phase.events){
+        TCA8418_XCoreBatch *batch = TCA8418_XCore_Reserve(&ring);
+        if(batch == NULL){
+            phase.fullWaits++;
+            sched_yield();
+            continue;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        uint8_t count = (uint8_t)(1U + ((seed >> 8) % TCA8418_FIFO_DEPTH));
+        if(count > phase.events - sent){
+            count = (uint8_t)(phase.events - sent);
+        }
+        for(uint8_t i = 0; i < count; i++){
+            batch->keyEvents[i] = EventAt(sent++);
+        }
+        batch->numEvents = count;
+        TCA8418_XCore_Commit(&ring);
+        phase.batches++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Producer core, drain phase: drain the simulated TCA8418 into the ring
+ */
+static void *ProduceDrains(void *arg){
+    const TCA8418Sim_Stats *stats = TCA8418Sim_GetStats();
+    uint32_t seed = 1;
+    uint32_t scheduled = 0;
+    uint64_t at = TCA8418Sim_Now();
+    (void)arg;
+    while((stats->eventsRead + stats->eventsLost) < phase.events){
+        /* Keep key events 100 to 1000 us apart scheduled ahead, slower than a drain */
+        while((scheduled < phase.events) && (scheduled - stats->eventsQueued - stats->eventsLost < KEYS_AHEAD)){
+            seed = seed * 1664525U + 1013904223U;
+            at += US(100U + ((seed >> 8) % 900U));
+            (void)TCA8418Sim_Key(at, EventAt(scheduled++));
+        }
+        if(!TCA8418Sim_IntAsserted()){
+            TCA8418Sim_Run(US(50));
+            continue;
+        }
+        uint32_t before = stats->eventsRead;
+        HAL_StatusTypeDef status = TCA8418_XCore_Drain(&ring);
+        if(status == HAL_BUSY){
+            phase.fullWaits++;
+            sched_yield();
+        }else if(stats->eventsRead != before){
+            phase.batches++;
+        }
+    }
+    if(stats->eventsLost != 0){
+        stop = 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run one phase with a producer and a consumer thread
+ * @return int 0 if every event arrived once and in order
+ */
+static int Run(const char *name, void *(*producer)(void *), uint32_t events){
+    pthread_t threads[2];
+    struct timespec start;
+    struct timespec end;
+    double seconds;
+    phase = (Phase){ .events = events };
+    stop = 0;
+    TCA8418_XCore_Init(&ring);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if((pthread_create(&threads[0], NULL, Consumer, NULL) != 0) ||
+       (pthread_create(&threads[1], NULL, producer, NULL) != 0)){
+        fprintf(stderr, "thread creation failed\n");
+        return 1;
+    }
+    pthread_join(threads[1], NULL);
+    pthread_join(threads[0], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-8s %10lu %10lu %10lu %12lu %12.0f\n", name, (unsigned long)phase.received, (unsigned long)phase.batches,
+           (unsigned long)phase.fullWaits, (unsigned long)phase.emptyWaits, phase.received / seconds);
+    if((phase.received != events) || (phase.errors != 0) || (TCA8418_XCore_Peek(&ring) != NULL)){
+        fprintf(stderr, "%s: %lu of %lu events, %lu out of order\n", name, (unsigned long)phase.received,
+                (unsigned long)events, (unsigned long)phase.errors);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv){
+    uint32_t batchEvents = 10000000;
+    uint32_t drainEvents = 200000;
+    int result = 0;
+    if(argc > 1){
+        batchEvents = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2){
+        drainEvents = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if((argc > 3) || (batchEvents == 0) || (drainEvents == 0)){
+        fprintf(stderr, "usage: xcorering [batchEvents [drainEvents]]\n");
+        return 1;
+    }
+    printf("%u slots of %u bytes\n", TCA8418_XCORE_SLOTS, (unsigned)sizeof(TCA8418_XCoreBatch));
+    printf("%-8s %10s %10s %10s %12s %12s\n", "phase", "events", "batches", "full", "empty polls", "events/s");
+    result |= Run("batches", ProduceBatches, batchEvents);
+    TCA8418Sim_Reset(400000);
+    if(TCA8418_Init() != HAL_OK){
+        fprintf(stderr, "initialization failed\n");
+        return 1;
+    }
+    result |= Run("drain", ProduceDrains, drainEvents);
+    if(TCA8418Sim_GetStats()->eventsLost != 0){
+        fprintf(stderr, "drain: %lu events lost in the chip\n", (unsigned long)TCA8418Sim_GetStats()->eventsLost);
+        result = 1;
+    }
+    return result;
+}